@@ -0,0 +1,296 @@
+#ifndef ARRAY_ARG_REDUCE_H
+#define ARRAY_ARG_REDUCE_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <immintrin.h>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "constants.hpp"
+#include "simd.hpp"
+
+namespace ArrayLibrary
+{
+    /// @brief Kernels of Array::argMax, Array::argMin, Array::topK and Array::findWhere on raw pointers. Float entries are processed eight at a time with compare-and-blend and left-packing, all other types by the scalar loops, which give the same results.
+    /// @details NaN entries never win a comparison, and a line in which no entry beats -infinity (for the maximum) gives index 0. Of equal entries, the one with the smallest index wins.
+    namespace ArgReduce
+    {
+        /// The entries of a kernel call above which Array splits its lines between the threads of ThreadPool::global
+        constexpr long CONCURRENCY_THRESHOLD = 0x10000;
+
+        /// @brief The value that every other entry replaces, so that the kernels do not need a first entry to start from
+        template <DataType T, bool MAX>
+        constexpr T worst()
+        {
+            if constexpr (std::numeric_limits<T>::has_infinity)
+                return MAX ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+            else
+                return MAX ? std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max();
+        }
+
+        template <DataType T, bool MAX>
+        inline bool beats(const T a, const T b) { return MAX ? a > b : a < b; }
+
+        template <bool MAX>
+        inline __m256 beatsMask(const __m256 a, const __m256 b) { return _mm256_cmp_ps(a, b, MAX ? _CMP_GT_OQ : _CMP_LT_OQ); }
+
+        /// @brief The index of the maximum (MAX) or minimum of length entries that are stride apart
+        template <DataType T, bool MAX>
+        long lineArg(const T *pData, const long length, const long stride)
+        {
+            if constexpr (std::is_same_v<T, float>)
+            {
+                // Lane l keeps the best of the entries l, l + 8, ..., with 32 bit indices
+                if (stride == 1 && length >= 8 && length <= std::numeric_limits<int32_t>::max())
+                {
+                    const __m256 fill = _mm256_set1_ps(worst<T, MAX>());
+                    __m256 best = fill;
+                    __m256i bestIndices = _mm256_setzero_si256(), indices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+                    const __m256i step = _mm256_set1_epi32(8);
+                    for (long i = 0; i < length; i += 8)
+                    {
+                        __m256 values;
+                        if (i + 8 <= length)
+                            values = _mm256_loadu_ps(pData + i);
+                        else
+                        {
+                            const __m256i mask = Simd::makeTypePrefixMask<float>(length - i);
+                            values = _mm256_blendv_ps(fill, _mm256_maskload_ps(pData + i, mask), _mm256_castsi256_ps(mask));
+                        }
+                        const __m256 better = beatsMask<MAX>(values, best);
+                        best = _mm256_blendv_ps(best, values, better);
+                        bestIndices = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(bestIndices), _mm256_castsi256_ps(indices), better));
+                        indices = _mm256_add_epi32(indices, step);
+                    }
+
+                    float laneValues[8];
+                    int32_t laneIndices[8];
+                    _mm256_storeu_ps(laneValues, best);
+                    _mm256_storeu_si256((__m256i *)laneIndices, bestIndices);
+                    long result = laneIndices[0];
+                    float value = laneValues[0];
+                    for (long l = 1; l < 8; l++)
+                        if (beats<T, MAX>(laneValues[l], value) || (laneValues[l] == value && laneIndices[l] < result))
+                        {
+                            value = laneValues[l];
+                            result = laneIndices[l];
+                        }
+                    return result;
+                }
+            }
+
+            T best = worst<T, MAX>();
+            long result = 0;
+            for (long i = 0; i < length; i++)
+                if (beats<T, MAX>(pData[i * stride], best))
+                {
+                    best = pData[i * stride];
+                    result = i;
+                }
+            return result;
+        }
+
+        /// @brief Like lineArg for columns lines at once, whose entries are stride apart and which start columnStride apart. The indices are written to pDest, destStride apart.
+        /// @details Contiguous float columns are compared COLUMN_VECTORS vectors at a time, so that the entries of a block are read row by row and every load serves eight lines.
+        template <DataType T, bool MAX>
+        void columnArgs(const T *pData, const long columns, const long columnStride, const long length, const long stride, long *pDest, const long destStride)
+        {
+            long column = 0;
+            if constexpr (std::is_same_v<T, float>)
+            {
+                constexpr long COLUMN_VECTORS = 4;
+                if (columnStride == 1 && length <= std::numeric_limits<int32_t>::max())
+                    while (column + 8 <= columns)
+                    {
+                        const long vectors = std::min(COLUMN_VECTORS, (columns - column) / 8);
+                        __m256 best[COLUMN_VECTORS];
+                        __m256i bestIndices[COLUMN_VECTORS];
+                        for (long v = 0; v < COLUMN_VECTORS; v++)
+                        {
+                            best[v] = _mm256_set1_ps(worst<T, MAX>());
+                            bestIndices[v] = _mm256_setzero_si256();
+                        }
+
+                        for (long i = 0; i < length; i++)
+                        {
+                            const __m256 index = _mm256_castsi256_ps(_mm256_set1_epi32(i));
+                            for (long v = 0; v < vectors; v++)
+                            {
+                                const __m256 values = _mm256_loadu_ps(pData + i * stride + column + 8 * v);
+                                const __m256 better = beatsMask<MAX>(values, best[v]);
+                                best[v] = _mm256_blendv_ps(best[v], values, better);
+                                bestIndices[v] = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(bestIndices[v]), index, better));
+                            }
+                        }
+
+                        for (long v = 0; v < vectors; v++)
+                        {
+                            int32_t indices[8];
+                            _mm256_storeu_si256((__m256i *)indices, bestIndices[v]);
+                            for (long l = 0; l < 8; l++)
+                                pDest[(column + 8 * v + l) * destStride] = indices[l];
+                        }
+                        column += 8 * vectors;
+                    }
+            }
+
+            for (; column < columns; column++)
+                pDest[column * destStride] = lineArg<T, MAX>(pData + column * columnStride, length, stride);
+        }
+
+        /// @brief Finds the k largest (LARGEST) or smallest of length entries that are stride apart and writes them in order, with their indices, to pValues and pIndices, whose entries are outputStride apart.
+        /// @details The candidates are kept in a heap whose root is the worst of them, and an entry only goes into the heap if it beats the root. Float entries are compared with the root eight at a time, so that for k much smaller than length almost all entries are discarded by one comparison per vector.
+        /// @param heap A buffer, so that repeated calls do not allocate
+        template <DataType T, bool LARGEST>
+        void lineTopK(const T *pData, const long length, const long stride, const long k, T *pValues, long *pIndices, const long outputStride, std::vector<std::pair<T, long>> &heap)
+        {
+            // NaN ranks below every number, and equal entries are ranked by their index
+            auto better = [](const std::pair<T, long> &a, const std::pair<T, long> &b)
+            {
+                if constexpr (std::is_floating_point_v<T>)
+                    if (std::isnan(a.first) || std::isnan(b.first))
+                        return !std::isnan(a.first) || (std::isnan(b.first) && a.second < b.second);
+                return beats<T, LARGEST>(a.first, b.first) || (a.first == b.first && a.second < b.second);
+            };
+            auto offer = [&](long i)
+            {
+                const std::pair<T, long> entry(pData[i * stride], i);
+                if (!better(entry, heap.front()))
+                    return;
+                std::pop_heap(heap.begin(), heap.end(), better);
+                heap.back() = entry;
+                std::push_heap(heap.begin(), heap.end(), better);
+            };
+
+            heap.clear();
+            for (long i = 0; i < k; i++)
+            {
+                heap.emplace_back(pData[i * stride], i);
+                std::push_heap(heap.begin(), heap.end(), better);
+            }
+
+            long i = k;
+            if constexpr (std::is_same_v<T, float>)
+            {
+                if (stride == 1)
+                {
+                    // An entry that does not beat the root is discarded, and the root only gets better, so the mask may let through entries that offer then rejects, but never misses one. While the root is NaN, which every number beats, all entries are offered.
+                    for (; i + 8 <= length; i += 8)
+                    {
+                        const float root = heap.front().first;
+                        unsigned mask = std::isnan(root) ? 0xff : _mm256_movemask_ps(beatsMask<LARGEST>(_mm256_loadu_ps(pData + i), _mm256_set1_ps(root)));
+                        for (; mask != 0; mask &= mask - 1)
+                            offer(i + __builtin_ctz(mask));
+                    }
+                }
+            }
+            for (; i < length; i++)
+                offer(i);
+
+            // The sorted heap runs from the best entry to the worst
+            std::sort_heap(heap.begin(), heap.end(), better);
+            for (long j = 0; j < k; j++)
+            {
+                pValues[j * outputStride] = heap[j].first;
+                pIndices[j * outputStride] = heap[j].second;
+            }
+        }
+
+        /// @brief For each mask of 8 lanes, the lanes that are set, packed to the left
+        inline const std::array<std::array<int32_t, 8>, 256> &leftPackTable()
+        {
+            static const std::array<std::array<int32_t, 8>, 256> table = []
+            {
+                std::array<std::array<int32_t, 8>, 256> result{};
+                for (int mask = 0; mask < 256; mask++)
+                    for (int lane = 0, packed = 0; lane < 8; lane++)
+                        if (mask & (1 << lane))
+                            result[mask][packed++] = lane;
+                return result;
+            }();
+            return table;
+        }
+
+        /// @brief The mask of the lanes of 8 floats that are zero (ZERO) or nonzero
+        template <bool ZERO>
+        inline unsigned zeroMask(const float *pData)
+        {
+            const unsigned mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(pData), _mm256_setzero_ps(), _CMP_EQ_OQ));
+            return ZERO ? mask : ~mask & 0xff;
+        }
+
+        /// @brief The number of the first length entries that satisfy f
+        template <DataType T, bool (*f)(T)>
+        long count(const T *pData, const long length)
+        {
+            long count = 0;
+            for (long i = 0; i < length; i++)
+                count += f(pData[i]) ? 1 : 0;
+            return count;
+        }
+
+        /// @brief Writes the indices of the entries that satisfy f to pDest in ascending order
+        /// @return The number of indices written
+        template <DataType T, bool (*f)(T)>
+        long pack(const T *pData, const long length, long *pDest)
+        {
+            long count = 0;
+            for (long i = 0; i < length; i++)
+                if (f(pData[i]))
+                    pDest[count++] = i;
+            return count;
+        }
+
+        /// @brief Like count for the predicate "is zero" (ZERO) or "is nonzero" of floats, with one comparison per 8 entries
+        template <bool ZERO>
+        long countZeros(const float *pData, const long length)
+        {
+            long count = 0, i = 0;
+            for (; i + 8 <= length; i += 8)
+                count += __builtin_popcount(zeroMask<ZERO>(pData + i));
+            for (; i < length; i++)
+                count += (pData[i] == 0) == ZERO ? 1 : 0;
+            return count;
+        }
+
+        /// @brief Like pack for the predicate "is zero" (ZERO) or "is nonzero" of floats. The lanes that match are left-packed with a lookup table and stored as a whole, without a branch on the mask. The lanes beyond the matches are overwritten by the next store, and once fewer than 8 entries of the capacity remain, masked stores write only the matches.
+        /// @param capacity The number of indices that fit into pDest
+        template <bool ZERO>
+        long packZeros(const float *pData, const long length, long *pDest, const long capacity)
+        {
+            const std::array<std::array<int32_t, 8>, 256> &table = leftPackTable();
+            long count = 0, i = 0;
+            for (; i + 8 <= length; i += 8)
+            {
+                const unsigned mask = zeroMask<ZERO>(pData + i);
+                const long matches = __builtin_popcount(mask);
+                const __m256i lanes = _mm256_loadu_si256((const __m256i *)table[mask].data());
+                const __m256i base = _mm256_set1_epi64x(i);
+                const __m256i low = _mm256_add_epi64(base, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(lanes)));
+                const __m256i high = _mm256_add_epi64(base, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(lanes, 1)));
+                if (count + 8 <= capacity)
+                {
+                    _mm256_storeu_si256((__m256i *)(pDest + count), low);
+                    _mm256_storeu_si256((__m256i *)(pDest + count + 4), high);
+                }
+                else if (matches > 0)
+                {
+                    _mm256_maskstore_epi64((long long *)(pDest + count), Simd::makeTypePrefixMask<long>(matches), low);
+                    _mm256_maskstore_epi64((long long *)(pDest + count + 4), Simd::makeTypePrefixMask<long>(matches - 4), high);
+                }
+                count += matches;
+            }
+            for (; i < length; i++)
+                if ((pData[i] == 0) == ZERO)
+                    pDest[count++] = i;
+            return count;
+        }
+    }
+}
+
+#endif
@@ -16,6 +16,7 @@
 #include <limits>
 #include <thread>
 #include <optional>
+#include <utility>
 
 #include <cassert>
 // Use (void) to silence unused warnings.
@@ -23,8 +24,12 @@
 
 #include "data.hpp"
 #include "shape.hpp"
-#include "../performance.hpp"
+#include "profiler.hpp"
 #include "simd.hpp"
+#include "summation.hpp"
+#include "arg_reduce.hpp"
+#include "thread_pool.hpp"
+#include "permute.hpp"
 #include "common_operations.hpp"
 
 int main();
@@ -41,6 +46,26 @@ namespace ArrayLibrary
     template <DataType ResultType, DataType... InputTypes>
     class UniversalPointwise;
 
+    template <DataType ResultType, DataType... InputTypes>
+    class MapReduce;
+
+    template <DataType T>
+    class SparseArray;
+
+    class RandomArrayGenerator;
+
+    template <DataType T>
+    class Normalization;
+
+    /// Satisfied by the lazy expression nodes in expression.hpp
+    template <typename Node>
+    concept IsExpressionNode = requires(const Node &node) {
+        typename Node::ResultType;
+        typename Node::Leaves;
+        { Node::LEAVES } -> std::convertible_to<size_t>;
+        node.leaves();
+    };
+
     namespace Matmul
     {
         struct MatmulSettings;
@@ -67,9 +92,20 @@ namespace ArrayLibrary
         template <DataType ResultType, DataType... InputTypes>
         friend class UniversalPointwise;
 
+        template <DataType ResultType, DataType... InputTypes>
+        friend class MapReduce;
+
         template <DataType U>
         friend class Array;
 
+        template <DataType U>
+        friend class SparseArray;
+
+        friend class RandomArrayGenerator;
+
+        template <DataType U>
+        friend class Normalization;
+
         static_assert(std::is_arithmetic_v<T>, "T of Array<T> must be arithmetic type!");
 
     public:
@@ -117,6 +153,122 @@ namespace ArrayLibrary
 
     public:
         inline bool isContiguous() const { return mContiguous; }
+
+        /// @brief The number of arrays (including views) that refer to the same data
+        inline size_t useCount() const { return mData.useCount(); }
+
+        /// @brief Whether the array is a view, i.e. whether writes to it always go through to the data it was created from.
+        /// @details Arrays returned by reshape, transpose, slice etc. are views. Copies of a view are views as well. All other arrays own their data with copy-on-write semantics: copying them is cheap, and the first write to data that is owned by several arrays clones it first.
+        /// Writing into an array, creating a view of a non-const array and taking a reference to an entry of a non-const array all count as writes, so a view or reference never reaches the data of another owner. Views and entries of const arrays are for reading and do not clone. An owner of which views are alive is copied right away, since the views may still write to it.
+        inline bool isView() const { return mData.isView(); }
+
+        /// @brief Creates a view of the array, which writes through to its data without triggering copy-on-write.
+        Array<T> view() const
+        {
+            return Array<T>(mData.view(), mShape, mStrides, mOffset, mContiguous);
+        }
+
+        // The views of a non-const array may be written to, so its data is cloned first if it is owned by other arrays as well, see isView
+        Array<T> view()
+        {
+            copyOnWrite();
+            return std::as_const(*this).view();
+        }
+
+        Array<T> transpose(int axis1, int axis2)
+        {
+            copyOnWrite();
+            return std::as_const(*this).transpose(axis1, axis2);
+        }
+
+        Array<T> adjustDimension(long desiredDim)
+        {
+            copyOnWrite();
+            return std::as_const(*this).adjustDimension(desiredDim);
+        }
+
+        Array<T> leftExpandDim(long addedDims)
+        {
+            copyOnWrite();
+            return std::as_const(*this).leftExpandDim(addedDims);
+        }
+
+        Array<T> rightExpandDim(long addedDims)
+        {
+            copyOnWrite();
+            return std::as_const(*this).rightExpandDim(addedDims);
+        }
+
+        Array<T> reshape(const Coordinates &shape) &
+        {
+            copyOnWrite();
+            return std::as_const(*this).reshape(shape);
+        }
+
+        /// @brief Reshapes a temporary, e.g. a result that was just computed. The result takes over the data handle of the temporary, so it is an owner unless the temporary was a view.
+        Array<T> reshape(const Coordinates &shape) &&
+        {
+            Array<T> result = std::as_const(*this).reshape(shape);
+            result.mData = mData;
+            return result;
+        }
+
+        Array<T> contiguous()
+        {
+            copyOnWrite();
+            return std::as_const(*this).contiguous();
+        }
+
+        Array<T> sliceAxis(long axis, long from, long upto)
+        {
+            copyOnWrite();
+            return std::as_const(*this).sliceAxis(axis, from, upto);
+        }
+
+        Array<T> slice(const Coordinates &from, const Coordinates &upto, bool keepDims = false)
+        {
+            copyOnWrite();
+            return std::as_const(*this).slice(from, upto, keepDims);
+        }
+
+        Array<T> take(const Coordinates &at, bool keepDims = false)
+        {
+            copyOnWrite();
+            return std::as_const(*this).take(at, keepDims);
+        }
+
+        T &operator[](const Coordinates indices)
+        {
+            return get(indices);
+        }
+
+        T &get(const Coordinates &indices)
+        {
+            copyOnWrite();
+            return const_cast<T &>(std::as_const(*this).get(indices));
+        }
+
+        T &getFlat(long i)
+        {
+            copyOnWrite();
+            return const_cast<T &>(std::as_const(*this).getFlat(i));
+        }
+
+        /// @brief Makes sure that no other array refers to the data of this array, so that it can be mutated in place without affecting other arrays and vice versa. Only copies the data if it is referenced elsewhere.
+        /// @details An array owning shared data receives a copy of the whole buffer with the same layout. A view of shared data is detached from it and receives a contiguous copy of its entries.
+        /// @return A reference to this array
+        Array<T> &ensureUnique()
+        {
+            if (mData.useCount() == 1)
+                return *this;
+
+            if (mData.isView())
+                *this = copy();
+            else
+                mData = mData.copy();
+
+            return *this;
+        }
         inline const Coordinates &refShape() const { return mShape; }
         inline const Coordinates &refStrides() const { return mStrides; }
 
@@ -124,8 +276,7 @@ namespace ArrayLibrary
 
         Array() = delete;
 
-        Array(const Array<T> &other) : mData(other.mData),
-                                       mFlatLength(other.mFlatLength), mShape(other.mShape), mStrides(other.mStrides), mDim(other.mDim), mOffset(other.mOffset), mContiguous(other.mContiguous)
+        Array(const Array<T> &other) : Array(copied(other))
         {
         }
 
@@ -141,6 +292,23 @@ namespace ArrayLibrary
         Array(Array<T> &&other) = default;
 
     private:
+        /// @brief Clones the data if it is owned by other arrays as well, see isView.
+        void copyOnWrite()
+        {
+            if (!mData.isView() && mData.ownerCount() > 1)
+                mData = mData.copy();
+        }
+
+        /// @brief A copy of other, which shares the data of other unless writes through other or through views of other could reach it, i.e. unless other is a view or views of other are alive
+        static Array<T> copied(const Array<T> &other)
+        {
+            if (other.mData.isView())
+                return other.copy();
+
+            const Data<T> data = other.mData.useCount() > other.mData.ownerCount() ? other.mData.copy() : other.mData;
+            return Array<T>(data, other.mShape, other.mStrides, other.mOffset, other.mContiguous);
+        }
+
         Array(const Data<T> &data, const Coordinates &shape, const Coordinates &strides, long offset, bool contiguous) : mData(data), mFlatLength(calculateFlatLength(shape)), mDim(shape.size()), mShape(shape), mStrides(strides), mOffset(offset), mContiguous(contiguous)
         {
         }
@@ -162,9 +330,30 @@ namespace ArrayLibrary
 
         Array(const std::initializer_list<T> &values) : mData(values), mShape({mData.size()}), mFlatLength(mData.size()), mStrides({1}), mDim(1), mContiguous(true) {}
 
+        /// @brief Evaluates a lazy expression (see expression.hpp) into a new array.
+        template <IsExpressionNode Node>
+            requires std::is_same_v<typename Node::ResultType, T>
+        Array(const Node &expression) : Array(expression.eval())
+        {
+        }
+
+        /// @brief Returns a view of this array if its entries are contiguous, and a contiguous copy otherwise. Writes through the result only reach this array in the first case.
+        Array<T> contiguous() const
+        {
+            if (mContiguous || isContiguousLayout(mShape, mStrides))
+                return Array<T>(mData.view(), mShape, mStrides, mOffset, true);
+            return copy();
+        }
+
+        /// @brief Returns a contiguous copy of the array. Non-contiguous arrays, e.g. transposed views, are copied by Permute::permuteCopy.
         Array<T> copy() const
         {
-            return compute<Copy<T>, true>(*this);
+            if (mContiguous || mFlatLength <= 1)
+                return compute<Copy<T>>(*this);
+
+            Array<T> result(Data<T>(mFlatLength), mShape);
+            Permute::permuteCopy(mShape, mStrides, getDataPointer(), result.mStrides, result.getDataPointer());
+            return result;
         }
 
         bool isTransposed() const { return mContiguous; }
@@ -175,7 +364,7 @@ namespace ArrayLibrary
             axis1 = axis1 < 0 ? mDim + axis1 : axis1;
             axis2 = axis2 < 0 ? mDim + axis2 : axis2;
 
-            Array<T> result(*this);
+            Array<T> result = view();
             result.mContiguous = false;
             std::swap(result.mShape[axis1], result.mShape[axis2]);
             std::swap(result.mStrides[axis1], result.mStrides[axis2]);
@@ -194,14 +383,14 @@ namespace ArrayLibrary
                 throw std::invalid_argument("The dimension cannot exceed MAX_DIM");
 
             if (desiredDim == mDim)
-                return *this;
+                return view();
 
             if (desiredDim > mDim)
             {
                 Coordinates newShape = mShape.shiftRight(1, desiredDim - mDim);
                 Coordinates newStrides = mStrides.shiftRight(0, desiredDim - mDim);
 
-                return Array<T>(mData, newShape, newStrides, mOffset, mContiguous);
+                return Array<T>(mData.view(), newShape, newStrides, mOffset, mContiguous);
             }
             else
             {
@@ -214,7 +403,7 @@ namespace ArrayLibrary
                 Coordinates newShape = mShape.interval(mDim - desiredDim, mDim);
                 Coordinates newStrides = mStrides.interval(mDim - desiredDim, mDim);
 
-                return Array<T>(mData, newShape, newStrides, mOffset, mContiguous);
+                return Array<T>(mData.view(), newShape, newStrides, mOffset, mContiguous);
             }
         }
 
@@ -229,7 +418,7 @@ namespace ArrayLibrary
             Coordinates newShape = mShape.shiftRight(1, addedDims);
             Coordinates newStrides = mStrides.shiftRight(0, addedDims);
 
-            return Array<T>(mData, newShape, newStrides, mOffset, mContiguous);
+            return Array<T>(mData.view(), newShape, newStrides, mOffset, mContiguous);
         }
 
         Array<T> rightExpandDim(long addedDims) const
@@ -248,18 +437,25 @@ namespace ArrayLibrary
                 newStrides[i] = mStrides[i];
             }
 
-            return Array<T>(mData, newShape, newStrides, mOffset, mContiguous);
+            return Array<T>(mData.view(), newShape, newStrides, mOffset, mContiguous);
         }
 
         template <std::convertible_to<long>... Pack>
-        Array<T> reshape(Pack... shape)
+        Array<T> reshape(Pack... shape) &
         {
             return reshape(Coordinates({shape...}));
         }
 
-        Array<T> reshape(const Coordinates &shape) const
+        template <std::convertible_to<long>... Pack>
+        Array<T> reshape(Pack... shape) &&
         {
-            if (!mContiguous)
+            return std::move(*this).reshape(Coordinates({shape...}));
+        }
+
+        /// @brief Returns a view with the given shape, in which one axis may have length -1 to be inferred. Throws if the entries are not contiguous; use contiguous() first to reshape a copy.
+        Array<T> reshape(const Coordinates &shape) const &
+        {
+            if (!mContiguous && !isContiguousLayout(mShape, mStrides))
                 throw std::logic_error("Cannot reshape a non-contiguous array.");
 
             long flatLength = 1;
@@ -277,19 +473,25 @@ namespace ArrayLibrary
             }
             if (wildcardDimension == -1 && flatLength == mFlatLength)
             {
-                return Array<T>(mData, shape, mOffset);
+                return Array<T>(mData.view(), shape, mOffset);
             }
             else if (wildcardDimension != -1 && flatLength <= mFlatLength && mFlatLength % flatLength == 0)
             {
                 Coordinates newShape(shape);
                 newShape[wildcardDimension] = mFlatLength / flatLength;
-                return Array<T>(mData, newShape, mOffset);
+                return Array<T>(mData.view(), newShape, mOffset);
             }
             else
                 throw std::invalid_argument("Shape does not match data size.");
         }
 
-        Array<T> &operator=(const Array<T> &other) = default;
+        Array<T> &operator=(const Array<T> &other)
+        {
+            if (this == &other)
+                return *this;
+
+            return *this = copied(other);
+        }
 
         Array<T> &operator=(Array<T> &&other) = default;
 
@@ -300,6 +502,18 @@ namespace ArrayLibrary
             return *this;
         }
 
+        /// @brief Evaluates a lazy expression in a single pass. If the shape of the expression matches, the result is written into the existing data, like for a scalar assignment. Otherwise the array is rebound to a new array.
+        template <IsExpressionNode Node>
+            requires std::is_same_v<typename Node::ResultType, T>
+        Array<T> &operator=(const Node &expression)
+        {
+            if (expression.resultShape() == mShape)
+                expression.evaluateInto(*this);
+            else
+                *this = expression.eval();
+            return *this;
+        }
+
         static Coordinates calculateStrides(const Coordinates &shape)
         {
             int dim = shape.size();
@@ -346,6 +560,7 @@ namespace ArrayLibrary
         static Array<T> range(T from, T to);
         static Array<T> range(T to);
         static Array<T> constant(const Coordinates &shape, const T constant);
+        static Array<T> empty(const Coordinates &shape);
 
         Array<T> extend(const Coordinates &shape) const
         {
@@ -393,6 +608,7 @@ namespace ArrayLibrary
 
     public:
         static inline T add(const T a, const T b) { return a + b; }
+        static inline T subtract(const T a, const T b) { return a - b; }
         static inline T multiply(const T a, const T b) { return a * b; }
         static inline T modulo(const T a, const T b) { return a % b; }
         static inline T max(const T a, const T b) { return a > b ? a : b; }
@@ -412,8 +628,9 @@ namespace ArrayLibrary
             return g(f(x));
         }
 
+        /// @param summation How a sum is accumulated, which is ignored unless f is add on floating point entries
         template <DataType U, U (*f)(const U, const T)>
-        Array<U> reduce(const U &initial, const Coordinates &axes, bool keepDims = false) const
+        Array<U> reduce(const U &initial, const Coordinates &axes, bool keepDims = false, Summation summation = Summation::NAIVE) const
         {
             if (mDim == 0)
                 return f(initial, *(getDataPointer()));
@@ -423,73 +640,242 @@ namespace ArrayLibrary
             const ReduceInformation reduceInfo = reduceShape(mShape, axes, keepDims);
             const Coordinates &keepDimShape = reduceInfo.keepDimsShape;
             const Coordinates &keepDimStrides = reduceInfo.keepDimsStrides;
-            const long flatLength = reduceInfo.flatLength;
 
-            long boostDim = -1;
-            long boostDimLength = -1;
-            for (int i = mDim - 1; i >= 0; i--)
+            Data<U> data(reduceInfo.flatLength);
+            data = initial;
+            auto dest = Array<U>(data, keepDimShape, keepDimStrides, 0, true);
+
+            reduceLoop<U, f>(dest.getDataPointer(), keepDimStrides, summation);
+
+            if (keepDims)
+            {
+                return dest;
+            }
+            else
             {
-                if (mShape[i] > boostDimLength)
+                return std::move(dest).reshape(reduceInfo.reducedShape);
+            }
+        }
+
+        /// @brief Reduces along axes and writes the result into an existing array.
+        /// @param dest Either has the shape of the reduction with keepDims (trivial axes on the left may be omitted) or the shape with the reduced axes removed.
+        /// @param accumulate If true, the values in dest are used as initial values instead of initial, for example to add a sum to a gradient.
+        /// @param summation See reduce
+        /// @return A reference to dest
+        template <DataType U, U (*f)(const U, const T)>
+        Array<U> &reduceInto(Array<U> &dest, const U &initial, const Coordinates &axes, bool accumulate = false, Summation summation = Summation::NAIVE) const
+        {
+            dest.copyOnWrite();
+
+            if (mDim == 0)
+            {
+                if (dest.mFlatLength != 1)
+                    throw std::invalid_argument("The destination of a reduction of a scalar must have exactly one entry.");
+
+                U &value = *dest.getDataPointer();
+                value = f(accumulate ? value : initial, *getDataPointer());
+                return dest;
+            }
+
+            const ReduceInformation reduceInfo = reduceShape(mShape, axes, true);
+            const Coordinates &keepDimShape = reduceInfo.keepDimsShape;
+
+            bool reduced[MAX_DIM] = {false};
+            long reducedCount = 0;
+            for (long k = 0; k < axes.size(); k++)
+            {
+                long axis = axes[k] % mDim;
+                axis = axis < 0 ? axis + mDim : axis;
+                reducedCount += reduced[axis] ? 0 : 1;
+                reduced[axis] = true;
+            }
+
+            Coordinates destStrides(mDim, 0);
+            bool droppedAxes = dest.mDim < mDim && dest.mDim == mDim - reducedCount;
+
+            for (long i = 0, j = 0; droppedAxes && i < mDim; i++)
+            {
+                if (reduced[i])
+                    continue;
+                if (dest.mShape[j] != mShape[i])
+                    droppedAxes = false;
+                else
+                    destStrides[i] = dest.mShape[j] == 1 ? 0 : dest.mStrides[j];
+                j++;
+            }
+
+            if (!droppedAxes)
+            {
+                if (dest.mDim > mDim)
+                    throw std::invalid_argument("The destination array has too many dimensions for the reduction.");
+
+                const long shift = mDim - dest.mDim;
+                for (long i = 0; i < mDim; i++)
                 {
-                    boostDim = i;
-                    boostDimLength = mShape[i];
+                    const long length = i < shift ? 1 : dest.mShape[i - shift];
+                    if (length != keepDimShape[i])
+                        throw std::invalid_argument("The shape of the destination array does not match the reduction.");
+                    destStrides[i] = length == 1 ? 0 : dest.mStrides[i - shift];
                 }
             }
 
-            Data<U> data(flatLength);
-            data = initial;
-            auto dest = Array<U>(data, keepDimShape, keepDimStrides, 0, true);
+            Array<U> destView(dest.mData.view(), keepDimShape, destStrides, dest.mOffset, false);
+            if (!accumulate)
+                destView = initial;
 
-            U *pDestData = dest.getDataPointer();
-            T *pSourceData = getDataPointer();
-            const long sourceBoostStride = mStrides[boostDim];
-            const long destBoostStride = keepDimStrides[boostDim];
+            reduceLoop<U, f>(destView.getDataPointer(), destStrides, summation);
+            return dest;
+        }
 
-            Coordinates c(mDim, 0);
+    private:
+        template <DataType U, U (*f)(const U, const T)>
+        void reduceLoop(U *pDestData, const Coordinates &keepDimStrides, Summation summation = Summation::NAIVE) const
+        {
+            if constexpr (!std::is_same_v<U, T> || !std::is_floating_point_v<T>)
+                summation = Summation::NAIVE;
+            else if (f != add)
+                summation = Summation::NAIVE;
+
+            Profiler::Scope scope("reduce", Profiler::Category::REDUCE, mShape, mFlatLength * sizeof(T), mFlatLength);
+
+            // The dest strides are 0 along reduced axes, so the reduction is a loop in which the dest does not move along them
+            const CanonicalLayout<2> layout = canonicalizeLayout<2>(mShape, {&mStrides, &keepDimStrides});
+            const Coordinates &shape = layout.shape;
+            const Coordinates &sourceStrides = layout.strides[0];
+            const Coordinates &destStrides = layout.strides[1];
+            const long dim = shape.size();
+
+            // The boost axis is the innermost axis of the canonical layout, which has the smallest source stride. If it is reduced and the next axis is not, the two are boosted together as a tile so that several independent accumulations are interleaved.
+            const long boostDim = dim - 1;
+            const bool tiled = dim >= 2 && destStrides[boostDim] == 0 && destStrides[boostDim - 1] != 0;
+            const long outerDim = tiled ? dim - 2 : dim - 1;
+
+            if constexpr (std::is_same_v<U, T>)
+            {
+                // A compensated sum has to see all entries of a sum in one boost, so a reduced outer axis is moved innermost by copying the entries, after which the reduced axes are merged into the boost axis
+                bool outerReduced = false;
+                for (long i = 0; i < outerDim; i++)
+                    outerReduced = outerReduced || destStrides[i] == 0;
+
+                if (summation != Summation::NAIVE && outerReduced)
+                {
+                    Coordinates packedShape(mDim), packedSourceStrides(mDim), packedDestStrides(mDim);
+                    long j = 0;
+                    for (int pass = 0; pass < 2; pass++)
+                        for (long i = 0; i < mDim; i++)
+                            if ((keepDimStrides[i] == 0) == (pass == 1))
+                            {
+                                packedShape[j] = mShape[i];
+                                packedSourceStrides[j] = mStrides[i];
+                                packedDestStrides[j] = keepDimStrides[i];
+                                j++;
+                            }
+
+                    Array<T> packed(Data<T>(mFlatLength), packedShape);
+                    Permute::permuteCopy(packedShape, packedSourceStrides, getDataPointer(), packed.mStrides, packed.getDataPointer());
+                    packed.reduceLoop<U, f>(pDestData, packedDestStrides, summation);
+                    return;
+                }
+            }
+
+            const long boostDimLength = shape[boostDim];
+            const long sourceBoostStride = sourceStrides[boostDim];
+            const long destBoostStride = destStrides[boostDim];
+            const long tileLength = tiled ? shape[boostDim - 1] : 1;
+            const long sourceTileStride = tiled ? sourceStrides[boostDim - 1] : 0;
+            const long destTileStride = tiled ? destStrides[boostDim - 1] : 0;
+
+            auto boost = [=](const T *pSource, U *pDest)
+            {
+                if constexpr (std::is_same_v<U, T>)
+                {
+                    if (summation != Summation::NAIVE && tiled)
+                    {
+                        CompensatedSum::sumRows<T>(summation, pSource, pDest, tileLength, sourceTileStride, destTileStride, boostDimLength, sourceBoostStride);
+                        return;
+                    }
+                    if (summation != Summation::NAIVE && destBoostStride == 0)
+                    {
+                        *pDest += CompensatedSum::sum<T>(summation, pSource, boostDimLength, sourceBoostStride);
+                        return;
+                    }
+                }
+
+                if (tiled)
+                    reduceTile<U, f>(pSource, pDest, tileLength, sourceTileStride, destTileStride, boostDimLength, sourceBoostStride);
+                else
+                    reduceBoost<U, f>(pSource, pDest, boostDimLength, sourceBoostStride, destBoostStride);
+            };
+
+            auto stridedBoost = [&](StridedPointer<const T> source, StridedPointer<U> dest)
+            {
+                boost(source.pData, dest.pData);
+            };
+
+            const T *pSourceData = getDataPointer();
+
+            // For low dimensions, loop over the outer axes with compile-time nesting
+            if (dispatchStaticRank(outerDim, [&]<long RANK>()
+                                   { staticNestedLoop<RANK>(shape, stridedBoost, StridedPointer<const T>{pSourceData, sourceStrides}, StridedPointer<U>{pDestData, destStrides}); }))
+                return;
+
+            Coordinates c(outerDim, 0);
 
             bool end = false;
 
             while (!end)
             {
-                reduceBoost<U, f>(pSourceData, pDestData, boostDimLength, sourceBoostStride, destBoostStride);
+                boost(pSourceData, pDestData);
                 end = true;
 
-                for (long i = mDim - 1; i >= 0; i--)
+                for (long i = outerDim - 1; i >= 0; i--)
                 {
-                    if (i == boostDim)
-                        continue;
-
                     c[i]++;
 
-                    if (c[i] != mShape[i])
+                    if (c[i] != shape[i])
                     {
-                        pDestData = keepDimShape[i] == 1 ? pDestData : pDestData + keepDimStrides[i];
-                        pSourceData += mStrides[i];
+                        pDestData += destStrides[i];
+                        pSourceData += sourceStrides[i];
                         end = false;
                         break;
                     }
                     else
                     {
-                        pDestData = keepDimShape[i] == 1 ? pDestData : pDestData - keepDimStrides[i] * (mShape[i] - 1);
-                        pSourceData -= mStrides[i] * (mShape[i] - 1);
+                        pDestData -= destStrides[i] * (shape[i] - 1);
+                        pSourceData -= sourceStrides[i] * (shape[i] - 1);
                         c[i] = 0;
                     }
                 }
             }
+        }
 
-            if (keepDims)
-            {
-                return dest;
-            }
-            else
-            {
-                return dest.reshape(reduceInfo.keepDimsShape);
-            }
+        void validateAxes(const Coordinates &axes) const
+        {
+            if (axes.size() > mDim)
+                throw std::invalid_argument("Too many axes for array dimension.");
+
+            for (int i = 0; i < axes.size(); i++)
+                if (axes[i] < -mDim || axes[i] >= mDim)
+                    throw std::invalid_argument("Axis out of bounds.");
         }
 
-        template <typename U, U (*f)(const U, const T)>
-        static inline void reduceBoost(T *pSourceData, T *pDestData, const long length, const long sourceStride, const long destStride)
+    public:
+        template <DataType U, U (*f)(const U, const T)>
+        static inline void reduceBoost(const T *pSourceData, U *pDestData, const long length, const long sourceStride, const long destStride)
         {
+            if (destStride == 0)
+            {
+                // Accumulate in a register rather than through the dest entry
+                U accumulator = *pDestData;
+                for (long i = 0; i < length; i++)
+                {
+                    accumulator = f(accumulator, *pSourceData);
+                    pSourceData += sourceStride;
+                }
+                *pDestData = accumulator;
+                return;
+            }
+
             for (long i = 0; i < length; i++)
             {
                 *pDestData = f(*pDestData, *pSourceData);
@@ -498,6 +884,46 @@ namespace ArrayLibrary
             }
         }
 
+        /// @brief Reduces rows entries of the dest, each along a reduced axis of the given length, by interleaving REDUCE_TILE of the accumulations at a time.
+        /// @details The accumulations do not depend on each other, so interleaving hides the latency of f, while every single accumulation is still evaluated in order.
+        template <DataType U, U (*f)(const U, const T)>
+        static inline void reduceTile(const T *pSourceData, U *pDestData, const long rows, const long sourceRowStride, const long destRowStride, const long length, const long sourceStride)
+        {
+            constexpr long REDUCE_TILE = 8;
+
+            long row = 0;
+            for (; row + REDUCE_TILE <= rows; row += REDUCE_TILE)
+            {
+                U accumulators[REDUCE_TILE];
+#pragma GCC unroll 8
+                for (long t = 0; t < REDUCE_TILE; t++)
+                    accumulators[t] = pDestData[t * destRowStride];
+
+                const T *pSource = pSourceData;
+                for (long i = 0; i < length; i++)
+                {
+#pragma GCC unroll 8
+                    for (long t = 0; t < REDUCE_TILE; t++)
+                        accumulators[t] = f(accumulators[t], pSource[t * sourceRowStride]);
+                    pSource += sourceStride;
+                }
+
+#pragma GCC unroll 8
+                for (long t = 0; t < REDUCE_TILE; t++)
+                    pDestData[t * destRowStride] = accumulators[t];
+
+                pSourceData += REDUCE_TILE * sourceRowStride;
+                pDestData += REDUCE_TILE * destRowStride;
+            }
+
+            for (; row < rows; row++)
+            {
+                reduceBoost<U, f>(pSourceData, pDestData, length, sourceStride, 0);
+                pSourceData += sourceRowStride;
+                pDestData += destRowStride;
+            }
+        }
+
     public:
         Array<bool> operator==(const Array<T> &other) const
         {
@@ -529,6 +955,36 @@ namespace ArrayLibrary
             return compute<LessThanEqual<T>>(other, *this);
         }
 
+        Array<bool> &equal(const Array<T> &other, Array<bool> &dest) const
+        {
+            return computeInPlace<Equality<T>>(dest, *this, other);
+        }
+
+        Array<bool> &notEqual(const Array<T> &other, Array<bool> &dest) const
+        {
+            return computeInPlace<Inequality<T>>(dest, *this, other);
+        }
+
+        Array<bool> &less(const Array<T> &other, Array<bool> &dest) const
+        {
+            return computeInPlace<LessThan<T>>(dest, *this, other);
+        }
+
+        Array<bool> &lessEqual(const Array<T> &other, Array<bool> &dest) const
+        {
+            return computeInPlace<LessThanEqual<T>>(dest, *this, other);
+        }
+
+        Array<bool> &greater(const Array<T> &other, Array<bool> &dest) const
+        {
+            return computeInPlace<LessThan<T>>(dest, other, *this);
+        }
+
+        Array<bool> &greaterEqual(const Array<T> &other, Array<bool> &dest) const
+        {
+            return computeInPlace<LessThanEqual<T>>(dest, other, *this);
+        }
+
         Array<T> operator&&(const Array<T> &other) const
         {
             return compute<LogicalAnd<T>>(*this, other);
@@ -551,12 +1007,12 @@ namespace ArrayLibrary
 
         Array<T> &operator+=(const T other)
         {
-            return *this += Array<T>(other);
+            return computeInPlace<ScalarAddition<T>>(ScalarAddition<T>(other), *this, *this);
         }
 
         Array<T> operator+(const T other) const
         {
-            return *this + Array<T>(other);
+            return compute<ScalarAddition<T>>(ScalarAddition<T>(other), *this);
         }
 
         Array<T> &operator*=(const Array<T> &other)
@@ -571,12 +1027,12 @@ namespace ArrayLibrary
 
         Array<T> &operator*=(const T other)
         {
-            return *this *= Array<T>(other);
+            return computeInPlace<ScalarMultiplication<T>>(ScalarMultiplication<T>(other), *this, *this);
         }
 
         Array<T> operator*(const T other) const
         {
-            return *this * Array<T>(other);
+            return compute<ScalarMultiplication<T>>(ScalarMultiplication<T>(other), *this);
         }
 
         Array<T> &operator-=(const Array<T> &other)
@@ -591,12 +1047,12 @@ namespace ArrayLibrary
 
         Array<T> &operator-=(const T &other)
         {
-            return *this -= Array<T>(other);
+            return computeInPlace<ScalarSubtraction<T>>(ScalarSubtraction<T>(other), *this, *this);
         }
 
         Array<T> operator-(const T &other) const
         {
-            return *this - Array<T>(other);
+            return compute<ScalarSubtraction<T>>(ScalarSubtraction<T>(other), *this);
         }
 
         Array<T> &operator/=(const Array<T> &other)
@@ -611,12 +1067,12 @@ namespace ArrayLibrary
 
         Array<T> &operator/=(const T other)
         {
-            return *this /= Array<T>(other);
+            return computeInPlace<ScalarDivision<T>>(ScalarDivision<T>(other), *this, *this);
         }
 
         Array<T> operator/(const T other) const
         {
-            return *this / Array<T>(other);
+            return compute<ScalarDivision<T>>(ScalarDivision<T>(other), *this);
         }
 
         Array<T> operator%(const Array<T> &other) const
@@ -648,32 +1104,77 @@ namespace ArrayLibrary
             return isNaN().reduceAny().eval() || isInf().reduceAny().eval();
         }
 
+        /// @brief The coordinates of the entries for which f is true, as an array of shape {count, dim} in the order of the entries
+        /// @details The entries are counted first, so that the coordinates are written directly into an array of the right size. The flat indices of the entries are packed into the last count entries of that array and then expanded into coordinates from the front, which never overwrites an index that is still needed. For findZero and findNonZero of floats, both passes compare 8 entries at a time, see ArgReduce::packZeros.
         template <bool (*f)(T)>
         Array<long> findWhere() const
         {
-            auto list = std::vector<long>();
-            Coordinates c(mDim, 0);
+            if (!mContiguous)
+                return copy().template findWhere<f>();
+            if (mDim == 0)
+                return Array<long>::empty(Coordinates({f(*getDataPointer()) ? 1l : 0l, 0l}));
 
-            T *pData = getDataPointer();
+            const T *pData = getDataPointer();
+            constexpr bool simdZeros = std::is_same_v<T, float> && (f == find_isZero || f == find_isNonZero);
+            long count;
+            if constexpr (simdZeros)
+                count = f == find_isZero ? ArgReduce::countZeros<true>(pData, mFlatLength) : ArgReduce::countZeros<false>(pData, mFlatLength);
+            else
+                count = ArgReduce::count<T, f>(pData, mFlatLength);
 
-            for (long k = 0; k < mFlatLength; k++)
-            {
-                if (f(*(pData++)))
-                    for (long i = 0; i < mDim; i++)
-                        list.push_back(c[i]);
+            Array<long> result = Array<long>::empty(Coordinates({count, mDim}));
+            if (count == 0)
+                return result;
 
-                for (long i = mDim - 1; i >= 0; i--)
+            long *pResult = result.getDataPointer();
+            long *pIndices = pResult + count * (mDim - 1);
+            if constexpr (simdZeros)
+                f == find_isZero ? ArgReduce::packZeros<true>(pData, mFlatLength, pIndices, count) : ArgReduce::packZeros<false>(pData, mFlatLength, pIndices, count);
+            else
+                ArgReduce::pack<T, f>(pData, mFlatLength, pIndices);
+
+            if (mDim == 2)
+            {
+                // Writing in order is safe, since the pair of entry k ends at or before index k, which has been read already
+                const long columns = mShape[1];
+                long row = 0, rowStart = 0;
+                for (long k = 0; k < count; k++)
                 {
-                    c[i]++;
+                    const long index = pIndices[k];
+                    if (index - rowStart >= columns)
+                    {
+                        row = index / columns;
+                        rowStart = row * columns;
+                    }
+                    pResult[2 * k] = row;
+                    pResult[2 * k + 1] = index - rowStart;
+                }
+                return result;
+            }
 
-                    if (c[i] % mShape[i] == 0)
-                        c[i] = 0;
-                    else
-                        break;
+            // The indices ascend, so the coordinates of one entry are those of the previous one advanced along the last axis, with divisions only where an axis overflows
+            if (mDim > 1)
+            {
+                long c[MAX_DIM] = {0}, shape[MAX_DIM];
+                for (long i = 0; i < mDim; i++)
+                    shape[i] = mShape[i];
+                long previous = 0;
+                for (long k = 0; k < count; k++)
+                {
+                    const long index = pIndices[k];
+                    c[mDim - 1] += index - previous;
+                    previous = index;
+                    for (long i = mDim - 1; i > 0 && c[i] >= shape[i]; i--)
+                    {
+                        c[i - 1] += c[i] / shape[i];
+                        c[i] %= shape[i];
+                    }
+                    for (long i = 0; i < mDim; i++)
+                        pResult[k * mDim + i] = c[i];
                 }
             }
 
-            return Array<long>(Data<long>(list), Coordinates({list.size() / mDim, mDim}));
+            return result;
         }
 
         Array<long> findZero() const
@@ -707,49 +1208,152 @@ namespace ArrayLibrary
             return this->pow(Array<T>(k));
         }
 
+        Array<T> &intPow(const unsigned int k, Array<T> &dest) const
+        {
+            switch (k)
+            {
+            case 0:
+                if (!isExtensionSubshape(mShape, dest.refShape()))
+                    throw std::invalid_argument("Not all source arrays have a shape that is a subshape of the shape of the destination array.");
+                return dest = 1;
+            case 1:
+                return computeInPlace<Copy<T>>(dest, *this);
+            case 2:
+                return computeInPlace<IntPow<T, 2>>(dest, *this);
+            case 3:
+                return computeInPlace<IntPow<T, 3>>(dest, *this);
+            case 4:
+                return computeInPlace<IntPow<T, 4>>(dest, *this);
+            default:
+                return computeInPlace<Pow<T, T>>(dest, *this, Array<T>(k));
+            }
+        }
+
+        Array<T> &intPowInPlace(const unsigned int k)
+        {
+            return intPow(k, *this);
+        }
+
         Array<T> square() const
         {
             return (*this) * (*this);
         }
 
+        Array<T> &square(Array<T> &dest) const
+        {
+            return computeInPlace<IntPow<T, 2>>(dest, *this);
+        }
+
+        Array<T> &squareInPlace()
+        {
+            return computeInPlace<IntPow<T, 2>>(*this, *this);
+        }
+
     public:
         Array<T> pow(const Array<T> &other) const
         {
             return compute<Pow<T, T>>(*this, other);
         }
 
+        Array<T> &pow(const Array<T> &other, Array<T> &dest) const
+        {
+            return computeInPlace<Pow<T, T>>(dest, *this, other);
+        }
+
         Array<T> exp() const
         {
             static_assert(std::is_floating_point_v<T>, "Only floating points can be exponentiated.");
             return compute<Exp<T>>(*this);
         }
 
+        Array<T> &exp(Array<T> &dest) const
+        {
+            static_assert(std::is_floating_point_v<T>, "Only floating points can be exponentiated.");
+            return computeInPlace<Exp<T>>(dest, *this);
+        }
+
+        Array<T> &expInPlace()
+        {
+            return exp(*this);
+        }
+
         Array<T> sqrt() const
         {
             return compute<Sqrt<T>>(*this);
         }
 
+        Array<T> &sqrt(Array<T> &dest) const
+        {
+            return computeInPlace<Sqrt<T>>(dest, *this);
+        }
+
+        Array<T> &sqrtInPlace()
+        {
+            return sqrt(*this);
+        }
+
         Array<T> sin() const
         {
             return compute<Sin<T>>(*this);
         }
 
+        Array<T> &sin(Array<T> &dest) const
+        {
+            return computeInPlace<Sin<T>>(dest, *this);
+        }
+
+        Array<T> &sinInPlace()
+        {
+            return sin(*this);
+        }
+
         Array<T> cos() const
         {
             return compute<Cos<T>>(*this);
         }
 
+        Array<T> &cos(Array<T> &dest) const
+        {
+            return computeInPlace<Cos<T>>(dest, *this);
+        }
+
+        Array<T> &cosInPlace()
+        {
+            return cos(*this);
+        }
+
         Array<T> abs() const
         {
             return compute<Abs<T>>(*this);
         }
 
+        Array<T> &abs(Array<T> &dest) const
+        {
+            return computeInPlace<Abs<T>>(dest, *this);
+        }
+
+        Array<T> &absInPlace()
+        {
+            return abs(*this);
+        }
+
         Array<T> clip(T lower, T upper) const
         {
             return compute<Clip<T>>(Clip(lower, upper), *this);
         }
 
-        Array<T> reduceSum(const Coordinates &axes, bool keepDims = false) const
+        Array<T> &clip(T lower, T upper, Array<T> &dest) const
+        {
+            return computeInPlace<Clip<T>>(Clip(lower, upper), dest, *this);
+        }
+
+        Array<T> &clipInPlace(T lower, T upper)
+        {
+            return clip(lower, upper, *this);
+        }
+
+        /// @param summation How the sums are accumulated, see Summation. PAIRWISE and KAHAN keep long float sums accurate, and if an axis other than the innermost one is reduced together with others, they first copy the entries so that the reduced axes are innermost.
+        Array<T> reduceSum(const Coordinates &axes, bool keepDims = false, Summation summation = Summation::NAIVE) const
         {
             if (axes.size() > mDim)
                 throw std::invalid_argument("Too many axes for array dimension.");
@@ -758,19 +1362,33 @@ namespace ArrayLibrary
                 if (axes[i] < -mDim || axes[i] >= mDim)
                     throw std::invalid_argument("Axis out of bounds.");
 
-            return reduce<T, add>(0, axes, keepDims);
+            return reduce<T, add>(0, axes, keepDims, summation);
         }
 
-        Array<T> reduceSum() const
+        Array<T> reduceSum(Summation summation = Summation::NAIVE) const
         {
             Coordinates axes(mDim);
             for (int i = 0; i < mDim; i++)
                 axes[i] = i;
 
-            return reduce<T, add>(0, axes, false);
+            return reduce<T, add>(0, axes, false, summation);
+        }
+
+        /// @brief Sums along axes into dest, see reduceInto for the admissible shapes of dest.
+        Array<T> &reduceSum(const Coordinates &axes, Array<T> &dest, bool accumulate = false, Summation summation = Summation::NAIVE) const
+        {
+            validateAxes(axes);
+            return reduceInto<T, add>(dest, 0, axes, accumulate, summation);
+        }
+
+        /// @brief Subtracts the sum along axes from dest, see reduceInto for the admissible shapes of dest.
+        Array<T> &reduceSubtract(const Coordinates &axes, Array<T> &dest) const
+        {
+            validateAxes(axes);
+            return reduceInto<T, subtract>(dest, 0, axes, true);
         }
 
-        Array<T> reduceMean(const Coordinates &axes, bool keepDims = false) const
+        Array<T> reduceMean(const Coordinates &axes, bool keepDims = false, Summation summation = Summation::NAIVE) const
         {
             if (axes.size() > mDim)
                 throw std::invalid_argument("Too many axes for array dimension.");
@@ -787,16 +1405,32 @@ namespace ArrayLibrary
                     divisor *= mShape[a];
                 }
 
-            return reduce<T, add>(0, axes, keepDims) / divisor;
+            return reduce<T, add>(0, axes, keepDims, summation) / divisor;
         }
 
-        Array<T> reduceMean() const
+        Array<T> reduceMean(Summation summation = Summation::NAIVE) const
         {
             Coordinates axes(mDim);
             for (int i = 0; i < mDim; i++)
                 axes[i] = i;
 
-            return reduceMean(axes, false);
+            return reduceMean(axes, false, summation);
+        }
+
+        Array<T> &reduceMean(const Coordinates &axes, Array<T> &dest, Summation summation = Summation::NAIVE) const
+        {
+            validateAxes(axes);
+
+            long divisor = 1;
+            for (int i = 0; i < axes.size(); i++)
+            {
+                long a = axes[i] % mDim;
+                a = a >= 0 ? a : a + mDim;
+                divisor *= mShape[a];
+            }
+
+            reduceInto<T, add>(dest, 0, axes, false, summation);
+            return dest /= divisor;
         }
 
         Array<T> reduceProduct(const Coordinates &axes, bool keepDims = false) const
@@ -841,6 +1475,12 @@ namespace ArrayLibrary
             return reduce<T, max>(std::numeric_limits<T>::lowest(), axes);
         }
 
+        Array<T> &reduceMax(const Coordinates &axes, Array<T> &dest) const
+        {
+            validateAxes(axes);
+            return reduceInto<T, max>(dest, std::numeric_limits<T>::lowest(), axes);
+        }
+
         Array<T> reduceMin(const Coordinates &axes, bool keepDims = false) const
         {
             if (axes.size() > mDim)
@@ -862,6 +1502,204 @@ namespace ArrayLibrary
             return reduce<T, min>(std::numeric_limits<T>::max(), axes);
         }
 
+        Array<T> &reduceMin(const Coordinates &axes, Array<T> &dest) const
+        {
+            validateAxes(axes);
+            return reduceInto<T, min>(dest, std::numeric_limits<T>::max(), axes);
+        }
+
+        /// @brief The softmax along axes, exp(x - max) / sum(exp(x - max)) with the maximum and the sum taken over axes, see Normalization::softmax
+        Array<T> softmax(const Coordinates &axes) const
+        {
+            static_assert(std::is_floating_point_v<T>, "Only floating points can be exponentiated.");
+            Array<T> result = Array<T>::empty(mShape);
+            return Normalization<T>::softmax(*this, axes, result);
+        }
+
+        /// @brief The logarithm of softmax(axes), computed as x - max - log(sum(exp(x - max)))
+        Array<T> logSoftmax(const Coordinates &axes) const
+        {
+            static_assert(std::is_floating_point_v<T>, "Only floating points can be exponentiated.");
+            Array<T> result = Array<T>::empty(mShape);
+            return Normalization<T>::softmax(*this, axes, result, true);
+        }
+
+        /// @brief The indices along axis of the maxima along axis. Of equal entries, the first one is taken, and NaN entries are skipped.
+        Array<long> argMax(long axis, bool keepDims = false) const
+        {
+            return argReduce<true>(axis, keepDims);
+        }
+
+        /// @brief The flat index of the maximum in the order of the entries, see argMax(axis)
+        Array<long> argMax() const
+        {
+            return argReduce<true>();
+        }
+
+        /// @brief The indices along axis of the minima along axis, see argMax
+        Array<long> argMin(long axis, bool keepDims = false) const
+        {
+            return argReduce<false>(axis, keepDims);
+        }
+
+        Array<long> argMin() const
+        {
+            return argReduce<false>();
+        }
+
+        /// @brief The k largest entries along axis in decreasing order, or with largest false the k smallest in increasing order, and their indices along axis. Both arrays have the shape of this array with length k along axis. Of equal entries, the ones with smaller indices come first, and NaN entries come last.
+        std::pair<Array<T>, Array<long>> topK(long k, long axis = -1, bool largest = true) const
+        {
+            axis = normalizeAxis(axis);
+            if (k < 0 || k > mShape[axis])
+                throw std::invalid_argument("k must be between 0 and the length of the axis.");
+
+            Coordinates resultShape = mShape;
+            resultShape[axis] = k;
+            Array<T> values = Array<T>::empty(resultShape);
+            Array<long> indices = Array<long>::empty(resultShape);
+            if (k == 0 || values.mFlatLength == 0)
+                return {values, indices};
+
+            const LineLayout lines = lineLayout(axis, values.mStrides);
+            const long length = mShape[axis], stride = mStrides[axis], outputStride = values.mStrides[axis];
+            const T *pSource = getDataPointer();
+            T *pValues = values.getDataPointer();
+            long *pIndices = indices.getDataPointer();
+
+            forEachLine(lines, mFlatLength, [=](long sourceOffset, long resultOffset)
+                        {
+                            thread_local std::vector<std::pair<T, long>> heap;
+                            if (largest)
+                                ArgReduce::lineTopK<T, true>(pSource + sourceOffset, length, stride, k, pValues + resultOffset, pIndices + resultOffset, outputStride, heap);
+                            else
+                                ArgReduce::lineTopK<T, false>(pSource + sourceOffset, length, stride, k, pValues + resultOffset, pIndices + resultOffset, outputStride, heap); });
+            return {values, indices};
+        }
+
+    private:
+        long normalizeAxis(long axis) const
+        {
+            if (axis < -mDim || axis >= mDim)
+                throw std::invalid_argument("Axis out of bounds.");
+            return axis < 0 ? axis + mDim : axis;
+        }
+
+        /// @brief The positions of the lines along some axes of an array, as the shape of the other axes and the strides of the array and a result along them
+        struct LineLayout
+        {
+            Coordinates shape;
+            Coordinates sourceStrides;
+            Coordinates resultStrides;
+        };
+
+        LineLayout lineLayout(long axis, const Coordinates &resultStrides) const
+        {
+            LineLayout layout{Coordinates(mDim - 1), Coordinates(mDim - 1), Coordinates(mDim - 1)};
+            for (long i = 0, j = 0; i < mDim; i++)
+                if (i != axis)
+                {
+                    layout.shape[j] = mShape[i];
+                    layout.sourceStrides[j] = mStrides[i];
+                    layout.resultStrides[j] = resultStrides[i];
+                    j++;
+                }
+            return layout;
+        }
+
+        /// @brief Calls line(sourceOffset, resultOffset) for every position of layout. If the lines hold at least ArgReduce::CONCURRENCY_THRESHOLD entries in total, they are split between the threads of ThreadPool::global.
+        template <typename F>
+        static void forEachLine(const LineLayout &layout, long entries, const F &line)
+        {
+            long positions = 1;
+            for (long length : layout.shape)
+                positions *= length;
+
+            auto range = [&](long from, long upto)
+            {
+                for (long p = from; p < upto; p++)
+                {
+                    long sourceOffset = 0, resultOffset = 0;
+                    for (long i = layout.shape.size() - 1, rest = p; i >= 0; i--)
+                    {
+                        const long c = rest % layout.shape[i];
+                        rest /= layout.shape[i];
+                        sourceOffset += c * layout.sourceStrides[i];
+                        resultOffset += c * layout.resultStrides[i];
+                    }
+                    line(sourceOffset, resultOffset);
+                }
+            };
+
+            if (entries >= ArgReduce::CONCURRENCY_THRESHOLD && positions > 1)
+                ThreadPool::global().parallelFor(0, positions, std::max(1l, ArgReduce::CONCURRENCY_THRESHOLD * positions / entries), range);
+            else
+                range(0, positions);
+        }
+
+        template <bool MAX>
+        Array<long> argReduce(long axis, bool keepDims) const
+        {
+            axis = normalizeAxis(axis);
+            if (mShape[axis] == 0)
+                throw std::invalid_argument("Cannot find the extremum along an empty axis.");
+
+            Coordinates keepDimsShape = mShape, reducedShape(mDim - 1);
+            keepDimsShape[axis] = 1;
+            for (long i = 0, j = 0; i < mDim; i++)
+                if (i != axis)
+                    reducedShape[j++] = mShape[i];
+
+            Array<long> result = Array<long>::constant(keepDimsShape, 0);
+            if (mShape[axis] > 1 && result.mFlatLength > 0)
+            {
+                // The result has stride 0 along axis, so it is the only axis of the canonical layout along which the result does not move. If it is not innermost, the innermost axis is reduced as columns, which for contiguous floats share their loads.
+                const CanonicalLayout<2> canonical = canonicalizeLayout<2>(mShape, {&mStrides, &result.mStrides});
+                const Coordinates &shape = canonical.shape;
+                const long dim = shape.size(), innerDim = dim - 1;
+                long reducedDim = 0;
+                while (canonical.strides[1][reducedDim] != 0)
+                    reducedDim++;
+                const bool columns = reducedDim != innerDim;
+
+                LineLayout lines{Coordinates(dim - (columns ? 2 : 1)), Coordinates(dim - (columns ? 2 : 1)), Coordinates(dim - (columns ? 2 : 1))};
+                for (long i = 0, j = 0; i < dim; i++)
+                    if (i != reducedDim && !(columns && i == innerDim))
+                    {
+                        lines.shape[j] = shape[i];
+                        lines.sourceStrides[j] = canonical.strides[0][i];
+                        lines.resultStrides[j] = canonical.strides[1][i];
+                        j++;
+                    }
+
+                const long length = shape[reducedDim], stride = canonical.strides[0][reducedDim];
+                const long columnCount = shape[innerDim], columnStride = canonical.strides[0][innerDim], resultColumnStride = canonical.strides[1][innerDim];
+                const T *pSource = getDataPointer();
+                long *pResult = result.getDataPointer();
+                forEachLine(lines, mFlatLength, [=](long sourceOffset, long resultOffset)
+                            {
+                                if (columns)
+                                    ArgReduce::columnArgs<T, MAX>(pSource + sourceOffset, columnCount, columnStride, length, stride, pResult + resultOffset, resultColumnStride);
+                                else
+                                    pResult[resultOffset] = ArgReduce::lineArg<T, MAX>(pSource + sourceOffset, length, stride); });
+            }
+
+            return keepDims ? result : std::move(result).reshape(reducedShape);
+        }
+
+        template <bool MAX>
+        Array<long> argReduce() const
+        {
+            if (mFlatLength == 0)
+                throw std::invalid_argument("Cannot find the extremum of an empty array.");
+            if (mDim == 0)
+                return Array<long>::constant({}, 0);
+
+            // The flat index is the index along the only axis of a contiguous copy
+            return contiguous().reshape(Coordinates({mFlatLength})).template argReduce<MAX>(0, false);
+        }
+
+    public:
         Array<bool> reduceAny(const Coordinates &axes, bool keepDims = false) const
         {
             if (axes.size() > mDim)
@@ -935,11 +1773,13 @@ namespace ArrayLibrary
             Coordinates newShape(mShape);
             newShape[axis] = upto - from;
             Coordinates newStrides(mStrides);
+            if (newShape[axis] == 1)
+                newStrides[axis] = 0;
             long flatlength = mFlatLength / mShape[axis] * newShape[axis];
             long offset = mOffset + from * mStrides[axis];
-            bool contiguous = mContiguous;
+            bool contiguous = isContiguousLayout(newShape, newStrides);
 
-            return Array<T>(mData, newShape, newStrides, offset, contiguous);
+            return Array<T>(mData.view(), newShape, newStrides, offset, contiguous);
         }
 
         Array<T> slice(Coordinates from, Coordinates upto, bool keepDims = false) const
@@ -953,7 +1793,6 @@ namespace ArrayLibrary
             Coordinates newStrides(0);
             long flatlength = 1;
             long offset = mOffset;
-            bool contiguous = mContiguous;
 
             for (long i = 0; i < mDim; i++)
             {
@@ -974,8 +1813,6 @@ namespace ArrayLibrary
 
                     if (from[i] != upto[i])
                     {
-                        if (i != 0)
-                            contiguous = false;
                         newShape.pushBack(upto[i] - from[i]);
                         newStrides.pushBack(mStrides[i]);
                         flatlength *= upto[i] - from[i];
@@ -994,7 +1831,7 @@ namespace ArrayLibrary
                 }
             }
 
-            return Array<T>(mData, newShape, newStrides, offset, contiguous);
+            return Array<T>(mData.view(), newShape, newStrides, offset, isContiguousLayout(newShape, newStrides));
         }
 
         explicit operator T() const
@@ -1010,9 +1847,9 @@ namespace ArrayLibrary
             return *getDataPointer();
         }
 
-        T &operator[](const Coordinates indices) const { return get(indices); }
+        const T &operator[](const Coordinates indices) const { return get(indices); }
 
-        T &get(const Coordinates &indices) const
+        const T &get(const Coordinates &indices) const
         {
             if (indices.size() != mDim)
                 throw std::invalid_argument("The index tuple does not match the array shape");
@@ -1030,7 +1867,7 @@ namespace ArrayLibrary
             return mData[combinedIndex];
         }
 
-        T &getFlat(long i) const
+        const T &getFlat(long i) const
         {
             long k = 0;
             for (long j = mDim - 1; j >= 0; j--)
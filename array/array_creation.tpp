@@ -120,6 +120,13 @@ namespace ArrayLibrary
 
         return x;
     }
+
+    /// @detail The entries of the returned array are not initialized, use it for arrays that are overwritten anyway.
+    template <DataType T>
+    Array<T> Array<T>::empty(const Coordinates &shape)
+    {
+        return Array<T>(Data<T>(calculateFlatLength(shape)), shape);
+    }
 }
 
 #endif
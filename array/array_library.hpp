@@ -5,8 +5,13 @@
 #include "array_creation.tpp"
 #include "universal_ptws.hpp"
 #include "matmul.tpp"
+#include "sparse.hpp"
+#include "normalization.hpp"
+#include "roofline.hpp"
 #include "random.hpp"
 #include "common_operations.hpp"
+#include "expression.hpp"
+#include "map_reduce.hpp"
 
 namespace ArrayLibrary
 {
@@ -20,49 +25,49 @@ namespace ArrayLibrary
     template <DataType T>
     Array<T> operator+(const T &left, const Array<T> &right)
     {
-        return Array<T>(left) + right;
+        return compute<ScalarAddition<T>>(ScalarAddition<T>(left), right);
     }
 
     template <DataType T>
     Array<T> operator+(const Array<T> &left, const T &right)
     {
-        return left + Array<T>(right);
+        return compute<ScalarAddition<T>>(ScalarAddition<T>(right), left);
     }
 
     template <DataType T>
     Array<T> operator-(const T &left, const Array<T> &right)
     {
-        return Array<T>(left) - right;
+        return compute<ScalarReverseSubtraction<T>>(ScalarReverseSubtraction<T>(left), right);
     }
 
     template <DataType T>
     Array<T> operator-(const Array<T> &left, const T &right)
     {
-        return left - Array<T>(right);
+        return compute<ScalarSubtraction<T>>(ScalarSubtraction<T>(right), left);
     }
 
     template <DataType T>
     Array<T> operator*(const T &left, const Array<T> &right)
     {
-        return Array<T>(left) * right;
+        return compute<ScalarMultiplication<T>>(ScalarMultiplication<T>(left), right);
     }
 
     template <DataType T>
     Array<T> operator*(const Array<T> &left, const T &right)
     {
-        return left * Array<T>(right);
+        return compute<ScalarMultiplication<T>>(ScalarMultiplication<T>(right), left);
     }
 
     template <DataType T>
     Array<T> operator/(const T &left, const Array<T> &right)
     {
-        return Array<T>(left) / right;
+        return compute<ScalarReverseDivision<T>>(ScalarReverseDivision<T>(left), right);
     }
 
     template <DataType T>
     Array<T> operator/(const Array<T> &left, const T &right)
     {
-        return left / Array<T>(right);
+        return compute<ScalarDivision<T>>(ScalarDivision<T>(right), left);
     }
 
     template <DataType T>
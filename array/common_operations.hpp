@@ -17,7 +17,7 @@ namespace ArrayLibrary
         const T param;
         const Simd::Vector<T> simdParam;
 
-        Assign(T param) : param(param), simdParam(Simd::broadcast_set(param)) {}
+        Assign(T param) : param(param), simdParam(Simd::broadcastParam<T>(param)) {}
 
         static inline T f(T param) { return param; }
         static inline Simd::Vector<T> fSimd(const Simd::Vector<T> param) { return param; }
@@ -31,6 +31,7 @@ namespace ArrayLibrary
     template <DataType T>
     struct Addition
     {
+        static inline T identity() { return 0; }
         static inline T f(const T x, const T y) { return x + y; }
         static inline Simd::Vector<T> fSimd(const Simd::Vector<T> x, const Simd::Vector<T> y) { return x + y; }
         constexpr static bool ignoreSimd = !Simd::supported<T>;
@@ -47,6 +48,7 @@ namespace ArrayLibrary
     template <DataType T>
     struct Multiplication
     {
+        static inline T identity() { return 1; }
         static inline T f(const T x, const T y) { return x * y; }
         static inline Simd::Vector<T> fSimd(const Simd::Vector<T> x, const Simd::Vector<T> y) { return x * y; }
         constexpr static bool ignoreSimd = !Simd::supported<T>;
@@ -60,6 +62,104 @@ namespace ArrayLibrary
         constexpr static bool ignoreSimd = !Simd::supported<T>;
     };
 
+    template <DataType T>
+    struct Maximum
+    {
+        static inline T identity() { return std::numeric_limits<T>::lowest(); }
+        static inline T f(const T x, const T y) { return x > y ? x : y; }
+        static inline Simd::Vector<T> fSimd(const Simd::Vector<T> x, const Simd::Vector<T> y) { return Simd::max<T>(x, y); }
+        constexpr static bool ignoreSimd = !Simd::supported<T>;
+    };
+
+    template <DataType T>
+    struct Minimum
+    {
+        static inline T identity() { return std::numeric_limits<T>::max(); }
+        static inline T f(const T x, const T y) { return x < y ? x : y; }
+        static inline Simd::Vector<T> fSimd(const Simd::Vector<T> x, const Simd::Vector<T> y) { return Simd::min<T>(x, y); }
+        constexpr static bool ignoreSimd = !Simd::supported<T>;
+    };
+
+    template <DataType T>
+    struct ScalarAddition
+    {
+        const T param;
+        const Simd::Vector<T> simdParam;
+
+        ScalarAddition(T param) : param(param), simdParam(Simd::broadcastParam<T>(param)) {}
+
+        static inline T f(const T y, const T x) { return x + y; }
+        static inline Simd::Vector<T> fSimd(const Simd::Vector<T> y, const Simd::Vector<T> x) { return x + y; }
+        constexpr static bool ignoreSimd = !Simd::supported<T>;
+    };
+
+    template <DataType T>
+    struct ScalarSubtraction
+    {
+        const T param;
+        const Simd::Vector<T> simdParam;
+
+        ScalarSubtraction(T param) : param(param), simdParam(Simd::broadcastParam<T>(param)) {}
+
+        static inline T f(const T y, const T x) { return x - y; }
+        static inline Simd::Vector<T> fSimd(const Simd::Vector<T> y, const Simd::Vector<T> x) { return x - y; }
+        constexpr static bool ignoreSimd = !Simd::supported<T>;
+    };
+
+    template <DataType T>
+    struct ScalarMultiplication
+    {
+        const T param;
+        const Simd::Vector<T> simdParam;
+
+        ScalarMultiplication(T param) : param(param), simdParam(Simd::broadcastParam<T>(param)) {}
+
+        static inline T f(const T y, const T x) { return x * y; }
+        static inline Simd::Vector<T> fSimd(const Simd::Vector<T> y, const Simd::Vector<T> x) { return x * y; }
+        constexpr static bool ignoreSimd = !Simd::supported<T>;
+    };
+
+    template <DataType T>
+    struct ScalarDivision
+    {
+        const T param;
+        const Simd::Vector<T> simdParam;
+
+        ScalarDivision(T param) : param(param), simdParam(Simd::broadcastParam<T>(param)) {}
+
+        static inline T f(const T y, const T x) { return x / y; }
+        static inline Simd::Vector<T> fSimd(const Simd::Vector<T> y, const Simd::Vector<T> x) { return x / y; }
+        constexpr static bool ignoreSimd = !Simd::supported<T>;
+    };
+
+    /// @brief Subtracts the input from the parameter, i.e. computes scalar - array
+    template <DataType T>
+    struct ScalarReverseSubtraction
+    {
+        const T param;
+        const Simd::Vector<T> simdParam;
+
+        ScalarReverseSubtraction(T param) : param(param), simdParam(Simd::broadcastParam<T>(param)) {}
+
+        static inline T f(const T y, const T x) { return y - x; }
+        static inline Simd::Vector<T> fSimd(const Simd::Vector<T> y, const Simd::Vector<T> x) { return y - x; }
+        constexpr static bool ignoreSimd = !Simd::supported<T>;
+    };
+
+    /// @brief Divides the parameter by the input, i.e. computes scalar / array
+    template <DataType T>
+    struct ScalarReverseDivision
+    {
+        const T param;
+        const Simd::Vector<T> simdParam;
+
+        ScalarReverseDivision(T param) : param(param), simdParam(Simd::broadcastParam<T>(param)) {}
+
+        static inline T f(const T y, const T x) { return y / x; }
+        static inline Simd::Vector<T> fSimd(const Simd::Vector<T> y, const Simd::Vector<T> x) { return y / x; }
+        constexpr static bool ignoreSimd = !Simd::supported<T>;
+    };
+
     template <DataType T>
         requires std::is_integral_v<T>
     struct Modulo
@@ -194,6 +294,8 @@ namespace ArrayLibrary
     struct Sqrt
     {
         static inline T f(const T x) { return std::sqrt(x); }
+        static inline Simd::Vector<T> fSimd(const Simd::Vector<T> x) { return Simd::sqrt<T>(x); }
+        constexpr static bool ignoreSimd = !Simd::supported<T>;
     };
 
     template <DataType T, uint8_t Power>
@@ -210,6 +312,19 @@ namespace ArrayLibrary
 
             return result;
         }
+
+        static inline Simd::Vector<T> fSimd(const Simd::Vector<T> x)
+        {
+            Simd::Vector<T> result = x;
+
+#pragma GCC unroll 4
+            for (uint8_t i = 1; i < Power; i++)
+                result = Simd::multiply<T>(result, x);
+
+            return result;
+        }
+
+        constexpr static bool ignoreSimd = !Simd::supported<T>;
     };
 
     template <DataType T>
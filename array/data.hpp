@@ -5,10 +5,17 @@
 #include <cstdlib>
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <new>
 #include "simd.hpp"
+#include "profiler.hpp"
 
 namespace ArrayLibrary
 {
+    /// @brief Counts all data buffers that have been allocated, so that tests and debug checks can verify that a code path does not allocate.
+    /// @details The counter is only incremented if DEBUG_MODE is defined, otherwise it stays zero.
+    inline std::atomic<size_t> allocationCounter = 0;
+
     template <DataType T>
     class Array;
 
@@ -23,45 +30,150 @@ namespace ArrayLibrary
         friend class Array;
 
     private:
+        /// @brief Reference counts and size of a buffer. The control block and the entries are placed in a single aligned allocation, with the entries starting at the next multiple of ALIGNMENT after the control block.
+        /// @details The counts are updated with atomic read-modify-write operations, so that handles to the same buffer can be copied and dropped on several threads at once. Increments are relaxed, since a new handle is always created from an existing one, and decrements are acquire-release, so that the writes of all other handles happen before the last one frees the buffer.
         class Control
         {
             friend class Data<T>;
 
         private:
-            T * mRaw;
-            size_t mAccessCount;
+            std::atomic<size_t> mAccessCount;
+            std::atomic<size_t> mOwnerCount;
             const size_t mSize;
-            bool mRealeased;
 
-            void release()
+            Control(size_t size) : mAccessCount(1), mOwnerCount(1), mSize(size) {}
+
+            static Control *create(size_t size)
             {
-                assertm(mAccessCount != 0, "Data has already been fully released!");
-                mAccessCount--;
+#ifdef DEBUG_MODE
+                allocationCounter++;
+#endif
+                Profiler::instant("allocate", Profiler::Category::ALLOCATION, size * sizeof(T));
+                void *pBlock = size <= SMALL_SIZE ? SmallBlockPool::acquire() : _aligned_malloc(CONTROL_BYTES + size * sizeof(T), ALIGNMENT);
+                return new (pBlock) Control(size);
+            }
 
-                if (mAccessCount == 0)
-                {
-                    _aligned_free(mRaw);
-                    mRealeased = true;
-                }
+            T *data()
+            {
+                return reinterpret_cast<T *>(reinterpret_cast<char *>(this) + CONTROL_BYTES);
             }
 
-        public:
-            Control(size_t size) : mSize(size)
+            void increment(std::atomic<size_t> &count)
             {
-                mRaw = static_cast<T *>(_aligned_malloc(size * sizeof(T), ALIGNMENT));
-                mAccessCount = 1;
-                mRealeased = false;
+                count.fetch_add(1, std::memory_order_relaxed);
             }
 
+            size_t decrement(std::atomic<size_t> &count)
+            {
+                return count.fetch_sub(1, std::memory_order_acq_rel);
+            }
+
+            void acquire(bool owner)
+            {
+                increment(mAccessCount);
+                if (owner)
+                    increment(mOwnerCount);
+            }
+
+            /// @brief Decrements the reference counts and frees the allocation if it was the last reference.
+            void release(bool owner)
+            {
+                if (owner)
+                {
+                    [[maybe_unused]] const size_t previousOwners = decrement(mOwnerCount);
+                    assertm(previousOwners != 0, "Data has more owner releases than owners!");
+                }
+
+                const size_t previous = decrement(mAccessCount);
+                assertm(previous != 0, "Data has already been fully released!");
+
+                if (previous == 1)
+                {
+                    const bool small = mSize <= SMALL_SIZE;
+                    this->~Control();
+                    if (small)
+                        SmallBlockPool::release(this);
+                    else
+                        _aligned_free(this);
+                }
+            }
+
+        public:
             Control(const Control &other) = delete;
             Control &operator=(const Control &other) = delete;
             Control(Control &&other) = delete;
             Control &operator=(Control &&other) = delete;
             Control() = delete;
+        };
+
+        static constexpr size_t CONTROL_BYTES = ((sizeof(Control) + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+
+        /// @brief Buffers with at most SMALL_SIZE entries, like scalars, bias vectors and reduction results, share one block size and are recycled by SmallBlockPool.
+        static constexpr size_t SMALL_SIZE = 4 * SIMD_BYTES / sizeof(T);
+        static constexpr size_t SMALL_BLOCK_BYTES = CONTROL_BYTES + SMALL_SIZE * sizeof(T);
+
+        /// @brief A per-thread cache of freed small blocks, so that creating small arrays does not go through the heap allocator.
+        /// @details A block may be released on a different thread than the one that allocated it, it then moves to the cache of the releasing thread.
+        class SmallBlockPool
+        {
+            static constexpr size_t CAPACITY = 256;
+
+            enum class State : char
+            {
+                UNBORN,
+                ALIVE,
+                DESTROYED
+            };
+
+            /// The state of the pool of this thread. Unlike the pool, it is trivially destructible, so it can still be read while the other thread_local objects of the thread are destroyed.
+            static inline thread_local State state = State::UNBORN;
+
+            void *mBlocks[CAPACITY];
+            size_t mCount = 0;
+
+            SmallBlockPool()
+            {
+                state = State::ALIVE;
+            }
+
+            ~SmallBlockPool()
+            {
+                state = State::DESTROYED;
+                while (mCount > 0)
+                    _aligned_free(mBlocks[--mCount]);
+            }
 
-            ~Control()
+            static SmallBlockPool &get()
             {
-                assertm(mRealeased, "Data has not been fully released!");
+                thread_local SmallBlockPool pool;
+                return pool;
+            }
+
+        public:
+            static void *acquire()
+            {
+                if (state != State::DESTROYED)
+                {
+                    SmallBlockPool &pool = get();
+                    if (pool.mCount > 0)
+                        return pool.mBlocks[--pool.mCount];
+                }
+                return _aligned_malloc(SMALL_BLOCK_BYTES, ALIGNMENT);
+            }
+
+            /// @brief Caches the block in the pool of this thread. Blocks that are released before the pool has been used or after it has been destroyed, e.g. by other thread_local objects, are freed directly.
+            static void release(void *pBlock)
+            {
+                if (state == State::ALIVE)
+                {
+                    SmallBlockPool &pool = get();
+                    if (pool.mCount < CAPACITY)
+                    {
+                        pool.mBlocks[pool.mCount++] = pBlock;
+                        return;
+                    }
+                }
+                _aligned_free(pBlock);
             }
         };
 
@@ -71,55 +183,94 @@ namespace ArrayLibrary
     private:
         T *mRaw;
         Control *mControl;
+        // Views write through to the buffer and do not count as owners for copy-on-write
+        bool mView = false;
 
         void release()
         {
             assertm(mControl != nullptr, "This Data pointer has already released its data!");
-            mControl->release();
-            if (mControl->mRealeased)
-                delete mControl;
+            mControl->release(!mView);
+            mControl = nullptr;
         }
 
     public:
         size_t size() const { return mControl->mSize; }
 
+        /// @brief The number of Data objects that currently refer to the same buffer, including views
+        size_t useCount() const { return mControl->mAccessCount.load(std::memory_order_acquire); }
+
+        /// @brief The number of Data objects that refer to the same buffer as independent values, i.e. that are not views
+        size_t ownerCount() const { return mControl->mOwnerCount.load(std::memory_order_acquire); }
+
+        bool isView() const { return mView; }
+
+        /// @brief Creates a handle to the same buffer that writes through to it without triggering copy-on-write.
+        Data<T> view() const
+        {
+            Data<T> result(*this);
+            if (!result.mView)
+            {
+                result.mControl->release(true);
+                result.mControl->acquire(false);
+                result.mView = true;
+            }
+            return result;
+        }
+
         /// @detail This constructor does not put initial values in the array, use with caution!
         Data(size_t size)
         {
-            mControl = new Control(size);
-            mRaw = mControl->mRaw;
+            mControl = Control::create(size);
+            mRaw = mControl->data();
         }
 
         Data(std::vector<T> &vector)
         {
-            mControl = new Control(vector.size());
-            mRaw = mControl->mRaw;
+            mControl = Control::create(vector.size());
+            mRaw = mControl->data();
             std::copy(vector.begin(), vector.end(), mRaw);
         }
 
         Data(const std::initializer_list<T> &values)
         {
-            mControl = new Control(values.size());
-            mRaw = mControl->mRaw;
+            mControl = Control::create(values.size());
+            mRaw = mControl->data();
             size_t i = 0;
             for (const T &value : values)
                 mRaw[i++] = value;
         }
 
-        Data(const Data<T> &other) : mControl(other.mControl), mRaw(other.mRaw)
+        Data(const Data<T> &other) : mRaw(other.mRaw), mControl(other.mControl), mView(other.mView)
+        {
+            mControl->acquire(!mView);
+        }
+
+        /// @brief Takes over the reference of other without touching the reference counts. other must not be used afterwards except for assigning to it.
+        Data(Data<T> &&other) : mRaw(other.mRaw), mControl(other.mControl), mView(other.mView)
         {
-            mControl->mAccessCount++;
+            other.mControl = nullptr;
+            other.mRaw = nullptr;
         }
 
         Data<T> &operator=(const Data<T> &other)
         {
-            if (this == &other)
+            if (mControl == other.mControl && mView == other.mView)
                 return *this;
 
-            mControl->release();
+            other.mControl->acquire(!other.mView);
+            if (mControl != nullptr)
+                release();
             mRaw = other.mRaw;
             mControl = other.mControl;
-            mControl->mAccessCount++;
+            mView = other.mView;
+            return *this;
+        }
+
+        Data<T> &operator=(Data<T> &&other)
+        {
+            std::swap(mControl, other.mControl);
+            std::swap(mRaw, other.mRaw);
+            std::swap(mView, other.mView);
             return *this;
         }
 
@@ -1,14 +1,373 @@
 #ifndef EXPRESSION_H
 #define EXPRESSION_H
 
+#include <tuple>
+
 #include "array.hpp"
+#include "universal_ptws.hpp"
+#include "common_operations.hpp"
 
 namespace ArrayLibrary
 {
-    template <DataType ResultType, DataType... InputTypes>
-    class Expression
+    template <typename... Types>
+    struct TypeList
+    {
+    };
+
+    template <typename... Lists>
+    struct ConcatTypeLists;
+
+    template <>
+    struct ConcatTypeLists<>
+    {
+        using type = TypeList<>;
+    };
+
+    template <typename... Types>
+    struct ConcatTypeLists<TypeList<Types...>>
+    {
+        using type = TypeList<Types...>;
+    };
+
+    template <typename... First, typename... Second, typename... Remainder>
+    struct ConcatTypeLists<TypeList<First...>, TypeList<Second...>, Remainder...>
+    {
+        using type = typename ConcatTypeLists<TypeList<First..., Second...>, Remainder...>::type;
+    };
+
+    template <typename Operation, typename... Operands>
+    class Expression;
+
+    /// @brief Wraps the whole expression tree into a single parametrized operation so that UniversalPointwise can evaluate it in one pass.
+    /// @details The tree itself is the parameter: its scalar leaves hold both their scalar and their broadcast SIMD value, and the array leaves are mapped to the inputs of f in order.
+    template <typename Node, typename Leaves>
+    struct FusedExpression;
+
+    template <typename Node, DataType... InputTypes>
+    struct FusedExpression<Node, TypeList<InputTypes...>>
+    {
+        using ResultType = typename Node::ResultType;
+
+        const Node &param;
+        const Node &simdParam;
+
+        FusedExpression(const Node &node) : param(node), simdParam(node) {}
+
+        static inline ResultType f(const Node &node, const InputTypes... inputs)
+        {
+            return node.template evaluate<0>(inputs...);
+        }
+
+        static inline Simd::Vector<ResultType> fSimd(const Node &node, const Simd::Vector<InputTypes>... inputs)
+        {
+            return node.template evaluateSimd<0>(inputs...);
+        }
+
+        constexpr static bool ignoreSimd = !Node::SIMD;
+    };
+
+    /// @brief Common interface of all lazy expression nodes. Nothing is computed until the expression is assigned to an array or eval() is called.
+    /// @tparam Node The derived node class
+    template <typename Node>
+    class ExpressionNode
+    {
+        const Node &self() const { return static_cast<const Node &>(*this); }
+
+        /// @brief Checks whether writing into dest while reading source could overwrite entries of source before they are read.
+        template <DataType ResultType, DataType SourceType>
+        static bool unsafeAlias(const Array<ResultType> &dest, const Array<SourceType> &source)
+        {
+            if constexpr (!std::is_same_v<ResultType, SourceType>)
+                return false;
+            else
+            {
+                const ResultType *pDestStart = dest.readDataPointer();
+                const ResultType *pSourceStart = source.readDataPointer();
+
+                if (pDestStart == pSourceStart && dest.refShape() == source.refShape() && dest.refStrides() == source.refStrides())
+                    return false;
+
+                const ResultType *pDestEnd = pDestStart;
+                for (long i = 0; i < dest.getDim(); i++)
+                    pDestEnd += dest.refStrides()[i] * (dest.refShape()[i] - 1);
+
+                const ResultType *pSourceEnd = pSourceStart;
+                for (long i = 0; i < source.getDim(); i++)
+                    pSourceEnd += source.refStrides()[i] * (source.refShape()[i] - 1);
+
+                return pDestStart <= pSourceEnd && pSourceStart <= pDestEnd;
+            }
+        }
+
+    public:
+        template <typename Operation>
+        Expression<Operation, Node> apply(const Operation &operation = Operation()) const
+        {
+            return Expression<Operation, Node>(operation, self());
+        }
+
+        auto exp() const { return apply<Exp<typename Node::ResultType>>(); }
+        auto sqrt() const { return apply<Sqrt<typename Node::ResultType>>(); }
+        auto sin() const { return apply<Sin<typename Node::ResultType>>(); }
+        auto cos() const { return apply<Cos<typename Node::ResultType>>(); }
+        auto abs() const { return apply<Abs<typename Node::ResultType>>(); }
+        auto square() const { return apply<IntPow<typename Node::ResultType, 2>>(); }
+
+        template <typename N = Node>
+        auto clip(const typename N::ResultType lower, const typename N::ResultType upper) const
+        {
+            using T = typename N::ResultType;
+            return apply<Clip<T>>(Clip<T>(lower, upper));
+        }
+
+        /// @brief The broadcasted shape of all array leaves of the expression
+        Coordinates resultShape() const
+        {
+            if constexpr (Node::LEAVES == 0)
+                return Coordinates(0);
+            else
+                return std::apply([](const auto &...leaves)
+                                  { return findOuterShape(leaves.refShape()...); }, self().leaves());
+        }
+
+        /// @brief Evaluates the expression in a single pass into a newly created array.
+        auto eval() const
+        {
+            using ResultType = typename Node::ResultType;
+            using Fused = FusedExpression<Node, typename Node::Leaves>;
+
+            if constexpr (Node::LEAVES == 0)
+                return Array<ResultType>(self().template evaluate<0>());
+            else
+                return std::apply([this](const auto &...leaves)
+                                  { return compute<Fused>(Fused(self()), leaves...); }, self().leaves());
+        }
+
+        /// @brief Evaluates the expression in a single pass and writes the result into the existing array dest.
+        /// @details If one of the array leaves overlaps with dest in a way that is not entry-by-entry, the expression is evaluated into a temporary first.
+        template <DataType ResultType>
+            requires std::is_same_v<ResultType, typename Node::ResultType>
+        Array<ResultType> &evaluateInto(Array<ResultType> &dest) const
+        {
+            using Fused = FusedExpression<Node, typename Node::Leaves>;
+
+            if constexpr (Node::LEAVES == 0)
+            {
+                dest = self().template evaluate<0>();
+                return dest;
+            }
+            else
+            {
+                const auto leaves = self().leaves();
+                const bool aliased = std::apply([&dest](const auto &...leaves)
+                                                { return (... || unsafeAlias(dest, leaves)); }, leaves);
+
+                if (aliased)
+                    return computeInPlace<Copy<ResultType>>(dest, eval());
+
+                return std::apply([this, &dest](const auto &...leaves) -> Array<ResultType> &
+                                  { return computeInPlace<Fused>(Fused(self()), dest, leaves...); }, leaves);
+            }
+        }
+    };
+
+    template <DataType T>
+    class ArrayOperand : public ExpressionNode<ArrayOperand<T>>
+    {
+        const Array<T> mArray;
+
+    public:
+        using ResultType = T;
+        using Leaves = TypeList<T>;
+        static constexpr size_t LEAVES = 1;
+        static constexpr bool SIMD = Simd::supported<T>;
+
+        ArrayOperand(const Array<T> &array) : mArray(array.view()) {}
+
+        ArrayOperand(const ArrayOperand<T> &other) : mArray(other.mArray.view()) {}
+
+        std::tuple<Array<T>> leaves() const { return std::tuple<Array<T>>(mArray.view()); }
+
+        template <size_t Offset, DataType... Inputs>
+        inline T evaluate(const Inputs... inputs) const
+        {
+            return refPackGet<Offset>(inputs...);
+        }
+
+        template <size_t Offset, typename... Inputs>
+        inline Simd::Vector<T> evaluateSimd(const Inputs &...inputs) const
+        {
+            return refPackGet<Offset>(inputs...);
+        }
+    };
+
+    /// @brief A scalar in an expression. It is not an input of the fused kernel but a parameter, so it is kept in a broadcast register instead of being read from memory.
+    template <DataType T>
+    class ScalarOperand : public ExpressionNode<ScalarOperand<T>>
     {
+        const T mValue;
+        const Simd::Vector<T> mSimdValue;
+
+    public:
+        using ResultType = T;
+        using Leaves = TypeList<>;
+        static constexpr size_t LEAVES = 0;
+        static constexpr bool SIMD = Simd::supported<T>;
+
+        ScalarOperand(const T value) : mValue(value), mSimdValue(Simd::broadcastParam<T>(value)) {}
+
+        std::tuple<> leaves() const { return std::tuple<>(); }
+
+        template <size_t Offset, DataType... Inputs>
+        inline T evaluate(const Inputs...) const
+        {
+            return mValue;
+        }
+
+        template <size_t Offset, typename... Inputs>
+        inline Simd::Vector<T> evaluateSimd(const Inputs &...) const
+        {
+            return mSimdValue;
+        }
+    };
+
+    /// @brief A lazy application of Operation to the results of the operand nodes.
+    /// @tparam Operation An operation class as in common_operations.hpp. Parametrized operations are supported, their instance is stored in the node.
+    /// @tparam ...Operands The child nodes
+    template <typename Operation, typename... Operands>
+    class Expression : public ExpressionNode<Expression<Operation, Operands...>>
+    {
+        const Operation mOperation;
+        const std::tuple<Operands...> mOperands;
+
+        static constexpr bool PARAMETRIZED = requires(const Operation &operation) { operation.param; };
+
+        /// @brief The position of the first array leaf of operand I among the array leaves of this node
+        template <size_t I>
+        static constexpr size_t leafOffset()
+        {
+            constexpr size_t leafCounts[] = {Operands::LEAVES..., 0};
+            size_t offset = 0;
+            for (size_t i = 0; i < I; i++)
+                offset += leafCounts[i];
+            return offset;
+        }
+
+        template <size_t Offset, size_t... I, DataType... Inputs>
+        inline auto evaluateOperands(std::index_sequence<I...>, const Inputs... inputs) const
+        {
+            if constexpr (PARAMETRIZED)
+                return Operation::f(mOperation.param, std::get<I>(mOperands).template evaluate<Offset + leafOffset<I>()>(inputs...)...);
+            else
+                return Operation::f(std::get<I>(mOperands).template evaluate<Offset + leafOffset<I>()>(inputs...)...);
+        }
+
+        template <size_t Offset, size_t... I, typename... Inputs>
+        inline auto evaluateOperandsSimd(std::index_sequence<I...>, const Inputs &...inputs) const
+        {
+            if constexpr (PARAMETRIZED)
+                return Operation::fSimd(mOperation.simdParam, std::get<I>(mOperands).template evaluateSimd<Offset + leafOffset<I>()>(inputs...)...);
+            else
+                return Operation::fSimd(std::get<I>(mOperands).template evaluateSimd<Offset + leafOffset<I>()>(inputs...)...);
+        }
+
+    public:
+        using ResultType = OperationResultType<Operation>;
+        using Leaves = typename ConcatTypeLists<typename Operands::Leaves...>::type;
+        static constexpr size_t LEAVES = (0 + ... + Operands::LEAVES);
+        static constexpr bool SIMD = HasSimd<Operation> && (... && Operands::SIMD) && Simd::supported<ResultType>;
+
+        Expression(const Operation &operation, const Operands &...operands) : mOperation(operation), mOperands(operands...) {}
+
+        auto leaves() const
+        {
+            return std::apply([](const auto &...operands)
+                              { return std::tuple_cat(operands.leaves()...); }, mOperands);
+        }
+
+        template <size_t Offset, DataType... Inputs>
+        inline ResultType evaluate(const Inputs... inputs) const
+        {
+            return evaluateOperands<Offset>(std::index_sequence_for<Operands...>(), inputs...);
+        }
+
+        template <size_t Offset, typename... Inputs>
+        inline Simd::Vector<ResultType> evaluateSimd(const Inputs &...inputs) const
+        {
+            return evaluateOperandsSimd<Offset>(std::index_sequence_for<Operands...>(), inputs...);
+        }
     };
+
+    /// @brief Starts a lazy expression. Arithmetic on the result builds an expression tree instead of computing intermediate arrays.
+    template <DataType T>
+    ArrayOperand<T> lazy(const Array<T> &array)
+    {
+        return ArrayOperand<T>(array);
+    }
+
+    template <typename X>
+    struct IsArrayType : std::false_type
+    {
+    };
+
+    template <DataType T>
+    struct IsArrayType<Array<T>> : std::true_type
+    {
+    };
+
+    template <typename X>
+    concept IsExpressionArgument = IsExpressionNode<X> || IsArrayType<X>::value || std::is_arithmetic_v<X>;
+
+    template <typename Left, typename Right>
+    concept IsExpressionOperands = IsExpressionArgument<Left> && IsExpressionArgument<Right> && (IsExpressionNode<Left> || IsExpressionNode<Right>);
+
+    template <DataType T, typename X>
+    auto toOperand(const X &x)
+    {
+        if constexpr (IsExpressionNode<X>)
+            return x;
+        else if constexpr (std::is_arithmetic_v<X>)
+            return ScalarOperand<T>((T)x);
+        else
+            return ArrayOperand<T>(x);
+    }
+
+    template <template <typename> typename Operation, typename Left, typename Right>
+    auto makeBinaryExpression(const Left &left, const Right &right)
+    {
+        using T = typename std::conditional_t<IsExpressionNode<Left>, Left, Right>::ResultType;
+        auto leftOperand = toOperand<T>(left);
+        auto rightOperand = toOperand<T>(right);
+        return Expression<Operation<T>, decltype(leftOperand), decltype(rightOperand)>(Operation<T>(), leftOperand, rightOperand);
+    }
+
+    template <typename Left, typename Right>
+        requires IsExpressionOperands<Left, Right>
+    auto operator+(const Left &left, const Right &right)
+    {
+        return makeBinaryExpression<Addition>(left, right);
+    }
+
+    template <typename Left, typename Right>
+        requires IsExpressionOperands<Left, Right>
+    auto operator-(const Left &left, const Right &right)
+    {
+        return makeBinaryExpression<Subtraction>(left, right);
+    }
+
+    template <typename Left, typename Right>
+        requires IsExpressionOperands<Left, Right>
+    auto operator*(const Left &left, const Right &right)
+    {
+        return makeBinaryExpression<Multiplication>(left, right);
+    }
+
+    template <typename Left, typename Right>
+        requires IsExpressionOperands<Left, Right>
+    auto operator/(const Left &left, const Right &right)
+    {
+        return makeBinaryExpression<Division>(left, right);
+    }
 }
 
-#endif
\ No newline at end of file
+#endif
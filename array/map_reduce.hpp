@@ -0,0 +1,556 @@
+#ifndef ARRAY_MAP_REDUCE_H
+#define ARRAY_MAP_REDUCE_H
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#include "array.hpp"
+#include "common_operations.hpp"
+#include "summation.hpp"
+#include "thread_pool.hpp"
+#include "universal_ptws.hpp"
+
+namespace ArrayLibrary
+{
+    /// A class Reducer satisfies IsReducer for T if it has a static f that combines two entries of type T, like Addition<T>, and a static identity() whose combination with any x is x. If the class satisfies HasSimd<Reducer>, its fSimd combines two vectors lane by lane.
+    template <typename Reducer, typename T>
+    concept IsReducer = requires(const T x, const T y) {
+        { Reducer::f(x, y) } -> std::same_as<T>;
+        { Reducer::identity() } -> std::same_as<T>;
+    };
+
+    /// @brief Reduces the results of a pointwise N-ary operation along some axes in one pass, without storing the results of the operation.
+    /// @details The sources are broadcast against each other as in UniversalPointwise, and the loop runs over the canonical layout of the sources and the dest, see canonicalizeLayout. Along the innermost axis of that layout, the operation is evaluated TILE entries at a time into a buffer on the stack, with fSimd if every source is contiguous or constant along the axis, and each tile is reduced while it is still in L1. If the innermost axis is reduced, every tile is summed up to one value and these values are accumulated as the Summation says. Otherwise, the tiles are combined with the dest entry by entry.
+    /// Large reductions are split between the threads of ThreadPool::global, over the dest entries if there are several lines of them. A single line of dest entries is split into pieces of whole tiles if it is long, and otherwise the reduced entries are split into fixed blocks, whose partial results are combined in order. So the result does not depend on the number of threads.
+    template <DataType ResultType, DataType... InputTypes>
+    class MapReduce
+    {
+        MapReduce() = delete;
+
+        static constexpr size_t N = sizeof...(InputTypes);
+        /// fSimd is only used if the vectors of all inputs have as many lanes as those of the result
+        static constexpr bool SIMD_SUPPORTED = Simd::supported<ResultType> && (... && std::is_same_v<InputTypes, ResultType>);
+        /// The number of results of the operation that are evaluated into the buffer at a time
+        static constexpr long TILE = 256;
+        /// The length of the pieces into which a long reduced line is split between the threads
+        static constexpr long SEGMENT = 0x4000;
+        static constexpr long CONCURRENCY_THRESHOLD = 0x10000;
+
+        /// @brief The entries of a source along the innermost axis of the layout
+        template <DataType T>
+        struct Line
+        {
+            const T *pData;
+            long stride;
+
+            Line<T> advanced(const long entries) const { return Line<T>{pData + entries * stride, stride}; }
+        };
+
+        using Lines = std::tuple<Line<InputTypes>...>;
+
+        /// @brief Accumulates the values of the tiles of one dest entry. If summation is PAIRWISE, the values are added along a binary tree, in which levels[l] holds the sum of 2^l tiles if bit l of count is set.
+        template <typename Reducer>
+        struct Accumulation
+        {
+            static constexpr long MAX_LEVELS = 64;
+
+            const Summation summation;
+            ResultType value = Reducer::identity();
+            ResultType compensation = 0;
+            ResultType levels[MAX_LEVELS];
+            long count = 0;
+
+            Accumulation(const Summation summation) : summation(summation) {}
+
+            void add(const ResultType x)
+            {
+                if (summation == Summation::KAHAN)
+                    CompensatedSum::kahanAdd<ResultType>(value, compensation, x);
+                else if (summation == Summation::PAIRWISE)
+                {
+                    ResultType sum = x;
+                    long level = 0;
+                    for (; (count >> level) & 1; level++)
+                        sum = levels[level] + sum;
+                    levels[level] = sum;
+                    count++;
+                }
+                else
+                    value = Reducer::f(value, x);
+            }
+
+            ResultType result() const
+            {
+                if (summation == Summation::KAHAN)
+                    return value + compensation;
+
+                if (summation == Summation::PAIRWISE)
+                {
+                    ResultType sum = 0;
+                    for (long level = 0; (count >> level) != 0; level++)
+                        if ((count >> level) & 1)
+                            sum = levels[level] + sum;
+                    return sum;
+                }
+
+                return value;
+            }
+        };
+
+        template <typename Operation, typename... Values>
+        static inline ResultType apply(const Operation &operation, const Values... values)
+        {
+            if constexpr (IsNonParametrizedOperation<Operation, InputTypes...>)
+                return Operation::f(values...);
+            else
+                return Operation::f(operation.param, values...);
+        }
+
+        template <typename Operation, typename... Vectors>
+        static inline Simd::Vector<ResultType> applySimd(const Operation &operation, const Vectors &...vectors)
+        {
+            if constexpr (IsNonParametrizedOperation<Operation, InputTypes...>)
+                return Operation::fSimd(vectors...);
+            else
+                return Operation::fSimd(operation.simdParam, vectors...);
+        }
+
+        /// @brief Writes the results of the operation for the first length entries of the lines to pTile. With SIMD, the last vector is written completely, so pTile must have room for length rounded up to whole vectors.
+        template <typename Operation>
+        static void evaluate(const Operation &operation, ResultType *pTile, const long length, const Line<InputTypes>... lines)
+        {
+            if constexpr (HasSimd<Operation> && SIMD_SUPPORTED)
+            {
+                if ((... && (lines.stride == 0 || lines.stride == 1)))
+                {
+                    constexpr long LENGTH = Simd::LENGTH<ResultType>;
+                    long i = 0;
+                    for (; i + LENGTH <= length; i += LENGTH)
+                        Simd::storeUnaligned<ResultType>(pTile + i, applySimd(operation, (lines.stride == 0 ? Simd::broadcast_set<InputTypes>(*lines.pData) : Simd::loadUnaligned<InputTypes>(lines.pData + i))...));
+                    if (i < length)
+                        Simd::storeUnaligned<ResultType>(pTile + i, applySimd(operation, (lines.stride == 0 ? Simd::broadcast_set<InputTypes>(*lines.pData) : Simd::prefixLoad<InputTypes>(lines.pData + i, length - i))...));
+                    return;
+                }
+            }
+
+            for (long i = 0; i < length; i++)
+                pTile[i] = apply(operation, lines.pData[i * lines.stride]...);
+        }
+
+        /// @brief Reduces the first length entries of a tile to one value. Sums are computed as summation says, other reductions with one accumulator per lane if Reducer has fSimd.
+        template <typename Reducer>
+        static ResultType fold(const ResultType *pTile, const long length, const Summation summation)
+        {
+            if constexpr (std::is_same_v<Reducer, Addition<ResultType>>)
+            {
+                if (summation == Summation::NAIVE)
+                    return CompensatedSum::blockSum<ResultType>(pTile, length, 1);
+                return CompensatedSum::sum<ResultType>(summation, pTile, length, 1);
+            }
+
+            ResultType value = Reducer::identity();
+            long i = 0;
+            if constexpr (HasSimd<Reducer> && Simd::supported<ResultType>)
+            {
+                constexpr long LENGTH = Simd::LENGTH<ResultType>;
+                if (length >= LENGTH)
+                {
+                    Simd::Vector<ResultType> accumulator = Simd::broadcast_set<ResultType>(Reducer::identity());
+                    for (; i + LENGTH <= length; i += LENGTH)
+                        accumulator = Reducer::fSimd(accumulator, Simd::loadUnaligned<ResultType>(pTile + i));
+
+                    ResultType lanes[LENGTH];
+                    Simd::storeUnaligned<ResultType>(lanes, accumulator);
+                    for (long l = 0; l < LENGTH; l++)
+                        value = Reducer::f(value, lanes[l]);
+                }
+            }
+
+            for (; i < length; i++)
+                value = Reducer::f(value, pTile[i]);
+            return value;
+        }
+
+        /// @brief Accumulates the results of the operation for the entries from to upto of a line whose dest entry does not move
+        template <typename Operation, typename Reducer>
+        static void accumulateLine(const Operation &operation, Accumulation<Reducer> &accumulation, const Lines &lines, const long from, const long upto)
+        {
+            alignas(SIMD_BYTES) ResultType tile[TILE];
+            for (long j = from; j < upto; j += TILE)
+            {
+                const long length = std::min(TILE, upto - j);
+                std::apply([&](const auto &...line)
+                           { evaluate(operation, tile, length, line.advanced(j)...); }, lines);
+                accumulation.add(fold<Reducer>(tile, length, accumulation.summation));
+            }
+        }
+
+        /// @brief Combines the results of the operation for the entries of a line with the dest entries along the line, which are destStride apart
+        template <typename Operation, typename Reducer>
+        static void combineLine(const Operation &operation, ResultType *pDest, const long destStride, const Lines &lines, const long length)
+        {
+            alignas(SIMD_BYTES) ResultType tile[TILE];
+            for (long j = 0; j < length; j += TILE)
+            {
+                const long tileLength = std::min(TILE, length - j);
+                std::apply([&](const auto &...line)
+                           { evaluate(operation, tile, tileLength, line.advanced(j)...); }, lines);
+
+                ResultType *pTileDest = pDest + j * destStride;
+                long i = 0;
+                if constexpr (HasSimd<Reducer> && Simd::supported<ResultType>)
+                {
+                    constexpr long LENGTH = Simd::LENGTH<ResultType>;
+                    if (destStride == 1)
+                        for (; i + LENGTH <= tileLength; i += LENGTH)
+                            Simd::storeUnaligned<ResultType>(pTileDest + i, Reducer::fSimd(Simd::loadUnaligned<ResultType>(pTileDest + i), Simd::load<ResultType>(tile + i)));
+                }
+
+                for (; i < tileLength; i++)
+                    pTileDest[i * destStride] = Reducer::f(pTileDest[i * destStride], tile[i]);
+            }
+        }
+
+        /// @brief Walks through the positions of a loop over shape, in which the operands move by strides, and keeps track of their offsets
+        struct Cursor
+        {
+            const Coordinates &shape;
+            const std::array<Coordinates, N + 1> &strides;
+            Coordinates position;
+            std::array<long, N + 1> offsets;
+
+            /// @brief Starts at the given flat position, with base added to the offsets
+            Cursor(const Coordinates &shape, const std::array<Coordinates, N + 1> &strides, long flatPosition, const std::array<long, N + 1> &base) : shape(shape), strides(strides), position(shape.size(), 0), offsets(base)
+            {
+                for (long i = shape.size() - 1; i >= 0; i--)
+                {
+                    position[i] = flatPosition % shape[i];
+                    flatPosition /= shape[i];
+                    for (size_t k = 0; k <= N; k++)
+                        offsets[k] += position[i] * strides[k][i];
+                }
+            }
+
+            void advance()
+            {
+                for (long i = shape.size() - 1; i >= 0; i--)
+                {
+                    for (size_t k = 0; k <= N; k++)
+                        offsets[k] += strides[k][i];
+                    if (++position[i] < shape[i])
+                        return;
+                    for (size_t k = 0; k <= N; k++)
+                        offsets[k] -= strides[k][i] * shape[i];
+                    position[i] = 0;
+                }
+            }
+        };
+
+        template <size_t... I>
+        static Lines makeLines(std::index_sequence<I...>, const std::tuple<const InputTypes *...> &pSources, const std::array<long, N + 1> &offsets, const std::array<long, N + 1> &strides)
+        {
+            return Lines(Line<InputTypes>{std::get<I>(pSources) + offsets[I], strides[I]}...);
+        }
+
+        /// @brief Reduces the operation into the dest entries at pDest, which have been initialized, in a loop over shape in which the dest moves by destStrides, which are 0 along the reduced axes.
+        /// @return False if a compensated sum would have to accumulate the entries of a dest entry that is not innermost across several lines, which the tiles do not support. The caller then reduces the results of the operation instead, like Array::reduceInto does.
+        template <typename Operation, typename Reducer>
+        static bool run(const Operation &operation, Summation summation, ResultType *pDest, const Coordinates &shape, const Coordinates &destStrides, const Array<InputTypes> &...sources)
+        {
+            if constexpr (!std::is_same_v<Reducer, Addition<ResultType>> || !std::is_floating_point_v<ResultType>)
+                summation = Summation::NAIVE;
+
+            const long entries = Array<ResultType>::calculateFlatLength(shape);
+            Profiler::Scope scope("map reduce", Profiler::Category::REDUCE, shape, (0 + ... + (sources.getFlatLength() * sizeof(InputTypes))), entries);
+
+            // The sources decide the order of the axes, so that they are read in memory order
+            const CanonicalLayout<N + 1> layout = canonicalizeLayout<N + 1>(shape, {&sources.refStrides()..., &destStrides});
+            const long dim = layout.shape.size();
+            const long length = layout.shape[dim - 1];
+
+            std::array<long, N + 1> strides;
+            for (size_t k = 0; k <= N; k++)
+                strides[k] = layout.strides[k][dim - 1];
+            const bool reducedLine = strides[N] == 0;
+
+            // The outer axes are split into those along which the dest moves and those that are reduced
+            Coordinates keptShape(0), reducedShape(0);
+            std::array<Coordinates, N + 1> keptStrides, reducedStrides;
+            long kept = 1, reduced = 1;
+            for (long i = 0; i < dim - 1; i++)
+            {
+                const bool keptAxis = layout.strides[N][i] != 0;
+                (keptAxis ? keptShape : reducedShape).pushBack(layout.shape[i]);
+                (keptAxis ? kept : reduced) *= layout.shape[i];
+                for (size_t k = 0; k <= N; k++)
+                    (keptAxis ? keptStrides : reducedStrides)[k].pushBack(layout.strides[k][i]);
+            }
+
+            if (summation != Summation::NAIVE && !reducedLine && reduced > 1)
+                return false;
+
+            const std::tuple<const InputTypes *...> pSources(sources.readDataPointer()...);
+            auto lines = [&](const std::array<long, N + 1> &offsets)
+            {
+                return makeLines(std::index_sequence_for<InputTypes...>(), pSources, offsets, strides);
+            };
+
+            const std::array<long, N + 1> origin{};
+
+            // With a single line of dest entries, the reduced entries are split into blocks with partial results, or the line is split into pieces
+            if (kept == 1 && entries >= CONCURRENCY_THRESHOLD)
+            {
+                static thread_local std::vector<ResultType> partials;
+
+                if (reducedLine)
+                {
+                    const long segments = (length + SEGMENT - 1) / SEGMENT;
+                    const long blocks = reduced * segments;
+                    partials.resize(blocks);
+                    ResultType *pPartials = partials.data();
+
+                    ThreadPool::global().parallelFor(0, blocks, std::max(1l, CONCURRENCY_THRESHOLD * blocks / entries), [&](long from, long upto)
+                                                     {
+                        for (long block = from; block < upto; block++)
+                        {
+                            const Cursor cursor(reducedShape, reducedStrides, block / segments, origin);
+                            const long segment = block % segments;
+                            Accumulation<Reducer> accumulation(summation);
+                            accumulateLine<Operation, Reducer>(operation, accumulation, lines(cursor.offsets), segment * SEGMENT, std::min(length, (segment + 1) * SEGMENT));
+                            pPartials[block] = accumulation.result();
+                        } });
+
+                    Accumulation<Reducer> accumulation(summation);
+                    if constexpr (std::is_same_v<Reducer, Addition<ResultType>>)
+                        accumulation.add(CompensatedSum::sum<ResultType>(summation, pPartials, blocks, 1));
+                    else
+                        for (long block = 0; block < blocks; block++)
+                            accumulation.add(pPartials[block]);
+                    *pDest = Reducer::f(*pDest, accumulation.result());
+                    return true;
+                }
+
+                // A long line is split into pieces of whole tiles, each of which is combined with all reduced lines by one thread
+                const long tiles = (length + TILE - 1) / TILE;
+                if (tiles > 1)
+                {
+                    ThreadPool::global().parallelFor(0, tiles, std::max(1l, CONCURRENCY_THRESHOLD * tiles / entries), [&](long from, long upto)
+                                                     {
+                        const long begin = from * TILE, pieceLength = std::min(length, upto * TILE) - begin;
+                        Cursor cursor(reducedShape, reducedStrides, 0, origin);
+                        for (long line = 0; line < reduced; line++, cursor.advance())
+                        {
+                            std::array<long, N + 1> offsets = cursor.offsets;
+                            for (size_t k = 0; k <= N; k++)
+                                offsets[k] += begin * strides[k];
+                            combineLine<Operation, Reducer>(operation, pDest + offsets[N], strides[N], lines(offsets), pieceLength);
+                        } });
+                    return true;
+                }
+
+                if (reduced > 1)
+                {
+                    const long linesPerBlock = std::max(1l, SEGMENT / length);
+                    const long blocks = (reduced + linesPerBlock - 1) / linesPerBlock;
+                    partials.assign(blocks * length, Reducer::identity());
+                    ResultType *pPartials = partials.data();
+
+                    ThreadPool::global().parallelFor(0, blocks, std::max(1l, CONCURRENCY_THRESHOLD * blocks / entries), [&](long from, long upto)
+                                                     {
+                        for (long block = from; block < upto; block++)
+                        {
+                            const long first = block * linesPerBlock;
+                            Cursor cursor(reducedShape, reducedStrides, first, origin);
+                            for (long line = first; line < std::min(reduced, first + linesPerBlock); line++, cursor.advance())
+                                combineLine<Operation, Reducer>(operation, pPartials + block * length, 1, lines(cursor.offsets), length);
+                        } });
+
+                    for (long block = 0; block < blocks; block++)
+                        for (long i = 0; i < length; i++)
+                            pDest[i * strides[N]] = Reducer::f(pDest[i * strides[N]], pPartials[block * length + i]);
+                    return true;
+                }
+            }
+
+            // Otherwise every dest line is reduced by one thread
+            auto keptRange = [&](long from, long upto)
+            {
+                Cursor keptCursor(keptShape, keptStrides, from, origin);
+                for (long position = from; position < upto; position++, keptCursor.advance())
+                {
+                    ResultType *pEntry = pDest + keptCursor.offsets[N];
+                    Accumulation<Reducer> accumulation(summation);
+
+                    Cursor cursor(reducedShape, reducedStrides, 0, keptCursor.offsets);
+                    for (long line = 0; line < reduced; line++, cursor.advance())
+                    {
+                        if (reducedLine)
+                            accumulateLine<Operation, Reducer>(operation, accumulation, lines(cursor.offsets), 0, length);
+                        else
+                            combineLine<Operation, Reducer>(operation, pEntry, strides[N], lines(cursor.offsets), length);
+                    }
+
+                    if (reducedLine)
+                        *pEntry = Reducer::f(*pEntry, accumulation.result());
+                }
+            };
+
+            if (entries >= CONCURRENCY_THRESHOLD && kept > 1)
+                ThreadPool::global().parallelFor(0, kept, std::max(1l, CONCURRENCY_THRESHOLD * kept / entries), keptRange);
+            else
+                keptRange(0, kept);
+            return true;
+        }
+
+        static void validateAxes(const Coordinates &axes, const long dim)
+        {
+            if (axes.size() > dim)
+                throw std::invalid_argument("Too many axes for array dimension.");
+
+            for (long i = 0; i < axes.size(); i++)
+                if (axes[i] < -dim || axes[i] >= dim)
+                    throw std::invalid_argument("Axis out of bounds.");
+        }
+
+        /// @brief The strides of dest in a loop over shape, which are 0 along the reduced axes. As for Array::reduceInto, dest either has the shape of the reduction with keepDims, where trivial axes on the left may be omitted, or the shape with the reduced axes removed.
+        static Coordinates destStrides(const Array<ResultType> &dest, const Coordinates &shape, const Coordinates &axes, const Coordinates &keepDimsShape)
+        {
+            const long dim = shape.size();
+            bool reduced[MAX_DIM] = {false};
+            long reducedCount = 0;
+            for (long k = 0; k < axes.size(); k++)
+            {
+                const long axis = axes[k] < 0 ? axes[k] + dim : axes[k];
+                reducedCount += reduced[axis] ? 0 : 1;
+                reduced[axis] = true;
+            }
+
+            Coordinates strides(dim, 0);
+            bool droppedAxes = dest.getDim() < dim && dest.getDim() == dim - reducedCount;
+
+            for (long i = 0, j = 0; droppedAxes && i < dim; i++)
+            {
+                if (reduced[i])
+                    continue;
+                if (dest.refShape()[j] != shape[i])
+                    droppedAxes = false;
+                else
+                    strides[i] = dest.refShape()[j] == 1 ? 0 : dest.refStrides()[j];
+                j++;
+            }
+
+            if (!droppedAxes)
+            {
+                if (dest.getDim() > dim)
+                    throw std::invalid_argument("The destination array has too many dimensions for the reduction.");
+
+                const long shift = dim - dest.getDim();
+                for (long i = 0; i < dim; i++)
+                {
+                    const long axisLength = i < shift ? 1 : dest.refShape()[i - shift];
+                    if (axisLength != keepDimsShape[i])
+                        throw std::invalid_argument("The shape of the destination array does not match the reduction.");
+                    strides[i] = axisLength == 1 ? 0 : dest.refStrides()[i - shift];
+                }
+            }
+
+            return strides;
+        }
+
+    public:
+        template <typename Operation, typename Reducer>
+        static Array<ResultType> mapReduce(const Operation &operation, const Coordinates &axes, const Array<InputTypes> &...sources)
+        {
+            const Coordinates shape = findOuterShape(sources.refShape()...);
+            validateAxes(axes, shape.size());
+
+            const ReduceInformation reduceInfo = reduceShape(shape, axes, false);
+            const Coordinates &keepDimsShape = reduceInfo.keepDimsShape;
+            const Coordinates &keepDimsStrides = reduceInfo.keepDimsStrides;
+
+            Data<ResultType> data(Array<ResultType>::calculateFlatLength(keepDimsShape));
+            data = Reducer::identity();
+            Array<ResultType> dest(data, keepDimsShape, keepDimsStrides, 0, true);
+
+            // Reductions other than sums always succeed
+            run<Operation, Reducer>(operation, Summation::NAIVE, dest.getDataPointer(), shape, keepDimsStrides, sources.leftExpandDim(shape.size() - sources.getDim())...);
+            return dest.reshape(reduceInfo.reducedShape);
+        }
+
+        template <typename Operation, typename Reducer>
+        static Array<ResultType> &mapReduceInto(const Operation &operation, Array<ResultType> &dest, const Coordinates &axes, const Summation summation, const Array<InputTypes> &...sources)
+        {
+            dest.copyOnWrite();
+
+            const Coordinates shape = findOuterShape(sources.refShape()...);
+            validateAxes(axes, shape.size());
+
+            const Coordinates keepDimsShape = reduceShape(shape, axes, true).keepDimsShape;
+            const Coordinates strides = destStrides(dest, shape, axes, keepDimsShape);
+            Array<ResultType> destView(dest.mData.view(), keepDimsShape, strides, dest.mOffset, false);
+            destView = Reducer::identity();
+
+            if (!run<Operation, Reducer>(operation, summation, destView.getDataPointer(), shape, strides, sources.leftExpandDim(shape.size() - sources.getDim())...))
+            {
+                if constexpr (IsNonParametrizedOperation<Operation, InputTypes...>)
+                    compute<Operation>(sources...).template reduceInto<ResultType, Array<ResultType>::add>(dest, 0, axes, false, summation);
+                else
+                    compute<Operation>(operation, sources...).template reduceInto<ResultType, Array<ResultType>::add>(dest, 0, axes, false, summation);
+            }
+
+            return dest;
+        }
+    };
+
+    /// @brief Reduces an N-ary pointwise operation of the sources along axes in a single pass, without storing the results of the operation, see MapReduce.
+    /// @tparam Operation An operation class for a computation that does NOT have a parameter, as for compute
+    /// @tparam Reducer How the results are combined, see IsReducer. By default they are summed.
+    /// @param axes The axes of the broadcast shape of the sources that are reduced, which are removed from the result
+    /// @return The newly created array
+    template <typename Operation, typename Reducer = Addition<OperationResultType<Operation>>, DataType... InputTypes>
+        requires(IsNonParametrizedOperation<Operation, InputTypes...> && IsReducer<Reducer, OperationResultType<Operation>>)
+    Array<OperationResultType<Operation>> mapReduce(const Coordinates &axes, const Array<InputTypes> &...sources)
+    {
+        if (!isExtensionBroadcastable(sources.refShape()...))
+            throw std::invalid_argument("The shapes of the input arrays cannot be broadcasted to match.");
+        return MapReduce<OperationResultType<Operation>, InputTypes...>::template mapReduce<Operation, Reducer>(Operation(), axes, sources...);
+    }
+
+    /// @brief Like mapReduce, for an operation class for a computation that DOES have a parameter
+    /// @param operation An instance of Operation which holds the parameter
+    template <typename Operation, typename Reducer = Addition<OperationResultType<Operation>>, DataType... InputTypes>
+        requires(IsParametrizedOperation<Operation, InputTypes...> && IsReducer<Reducer, OperationResultType<Operation>>)
+    Array<OperationResultType<Operation>> mapReduce(const Operation &operation, const Coordinates &axes, const Array<InputTypes> &...sources)
+    {
+        if (!isExtensionBroadcastable(sources.refShape()...))
+            throw std::invalid_argument("The shapes of the input arrays cannot be broadcasted to match.");
+        return MapReduce<OperationResultType<Operation>, InputTypes...>::template mapReduce<Operation, Reducer>(operation, axes, sources...);
+    }
+
+    /// @brief Like mapReduce, but writes the result into an existing array.
+    /// @param dest Either has the shape of the reduction with keepDims (trivial axes on the left may be omitted) or the shape with the reduced axes removed, as for Array::reduceInto
+    /// @param summation How the results are summed if Reducer is Addition of floating point entries, see Summation. It is ignored otherwise.
+    /// @return A reference to dest
+    template <typename Operation, typename Reducer = Addition<OperationResultType<Operation>>, DataType... InputTypes>
+        requires(IsNonParametrizedOperation<Operation, InputTypes...> && IsReducer<Reducer, OperationResultType<Operation>>)
+    Array<OperationResultType<Operation>> &mapReduceInto(Array<OperationResultType<Operation>> &dest, const Coordinates &axes, const Summation summation, const Array<InputTypes> &...sources)
+    {
+        if (!isExtensionBroadcastable(sources.refShape()...))
+            throw std::invalid_argument("The shapes of the input arrays cannot be broadcasted to match.");
+        return MapReduce<OperationResultType<Operation>, InputTypes...>::template mapReduceInto<Operation, Reducer>(Operation(), dest, axes, summation, sources...);
+    }
+
+    /// @brief Like mapReduceInto, for an operation class for a computation that DOES have a parameter
+    /// @param operation An instance of Operation which holds the parameter
+    template <typename Operation, typename Reducer = Addition<OperationResultType<Operation>>, DataType... InputTypes>
+        requires(IsParametrizedOperation<Operation, InputTypes...> && IsReducer<Reducer, OperationResultType<Operation>>)
+    Array<OperationResultType<Operation>> &mapReduceInto(const Operation &operation, Array<OperationResultType<Operation>> &dest, const Coordinates &axes, const Summation summation, const Array<InputTypes> &...sources)
+    {
+        if (!isExtensionBroadcastable(sources.refShape()...))
+            throw std::invalid_argument("The shapes of the input arrays cannot be broadcasted to match.");
+        return MapReduce<OperationResultType<Operation>, InputTypes...>::template mapReduceInto<Operation, Reducer>(operation, dest, axes, summation, sources...);
+    }
+}
+
+#endif
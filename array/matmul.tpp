@@ -1,9 +1,18 @@
 #ifndef ARRAY_MATMUL_H
 #define ARRAY_MATMUL_H
 
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+
 #include "array.hpp"
 #include "simd.hpp"
+#include "summation.hpp"
 #include "array_creation.tpp"
+#include "thread_pool.hpp"
 
 namespace ArrayLibrary
 {
@@ -69,7 +78,7 @@ namespace ArrayLibrary
                         }
                         pLeftData = pLeftSave;
                         pRightData = pRightSave + rightFreeStride;
-                        *pResultData = sum;
+                        *pResultData += sum;
                         pResultData += resultRightStride;
                     }
                     pLeftData += leftFreeStride;
@@ -83,7 +92,7 @@ namespace ArrayLibrary
                 {
                     for (long j = 0; j < rightLength; j++)
                     {
-                        *pResultData = *pLeftData * *pRightData;
+                        *pResultData += *pLeftData * *pRightData;
                         pRightData += rightFreeStride;
                         pResultData += resultRightStride;
                     }
@@ -178,13 +187,155 @@ namespace ArrayLibrary
             }
         }
 
+        /// @brief This matrix product function only assumes that resultRightStride is 1. The entries of right along its free axis are gathered, so rightFreeStride can be arbitrary.
+        /// @details Each strip of Simd::LENGTH<T> columns of right is gathered once per block of PRODUCT_BLOCK entries along the product axis and then reused for every row of left.
+        template <DataType T>
+        void inline simdGatherMatmulAlongRightFreeAxis(const T *pLeftData, const T *pRightData, T *pResultData, const long leftLength, const long rightLength, const long productLength, const long leftFreeStride, const long leftProductStride, const long rightFreeStride, const long rightProductStride, const long resultLeftStride, [[maybe_unused]] const long resultRightStride)
+        {
+            assertm(resultRightStride == 1, "The gather kernel writes the result contiguously along the free axis of right.");
+            constexpr long LENGTH = Simd::LENGTH<T>;
+            constexpr long PRODUCT_BLOCK = 64;
+            const __m256i index = Simd::strideIndex<T>(rightFreeStride);
+            Simd::Vector<T> strip[PRODUCT_BLOCK];
+
+            for (long j = 0; j < rightLength; j += LENGTH)
+            {
+                const long width = std::min(LENGTH, rightLength - j);
+                const auto mask = Simd::makeTypePrefixMask<T>(width);
+
+                for (long k0 = 0; k0 < productLength; k0 += PRODUCT_BLOCK)
+                {
+                    const long depth = std::min(PRODUCT_BLOCK, productLength - k0);
+                    const T *pRight = pRightData + k0 * rightProductStride + j * rightFreeStride;
+                    for (long k = 0; k < depth; k++)
+                        strip[k] = Simd::prefixGather<T>(pRight + k * rightProductStride, index, width);
+
+                    for (long i = 0; i < leftLength; i++)
+                    {
+                        const T *pLeft = pLeftData + i * leftFreeStride + k0 * leftProductStride;
+                        T *pResult = pResultData + i * resultLeftStride + j;
+
+                        auto c = Simd::maskedLoad<T>(pResult, mask);
+                        for (long k = 0; k < depth; k++)
+                            c = Simd::fusedMultiplyAdd<T>(Simd::broadcast_set<T>(pLeft[k * leftProductStride]), strip[k], c);
+                        Simd::maskedStore<T>(pResult, mask, c);
+                    }
+                }
+            }
+        }
+
+        /// @brief This matrix product function only assumes that resultLeftStride is 1, and gathers the entries of left along its free axis
+        template <DataType T>
+        void inline simdGatherMatmulAlongLeftFreeAxis(const T *pLeftData, const T *pRightData, T *pResultData, const long leftLength, const long rightLength, const long productLength, const long leftFreeStride, const long leftProductStride, const long rightFreeStride, const long rightProductStride, const long resultLeftStride, const long resultRightStride)
+        {
+            simdGatherMatmulAlongRightFreeAxis<T>(pRightData, pLeftData, pResultData, rightLength, leftLength, productLength, rightFreeStride, rightProductStride, leftFreeStride, leftProductStride, resultRightStride, resultLeftStride);
+        }
+
+        /// @brief The longest free or product axis for which simdSmallMatmul is used
+        constexpr long SMALL_MATRIX_LENGTH = 16;
+
+        /// @brief Accumulates ROWS rows of the result in VECTORS registers each over the product axis, reading the rows of right from a panel packed by simdSmallMatmul. The rows are independent chains of multiply-adds that share the loads from the panel.
+        template <DataType T, long VECTORS, long ROWS>
+        void inline simdSmallMatmulRows(const T *pLeftData, const Simd::Vector<T> *pPanel, T *pResultData, const long rightLength, const long productLength, const long leftFreeStride, const long leftProductStride, const long resultLeftStride)
+        {
+            constexpr long LENGTH = Simd::LENGTH<T>;
+            const auto mask = Simd::makeTypePrefixMask<T>(rightLength - (VECTORS - 1) * LENGTH);
+
+            // The unroll counts are literals, since not every compiler accepts template arguments in the pragma. 4 and 2 are the largest ROWS and VECTORS that simdSmallMatmulPanel uses.
+            Simd::Vector<T> acc[ROWS][VECTORS];
+#pragma GCC unroll 4
+            for (long r = 0; r < ROWS; r++)
+            {
+                T *pResult = pResultData + r * resultLeftStride;
+#pragma GCC unroll 2
+                for (long v = 0; v + 1 < VECTORS; v++)
+                    acc[r][v] = Simd::loadUnaligned<T>(pResult + v * LENGTH);
+                acc[r][VECTORS - 1] = Simd::maskedLoad<T>(pResult + (VECTORS - 1) * LENGTH, mask);
+            }
+
+#pragma GCC unroll 16
+            for (long k = 0; k < productLength; k++)
+            {
+#pragma GCC unroll 4
+                for (long r = 0; r < ROWS; r++)
+                {
+                    const auto a = Simd::broadcast_set<T>(pLeftData[r * leftFreeStride + k * leftProductStride]);
+#pragma GCC unroll 2
+                    for (long v = 0; v < VECTORS; v++)
+                        acc[r][v] = Simd::fusedMultiplyAdd<T>(a, pPanel[k * VECTORS + v], acc[r][v]);
+                }
+            }
+
+#pragma GCC unroll 4
+            for (long r = 0; r < ROWS; r++)
+            {
+                T *pResult = pResultData + r * resultLeftStride;
+#pragma GCC unroll 2
+                for (long v = 0; v + 1 < VECTORS; v++)
+                    Simd::storeUnaligned<T>(pResult + v * LENGTH, acc[r][v]);
+                Simd::maskedStore<T>(pResult + (VECTORS - 1) * LENGTH, mask, acc[r][VECTORS - 1]);
+            }
+        }
+
+        /// @brief Runs simdSmallMatmulRows on blocks of four rows, and on the remaining rows one at a time
+        template <DataType T, long VECTORS>
+        void inline simdSmallMatmulPanel(const T *pLeftData, const Simd::Vector<T> *pPanel, T *pResultData, const long leftLength, const long rightLength, const long productLength, const long leftFreeStride, const long leftProductStride, const long resultLeftStride)
+        {
+            constexpr long ROWS = 4;
+            long i = 0;
+            for (; i + ROWS <= leftLength; i += ROWS)
+                simdSmallMatmulRows<T, VECTORS, ROWS>(pLeftData + i * leftFreeStride, pPanel, pResultData + i * resultLeftStride, rightLength, productLength, leftFreeStride, leftProductStride, resultLeftStride);
+            for (; i < leftLength; i++)
+                simdSmallMatmulRows<T, VECTORS, 1>(pLeftData + i * leftFreeStride, pPanel, pResultData + i * resultLeftStride, rightLength, productLength, leftFreeStride, leftProductStride, resultLeftStride);
+        }
+
+        /// @brief This matrix product function is for matrices whose axes are at most SMALL_MATRIX_LENGTH long, e.g. the many small products of a batch, and only assumes that resultRightStride or resultLeftStride is 1.
+        /// @details Right is packed into a panel of vectors on the stack of the calling thread, so that its strides are arbitrary and each thread of a batched product has its own buffer. Blocks of rows of the result then stay in registers, at most SMALL_MATRIX_LENGTH / Simd::LENGTH<T> per row, while the unrolled loop over the product axis runs.
+        template <DataType T>
+        void inline simdSmallMatmul(const T *pLeftData, const T *pRightData, T *pResultData, const long leftLength, const long rightLength, const long productLength, const long leftFreeStride, const long leftProductStride, const long rightFreeStride, const long rightProductStride, const long resultLeftStride, const long resultRightStride)
+        {
+            if (resultRightStride != 1 && resultLeftStride == 1)
+            {
+                simdSmallMatmul<T>(pRightData, pLeftData, pResultData, rightLength, leftLength, productLength, rightFreeStride, rightProductStride, leftFreeStride, leftProductStride, resultRightStride, resultLeftStride);
+                return;
+            }
+
+            constexpr long LENGTH = Simd::LENGTH<T>;
+            constexpr long MAX_VECTORS = (SMALL_MATRIX_LENGTH + LENGTH - 1) / LENGTH;
+            const long vectors = rightLength <= LENGTH ? 1 : MAX_VECTORS;
+            Simd::Vector<T> panel[SMALL_MATRIX_LENGTH * MAX_VECTORS];
+
+            for (long k = 0; k < productLength; k++)
+            {
+                const T *pRight = pRightData + k * rightProductStride;
+                for (long v = 0; v < vectors; v++)
+                {
+                    const long width = std::clamp(rightLength - v * LENGTH, 0l, LENGTH);
+                    if (rightFreeStride == 1)
+                        panel[k * vectors + v] = Simd::maskedLoad<T>(pRight + v * LENGTH, Simd::makeTypePrefixMask<T>(width));
+                    else
+                    {
+                        alignas(SIMD_BYTES) T entries[LENGTH] = {};
+                        for (long j = 0; j < width; j++)
+                            entries[j] = pRight[(v * LENGTH + j) * rightFreeStride];
+                        panel[k * vectors + v] = Simd::load<T>(entries);
+                    }
+                }
+            }
+
+            if (vectors == 1)
+                simdSmallMatmulPanel<T, 1>(pLeftData, panel, pResultData, leftLength, rightLength, productLength, leftFreeStride, leftProductStride, resultLeftStride);
+            else
+                simdSmallMatmulPanel<T, MAX_VECTORS>(pLeftData, panel, pResultData, leftLength, rightLength, productLength, leftFreeStride, leftProductStride, resultLeftStride);
+        }
+
         template <DataType T, uint8_t LANES>
         inline T simdInnerProduct(const T *pLeftData, const T *pRightData, const long axisLength)
         {
             constexpr uint8_t LENGTH = Simd::LENGTH<T>;
             SimdVector<T> acc[LANES];
 
-#pragma GCC unroll LANES
+#pragma GCC unroll 4
             for (uint8_t i = 0; i < LANES; i++)
             {
                 acc[i] = Simd::broadcast_set<T>((T)0);
@@ -192,7 +343,7 @@ namespace ArrayLibrary
 
             for (long k = 0; k + LENGTH * LANES <= axisLength; k += LENGTH * LANES)
             {
-#pragma GCC unroll LANES
+#pragma GCC unroll 4
                 for (uint8_t i = 0; i < LANES; i++)
                 {
                     auto left = Simd::load(pLeftData + LENGTH * i);
@@ -210,7 +361,7 @@ namespace ArrayLibrary
             auto right = Simd::maskedLoad(pRightData, mask);
             acc[0] = Simd::fusedMultiplyAdd<T>(left, right, acc[0]);
 
-#pragma GCC unroll LANES
+#pragma GCC unroll 4
             for (uint8_t i = 1; i < LANES; i++)
             {
                 auto mask = Simd::makeTypePrefixMask<T>(leftover - LENGTH * i);
@@ -242,7 +393,7 @@ namespace ArrayLibrary
             {
                 for (long j = 0; j < rightLength; j++)
                 {
-                    *pResultData = simdInnerProduct<T, LANES>(pLeftData, pRightData, productLength);
+                    *pResultData += simdInnerProduct<T, LANES>(pLeftData, pRightData, productLength);
 
                     pResultData += resultRightStride;
                     pRightData += rightFreeStride;
@@ -257,8 +408,78 @@ namespace ArrayLibrary
         template <DataType T>
         using f2DimMultiplier_t = decltype(matmulBoost<T>);
 
+        /// @brief The two-dimensional kernels that matmulDispatcher can run, see kernelFits for the layouts they need
+        enum class MatmulKernel
+        {
+            SCALAR,
+            PRODUCT_AXIS,
+            RIGHT_FREE_AXIS,
+            LEFT_FREE_AXIS,
+            GATHER_RIGHT_FREE_AXIS,
+            GATHER_LEFT_FREE_AXIS,
+            SMALL
+        };
+
+        /// @brief Which axis matmul copies operands to be contiguous along before the kernel runs
+        enum class MatmulPacking
+        {
+            NONE,
+            /// Both operands along the product axis, for the kernel along the product axis
+            PRODUCT_AXIS,
+            /// The operand of the free axis along which the kernel runs, i.e. right for RIGHT_FREE_AXIS and left for LEFT_FREE_AXIS, e.g. a transposed operand
+            FREE_AXIS
+        };
+
+        /// @brief How matmul computes a product: whether operands are packed first, which kernel runs, how the free axes are blocked and how many threads share the work.
+        struct MatmulConfig
+        {
+            MatmulPacking pack = MatmulPacking::NONE;
+            MatmulKernel kernel = MatmulKernel::SCALAR;
+            /// The number of rows of left per block, or 0 for no blocking
+            long rowBlock = 0;
+            /// The number of columns of right per block, or 0 for no blocking
+            long columnBlock = 0;
+            long threads = 1;
+
+            bool operator==(const MatmulConfig &other) const = default;
+        };
+
+        /// @brief Products with at least this many multiply-adds per matrix are split between threads if MatmulSettings::multiThread is set and the product is not autotuned
+        constexpr long CONCURRENCY_THRESHOLD = 0x10000;
+
+        /// @brief Calls f on blocks of at most config.rowBlock rows of left and config.columnBlock columns of right, and splits the longer of the two free axes between config.threads threads of ThreadPool::global.
+        /// @details The columns are the outer loop, so that the panel of right that a block of columns reads is reused for all rows of left. Every kernel computes each entry of the result over the whole product axis, so the blocks and chunks write disjoint entries and the result does not depend on the blocking.
+        template <DataType T, f2DimMultiplier_t<T> f>
+        void blockedMatmul(const T *pLeftData, const T *pRightData, T *pResultData, const long leftLength, const long rightLength, const long productLength, const long leftFreeStride, const long leftProductStride, const long rightFreeStride, const long rightProductStride, const long resultLeftStride, const long resultRightStride, const MatmulConfig &config)
+        {
+            if (config.rowBlock <= 0 && config.columnBlock <= 0 && config.threads <= 1)
+            {
+                f(pLeftData, pRightData, pResultData, leftLength, rightLength, productLength, leftFreeStride, leftProductStride, rightFreeStride, rightProductStride, resultLeftStride, resultRightStride);
+                return;
+            }
+
+            const long rowBlock = config.rowBlock > 0 ? config.rowBlock : leftLength;
+            const long columnBlock = config.columnBlock > 0 ? config.columnBlock : rightLength;
+
+            auto blocks = [&](long rowFrom, long rowUpto, long columnFrom, long columnUpto)
+            {
+                for (long j = columnFrom; j < columnUpto; j += columnBlock)
+                    for (long i = rowFrom; i < rowUpto; i += rowBlock)
+                        f(pLeftData + i * leftFreeStride, pRightData + j * rightFreeStride, pResultData + i * resultLeftStride + j * resultRightStride, std::min(rowBlock, rowUpto - i), std::min(columnBlock, columnUpto - j), productLength, leftFreeStride, leftProductStride, rightFreeStride, rightProductStride, resultLeftStride, resultRightStride);
+            };
+
+            if (config.threads <= 1)
+                blocks(0, leftLength, 0, rightLength);
+            else if (leftLength >= rightLength)
+                ThreadPool::global().parallelFor(0, leftLength, (leftLength + config.threads - 1) / config.threads, [&](long from, long upto)
+                                                 { blocks(from, upto, 0, rightLength); });
+            else
+                ThreadPool::global().parallelFor(0, rightLength, (rightLength + config.threads - 1) / config.threads, [&](long from, long upto)
+                                                 { blocks(0, leftLength, from, upto); });
+        }
+
         template <DataType T, f2DimMultiplier_t<T> f>
-        void baseMatmul(const Coordinates &leftShape, const Coordinates &leftStrides, const T *pLeftData, const Coordinates &rightShape, const Coordinates &rightStrides, const T *pRightData, const Coordinates &resultShape, const Coordinates &resultStrides, T *pResultData, long leftProductAxis, long rightProductAxis)
+        void baseMatmul(const Coordinates &leftShape, const Coordinates &leftStrides, const T *pLeftData, const Coordinates &rightShape, const Coordinates &rightStrides, const T *pRightData, const Coordinates &resultShape, const Coordinates &resultStrides, T *pResultData, long leftProductAxis, long rightProductAxis, const MatmulConfig &config)
         {
             const long productAxisLength = leftShape[leftProductAxis];
             const long leftProductStride = leftStrides[leftProductAxis], rightProductStride = rightStrides[rightProductAxis];
@@ -279,12 +500,65 @@ namespace ArrayLibrary
                     outerShape[i] = std::max({leftShape[i], rightShape[i], resultShape[i]});
             }
 
+            // For low dimensions, loop over the axes other than the product axes with compile-time nesting
+            Coordinates staticShape(0), leftOuterStrides(0), rightOuterStrides(0), resultOuterStrides(0);
+            for (long i = 0; i < dim; i++)
+            {
+                if (i == leftProductAxis || i == rightProductAxis)
+                    continue;
+                staticShape.pushBack(outerShape[i]);
+                leftOuterStrides.pushBack(leftShape[i] == 1 ? 0 : leftStrides[i]);
+                rightOuterStrides.pushBack(rightShape[i] == 1 ? 0 : rightStrides[i]);
+                resultOuterStrides.pushBack(resultShape[i] == 1 ? 0 : resultStrides[i]);
+            }
+
+            // A batch with at least one matrix product per thread is split between the threads as consecutive groups of products, unless products of a reduced axis accumulate into the same result
+            long batchCount = 1;
+            bool disjointResults = true;
+            for (long i = 0; i < staticShape.size(); i++)
+            {
+                batchCount *= staticShape[i];
+                disjointResults &= staticShape[i] == 1 || resultOuterStrides[i] != 0;
+            }
+
+            if (config.threads > 1 && batchCount >= config.threads && disjointResults)
+            {
+                MatmulConfig productConfig = config;
+                productConfig.threads = 1;
+                ThreadPool::global().parallelFor(0, batchCount, (batchCount + config.threads - 1) / config.threads, [&](long from, long upto)
+                                                 {
+                                                     for (long b = from; b < upto; b++)
+                                                     {
+                                                         const T *pLeft = pLeftData, *pRight = pRightData;
+                                                         T *pResult = pResultData;
+                                                         for (long i = staticShape.size() - 1, index = b; i >= 0; i--)
+                                                         {
+                                                             const long c = index % staticShape[i];
+                                                             index /= staticShape[i];
+                                                             pLeft += c * leftOuterStrides[i];
+                                                             pRight += c * rightOuterStrides[i];
+                                                             pResult += c * resultOuterStrides[i];
+                                                         }
+                                                         blockedMatmul<T, f>(pLeft, pRight, pResult, leftLength, rightLength, productAxisLength, leftFreeStride, leftProductStride, rightFreeStride, rightProductStride, resultLeftStride, resultRightStride, productConfig);
+                                                     } });
+                return;
+            }
+
+            auto product = [=](StridedPointer<const T> left, StridedPointer<const T> right, StridedPointer<T> result)
+            {
+                blockedMatmul<T, f>(left.pData, right.pData, result.pData, leftLength, rightLength, productAxisLength, leftFreeStride, leftProductStride, rightFreeStride, rightProductStride, resultLeftStride, resultRightStride, config);
+            };
+
+            if (dispatchStaticRank(staticShape.size(), [&]<long RANK>()
+                                   { staticNestedLoop<RANK>(staticShape, product, StridedPointer<const T>{pLeftData, leftOuterStrides}, StridedPointer<const T>{pRightData, rightOuterStrides}, StridedPointer<T>{pResultData, resultOuterStrides}); }))
+                return;
+
             Coordinates c(dim, 0);
 
             bool end = false;
             while (!end)
             {
-                f(pLeftData, pRightData, pResultData, leftLength, rightLength, productAxisLength, leftFreeStride, leftProductStride, rightFreeStride, rightProductStride, resultLeftStride, resultRightStride);
+                blockedMatmul<T, f>(pLeftData, pRightData, pResultData, leftLength, rightLength, productAxisLength, leftFreeStride, leftProductStride, rightFreeStride, rightProductStride, resultLeftStride, resultRightStride, config);
 
                 end = true;
 
@@ -315,31 +589,165 @@ namespace ArrayLibrary
         }
 
         template <DataType T>
-        void matmulDispatcher(const Coordinates &leftShape, const Coordinates &leftStrides, const T *pLeftData, const Coordinates &rightShape, const Coordinates &rightStrides, const T *pRightData, const Coordinates &resultShape, const Coordinates &resultStrides, T *pResultData, long leftProductAxis, long rightProductAxis, bool useSimd, bool multiThread)
+        void matmulDispatcher(const Coordinates &leftShape, const Coordinates &leftStrides, const T *pLeftData, const Coordinates &rightShape, const Coordinates &rightStrides, const T *pRightData, const Coordinates &resultShape, const Coordinates &resultStrides, T *pResultData, long leftProductAxis, long rightProductAxis, const MatmulConfig &config)
         {
             static_assert(!Simd::supported<T> || std::is_same_v<decltype(simdMatmulAlongRightFreeAxis<T>), f2DimMultiplier_t<T>>);
             static_assert(!Simd::supported<T> || std::is_same_v<decltype(simdMatmulAlongProductAxis<T, 1>), f2DimMultiplier_t<T>>);
             static_assert(!Simd::supported<T> || std::is_same_v<decltype(simdMatmulAlongLeftFreeAxis<T>), f2DimMultiplier_t<T>>);
 
-            const long productAxisLength = leftShape[leftProductAxis];
-            const long leftProductStride = leftStrides[leftProductAxis], rightProductStride = rightStrides[rightProductAxis];
-            const long leftLength = leftShape[rightProductAxis], rightLength = rightShape[leftProductAxis];
-            const long leftFreeStride = leftStrides[rightProductAxis], rightFreeStride = rightStrides[leftProductAxis];
-            const long resultLeftStride = resultStrides[rightProductAxis], resultRightStride = resultStrides[leftProductAxis];
+            if (!Simd::supported<T>)
+            {
+                baseMatmul<T, matmulBoost<T>>(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis, config);
+                return;
+            }
 
-            const long dim = leftShape.size();
-            if (!Simd::supported<T> || !useSimd)
-                baseMatmul<T, matmulBoost<T>>(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis);
-            else if (leftProductStride == 1 && rightProductStride == 1)
-                baseMatmul<T, simdMatmulAlongProductAxis<T, 4>>(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis);
-            else if (rightFreeStride == 1 && resultRightStride == 1)
-                baseMatmul<T, simdMatmulAlongRightFreeAxis<T>>(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis);
-            else if (leftFreeStride == 1 && resultLeftStride == 1)
-                baseMatmul<T, simdMatmulAlongLeftFreeAxis<T>>(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis);
-            else
-                baseMatmul<T, matmulBoost<T>>(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis);
+            switch (config.kernel)
+            {
+            case MatmulKernel::PRODUCT_AXIS:
+                baseMatmul<T, simdMatmulAlongProductAxis<T, 4>>(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis, config);
+                break;
+            case MatmulKernel::RIGHT_FREE_AXIS:
+                baseMatmul<T, simdMatmulAlongRightFreeAxis<T>>(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis, config);
+                break;
+            case MatmulKernel::LEFT_FREE_AXIS:
+                baseMatmul<T, simdMatmulAlongLeftFreeAxis<T>>(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis, config);
+                break;
+            case MatmulKernel::GATHER_RIGHT_FREE_AXIS:
+                baseMatmul<T, simdGatherMatmulAlongRightFreeAxis<T>>(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis, config);
+                break;
+            case MatmulKernel::GATHER_LEFT_FREE_AXIS:
+                baseMatmul<T, simdGatherMatmulAlongLeftFreeAxis<T>>(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis, config);
+                break;
+            case MatmulKernel::SMALL:
+                baseMatmul<T, simdSmallMatmul<T>>(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis, config);
+                break;
+            default:
+                baseMatmul<T, matmulBoost<T>>(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis, config);
+            }
+        }
+
+        /// @brief Whether kernel can compute a product of operands and a result with these strides. Gathering and the small matrix kernel need a result with stride 1 along a free axis, and gathering needs indices that fit into 32 bits. The small matrix kernel also needs short axes, see smallMatrixFits.
+        template <DataType T>
+        bool kernelFits(MatmulKernel kernel, const Coordinates &leftStrides, const Coordinates &rightStrides, const Coordinates &resultStrides, long leftProductAxis, long rightProductAxis)
+        {
+            if (kernel == MatmulKernel::SCALAR)
+                return true;
+            if (!Simd::supported<T>)
+                return false;
+
+            auto gatherable = [](long stride)
+            { return std::abs(stride) * (long)Simd::LENGTH<T> <= std::numeric_limits<int32_t>::max(); };
+
+            switch (kernel)
+            {
+            case MatmulKernel::PRODUCT_AXIS:
+                return leftStrides[leftProductAxis] == 1 && rightStrides[rightProductAxis] == 1;
+            case MatmulKernel::RIGHT_FREE_AXIS:
+                return rightStrides[leftProductAxis] == 1 && resultStrides[leftProductAxis] == 1;
+            case MatmulKernel::LEFT_FREE_AXIS:
+                return leftStrides[rightProductAxis] == 1 && resultStrides[rightProductAxis] == 1;
+            case MatmulKernel::GATHER_RIGHT_FREE_AXIS:
+                return resultStrides[leftProductAxis] == 1 && gatherable(rightStrides[leftProductAxis]);
+            case MatmulKernel::GATHER_LEFT_FREE_AXIS:
+                return resultStrides[rightProductAxis] == 1 && gatherable(leftStrides[rightProductAxis]);
+            case MatmulKernel::SMALL:
+                return resultStrides[leftProductAxis] == 1 || resultStrides[rightProductAxis] == 1;
+            default:
+                return false;
+            }
+        }
+
+        /// @brief Whether all axes of the matrices are short enough for simdSmallMatmul
+        inline bool smallMatrixFits(long leftLength, long rightLength, long productLength)
+        {
+            return leftLength <= SMALL_MATRIX_LENGTH && rightLength <= SMALL_MATRIX_LENGTH && productLength <= SMALL_MATRIX_LENGTH;
+        }
+
+        /// @brief Whether matmulDispatcher has a SIMD kernel for operands and a result with these strides
+        inline bool hasSimdLayout(const Coordinates &leftStrides, const Coordinates &rightStrides, const Coordinates &resultStrides, long leftProductAxis, long rightProductAxis)
+        {
+            return (leftStrides[leftProductAxis] == 1 && rightStrides[rightProductAxis] == 1) || (rightStrides[leftProductAxis] == 1 && resultStrides[leftProductAxis] == 1) || (leftStrides[rightProductAxis] == 1 && resultStrides[rightProductAxis] == 1);
+        }
+
+        /// @brief How matmul computes a product for whose layout none of the contiguous SIMD kernels fits, see chooseOperandStrategy
+        enum class OperandStrategy
+        {
+            SCALAR,
+            GATHER,
+            PACK
+        };
+
+        namespace Cost
+        {
+            /// Cycles per multiply-add of the gather kernels, which broadcast an entry of the other operand for every vector of products and reload the accumulators for every block
+            constexpr double GATHER_PER_PRODUCT = 1;
+            /// Cycles per multiply-add of the kernel along the product axis, whose contiguous loads of both operands keep it at about 2.5 products per cycle
+            constexpr double PRODUCT_AXIS_PER_PRODUCT = 0.4;
+            /// Cycles per result entry of the kernel along the product axis for the horizontal sum that ends each dot product and the loop around it
+            constexpr double PRODUCT_AXIS_PER_RESULT = 80;
+            /// Cycles per multiply-add of the kernels along a free axis, which keep their accumulators in registers and reach about 4 products per cycle
+            constexpr double FREE_AXIS_PER_PRODUCT = 0.25;
+            /// Cycles per packed entry, a strided read that touches a new cache line for most entries and a contiguous write
+            constexpr double PACK_PER_ENTRY = 2;
+            /// Cycles for allocating the packing buffer and setting up the copy, paid once per product
+            constexpr double PACK_OVERHEAD = 2000;
+        }
+
+        /// @brief A rough cost model in cycles for products for whose layout none of the contiguous SIMD kernels fits, with the constants of namespace Cost.
+        /// @details Gathering needs a result with stride 1 along a free axis. The gathered strips are reused for every row of the other operand, but each multiply-add still costs about Cost::GATHER_PER_PRODUCT per scalar product. Packing needs a product axis that fills at least one vector and costs a pass over the packed operands plus an allocation. The packed kernels are cheaper per product but end every result entry with a horizontal sum, so gathering wins for short product axes. If neither is possible, the scalar kernel is used.
+        /// @param productCount The number of scalar multiply-adds of the product
+        /// @param packedEntries The number of entries of the operands that would have to be packed
+        /// @param gatherStride The stride of the operand that would be gathered, or 0 if the result has no free axis with stride 1
+        template <DataType T>
+        OperandStrategy chooseOperandStrategy(long productCount, long packedEntries, long productLength, long gatherStride)
+        {
+            const bool canGather = gatherStride != 0 && std::abs(gatherStride) * (long)Simd::LENGTH<T> <= std::numeric_limits<int32_t>::max();
+            const bool canPack = productLength >= (long)Simd::LENGTH<T>;
+
+            if (!canGather)
+                return canPack ? OperandStrategy::PACK : OperandStrategy::SCALAR;
+            if (!canPack)
+                return OperandStrategy::GATHER;
+
+            const double gatherCost = Cost::GATHER_PER_PRODUCT * productCount;
+            const double packCost = Cost::PRODUCT_AXIS_PER_PRODUCT * productCount + Cost::PRODUCT_AXIS_PER_RESULT * (productCount / productLength) + Cost::PACK_PER_ENTRY * packedEntries + Cost::PACK_OVERHEAD;
+            return gatherCost <= packCost ? OperandStrategy::GATHER : OperandStrategy::PACK;
+        }
+
+        /// @brief Whether packing an operand along the free axis on which the result has stride 1 and running the kernel along that axis is cheaper than the kernel along the product axis, which ends every result entry with a horizontal sum. This is the case for the product of the gradient with a transposed operand in the backward pass of MatrixProduct.
+        /// @param productAxisPackedEntries The number of entries that the kernel along the product axis needs packed, 0 if the operands are contiguous along it
+        /// @param freeAxisPackedEntries The number of entries of the operand that would be packed along its free axis
+        inline bool preferFreeAxisPacking(long productCount, long productLength, long productAxisPackedEntries, long freeAxisPackedEntries)
+        {
+            const double productAxisCost = Cost::PRODUCT_AXIS_PER_PRODUCT * productCount + Cost::PRODUCT_AXIS_PER_RESULT * (productCount / productLength) + Cost::PACK_PER_ENTRY * productAxisPackedEntries + (productAxisPackedEntries > 0 ? Cost::PACK_OVERHEAD : 0);
+            const double freeAxisCost = Cost::FREE_AXIS_PER_PRODUCT * productCount + Cost::PACK_PER_ENTRY * freeAxisPackedEntries + Cost::PACK_OVERHEAD;
+            return freeAxisCost < productAxisCost;
+        }
+
+        /// @brief The kernel along the free axis on which the result has stride 1 and its operand is long enough to fill a vector but not contiguous, so that packing that operand along its free axis makes the kernel fit, or MatmulKernel::SCALAR if there is none. The number of entries to pack is written to packedEntries.
+        template <DataType T>
+        MatmulKernel freeAxisPackingKernel(const Coordinates &leftShape, const Coordinates &leftStrides, long leftFlatLength, const Coordinates &rightShape, const Coordinates &rightStrides, long rightFlatLength, const Coordinates &resultStrides, long leftProductAxis, long rightProductAxis, long &packedEntries)
+        {
+            if (resultStrides[leftProductAxis] == 1 && rightStrides[leftProductAxis] != 1 && rightShape[leftProductAxis] >= (long)Simd::LENGTH<T>)
+            {
+                packedEntries = rightFlatLength;
+                return MatmulKernel::RIGHT_FREE_AXIS;
+            }
+            if (resultStrides[rightProductAxis] == 1 && leftStrides[rightProductAxis] != 1 && leftShape[rightProductAxis] >= (long)Simd::LENGTH<T>)
+            {
+                packedEntries = leftFlatLength;
+                return MatmulKernel::LEFT_FREE_AXIS;
+            }
+            packedEntries = 0;
+            return MatmulKernel::SCALAR;
         }
 
+        /// @brief The default of MatmulSettings::strassenCutoff. Below about this length, the additions and the memory traffic of a level of strassenMatmul cost more than the multiply-adds they save with AVX2 kernels.
+        constexpr long STRASSEN_CUTOFF = 256;
+
+        /// @brief The default of MatmulSettings::summationBlock. The kernels accumulate products along blocks of this length in order, which bounds the error of a block by about SUMMATION_BLOCK * eps, while the pass over the result per block stays small against the 2 * SUMMATION_BLOCK operations per result entry.
+        constexpr long SUMMATION_BLOCK = 256;
+
         struct MatmulSettings
         {
             bool setzero = true;
@@ -349,136 +757,759 @@ namespace ArrayLibrary
             bool multiThread = false;
             Coordinates reduceAxes;
             bool keepDims = false;
+            /// If set, left is multiplied with its axes leftProductAxis and rightProductAxis swapped. Like Array::transpose, this only swaps the strides, and the kernels read the operand in place or pack it along the axis they need.
+            bool transposeLeft = false;
+            /// If set, right is multiplied with its axes leftProductAxis and rightProductAxis swapped, see transposeLeft
+            bool transposeRight = false;
+            /// If set, products of single matrices whose axes are all longer than strassenCutoff use strassenMatmul, which takes fewer multiply-adds at the price of a larger rounding error, see there for a bound. Batched products are not affected.
+            bool strassen = false;
+            /// The recursion of strassenMatmul stops at blocks with an axis of at most this length
+            long strassenCutoff = STRASSEN_CUTOFF;
+            /// How the multiply-adds along a product axis longer than summationBlock are summed, see Summation. For PAIRWISE and KAHAN, the product axis is split into blocks of summationBlock entries whose partial products go to temporary arrays, which are then added along a binary tree or with compensation. This keeps float products with long product axes accurate at the price of a pass over the result per block.
+            Summation summation = Summation::NAIVE;
+            long summationBlock = SUMMATION_BLOCK;
         };
 
-        /// @brief Computes the matrix product of two arrays along the specified product axes lpa and rpa. If the argument matrices have different dimension, their shapes will be padded with 1s from the left to match the dimensions. For the padded shape, the corresponding product axis will be adjusted accordingly if the product axis was positive; otherwise the product axis will not be changed. The padded shapes sl and sr must be broadcastable to match outside of the adjusted lpa and rpa, and they must satisfy left.getShape()[leftProductAxis]==right.getShape()[rightProductAxis].
-        /// @return The matrix product of left and right axes specified in settings.
+        /// @brief The configuration of matmul without autotuning: the small matrix kernel for short axes, the first contiguous SIMD kernel that fits the layout, or otherwise gathering or packing as chosen by chooseOperandStrategy. Instead of the kernel along the product axis, an operand is packed along its free axis if preferFreeAxisPacking says so. Nothing is blocked, and if settings.multiThread is set, each thread gets at least CONCURRENCY_THRESHOLD multiply-adds, see baseMatmul for how they are split.
         template <DataType T>
-        ArrayLibrary::Array<T> matmul(const Array<T> &left, const Array<T> &right, Array<T> *const pDestArray, const MatmulSettings &settings)
+        MatmulConfig defaultConfig(const Coordinates &leftShape, const Coordinates &leftStrides, long leftFlatLength, const Coordinates &rightShape, const Coordinates &rightStrides, long rightFlatLength, const Coordinates &resultStrides, long leftProductAxis, long rightProductAxis, long productCount, const MatmulSettings &settings)
         {
-            long leftProductAxis = settings.leftProductAxis % left.mDim;
-            leftProductAxis = leftProductAxis < 0 ? left.mDim + leftProductAxis : leftProductAxis;
-            long rightProductAxis = settings.rightProductAxis % right.mDim;
-            rightProductAxis = rightProductAxis < 0 ? right.mDim + rightProductAxis : rightProductAxis;
+            MatmulConfig config;
+            const long productLength = leftShape[leftProductAxis];
+            const long productAxisPackedEntries = (leftStrides[leftProductAxis] != 1 ? leftFlatLength : 0) + (rightStrides[rightProductAxis] != 1 ? rightFlatLength : 0);
 
-            long dim = std::max(left.mDim, right.mDim);
+            if (settings.useSimd && Simd::supported<T>)
+            {
+                if (smallMatrixFits(leftShape[rightProductAxis], rightShape[leftProductAxis], productLength) && kernelFits<T>(MatmulKernel::SMALL, leftStrides, rightStrides, resultStrides, leftProductAxis, rightProductAxis))
+                    config.kernel = MatmulKernel::SMALL;
+                else if (hasSimdLayout(leftStrides, rightStrides, resultStrides, leftProductAxis, rightProductAxis))
+                {
+                    for (MatmulKernel kernel : {MatmulKernel::PRODUCT_AXIS, MatmulKernel::RIGHT_FREE_AXIS, MatmulKernel::LEFT_FREE_AXIS})
+                        if (kernelFits<T>(kernel, leftStrides, rightStrides, resultStrides, leftProductAxis, rightProductAxis))
+                        {
+                            config.kernel = kernel;
+                            break;
+                        }
+                }
+                else
+                {
+                    const long gatherStride = resultStrides[leftProductAxis] == 1 ? rightStrides[leftProductAxis] : (resultStrides[rightProductAxis] == 1 ? leftStrides[rightProductAxis] : 0);
+                    switch (chooseOperandStrategy<T>(productCount, productAxisPackedEntries, productLength, gatherStride))
+                    {
+                    case OperandStrategy::PACK:
+                        config.pack = MatmulPacking::PRODUCT_AXIS;
+                        config.kernel = MatmulKernel::PRODUCT_AXIS;
+                        break;
+                    case OperandStrategy::GATHER:
+                        config.kernel = resultStrides[leftProductAxis] == 1 ? MatmulKernel::GATHER_RIGHT_FREE_AXIS : MatmulKernel::GATHER_LEFT_FREE_AXIS;
+                        break;
+                    default:
+                        break;
+                    }
+                }
 
-            auto leftShape = left.mShape.shiftRight(1, dim - left.mDim);
-            auto leftStrides = left.mStrides.shiftRight(0, dim - left.mDim);
-            leftProductAxis += dim - left.mDim;
+                if (config.kernel == MatmulKernel::PRODUCT_AXIS)
+                {
+                    long freeAxisPackedEntries;
+                    const MatmulKernel kernel = freeAxisPackingKernel<T>(leftShape, leftStrides, leftFlatLength, rightShape, rightStrides, rightFlatLength, resultStrides, leftProductAxis, rightProductAxis, freeAxisPackedEntries);
+                    if (kernel != MatmulKernel::SCALAR && preferFreeAxisPacking(productCount, productLength, config.pack == MatmulPacking::PRODUCT_AXIS ? productAxisPackedEntries : 0, freeAxisPackedEntries))
+                        config = {MatmulPacking::FREE_AXIS, kernel};
+                }
+            }
 
-            auto rightShape = right.mShape.shiftRight(1, dim - right.mDim);
-            auto rightStrides = right.mStrides.shiftRight(0, dim - right.mDim);
-            rightProductAxis += dim - right.mDim;
+            if (settings.multiThread)
+                config.threads = std::clamp(productCount / CONCURRENCY_THRESHOLD, 1l, ThreadPool::global().getThreadCount());
+            return config;
+        }
 
-            if (leftProductAxis == rightProductAxis)
-                throw std::invalid_argument("leftProductAxis must be different from rightProductAxis");
+        /// @brief The packing and kernel combinations that the autotuner times for a layout: every SIMD kernel that fits, packing if an operand is not contiguous along a product axis that fills a vector, and packing along a free axis for the kernels along it. The scalar kernel is only a candidate if no SIMD kernel is possible.
+        template <DataType T>
+        std::vector<MatmulConfig> kernelCandidates(const Coordinates &leftShape, const Coordinates &leftStrides, const Coordinates &rightShape, const Coordinates &rightStrides, const Coordinates &resultStrides, long leftProductAxis, long rightProductAxis, const MatmulSettings &settings)
+        {
+            std::vector<MatmulConfig> candidates;
+            if (settings.useSimd && Simd::supported<T>)
+            {
+                for (MatmulKernel kernel : {MatmulKernel::PRODUCT_AXIS, MatmulKernel::RIGHT_FREE_AXIS, MatmulKernel::LEFT_FREE_AXIS, MatmulKernel::GATHER_RIGHT_FREE_AXIS, MatmulKernel::GATHER_LEFT_FREE_AXIS})
+                    if (kernelFits<T>(kernel, leftStrides, rightStrides, resultStrides, leftProductAxis, rightProductAxis))
+                        candidates.push_back({MatmulPacking::NONE, kernel});
 
-            if (leftShape[leftProductAxis] != rightShape[rightProductAxis])
-                throw std::invalid_argument("Arrays do not have the same length in product dimension.");
+                if (smallMatrixFits(leftShape[rightProductAxis], rightShape[leftProductAxis], leftShape[leftProductAxis]) && kernelFits<T>(MatmulKernel::SMALL, leftStrides, rightStrides, resultStrides, leftProductAxis, rightProductAxis))
+                    candidates.push_back({MatmulPacking::NONE, MatmulKernel::SMALL});
 
-            ReduceInformation reduceInfo = reduceShape(matmulShape(leftShape, rightShape, leftProductAxis, rightProductAxis), settings.reduceAxes, settings.keepDims);
+                if (leftShape[leftProductAxis] >= (long)Simd::LENGTH<T> && (leftStrides[leftProductAxis] != 1 || rightStrides[rightProductAxis] != 1))
+                    candidates.push_back({MatmulPacking::PRODUCT_AXIS, MatmulKernel::PRODUCT_AXIS});
 
-            if (pDestArray == nullptr)
+                if (resultStrides[leftProductAxis] == 1 && rightStrides[leftProductAxis] != 1 && rightShape[leftProductAxis] >= (long)Simd::LENGTH<T>)
+                    candidates.push_back({MatmulPacking::FREE_AXIS, MatmulKernel::RIGHT_FREE_AXIS});
+                if (resultStrides[rightProductAxis] == 1 && leftStrides[rightProductAxis] != 1 && leftShape[rightProductAxis] >= (long)Simd::LENGTH<T>)
+                    candidates.push_back({MatmulPacking::FREE_AXIS, MatmulKernel::LEFT_FREE_AXIS});
+            }
+
+            if (candidates.empty())
+                candidates.push_back(MatmulConfig());
+            return candidates;
+        }
+
+        /// @brief Chooses the configuration of matmul by timing candidates on the first product with a new signature, i.e. data type, shapes and strides of the operands and the result, product axes and the settings that restrict the candidates. The fastest configuration is kept in a table, so that later products with that signature, e.g. every batch of Model::fit, use it right away.
+        /// @details Autotuning is off by default, since the first product with each signature runs many times and the chosen kernel may round differently from the default one. The table can be saved to a file and loaded in later runs on the same machine.
+        class Autotuner
+        {
+            std::map<std::string, MatmulConfig> mConfigs;
+            mutable std::mutex mMutex;
+            std::atomic<bool> mEnabled = false;
+            long mRepetitions = 3;
+
+            /// @brief The best time in seconds of runs with config, after one run to warm up caches and buffers. Short products run until they have taken MIN_SECONDS in total, so that a single disturbed run does not decide.
+            template <typename F>
+            double bestTime(const F &run, const MatmulConfig &config) const
             {
-                Array<T> result = Array<T>::constant(reduceInfo.keepDimsShape, 0);
+                constexpr double MIN_SECONDS = 1e-3;
+                constexpr long MAX_RUNS = 100;
+
+                run(config);
+                double best = std::numeric_limits<double>::infinity(), total = 0;
+                for (long r = 0; r < mRepetitions || (total < MIN_SECONDS && r < MAX_RUNS); r++)
+                {
+                    const auto start = std::chrono::steady_clock::now();
+                    run(config);
+                    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    best = std::min(best, seconds);
+                    total += seconds;
+                }
+                return best;
+            }
+
+        public:
+            /// @brief The table used by matmul
+            static Autotuner &global()
+            {
+                static Autotuner tuner;
+                return tuner;
+            }
 
-                T *pLeftData = left.getDataPointer(), *pRightData = right.getDataPointer(), *pDestData = result.getDataPointer();
+            bool isEnabled() const { return mEnabled; }
+            void setEnabled(bool enabled) { mEnabled = enabled; }
 
-                matmulDispatcher(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, result.refShape(), result.refStrides(), pDestData, leftProductAxis, rightProductAxis, settings.useSimd, settings.multiThread);
+            long getRepetitions() const { return mRepetitions; }
+            void setRepetitions(long repetitions) { mRepetitions = std::max(1l, repetitions); }
 
-                return settings.keepDims ? result : result.reshape(reduceInfo.reducedShape);
+            std::optional<MatmulConfig> find(const std::string &signature) const
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                const auto it = mConfigs.find(signature);
+                return it == mConfigs.end() ? std::nullopt : std::optional<MatmulConfig>(it->second);
             }
-            else
+
+            void store(const std::string &signature, const MatmulConfig &config)
             {
-                if (reduceInfo.reducedShape != pDestArray->refShape().shiftRight(1, reduceInfo.reducedShape.size() - pDestArray->getDim()))
-                    throw std::invalid_argument("The shape of the destination array does not fit the product shape of left and right.");
+                std::lock_guard<std::mutex> lock(mMutex);
+                mConfigs[signature] = config;
+            }
 
-                Array<T> dest = settings.keepDims ? (*pDestArray) : pDestArray->reshape(reduceInfo.keepDimsShape);
-                if (settings.setzero)
-                    dest = 0;
+            size_t size() const
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                return mConfigs.size();
+            }
+
+            void clear()
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mConfigs.clear();
+            }
 
-                T *pLeftData = left.getDataPointer(), *pRightData = right.getDataPointer(), *pDestData = dest.getDataPointer();
-                matmulDispatcher(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, dest.refShape(), dest.refStrides(), pDestData, leftProductAxis, rightProductAxis, settings.useSimd, settings.multiThread);
+            /// @brief Searches for the fastest configuration in three stages: the candidates without blocking on one thread, then blockings of the free axes for the fastest of them, and finally thread counts for the fastest blocking if multiThread is set.
+            /// @param batchCount The number of matrix products, which the threads can share instead of the free axes, see baseMatmul
+            /// @param run Computes the product with a configuration
+            template <typename F>
+            MatmulConfig search(const std::vector<MatmulConfig> &candidates, long leftLength, long rightLength, long batchCount, bool multiThread, const F &run) const
+            {
+                MatmulConfig best = candidates.front();
+                double bestSeconds = std::numeric_limits<double>::infinity();
+                auto consider = [&](const MatmulConfig &config)
+                {
+                    const double seconds = bestTime(run, config);
+                    if (seconds < bestSeconds)
+                    {
+                        best = config;
+                        bestSeconds = seconds;
+                    }
+                };
 
-                return dest;
+                for (const MatmulConfig &config : candidates)
+                    consider(config);
+
+                const MatmulConfig unblocked = best;
+                for (long rowBlock : {0l, 8l, 32l, 128l})
+                    for (long columnBlock : {0l, 64l, 256l, 1024l})
+                        if ((rowBlock > 0 || columnBlock > 0) && rowBlock < leftLength && columnBlock < rightLength)
+                        {
+                            MatmulConfig config = unblocked;
+                            config.rowBlock = rowBlock;
+                            config.columnBlock = columnBlock;
+                            consider(config);
+                        }
+
+                if (multiThread)
+                {
+                    const MatmulConfig blocked = best;
+                    const long maxThreads = std::min(ThreadPool::global().getThreadCount(), std::max({leftLength, rightLength, batchCount}));
+                    for (long threads = 2; threads < 2 * maxThreads; threads *= 2)
+                    {
+                        MatmulConfig config = blocked;
+                        config.threads = std::min(threads, maxThreads);
+                        consider(config);
+                    }
+                }
+
+                return best;
             }
-        }
 
+            /// @brief The key of a product in the table. It contains no whitespace, see save.
+            template <DataType T>
+            static std::string signature(const Coordinates &leftShape, const Coordinates &leftStrides, const Coordinates &rightShape, const Coordinates &rightStrides, const Coordinates &resultShape, const Coordinates &resultStrides, long leftProductAxis, long rightProductAxis, const MatmulSettings &settings)
+            {
+                std::stringstream s;
+                s << (std::is_floating_point_v<T> ? 'f' : (std::is_signed_v<T> ? 'i' : 'u')) << 8 * sizeof(T);
+                for (const Coordinates *pCoordinates : {&leftShape, &leftStrides, &rightShape, &rightStrides, &resultShape, &resultStrides})
+                {
+                    s << ';';
+                    for (long i = 0; i < pCoordinates->size(); i++)
+                        s << (i > 0 ? "," : "") << (*pCoordinates)[i];
+                }
+                s << ';' << leftProductAxis << ',' << rightProductAxis << ';' << settings.useSimd << settings.multiThread;
+                return s.str();
+            }
+
+            /// @brief Writes the table to a file, one signature and its configuration per line
+            void save(const std::string &path) const
+            {
+                std::ofstream file(path);
+                if (!file)
+                    throw std::runtime_error("Could not open " + path + " for writing.");
+
+                std::lock_guard<std::mutex> lock(mMutex);
+                file << "# signature pack kernel rowBlock columnBlock threads\n";
+                for (const auto &[signature, config] : mConfigs)
+                    file << signature << ' ' << (int)config.pack << ' ' << (int)config.kernel << ' ' << config.rowBlock << ' ' << config.columnBlock << ' ' << config.threads << '\n';
+            }
+
+            /// @brief Adds the configurations of a file written by save to the table, replacing those with the same signature
+            void load(const std::string &path)
+            {
+                std::ifstream file(path);
+                if (!file)
+                    throw std::runtime_error("Could not open " + path + " for reading.");
+
+                std::map<std::string, MatmulConfig> configs;
+                std::string line;
+                while (std::getline(file, line))
+                {
+                    if (line.empty() || line[0] == '#')
+                        continue;
+
+                    std::istringstream s(line);
+                    std::string signature;
+                    MatmulConfig config;
+                    int pack, kernel;
+                    if (!(s >> signature >> pack >> kernel >> config.rowBlock >> config.columnBlock >> config.threads) || pack < 0 || pack > (int)MatmulPacking::FREE_AXIS || kernel < 0 || kernel > (int)MatmulKernel::SMALL)
+                        throw std::runtime_error("Malformed line in " + path + ": " + line);
+
+                    config.pack = (MatmulPacking)pack;
+                    config.kernel = (MatmulKernel)kernel;
+                    configs[signature] = config;
+                }
+
+                std::lock_guard<std::mutex> lock(mMutex);
+                for (const auto &[signature, config] : configs)
+                    mConfigs[signature] = config;
+            }
+        };
+
+        /// @brief Scratch memory of the calling thread for the temporaries of strassenMatmul, handed out and released in stack order.
+        /// @details The buffer only grows in reserve, and only while nothing is allocated from it, so that the pointers handed out stay valid and repeated products do not allocate. Every allocation is rounded up to whole SIMD vectors, so that the temporaries start on a vector boundary.
         template <DataType T>
-        inline ArrayLibrary::Array<T> matmul(const Array<T> &left, const Array<T> &right, const MatmulSettings &settings)
+        class StrassenWorkspace
         {
-            return matmul<T>(left, right, nullptr, settings);
-        }
+            std::optional<Data<T>> mBuffer;
+            size_t mUsed = 0;
+
+        public:
+            static constexpr size_t ALIGNMENT = Data<T>::ALIGNMENT / sizeof(T);
+
+            static StrassenWorkspace &local()
+            {
+                thread_local StrassenWorkspace workspace;
+                return workspace;
+            }
+
+            /// @brief The number of entries that allocating size entries takes from the workspace
+            static size_t rounded(size_t size) { return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+            /// @brief Makes sure that size more entries can be allocated. If that needs a larger buffer, nothing may be allocated from the workspace.
+            void reserve(size_t size)
+            {
+                if (mBuffer && mUsed + size <= mBuffer->size())
+                    return;
+                if (mUsed != 0)
+                    throw std::logic_error("The Strassen workspace cannot grow while it is in use.");
+                mBuffer.emplace(size);
+            }
+
+            T *allocate(size_t size)
+            {
+                size = rounded(size);
+                if (!mBuffer || mUsed + size > mBuffer->size())
+                    throw std::logic_error("The Strassen workspace has not been reserved for this allocation.");
+                T *pData = &(*mBuffer)[mUsed];
+                mUsed += size;
+                return pData;
+            }
+
+            size_t mark() const { return mUsed; }
+
+            /// @brief Releases everything allocated since mark was returned
+            void release(size_t mark) { mUsed = mark; }
+        };
 
+        /// @brief The entries that strassenRecursive allocates from the workspace for an m x k times k x n product: three temporaries of half the size on every level of the recursion
         template <DataType T>
-        Array<T> matmul(const Array<T> &left, const Array<T> &right)
+        size_t strassenWorkspaceSize(long m, long k, long n, long cutoff)
         {
-            return matmul<T>(left, right, nullptr, MatmulSettings());
+            size_t size = 0;
+            for (; m > cutoff && k > cutoff && n > cutoff; m /= 2, k /= 2, n /= 2)
+                size += StrassenWorkspace<T>::rounded((m / 2) * (k / 2)) + StrassenWorkspace<T>::rounded((k / 2) * (n / 2)) + StrassenWorkspace<T>::rounded((m / 2) * (n / 2));
+            return size;
         }
 
-        // Currently not in use
+        /// @brief One term of combineBlocks: a row-major block and the factor it is added with
         template <DataType T>
-        void matmulThreadControl(const Coordinates &leftShape, const Coordinates &leftStrides, T *pLeftData, const Coordinates &rightShape, const Coordinates &rightStrides, T *pRightData, const Coordinates &resultShape, const Coordinates &resultStrides, T *pResultData, long leftProductAxis, long rightProductAxis)
+        struct BlockTerm
         {
-            static long maxThreads = std::max(1u, std::thread::hardware_concurrency());
-            static const long CONCURRENCY_THRESHOLD = 0x10000;
+            const T *pData;
+            T factor;
+        };
 
-            long flatLength = 1, longestAxis = -1, longestAxisLength = -1;
-            for (long i = 0; i < resultShape.size(); i++)
+        /// @brief Sets the row-major block dest to destFactor * dest plus the sum of the terms, which share sourceStride. A destFactor of 0 overwrites dest, so that it may hold anything before.
+        template <DataType T>
+        void combineBlocks(T *pDest, long destStride, std::initializer_list<BlockTerm<T>> terms, long sourceStride, long rows, long columns, T destFactor)
+        {
+            for (long i = 0; i < rows; i++)
             {
-                if (resultShape[i] > longestAxisLength)
+                T *pRow = pDest + i * destStride;
+                if (destFactor == 0)
+                    std::fill(pRow, pRow + columns, T(0));
+                else if (destFactor != 1)
+                    for (long j = 0; j < columns; j++)
+                        pRow[j] *= destFactor;
+
+                for (const BlockTerm<T> &term : terms)
                 {
-                    longestAxisLength = resultShape[i];
-                    longestAxis = i;
+                    const T *pSource = term.pData + i * sourceStride;
+                    for (long j = 0; j < columns; j++)
+                        pRow[j] += term.factor * pSource[j];
                 }
-                flatLength *= resultShape[i];
             }
+        }
 
-            if (flatLength * leftShape[leftProductAxis] < CONCURRENCY_THRESHOLD)
+        /// @brief Adds the product of the row-major blocks a (m x k) and b (k x n) to c with a single-threaded kernel of matmulDispatcher, which is the base case of strassenRecursive
+        template <DataType T>
+        void strassenBase(const T *pA, long aStride, const T *pB, long bStride, T *pC, long cStride, long m, long k, long n, MatmulKernel kernel)
+        {
+            matmulDispatcher<T>({m, k}, {aStride, 1}, pA, {k, n}, {bStride, 1}, pB, {m, n}, {cStride, 1}, pC, 1, 0, MatmulConfig{MatmulPacking::NONE, kernel});
+        }
+
+        /// @brief Adds the products of the last row and column of a and b to c for odd m, k or n, which the recursion on the even part leaves out
+        template <DataType T>
+        void strassenPeel(const T *pA, long aStride, const T *pB, long bStride, T *pC, long cStride, long m, long k, long n, MatmulKernel kernel)
+        {
+            const long evenM = m & ~1l, evenK = k & ~1l, evenN = n & ~1l;
+            if (k != evenK)
+                strassenBase(pA + evenK, aStride, pB + evenK * bStride, bStride, pC, cStride, evenM, 1l, evenN, kernel);
+            if (n != evenN)
+                strassenBase(pA, aStride, pB + evenN, bStride, pC + evenN, cStride, m, k, 1l, kernel);
+            if (m != evenM)
+                strassenBase(pA + evenM * aStride, aStride, pB, bStride, pC + evenM * cStride, cStride, 1l, k, evenN, kernel);
+        }
+
+        /// @brief Adds the product of the row-major blocks a (m x k) and b (k x n) to c with the Winograd variant of Strassen's algorithm, which replaces one of eight half-size products by additions on every level until an axis is at most cutoff long.
+        /// @details The seven products are scheduled so that each level needs only three temporaries X, Y and Z of the sizes of a, b and c quadrants, see Boyer, Dumas, Pernet and Zhou, "Memory efficient scheduling of Strassen-Winograd's matrix multiplication algorithm", 2009. Products that go to a single quadrant of c accumulate into it directly. Odd axes are handled by dynamic peeling, see strassenPeel.
+        template <DataType T>
+        void strassenRecursive(const T *pA, long aStride, const T *pB, long bStride, T *pC, long cStride, long m, long k, long n, long cutoff, MatmulKernel kernel, StrassenWorkspace<T> &workspace)
+        {
+            if (m <= cutoff || k <= cutoff || n <= cutoff)
             {
-                baseMatmul(leftShape, leftStrides, pLeftData, rightShape, rightStrides, pRightData, resultShape, resultStrides, pResultData, leftProductAxis, rightProductAxis);
+                strassenBase(pA, aStride, pB, bStride, pC, cStride, m, k, n, kernel);
                 return;
             }
 
-            long threads = std::min({maxThreads, longestAxisLength, flatLength / CONCURRENCY_THRESHOLD + 1});
-            long progress = 0;
-            std::vector<std::thread> threadPool(threads);
+            const long m2 = m / 2, k2 = k / 2, n2 = n / 2;
+            const T *pA11 = pA, *pA12 = pA + k2, *pA21 = pA + m2 * aStride, *pA22 = pA21 + k2;
+            const T *pB11 = pB, *pB12 = pB + n2, *pB21 = pB + k2 * bStride, *pB22 = pB21 + n2;
+            T *pC11 = pC, *pC12 = pC + n2, *pC21 = pC + m2 * cStride, *pC22 = pC21 + n2;
+
+            const size_t mark = workspace.mark();
+            T *pX = workspace.allocate(m2 * k2), *pY = workspace.allocate(k2 * n2), *pZ = workspace.allocate(m2 * n2);
+            auto product = [&](const T *pLeft, long leftStride, const T *pRight, long rightStride, T *pResult, long resultStride)
+            { strassenRecursive(pLeft, leftStride, pRight, rightStride, pResult, resultStride, m2, k2, n2, cutoff, kernel, workspace); };
+
+            // Z = P1 = A11 B11, C11 += P1 + P2 with P2 = A12 B21
+            combineBlocks<T>(pZ, n2, {}, n2, m2, n2, 0);
+            product(pA11, aStride, pB11, bStride, pZ, n2);
+            combineBlocks<T>(pC11, cStride, {{pZ, 1}}, n2, m2, n2, 1);
+            product(pA12, aStride, pB21, bStride, pC11, cStride);
+
+            // Z = U2 = P1 + P6 with P6 = S2 T2, S2 = A21 + A22 - A11 and T2 = B22 - B12 + B11, which goes to the other three quadrants
+            combineBlocks<T>(pX, k2, {{pA21, 1}, {pA22, 1}, {pA11, -1}}, aStride, m2, k2, 0);
+            combineBlocks<T>(pY, n2, {{pB22, 1}, {pB12, -1}, {pB11, 1}}, bStride, k2, n2, 0);
+            product(pX, k2, pY, n2, pZ, n2);
+            for (T *pQuadrant : {pC12, pC21, pC22})
+                combineBlocks<T>(pQuadrant, cStride, {{pZ, 1}}, n2, m2, n2, 1);
+
+            // P7 = S3 T3 with S3 = A11 - A21 and T3 = B22 - B12 goes to C21 and C22
+            combineBlocks<T>(pX, k2, {{pA11, 1}, {pA21, -1}}, aStride, m2, k2, 0);
+            combineBlocks<T>(pY, n2, {{pB22, 1}, {pB12, -1}}, bStride, k2, n2, 0);
+            combineBlocks<T>(pZ, n2, {}, n2, m2, n2, 0);
+            product(pX, k2, pY, n2, pZ, n2);
+            for (T *pQuadrant : {pC21, pC22})
+                combineBlocks<T>(pQuadrant, cStride, {{pZ, 1}}, n2, m2, n2, 1);
+
+            // P5 = S1 T1 with S1 = A21 + A22 and T1 = B12 - B11 goes to C12 and C22
+            combineBlocks<T>(pX, k2, {{pA21, 1}, {pA22, 1}}, aStride, m2, k2, 0);
+            combineBlocks<T>(pY, n2, {{pB12, 1}, {pB11, -1}}, bStride, k2, n2, 0);
+            combineBlocks<T>(pZ, n2, {}, n2, m2, n2, 0);
+            product(pX, k2, pY, n2, pZ, n2);
+            for (T *pQuadrant : {pC12, pC22})
+                combineBlocks<T>(pQuadrant, cStride, {{pZ, 1}}, n2, m2, n2, 1);
+
+            // C12 += P3 = S4 B22 with S4 = A12 - S2 = A12 + A11 - S1, and C21 -= P4 = A22 T4 with -T4 = T1 + B21 - B22
+            combineBlocks<T>(pX, k2, {{pA12, 1}, {pA11, 1}}, aStride, m2, k2, -1);
+            product(pX, k2, pB22, bStride, pC12, cStride);
+            combineBlocks<T>(pY, n2, {{pB21, 1}, {pB22, -1}}, bStride, k2, n2, 1);
+            product(pA22, aStride, pY, n2, pC21, cStride);
+
+            workspace.release(mark);
+            strassenPeel(pA, aStride, pB, bStride, pC, cStride, m, k, n, kernel);
+        }
 
-            for (; threads > 0; threads--)
+        /// @brief Like strassenRecursive, but the seven products of the first level run in parallel on the global thread pool, each into a buffer of its own and with the workspace of the thread that runs it. This takes the memory of seven quadrants of c more than the sequential schedule. The axes must be longer than cutoff.
+        template <DataType T>
+        void strassenParallel(const T *pA, long aStride, const T *pB, long bStride, T *pC, long cStride, long m, long k, long n, long cutoff, MatmulKernel kernel, StrassenWorkspace<T> &workspace)
+        {
+            const long m2 = m / 2, k2 = k / 2, n2 = n / 2;
+            const T *pA11 = pA, *pA12 = pA + k2, *pA21 = pA + m2 * aStride, *pA22 = pA21 + k2;
+            const T *pB11 = pB, *pB12 = pB + n2, *pB21 = pB + k2 * bStride, *pB22 = pB21 + n2;
+            T *pC11 = pC, *pC12 = pC + n2, *pC21 = pC + m2 * cStride, *pC22 = pC21 + n2;
+
+            // Enough for the products and, if the calling thread runs some of them, their temporaries
+            const size_t taskSize = StrassenWorkspace<T>::rounded(m2 * k2) + StrassenWorkspace<T>::rounded(k2 * n2) + strassenWorkspaceSize<T>(m2, k2, n2, cutoff);
+            workspace.reserve(7 * StrassenWorkspace<T>::rounded(m2 * n2) + taskSize);
+            const size_t mark = workspace.mark();
+            T *pP[7];
+            for (T *&pProduct : pP)
+                pProduct = workspace.allocate(m2 * n2);
+
+            ThreadPool::global().parallelFor(0, 7, 1, [&](long from, long upto)
+                                             {
+                for (long i = from; i < upto; i++)
+                {
+                    StrassenWorkspace<T> &local = StrassenWorkspace<T>::local();
+                    local.reserve(taskSize);
+                    const size_t localMark = local.mark();
+                    T *pX = local.allocate(m2 * k2), *pY = local.allocate(k2 * n2);
+                    const T *pLeft = pX, *pRight = pY;
+                    long leftStride = k2, rightStride = n2;
+
+                    switch (i)
+                    {
+                    case 0:
+                        pLeft = pA11, leftStride = aStride, pRight = pB11, rightStride = bStride;
+                        break;
+                    case 1:
+                        pLeft = pA12, leftStride = aStride, pRight = pB21, rightStride = bStride;
+                        break;
+                    case 2:
+                        combineBlocks<T>(pX, k2, {{pA12, 1}, {pA21, -1}, {pA22, -1}, {pA11, 1}}, aStride, m2, k2, 0);
+                        pRight = pB22, rightStride = bStride;
+                        break;
+                    case 3:
+                        pLeft = pA22, leftStride = aStride;
+                        combineBlocks<T>(pY, n2, {{pB22, 1}, {pB12, -1}, {pB11, 1}, {pB21, -1}}, bStride, k2, n2, 0);
+                        break;
+                    case 4:
+                        combineBlocks<T>(pX, k2, {{pA21, 1}, {pA22, 1}}, aStride, m2, k2, 0);
+                        combineBlocks<T>(pY, n2, {{pB12, 1}, {pB11, -1}}, bStride, k2, n2, 0);
+                        break;
+                    case 5:
+                        combineBlocks<T>(pX, k2, {{pA21, 1}, {pA22, 1}, {pA11, -1}}, aStride, m2, k2, 0);
+                        combineBlocks<T>(pY, n2, {{pB22, 1}, {pB12, -1}, {pB11, 1}}, bStride, k2, n2, 0);
+                        break;
+                    default:
+                        combineBlocks<T>(pX, k2, {{pA11, 1}, {pA21, -1}}, aStride, m2, k2, 0);
+                        combineBlocks<T>(pY, n2, {{pB22, 1}, {pB12, -1}}, bStride, k2, n2, 0);
+                    }
+
+                    combineBlocks<T>(pP[i], n2, {}, n2, m2, n2, 0);
+                    strassenRecursive(pLeft, leftStride, pRight, rightStride, pP[i], n2, m2, k2, n2, cutoff, kernel, local);
+                    local.release(localMark);
+                } });
+
+            // With P1, ..., P7 in pP[0], ..., pP[6]: C11 += P1 + P2, C12 += P1 + P6 + P5 + P3, C21 += P1 + P6 + P7 - P4 and C22 += P1 + P6 + P7 + P5
+            combineBlocks<T>(pC11, cStride, {{pP[0], 1}, {pP[1], 1}}, n2, m2, n2, 1);
+            combineBlocks<T>(pC12, cStride, {{pP[0], 1}, {pP[5], 1}, {pP[4], 1}, {pP[2], 1}}, n2, m2, n2, 1);
+            combineBlocks<T>(pC21, cStride, {{pP[0], 1}, {pP[5], 1}, {pP[6], 1}, {pP[3], -1}}, n2, m2, n2, 1);
+            combineBlocks<T>(pC22, cStride, {{pP[0], 1}, {pP[5], 1}, {pP[6], 1}, {pP[4], 1}}, n2, m2, n2, 1);
+
+            workspace.release(mark);
+            strassenPeel(pA, aStride, pB, bStride, pC, cStride, m, k, n, kernel);
+        }
+
+        /// @brief Adds the product of a (m x k) and b (k x n) with arbitrary strides to c with the Winograd variant of Strassen's algorithm, see strassenRecursive, which takes about (7/8)^l of the multiply-adds of the conventional product for l levels of recursion. If settings.multiThread is set and the global thread pool has more than one thread, the first level runs in parallel, see strassenParallel. Operands and results that are not contiguous along their rows are copied to the workspace first.
+        /// @details The rounding error is bounded normwise rather than entrywise. With u the unit roundoff, n0 = settings.strassenCutoff, n = 2^l n0 and ||X|| the largest absolute entry of X, to first order ||C - fl(C)|| <= ((n / n0)^(log2 18) (n0^2 + 6 n0) - 6 n) u ||A|| ||B||, see Higham, Accuracy and Stability of Numerical Algorithms, 2nd ed., section 23.2. The conventional product satisfies |C - fl(C)| <= n u |A| |B| entrywise, so entries of the result that are much smaller than ||A|| ||B|| can lose much more relative accuracy with Strassen's algorithm. The bound is far from sharp. In practice, the largest error about doubles with every level, e.g. for normally distributed 2048 x 2048 matrices and the default cutoff it is about seven times that of the conventional product.
+        template <DataType T>
+        void strassenMatmul(const T *pA, long aRowStride, long aColumnStride, const T *pB, long bRowStride, long bColumnStride, T *pC, long cRowStride, long cColumnStride, long m, long k, long n, const MatmulSettings &settings)
+        {
+            StrassenWorkspace<T> &workspace = StrassenWorkspace<T>::local();
+            const MatmulKernel kernel = settings.useSimd && Simd::supported<T> ? MatmulKernel::RIGHT_FREE_AXIS : MatmulKernel::SCALAR;
+            const long cutoff = std::max(settings.strassenCutoff, 1l);
+            const bool parallel = settings.multiThread && ThreadPool::global().getThreadCount() > 1 && m > cutoff && k > cutoff && n > cutoff;
+            const bool packA = aColumnStride != 1, packB = bColumnStride != 1, packC = cColumnStride != 1;
+
+            size_t size = (packA ? StrassenWorkspace<T>::rounded(m * k) : 0) + (packB ? StrassenWorkspace<T>::rounded(k * n) : 0) + (packC ? StrassenWorkspace<T>::rounded(m * n) : 0);
+            if (parallel)
+                size += 7 * StrassenWorkspace<T>::rounded((m / 2) * (n / 2)) + StrassenWorkspace<T>::rounded((m / 2) * (k / 2)) + StrassenWorkspace<T>::rounded((k / 2) * (n / 2)) + strassenWorkspaceSize<T>(m / 2, k / 2, n / 2, cutoff);
+            else
+                size += strassenWorkspaceSize<T>(m, k, n, cutoff);
+            workspace.reserve(size);
+            const size_t mark = workspace.mark();
+
+            auto pack = [&](const T *pSource, long rows, long columns, long rowStride, long columnStride)
+            {
+                T *pPacked = workspace.allocate(rows * columns);
+                Permute::permuteCopy<T>({rows, columns}, {rowStride, columnStride}, pSource, {columns, 1}, pPacked);
+                return pPacked;
+            };
+            const T *pPackedA = packA ? pack(pA, m, k, aRowStride, aColumnStride) : pA;
+            const T *pPackedB = packB ? pack(pB, k, n, bRowStride, bColumnStride) : pB;
+            T *pResult = pC;
+            if (packC)
+            {
+                pResult = workspace.allocate(m * n);
+                combineBlocks<T>(pResult, n, {}, n, m, n, 0);
+            }
+            const long aStride = packA ? k : aRowStride, bStride = packB ? n : bRowStride, resultStride = packC ? n : cRowStride;
+
+            if (parallel)
+                strassenParallel(pPackedA, aStride, pPackedB, bStride, pResult, resultStride, m, k, n, cutoff, kernel, workspace);
+            else
+                strassenRecursive(pPackedA, aStride, pPackedB, bStride, pResult, resultStride, m, k, n, cutoff, kernel, workspace);
+
+            if (packC)
+                for (long i = 0; i < m; i++)
+                    for (long j = 0; j < n; j++)
+                        pC[i * cRowStride + j * cColumnStride] += pResult[i * n + j];
+            workspace.release(mark);
+        }
+
+        /// @brief Computes the matrix product of two arrays along the specified product axes lpa and rpa. If the argument matrices have different dimension, their shapes will be padded with 1s from the left to match the dimensions. For the padded shape, the corresponding product axis will be adjusted accordingly if the product axis was positive; otherwise the product axis will not be changed. The padded shapes sl and sr must be broadcastable to match outside of the adjusted lpa and rpa, and they must satisfy left.getShape()[leftProductAxis]==right.getShape()[rightProductAxis].
+        /// @return The matrix product of left and right axes specified in settings.
+        template <DataType T>
+        ArrayLibrary::Array<T> matmul(const Array<T> &left, const Array<T> &right, Array<T> *const pDestArray, const MatmulSettings &settings)
+        {
+            long leftProductAxis = settings.leftProductAxis % left.mDim;
+            leftProductAxis = leftProductAxis < 0 ? left.mDim + leftProductAxis : leftProductAxis;
+            long rightProductAxis = settings.rightProductAxis % right.mDim;
+            rightProductAxis = rightProductAxis < 0 ? right.mDim + rightProductAxis : rightProductAxis;
+
+            long dim = std::max(left.mDim, right.mDim);
+            leftProductAxis += dim - left.mDim;
+            rightProductAxis += dim - right.mDim;
+
+            // The operands are padded to dimension dim, and a transposed operand has its axes leftProductAxis and rightProductAxis swapped, which only changes the strides of the view
+            auto padded = [&](const Array<T> &operand, bool transpose)
+            {
+                const Array<T> view(operand.mData.view(), operand.mShape.shiftRight(1, dim - operand.mDim), operand.mStrides.shiftRight(0, dim - operand.mDim), operand.mOffset, operand.mContiguous);
+                return transpose ? view.transpose(leftProductAxis, rightProductAxis) : view.view();
+            };
+            const Array<T> leftOperand = padded(left, settings.transposeLeft);
+            const Array<T> rightOperand = padded(right, settings.transposeRight);
+            const Coordinates &leftShape = leftOperand.mShape, &leftStrides = leftOperand.mStrides;
+            const Coordinates &rightShape = rightOperand.mShape, &rightStrides = rightOperand.mStrides;
+
+            if (leftProductAxis == rightProductAxis)
+                throw std::invalid_argument("leftProductAxis must be different from rightProductAxis");
+
+            if (leftShape[leftProductAxis] != rightShape[rightProductAxis])
+                throw std::invalid_argument("Arrays do not have the same length in product dimension.");
+
+            const Coordinates productShape = matmulShape(leftShape, rightShape, leftProductAxis, rightProductAxis);
+            ReduceInformation reduceInfo = reduceShape(productShape, settings.reduceAxes, settings.keepDims);
+            // Every product of an entry of left with one of right is a multiply-add, and the operands and the reduced result are moved once
+            long productCount = leftShape[leftProductAxis];
+            for (long i = 0; i < dim; i++)
+                productCount *= productShape[i];
+            Profiler::Scope scope("matmul", Profiler::Category::MATMUL, productShape, (left.mFlatLength + right.mFlatLength + reduceInfo.flatLength) * sizeof(T), 2 * productCount);
+
+            // Packing copies an operand that is not contiguous along the axis that the kernel runs along, see MatmulPacking, with the other axes in the same order. The copies go to buffers of the calling thread that are only reallocated when they are too small, so that repeated products, e.g. the training steps of Model::fit, do not allocate.
+            thread_local std::optional<Data<T>> leftBuffer, rightBuffer;
+            auto packAlongAxis = [](const Array<T> &operand, long axis, std::optional<Data<T>> &buffer)
             {
-                long threadLength = (longestAxisLength - progress) / threads;
+                if (!buffer || buffer->size() < (size_t)operand.mFlatLength)
+                    buffer.emplace(operand.mFlatLength);
+                const long last = operand.mDim - 1;
+                const Array<T> transposed = operand.transpose(axis, last);
+                const Array<T> packed(buffer->view(), transposed.mShape);
+                Permute::permuteCopy(transposed.mShape, transposed.mStrides, transposed.getDataPointer(), packed.mStrides, packed.getDataPointer());
+                return packed.transpose(axis, last);
+            };
+
+            auto run = [&](Array<T> &dest, const MatmulConfig &config)
+            {
+                const bool productAxis = config.pack == MatmulPacking::PRODUCT_AXIS, freeAxis = config.pack == MatmulPacking::FREE_AXIS;
+                const long leftPackAxis = productAxis ? leftProductAxis : (freeAxis && config.kernel == MatmulKernel::LEFT_FREE_AXIS ? rightProductAxis : -1);
+                const long rightPackAxis = productAxis ? rightProductAxis : (freeAxis && config.kernel == MatmulKernel::RIGHT_FREE_AXIS ? leftProductAxis : -1);
+                const Array<T> packedLeft = leftPackAxis >= 0 && leftStrides[leftPackAxis] != 1 ? packAlongAxis(leftOperand, leftPackAxis, leftBuffer) : leftOperand.view();
+                const Array<T> packedRight = rightPackAxis >= 0 && rightStrides[rightPackAxis] != 1 ? packAlongAxis(rightOperand, rightPackAxis, rightBuffer) : rightOperand.view();
+
+                T *pLeftData = packedLeft.getDataPointer(), *pRightData = packedRight.getDataPointer(), *pDestData = dest.getDataPointer();
+                matmulDispatcher(leftShape, packedLeft.mStrides, pLeftData, rightShape, packedRight.mStrides, pRightData, dest.refShape(), dest.refStrides(), pDestData, leftProductAxis, rightProductAxis, config);
+            };
+
+            // The partial products of the blocks of the product axis are computed without compensation by the kernels, and are then summed as settings.summation says
+            auto summedDispatch = [&](Array<T> &dest)
+            {
+                MatmulSettings blockSettings = settings;
+                blockSettings.setzero = true;
+                blockSettings.leftProductAxis = leftProductAxis;
+                blockSettings.rightProductAxis = rightProductAxis;
+                blockSettings.transposeLeft = blockSettings.transposeRight = false;
+                blockSettings.keepDims = true;
+                blockSettings.summation = Summation::NAIVE;
+
+                const long productLength = leftShape[leftProductAxis];
+                const long block = std::max(settings.summationBlock, 1l);
+                auto blockProduct = [&](long from)
+                {
+                    const long upto = std::min(from + block, productLength);
+                    Array<T> partial = Array<T>::empty(dest.refShape());
+                    matmul<T>(leftOperand.sliceAxis(leftProductAxis, from, upto), rightOperand.sliceAxis(rightProductAxis, from, upto), &partial, blockSettings);
+                    return partial;
+                };
+
+                if (settings.summation == Summation::KAHAN)
+                {
+                    Array<T> sum = dest.copy(), compensation = Array<T>::constant(dest.refShape(), 0);
+                    T *pSum = sum.getDataPointer(), *pCompensation = compensation.getDataPointer();
+                    for (long from = 0; from < productLength; from += block)
+                    {
+                        const Array<T> partial = blockProduct(from);
+                        const T *pPartial = partial.getDataPointer();
+                        for (long i = 0; i < sum.mFlatLength; i++)
+                            CompensatedSum::kahanAdd(pSum[i], pCompensation[i], pPartial[i]);
+                    }
+                    computeInPlace<Copy<T>>(dest, sum + compensation);
+                    return;
+                }
 
-                Coordinates threadLeftShape(leftShape);
-                Coordinates threadRightShape(rightShape);
-                Coordinates threadResultShape(resultShape);
+                // levels[l] holds the sum of 2^l consecutive blocks, like the digits of a binary counter, so that every block is added to sums of equally many blocks
+                std::vector<std::optional<Array<T>>> levels;
+                for (long from = 0; from < productLength; from += block)
+                {
+                    Array<T> carry = blockProduct(from);
+                    size_t l = 0;
+                    for (; l < levels.size() && levels[l]; l++)
+                    {
+                        carry += *levels[l];
+                        levels[l].reset();
+                    }
+                    if (l == levels.size())
+                        levels.emplace_back();
+                    levels[l] = std::move(carry);
+                }
 
-                T *pThreadLeftData = pLeftData;
-                T *pThreadRightData = pRightData;
-                T *pThreadResultData = pResultData + progress * resultStrides[longestAxis];
+                std::optional<Array<T>> total;
+                for (std::optional<Array<T>> &level : levels)
+                    if (level)
+                        total = total ? *level + *total : *level;
+                dest += *total;
+            };
 
-                if (longestAxis != leftProductAxis)
+            auto dispatch = [&](Array<T> &dest)
+            {
+                const long leftLength = leftShape[rightProductAxis], rightLength = rightShape[leftProductAxis], productLength = leftShape[leftProductAxis];
+                if (settings.summation != Summation::NAIVE && productLength > settings.summationBlock)
+                {
+                    summedDispatch(dest);
+                    return;
+                }
+
+                if (settings.strassen && productCount == leftLength * rightLength * productLength && std::min({leftLength, rightLength, productLength}) > settings.strassenCutoff)
                 {
-                    threadLeftShape[longestAxis] = threadLength;
-                    pThreadLeftData = pLeftData + progress * leftStrides[longestAxis];
+                    const Coordinates &destStrides = dest.refStrides();
+                    strassenMatmul<T>(leftOperand.getDataPointer(), leftStrides[rightProductAxis], leftStrides[leftProductAxis], rightOperand.getDataPointer(), rightStrides[rightProductAxis], rightStrides[leftProductAxis], dest.getDataPointer(), destStrides[rightProductAxis], destStrides[leftProductAxis], leftLength, productLength, rightLength, settings);
+                    return;
                 }
-                if (longestAxis != rightProductAxis)
+
+                Autotuner &tuner = Autotuner::global();
+                if (!tuner.isEnabled())
                 {
-                    threadRightShape[longestAxis] = threadLength;
-                    pThreadRightData = pRightData + progress * rightStrides[longestAxis];
+                    run(dest, defaultConfig<T>(leftShape, leftStrides, left.mFlatLength, rightShape, rightStrides, right.mFlatLength, dest.refStrides(), leftProductAxis, rightProductAxis, productCount, settings));
+                    return;
                 }
 
-                threadResultShape[longestAxis] = threadLength;
+                const std::string signature = Autotuner::signature<T>(leftShape, leftStrides, rightShape, rightStrides, dest.refShape(), dest.refStrides(), leftProductAxis, rightProductAxis, settings);
+                std::optional<MatmulConfig> config = tuner.find(signature);
+                if (!config)
+                {
+                    // The candidates accumulate into dest, so its entries are restored before the actual product
+                    const std::optional<Array<T>> initial = settings.setzero ? std::nullopt : std::optional<Array<T>>(dest.copy());
+                    const long matrixProductCount = leftShape[leftProductAxis] * leftShape[rightProductAxis] * rightShape[leftProductAxis];
+                    const long batchCount = matrixProductCount > 0 ? productCount / matrixProductCount : 0;
+                    config = tuner.search(kernelCandidates<T>(leftShape, leftStrides, rightShape, rightStrides, dest.refStrides(), leftProductAxis, rightProductAxis, settings), leftShape[rightProductAxis], rightShape[leftProductAxis], batchCount, settings.multiThread, [&](const MatmulConfig &candidate)
+                                          { run(dest, candidate); });
+                    tuner.store(signature, *config);
+
+                    if (settings.setzero)
+                        dest = 0;
+                    else
+                        computeInPlace<Copy<T>>(dest, *initial);
+                }
+                run(dest, *config);
+            };
+
+            if (pDestArray == nullptr)
+            {
+                Array<T> result = Array<T>::constant(reduceInfo.keepDimsShape, 0);
+                dispatch(result);
+
+                return settings.keepDims ? result : result.reshape(reduceInfo.reducedShape);
+            }
+            else
+            {
+                if (reduceInfo.reducedShape != pDestArray->refShape().shiftRight(1, reduceInfo.reducedShape.size() - pDestArray->getDim()))
+                    throw std::invalid_argument("The shape of the destination array does not fit the product shape of left and right.");
+
+                pDestArray->copyOnWrite();
+                Array<T> dest = settings.keepDims ? pDestArray->view() : pDestArray->reshape(reduceInfo.keepDimsShape);
+                if (settings.setzero)
+                    dest = 0;
 
-                progress += threadLength;
+                dispatch(dest);
 
-                // baseMatmul(threadLeftShape, leftStrides, pThreadLeftData, threadRightShape, rightStrides, pThreadRightData, threadResultShape, resultStrides, pThreadResultData, leftProductAxis, rightProductAxis);
-                std::thread t(baseMatmul, threadLeftShape, leftStrides, pThreadLeftData, threadRightShape, rightStrides, pThreadRightData, threadResultShape, resultStrides, pThreadResultData, leftProductAxis, rightProductAxis);
-                threadPool[threads - 1] = std::move(t);
+                return dest;
             }
+        }
 
-            for (auto &t : threadPool)
-                t.join();
+        template <DataType T>
+        inline ArrayLibrary::Array<T> matmul(const Array<T> &left, const Array<T> &right, const MatmulSettings &settings)
+        {
+            return matmul<T>(left, right, nullptr, settings);
+        }
+
+        template <DataType T>
+        Array<T> matmul(const Array<T> &left, const Array<T> &right)
+        {
+            return matmul<T>(left, right, nullptr, MatmulSettings());
         }
     }
 }
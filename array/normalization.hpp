@@ -0,0 +1,529 @@
+#ifndef ARRAY_NORMALIZATION_H
+#define ARRAY_NORMALIZATION_H
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+#include "array.hpp"
+#include "permute.hpp"
+#include "thread_pool.hpp"
+
+namespace ArrayLibrary
+{
+    /// @brief Kernels of layer and batch normalization and of softmax. An array is viewed as a matrix whose rows run along its last axis, which is the axis of the scale and shift.
+    /// @details The mean and variance are computed in a single pass with Welford's algorithm, which unlike E[x^2] - E[x]^2 does not cancel catastrophically, and normalization, scale and shift are applied together in a second sweep. The backward kernels reuse the mean and inverse standard deviation of the forward pass and accumulate into the gradients.
+    template <DataType T>
+    class Normalization
+    {
+        static constexpr long LENGTH = Simd::LENGTH<T>;
+        /// The number of entries above which the rows of softmax are spread over the thread pool
+        static constexpr long CONCURRENCY_THRESHOLD = 0x10000;
+
+        static T horizontalSum(const Simd::Vector<T> &a)
+        {
+            T buffer[LENGTH];
+            Simd::storeUnaligned<T>(buffer, a);
+            T sum = 0;
+            for (long l = 0; l < LENGTH; l++)
+                sum += buffer[l];
+            return sum;
+        }
+
+        /// @brief Makes array contiguous and unique so that it can be written through a pointer. A non-contiguous array is replaced by a copy if its entries are needed, and by an uninitialized array otherwise.
+        static T *writePointer(Array<T> &array, bool keepEntries)
+        {
+            if (!array.isContiguous())
+                array = keepEntries ? array.copy() : Array<T>::empty(array.refShape());
+            array.ensureUnique();
+            return array.getDataPointer();
+        }
+
+        static long rowLength(const Array<T> &x)
+        {
+            if (x.getDim() == 0)
+                throw std::invalid_argument("Normalization needs an array with at least one axis.");
+            return x.refShape()[x.getDim() - 1];
+        }
+
+        static void checkShapes(const Array<T> &x, const Array<T> &scale, const Array<T> &shift, const Array<T> &dest, const Array<T> &mean, const Array<T> &inverseStd, long statistics)
+        {
+            const long n = rowLength(x);
+            if (scale.getFlatLength() != n || shift.getFlatLength() != n)
+                throw std::invalid_argument("Scale and shift must have the length of the last axis.");
+            if (dest.refShape() != x.refShape())
+                throw std::invalid_argument("The destination must have the shape of the source.");
+            if (mean.getFlatLength() != statistics || inverseStd.getFlatLength() != statistics)
+                throw std::invalid_argument("The mean and inverse standard deviation have the wrong length.");
+        }
+
+        /// @brief The mean and the sum of squared deviations of p[0], ..., p[n - 1]. Each SIMD lane runs its own Welford recursion over every LENGTH-th entry, and the lanes are merged with the formula of Chan et al. before the remaining entries are added.
+        static void rowMoments(const T *p, long n, T &mean, T &squares)
+        {
+            long j = 0;
+            mean = 0;
+            squares = 0;
+
+            if constexpr (Simd::supported<T>)
+            {
+                if (n >= LENGTH)
+                {
+                    auto laneMean = Simd::zero<T>(), laneSquares = Simd::zero<T>();
+                    long count = 0;
+                    for (; j + LENGTH <= n; j += LENGTH)
+                    {
+                        const auto v = Simd::loadUnaligned<T>(p + j);
+                        const auto delta = v - laneMean;
+                        laneMean = Simd::fusedMultiplyAdd<T>(delta, Simd::broadcast_set<T>(T(1) / ++count), laneMean);
+                        laneSquares = Simd::fusedMultiplyAdd<T>(delta, v - laneMean, laneSquares);
+                    }
+
+                    T means[LENGTH], sums[LENGTH];
+                    Simd::storeUnaligned<T>(means, laneMean);
+                    Simd::storeUnaligned<T>(sums, laneSquares);
+                    for (long l = 0; l < LENGTH; l++)
+                        mean += means[l];
+                    mean /= LENGTH;
+                    for (long l = 0; l < LENGTH; l++)
+                        squares += sums[l] + count * (means[l] - mean) * (means[l] - mean);
+                }
+            }
+
+            for (; j < n; j++)
+            {
+                const T delta = p[j] - mean;
+                mean += delta / (j + 1);
+                squares += delta * (p[j] - mean);
+            }
+        }
+
+        /// @brief The maximum of p[0], ..., p[n - 1] and the sum of exp(p[j] - max), in a single pass. Whenever the maximum grows, the sum so far is rescaled by exp(old - new). Each SIMD lane keeps its own maximum and sum, which are updated once per block of four vectors so that the rescaling costs one exponential per block, and the lanes are merged before the remaining entries are added.
+        static void rowExpStatistics(const T *p, long n, T &max, T &sum)
+        {
+            long j = 0;
+            max = std::numeric_limits<T>::lowest();
+            sum = 0;
+
+            if constexpr (Simd::supported<T>)
+            {
+                if (n >= LENGTH)
+                {
+                    auto laneMax = Simd::broadcast_set<T>(max), laneSum = Simd::zero<T>();
+                    for (; j + 4 * LENGTH <= n; j += 4 * LENGTH)
+                    {
+                        const auto v0 = Simd::loadUnaligned<T>(p + j), v1 = Simd::loadUnaligned<T>(p + j + LENGTH);
+                        const auto v2 = Simd::loadUnaligned<T>(p + j + 2 * LENGTH), v3 = Simd::loadUnaligned<T>(p + j + 3 * LENGTH);
+                        const auto blockMax = Simd::max<T>(laneMax, Simd::max<T>(Simd::max<T>(v0, v1), Simd::max<T>(v2, v3)));
+                        laneSum = laneSum * Simd::exp<T>(laneMax - blockMax) + ((Simd::exp<T>(v0 - blockMax) + Simd::exp<T>(v1 - blockMax)) + (Simd::exp<T>(v2 - blockMax) + Simd::exp<T>(v3 - blockMax)));
+                        laneMax = blockMax;
+                    }
+                    for (; j + LENGTH <= n; j += LENGTH)
+                    {
+                        const auto v = Simd::loadUnaligned<T>(p + j);
+                        const auto blockMax = Simd::max<T>(laneMax, v);
+                        laneSum = laneSum * Simd::exp<T>(laneMax - blockMax) + Simd::exp<T>(v - blockMax);
+                        laneMax = blockMax;
+                    }
+
+                    T maxima[LENGTH], sums[LENGTH];
+                    Simd::storeUnaligned<T>(maxima, laneMax);
+                    Simd::storeUnaligned<T>(sums, laneSum);
+                    for (long l = 0; l < LENGTH; l++)
+                        max = std::max(max, maxima[l]);
+                    for (long l = 0; l < LENGTH; l++)
+                        sum += sums[l] * std::exp(maxima[l] - max);
+                }
+            }
+
+            for (; j < n; j++)
+            {
+                if (p[j] > max)
+                {
+                    sum = sum * std::exp(max - p[j]) + 1;
+                    max = p[j];
+                }
+                else
+                    sum += std::exp(p[j] - max);
+            }
+        }
+
+        /// @brief Writes the softmax of the row p[0], ..., p[n - 1], or its logarithm, to pOut, which may be p
+        static void softmaxRow(const T *p, T *pOut, long n, bool logarithm)
+        {
+            T max, sum;
+            rowExpStatistics(p, n, max, sum);
+
+            long j = 0;
+            if (logarithm)
+            {
+                const T shift = max + std::log(sum);
+                if constexpr (Simd::supported<T>)
+                {
+                    const auto vShift = Simd::broadcast_set<T>(shift);
+                    for (; j + LENGTH <= n; j += LENGTH)
+                        Simd::storeUnaligned<T>(pOut + j, Simd::loadUnaligned<T>(p + j) - vShift);
+                }
+                for (; j < n; j++)
+                    pOut[j] = p[j] - shift;
+                return;
+            }
+
+            const T scale = T(1) / sum;
+            if constexpr (Simd::supported<T>)
+            {
+                const auto vMax = Simd::broadcast_set<T>(max), vScale = Simd::broadcast_set<T>(scale);
+                for (; j + LENGTH <= n; j += LENGTH)
+                    Simd::storeUnaligned<T>(pOut + j, Simd::exp<T>(Simd::loadUnaligned<T>(p + j) - vMax) * vScale);
+            }
+            for (; j < n; j++)
+                pOut[j] = std::exp(p[j] - max) * scale;
+        }
+
+        static void softmaxRows(const T *pX, T *pOut, long rows, long n, bool logarithm)
+        {
+            auto rowRange = [&](long from, long upto)
+            {
+                for (long r = from; r < upto; r++)
+                    softmaxRow(pX + r * n, pOut + r * n, n, logarithm);
+            };
+
+            const long entries = rows * n;
+            if (entries >= CONCURRENCY_THRESHOLD && rows > 1)
+                ThreadPool::global().parallelFor(0, rows, std::max(1l, CONCURRENCY_THRESHOLD * rows / entries), rowRange);
+            else
+                rowRange(0, rows);
+        }
+
+    public:
+        /// @brief Softmax along axes, exp(x - max) / sum(exp(x - max)) with the maximum and the sum taken over axes. With logarithm set, dest receives x - max - log(sum) instead, which does not round tiny probabilities to zero.
+        /// @details Each row, i.e. the entries along axes for one position of the other axes, is read once for its maximum and sum of exponentials, see rowExpStatistics, and written once. The rows are spread over the thread pool. If axes are not the trailing axes, the entries are first copied into an array whose trailing axes they are, and the result is copied back.
+        static Array<T> &softmax(const Array<T> &x, const Coordinates &axes, Array<T> &dest, bool logarithm = false)
+        {
+            const long dim = x.getDim();
+            bool reduce[MAX_DIM] = {false};
+            for (long i = 0; i < axes.size(); i++)
+            {
+                if (axes[i] < -dim || axes[i] >= dim)
+                    throw std::invalid_argument("Axis out of bounds.");
+                reduce[axes[i] < 0 ? axes[i] + dim : axes[i]] = true;
+            }
+            if (dest.refShape() != x.refShape())
+                throw std::invalid_argument("The destination must have the shape of the source.");
+            if (x.getFlatLength() == 0)
+                return dest;
+
+            // The kept axes followed by the reduced ones, whose entries form the rows
+            Coordinates order(dim);
+            long k = 0;
+            for (long i = 0; i < dim; i++)
+                if (!reduce[i])
+                    order[k++] = i;
+            long n = 1;
+            for (long i = 0; i < dim; i++)
+                if (reduce[i])
+                {
+                    order[k++] = i;
+                    n *= x.refShape()[i];
+                }
+            const long rows = x.getFlatLength() / n;
+
+            bool trailing = true;
+            for (long i = 0; i < dim; i++)
+                trailing = trailing && order[i] == i;
+
+            // Holds on to the entries of x in case dest is x. A view of x is enough if x is a view itself, since dest then writes through to the same entries either way
+            const Array<T> source = x.isView() ? x.view() : x;
+            T *pDest = writePointer(dest, false);
+
+            if (trailing)
+            {
+                const T *pX = source.readDataPointer();
+                if (!source.isContiguous())
+                {
+                    Permute::permuteCopy(source.mShape, source.mStrides, pX, dest.mStrides, pDest);
+                    pX = pDest;
+                }
+                softmaxRows(pX, pDest, rows, n, logarithm);
+                return dest;
+            }
+
+            Coordinates shape(dim), sourceStrides(dim), destStrides(dim);
+            for (long i = 0; i < dim; i++)
+            {
+                shape[i] = source.mShape[order[i]];
+                sourceStrides[i] = source.mStrides[order[i]];
+                destStrides[i] = dest.mStrides[order[i]];
+            }
+            Array<T> permuted = Array<T>::empty(shape);
+            T *pPermuted = permuted.getDataPointer();
+            Permute::permuteCopy(shape, sourceStrides, source.readDataPointer(), permuted.mStrides, pPermuted);
+            softmaxRows(pPermuted, pPermuted, rows, n, logarithm);
+            Permute::permuteCopy(shape, permuted.mStrides, pPermuted, destStrides, pDest);
+
+            return dest;
+        }
+
+        /// @brief Layer normalization: normalizes each row of x by its own mean and variance, then applies scale and shift along the row.
+        /// @param mean Receives the mean of each row, and has to have one entry per row
+        /// @param inverseStd Receives 1 / sqrt(variance + epsilon) of each row
+        static Array<T> &normalizeRows(const Array<T> &x, const Array<T> &scale, const Array<T> &shift, T epsilon, Array<T> &dest, Array<T> &mean, Array<T> &inverseStd)
+        {
+            const long n = rowLength(x);
+            const long rows = n == 0 ? 0 : x.getFlatLength() / n;
+            checkShapes(x, scale, shift, dest, mean, inverseStd, rows);
+            if (x.getFlatLength() == 0)
+                return dest;
+
+            const Array<T> source = x.isContiguous() ? x : x.copy();
+            const Array<T> scaleSource = scale.isContiguous() ? scale : scale.copy(), shiftSource = shift.isContiguous() ? shift : shift.copy();
+            const T *pX = source.readDataPointer(), *pScale = scaleSource.readDataPointer(), *pShift = shiftSource.readDataPointer();
+            T *pDest = writePointer(dest, false), *pMean = writePointer(mean, false), *pInverseStd = writePointer(inverseStd, false);
+
+            for (long r = 0; r < rows; r++)
+            {
+                const T *pRow = pX + r * n;
+                T *pOut = pDest + r * n;
+                T squares;
+                rowMoments(pRow, n, pMean[r], squares);
+                pInverseStd[r] = T(1) / std::sqrt(squares / n + epsilon);
+
+                const T m = pMean[r], s = pInverseStd[r];
+                long j = 0;
+                if constexpr (Simd::supported<T>)
+                {
+                    const auto vMean = Simd::broadcast_set<T>(m), vInverseStd = Simd::broadcast_set<T>(s);
+                    for (; j + LENGTH <= n; j += LENGTH)
+                        Simd::storeUnaligned<T>(pOut + j, Simd::fusedMultiplyAdd<T>(Simd::loadUnaligned<T>(pRow + j) - vMean, Simd::loadUnaligned<T>(pScale + j) * vInverseStd, Simd::loadUnaligned<T>(pShift + j)));
+                }
+                for (; j < n; j++)
+                    pOut[j] = (pRow[j] - m) * pScale[j] * s + pShift[j];
+            }
+
+            return dest;
+        }
+
+        /// @brief Adds the gradients of normalizeRows with respect to x, scale and shift, given the gradient of its result and the statistics it computed.
+        /// @details With y = scale * xhat + shift and d = scale * gradient, the gradient of x is inverseStd * (d - mean(d) - xhat * mean(d * xhat)) along each row. The row sums are taken in a first sweep that also accumulates the gradients of scale and shift, and the gradient of x in a second one.
+        static void normalizeRowsGradient(const Array<T> &x, const Array<T> &scale, const Array<T> &mean, const Array<T> &inverseStd, const Array<T> &gradient, Array<T> &sourceGradient, Array<T> &scaleGradient, Array<T> &shiftGradient)
+        {
+            const long n = rowLength(x);
+            const long rows = n == 0 ? 0 : x.getFlatLength() / n;
+            checkShapes(x, scale, scale, gradient, mean, inverseStd, rows);
+            if (sourceGradient.refShape() != x.refShape() || scaleGradient.getFlatLength() != n || shiftGradient.getFlatLength() != n)
+                throw std::invalid_argument("The gradients must have the shapes of x, scale and shift.");
+            if (x.getFlatLength() == 0)
+                return;
+
+            const Array<T> source = x.isContiguous() ? x : x.copy(), grad = gradient.isContiguous() ? gradient : gradient.copy();
+            const Array<T> scaleSource = scale.isContiguous() ? scale : scale.copy();
+            const Array<T> meanSource = mean.isContiguous() ? mean : mean.copy(), inverseStdSource = inverseStd.isContiguous() ? inverseStd : inverseStd.copy();
+            const T *pX = source.readDataPointer(), *pGrad = grad.readDataPointer(), *pScale = scaleSource.readDataPointer();
+            const T *pMean = meanSource.readDataPointer(), *pInverseStd = inverseStdSource.readDataPointer();
+            T *pSourceGrad = writePointer(sourceGradient, true), *pScaleGrad = writePointer(scaleGradient, true), *pShiftGrad = writePointer(shiftGradient, true);
+
+            for (long r = 0; r < rows; r++)
+            {
+                const T *pRow = pX + r * n, *pG = pGrad + r * n;
+                T *pOut = pSourceGrad + r * n;
+                const T m = pMean[r], s = pInverseStd[r];
+
+                T sumD = 0, sumDX = 0;
+                long j = 0;
+                if constexpr (Simd::supported<T>)
+                {
+                    const auto vMean = Simd::broadcast_set<T>(m), vInverseStd = Simd::broadcast_set<T>(s);
+                    auto vSumD = Simd::zero<T>(), vSumDX = Simd::zero<T>();
+                    for (; j + LENGTH <= n; j += LENGTH)
+                    {
+                        const auto g = Simd::loadUnaligned<T>(pG + j);
+                        const auto xhat = (Simd::loadUnaligned<T>(pRow + j) - vMean) * vInverseStd;
+                        const auto d = g * Simd::loadUnaligned<T>(pScale + j);
+                        vSumD = vSumD + d;
+                        vSumDX = Simd::fusedMultiplyAdd<T>(d, xhat, vSumDX);
+                        Simd::storeUnaligned<T>(pScaleGrad + j, Simd::fusedMultiplyAdd<T>(g, xhat, Simd::loadUnaligned<T>(pScaleGrad + j)));
+                        Simd::storeUnaligned<T>(pShiftGrad + j, Simd::loadUnaligned<T>(pShiftGrad + j) + g);
+                    }
+                    sumD = horizontalSum(vSumD);
+                    sumDX = horizontalSum(vSumDX);
+                }
+                for (; j < n; j++)
+                {
+                    const T xhat = (pRow[j] - m) * s;
+                    const T d = pG[j] * pScale[j];
+                    sumD += d;
+                    sumDX += d * xhat;
+                    pScaleGrad[j] += pG[j] * xhat;
+                    pShiftGrad[j] += pG[j];
+                }
+
+                const T meanD = sumD / n, meanDX = sumDX / n;
+                j = 0;
+                if constexpr (Simd::supported<T>)
+                {
+                    const auto vMean = Simd::broadcast_set<T>(m), vInverseStd = Simd::broadcast_set<T>(s);
+                    const auto vMeanD = Simd::broadcast_set<T>(meanD), vMeanDX = Simd::broadcast_set<T>(meanDX);
+                    for (; j + LENGTH <= n; j += LENGTH)
+                    {
+                        const auto xhat = (Simd::loadUnaligned<T>(pRow + j) - vMean) * vInverseStd;
+                        const auto d = Simd::loadUnaligned<T>(pG + j) * Simd::loadUnaligned<T>(pScale + j);
+                        const auto dx = (d - vMeanD - xhat * vMeanDX) * vInverseStd;
+                        Simd::storeUnaligned<T>(pOut + j, Simd::loadUnaligned<T>(pOut + j) + dx);
+                    }
+                }
+                for (; j < n; j++)
+                {
+                    const T xhat = (pRow[j] - m) * s;
+                    pOut[j] += (pG[j] * pScale[j] - meanD - xhat * meanDX) * s;
+                }
+            }
+        }
+
+        /// @brief Batch normalization: normalizes each column of x, i.e. each entry of the last axis over all other axes, then applies scale and shift.
+        /// @param batchStatistics If true, the mean and inverse standard deviation of each column are computed from x and written to mean and inverseStd. Otherwise the given ones are used, e.g. running statistics at inference.
+        /// @details The statistics are accumulated row by row, so that x is read in memory order and every column advances its Welford recursion in its SIMD lane.
+        static Array<T> &normalizeColumns(const Array<T> &x, const Array<T> &scale, const Array<T> &shift, T epsilon, Array<T> &dest, Array<T> &mean, Array<T> &inverseStd, bool batchStatistics = true)
+        {
+            const long n = rowLength(x);
+            const long rows = n == 0 ? 0 : x.getFlatLength() / n;
+            checkShapes(x, scale, shift, dest, mean, inverseStd, n);
+            if (x.getFlatLength() == 0)
+                return dest;
+
+            const Array<T> source = x.isContiguous() ? x : x.copy();
+            const Array<T> scaleSource = scale.isContiguous() ? scale : scale.copy(), shiftSource = shift.isContiguous() ? shift : shift.copy();
+            const T *pX = source.readDataPointer(), *pScale = scaleSource.readDataPointer(), *pShift = shiftSource.readDataPointer();
+            T *pDest = writePointer(dest, false), *pMean = writePointer(mean, batchStatistics == false), *pInverseStd = writePointer(inverseStd, batchStatistics == false);
+
+            if (batchStatistics)
+            {
+                // The sums of squared deviations are kept in inverseStd until the last row
+                std::fill(pMean, pMean + n, T(0));
+                std::fill(pInverseStd, pInverseStd + n, T(0));
+                for (long r = 0; r < rows; r++)
+                {
+                    const T *pRow = pX + r * n;
+                    const T weight = T(1) / (r + 1);
+                    long j = 0;
+                    if constexpr (Simd::supported<T>)
+                    {
+                        const auto vWeight = Simd::broadcast_set<T>(weight);
+                        for (; j + LENGTH <= n; j += LENGTH)
+                        {
+                            const auto v = Simd::loadUnaligned<T>(pRow + j);
+                            const auto m = Simd::loadUnaligned<T>(pMean + j);
+                            const auto delta = v - m;
+                            const auto updated = Simd::fusedMultiplyAdd<T>(delta, vWeight, m);
+                            Simd::storeUnaligned<T>(pMean + j, updated);
+                            Simd::storeUnaligned<T>(pInverseStd + j, Simd::fusedMultiplyAdd<T>(delta, v - updated, Simd::loadUnaligned<T>(pInverseStd + j)));
+                        }
+                    }
+                    for (; j < n; j++)
+                    {
+                        const T delta = pRow[j] - pMean[j];
+                        pMean[j] += delta * weight;
+                        pInverseStd[j] += delta * (pRow[j] - pMean[j]);
+                    }
+                }
+
+                for (long j = 0; j < n; j++)
+                    pInverseStd[j] = T(1) / std::sqrt(pInverseStd[j] / rows + epsilon);
+            }
+
+            for (long r = 0; r < rows; r++)
+            {
+                const T *pRow = pX + r * n;
+                T *pOut = pDest + r * n;
+                long j = 0;
+                if constexpr (Simd::supported<T>)
+                {
+                    for (; j + LENGTH <= n; j += LENGTH)
+                    {
+                        const auto factor = Simd::loadUnaligned<T>(pScale + j) * Simd::loadUnaligned<T>(pInverseStd + j);
+                        Simd::storeUnaligned<T>(pOut + j, Simd::fusedMultiplyAdd<T>(Simd::loadUnaligned<T>(pRow + j) - Simd::loadUnaligned<T>(pMean + j), factor, Simd::loadUnaligned<T>(pShift + j)));
+                    }
+                }
+                for (; j < n; j++)
+                    pOut[j] = (pRow[j] - pMean[j]) * pScale[j] * pInverseStd[j] + pShift[j];
+            }
+
+            return dest;
+        }
+
+        /// @brief Adds the gradients of normalizeColumns with respect to x, scale and shift.
+        /// @param batchStatistics Whether the statistics were computed from x, in which case they depend on x as well. For fixed statistics, the gradient of x is just scale * inverseStd * gradient.
+        /// @details The column sums of gradient and gradient * xhat, which are also the batch's contribution to the gradients of shift and scale, are taken in a first sweep over the rows, and the gradient of x in a second one.
+        static void normalizeColumnsGradient(const Array<T> &x, const Array<T> &scale, const Array<T> &mean, const Array<T> &inverseStd, const Array<T> &gradient, Array<T> &sourceGradient, Array<T> &scaleGradient, Array<T> &shiftGradient, bool batchStatistics = true)
+        {
+            const long n = rowLength(x);
+            const long rows = n == 0 ? 0 : x.getFlatLength() / n;
+            checkShapes(x, scale, scale, gradient, mean, inverseStd, n);
+            if (sourceGradient.refShape() != x.refShape() || scaleGradient.getFlatLength() != n || shiftGradient.getFlatLength() != n)
+                throw std::invalid_argument("The gradients must have the shapes of x, scale and shift.");
+            if (x.getFlatLength() == 0)
+                return;
+
+            const Array<T> source = x.isContiguous() ? x : x.copy(), grad = gradient.isContiguous() ? gradient : gradient.copy();
+            const Array<T> scaleSource = scale.isContiguous() ? scale : scale.copy();
+            const Array<T> meanSource = mean.isContiguous() ? mean : mean.copy(), inverseStdSource = inverseStd.isContiguous() ? inverseStd : inverseStd.copy();
+            const T *pX = source.readDataPointer(), *pGrad = grad.readDataPointer(), *pScale = scaleSource.readDataPointer();
+            const T *pMean = meanSource.readDataPointer(), *pInverseStd = inverseStdSource.readDataPointer();
+            T *pSourceGrad = writePointer(sourceGradient, true), *pScaleGrad = writePointer(scaleGradient, true), *pShiftGrad = writePointer(shiftGradient, true);
+
+            std::vector<T> sumG(n, T(0)), sumGX(n, T(0));
+            for (long r = 0; r < rows; r++)
+            {
+                const T *pRow = pX + r * n, *pG = pGrad + r * n;
+                long j = 0;
+                if constexpr (Simd::supported<T>)
+                {
+                    for (; j + LENGTH <= n; j += LENGTH)
+                    {
+                        const auto g = Simd::loadUnaligned<T>(pG + j);
+                        const auto xhat = (Simd::loadUnaligned<T>(pRow + j) - Simd::loadUnaligned<T>(pMean + j)) * Simd::loadUnaligned<T>(pInverseStd + j);
+                        Simd::storeUnaligned<T>(sumG.data() + j, Simd::loadUnaligned<T>(sumG.data() + j) + g);
+                        Simd::storeUnaligned<T>(sumGX.data() + j, Simd::fusedMultiplyAdd<T>(g, xhat, Simd::loadUnaligned<T>(sumGX.data() + j)));
+                    }
+                }
+                for (; j < n; j++)
+                {
+                    sumG[j] += pG[j];
+                    sumGX[j] += pG[j] * (pRow[j] - pMean[j]) * pInverseStd[j];
+                }
+            }
+
+            for (long j = 0; j < n; j++)
+            {
+                pScaleGrad[j] += sumGX[j];
+                pShiftGrad[j] += sumG[j];
+                // Turned into the means of d = scale * gradient and d * xhat over the column
+                sumG[j] = batchStatistics ? sumG[j] * pScale[j] / rows : 0;
+                sumGX[j] = batchStatistics ? sumGX[j] * pScale[j] / rows : 0;
+            }
+
+            for (long r = 0; r < rows; r++)
+            {
+                const T *pRow = pX + r * n, *pG = pGrad + r * n;
+                T *pOut = pSourceGrad + r * n;
+                long j = 0;
+                if constexpr (Simd::supported<T>)
+                {
+                    for (; j + LENGTH <= n; j += LENGTH)
+                    {
+                        const auto s = Simd::loadUnaligned<T>(pInverseStd + j);
+                        const auto xhat = (Simd::loadUnaligned<T>(pRow + j) - Simd::loadUnaligned<T>(pMean + j)) * s;
+                        const auto d = Simd::loadUnaligned<T>(pG + j) * Simd::loadUnaligned<T>(pScale + j);
+                        const auto dx = (d - Simd::loadUnaligned<T>(sumG.data() + j) - xhat * Simd::loadUnaligned<T>(sumGX.data() + j)) * s;
+                        Simd::storeUnaligned<T>(pOut + j, Simd::loadUnaligned<T>(pOut + j) + dx);
+                    }
+                }
+                for (; j < n; j++)
+                {
+                    const T xhat = (pRow[j] - pMean[j]) * pInverseStd[j];
+                    pOut[j] += (pG[j] * pScale[j] - sumG[j] - xhat * sumGX[j]) * pInverseStd[j];
+                }
+            }
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef ARRAY_PERMUTE_H
+#define ARRAY_PERMUTE_H
+
+#include <algorithm>
+
+#include "constants.hpp"
+#include "shape.hpp"
+#include "simd.hpp"
+
+namespace ArrayLibrary
+{
+    namespace Permute
+    {
+        /// @brief The side length of the square tiles in which transposeTiled works, chosen so that the source and dest lines of a tile stay in the L1 cache
+        constexpr long TRANSPOSE_TILE = 32;
+
+        /// @brief Sets dest[r * destStride + c] = source[c * sourceStride + r] for all r < rows and c < cols.
+        /// @details The loops run over square tiles so that neither the reads nor the writes jump through memory. Inside a tile, blocks of Simd::LENGTH<T> x Simd::LENGTH<T> entries are transposed in registers if T has SIMD support.
+        template <DataType T>
+        void transposeTiled(const T *pSource, const long sourceStride, T *pDest, const long destStride, const long rows, const long cols)
+        {
+            constexpr long BLOCK = Simd::supported<T> ? Simd::LENGTH<T> : 1;
+
+            for (long r0 = 0; r0 < rows; r0 += TRANSPOSE_TILE)
+            {
+                const long rEnd = std::min(r0 + TRANSPOSE_TILE, rows);
+                for (long c0 = 0; c0 < cols; c0 += TRANSPOSE_TILE)
+                {
+                    const long cEnd = std::min(c0 + TRANSPOSE_TILE, cols);
+
+                    long r = r0;
+                    if constexpr (Simd::supported<T>)
+                    {
+                        for (; r + BLOCK <= rEnd; r += BLOCK)
+                        {
+                            long c = c0;
+                            for (; c + BLOCK <= cEnd; c += BLOCK)
+                                Simd::transposeBlock<T>(pSource + c * sourceStride + r, sourceStride, pDest + r * destStride + c, destStride);
+
+                            for (long i = r; i < r + BLOCK; i++)
+                                for (long j = c; j < cEnd; j++)
+                                    pDest[i * destStride + j] = pSource[j * sourceStride + i];
+                        }
+                    }
+
+                    for (; r < rEnd; r++)
+                        for (long c = c0; c < cEnd; c++)
+                            pDest[r * destStride + c] = pSource[c * sourceStride + r];
+                }
+            }
+        }
+
+        /// @brief Copies the entries of a source with the given shape and strides into a dest with the same shape and its own strides.
+        /// @details The loops run over the canonical layout of dest and source, see canonicalizeLayout. If the innermost axis is contiguous for both, it is copied row by row. If it is only contiguous for dest, the axis along which the source is contiguous is transposed into it with transposeTiled. Otherwise, the entries are copied one by one along the innermost axis. All other axes are looped over one position at a time.
+        template <DataType T>
+        void permuteCopy(const Coordinates &shape, const Coordinates &sourceStrides, const T *pSource, const Coordinates &destStrides, T *pDest)
+        {
+            for (long i = 0; i < shape.size(); i++)
+                if (shape[i] == 0)
+                    return;
+
+            // Dest first, so that the innermost axis is the one along which dest is written contiguously
+            const CanonicalLayout<2> layout = canonicalizeLayout<2>(shape, {&destStrides, &sourceStrides});
+            const Coordinates &canonicalShape = layout.shape;
+            const Coordinates &dStrides = layout.strides[0];
+            const Coordinates &sStrides = layout.strides[1];
+
+            const long inner = canonicalShape.size() - 1;
+            const long innerLength = canonicalShape[inner];
+
+            long transposeAxis = -1;
+            if (sStrides[inner] != 1 && dStrides[inner] == 1)
+                for (long i = 0; i < inner; i++)
+                    if (sStrides[i] == 1)
+                        transposeAxis = i;
+
+            Coordinates outerShape(0), sourceOuterStrides(0), destOuterStrides(0);
+            for (long i = 0; i < inner; i++)
+            {
+                if (i == transposeAxis)
+                    continue;
+                outerShape.pushBack(canonicalShape[i]);
+                sourceOuterStrides.pushBack(sStrides[i]);
+                destOuterStrides.pushBack(dStrides[i]);
+            }
+
+            const long outerDim = outerShape.size();
+            Coordinates c(outerDim, 0);
+
+            while (true)
+            {
+                if (transposeAxis != -1)
+                    transposeTiled(pSource, sStrides[inner], pDest, dStrides[transposeAxis], canonicalShape[transposeAxis], innerLength);
+                else if (sStrides[inner] == 1 && dStrides[inner] == 1)
+                    std::copy(pSource, pSource + innerLength, pDest);
+                else
+                    for (long j = 0; j < innerLength; j++)
+                        pDest[j * dStrides[inner]] = pSource[j * sStrides[inner]];
+
+                long i = outerDim - 1;
+                for (; i >= 0; i--)
+                {
+                    c[i]++;
+
+                    if (c[i] != outerShape[i])
+                    {
+                        pSource += sourceOuterStrides[i];
+                        pDest += destOuterStrides[i];
+                        break;
+                    }
+                    else
+                    {
+                        pSource -= sourceOuterStrides[i] * (outerShape[i] - 1);
+                        pDest -= destOuterStrides[i] * (outerShape[i] - 1);
+                        c[i] = 0;
+                    }
+                }
+
+                if (i < 0)
+                    break;
+            }
+        }
+    }
+}
+
+#endif
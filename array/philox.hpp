@@ -0,0 +1,110 @@
+#ifndef ARRAY_PHILOX_H
+#define ARRAY_PHILOX_H
+
+#include <array>
+#include <cstdint>
+#include <immintrin.h>
+
+namespace ArrayLibrary
+{
+    /// @brief The Philox4x32-10 counter-based random number generator by Salmon et al., "Parallel random numbers: as easy as 1, 2, 3".
+    /// @details Each block of four random 32-bit words is a bijective function of a 128-bit counter under a 64-bit key, so any block can be computed without computing the blocks before it. The counter holds the index of the block in its low and a stream number in its high 64 bits.
+    namespace Philox
+    {
+        constexpr uint32_t MULTIPLIER_0 = 0xD2511F53;
+        constexpr uint32_t MULTIPLIER_1 = 0xCD9E8D57;
+        constexpr uint32_t WEYL_0 = 0x9E3779B9;
+        constexpr uint32_t WEYL_1 = 0xBB67AE85;
+        constexpr int ROUNDS = 10;
+
+        /// @brief The number of blocks computed at once by batch, one per 32-bit lane of a SIMD vector
+        constexpr long BLOCKS_PER_BATCH = 8;
+        constexpr long WORDS_PER_BATCH = 4 * BLOCKS_PER_BATCH;
+
+        struct Key
+        {
+            uint32_t k0;
+            uint32_t k1;
+
+            Key() : k0(0), k1(0) {}
+            Key(uint64_t seed) : k0((uint32_t)seed), k1((uint32_t)(seed >> 32)) {}
+        };
+
+        using Block = std::array<uint32_t, 4>;
+        /// @brief Word w of block firstBlock + j is lane j of words[w]
+        struct Batch
+        {
+            __m256i words[4];
+        };
+
+        /// @brief Applies the rounds to the counter {c0, c1, c2, c3}
+        inline Block block(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, Key key)
+        {
+            for (int round = 0; round < ROUNDS; round++)
+            {
+                if (round > 0)
+                {
+                    key.k0 += WEYL_0;
+                    key.k1 += WEYL_1;
+                }
+
+                const uint64_t p0 = (uint64_t)MULTIPLIER_0 * c0;
+                const uint64_t p1 = (uint64_t)MULTIPLIER_1 * c2;
+                c0 = (uint32_t)(p1 >> 32) ^ c1 ^ key.k0;
+                c1 = (uint32_t)p1;
+                c2 = (uint32_t)(p0 >> 32) ^ c3 ^ key.k1;
+                c3 = (uint32_t)p0;
+            }
+
+            return {c0, c1, c2, c3};
+        }
+
+        inline Block block(uint64_t index, uint64_t stream, Key key)
+        {
+            return block((uint32_t)index, (uint32_t)(index >> 32), (uint32_t)stream, (uint32_t)(stream >> 32), key);
+        }
+
+        /// @brief The high and low 32 bits of the products of multiplier with each lane of x
+        inline void multiplyHighLow(const __m256i &multiplier, const __m256i &x, __m256i &high, __m256i &low)
+        {
+            const __m256i even = _mm256_mul_epu32(x, multiplier);
+            const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), multiplier);
+            low = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+            high = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+        }
+
+        /// @brief Computes the blocks firstBlock, ..., firstBlock + BLOCKS_PER_BATCH - 1 of a stream at once. The result is the same as that of block for each of them.
+        /// @param firstBlock Has to be a multiple of BLOCKS_PER_BATCH, so that the low words of the counters do not wrap around inside the batch
+        inline Batch batch(uint64_t firstBlock, uint64_t stream, Key key)
+        {
+            const __m256i m0 = _mm256_set1_epi32((int)MULTIPLIER_0);
+            const __m256i m1 = _mm256_set1_epi32((int)MULTIPLIER_1);
+
+            __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32((int)(uint32_t)firstBlock), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+            __m256i c1 = _mm256_set1_epi32((int)(uint32_t)(firstBlock >> 32));
+            __m256i c2 = _mm256_set1_epi32((int)(uint32_t)stream);
+            __m256i c3 = _mm256_set1_epi32((int)(uint32_t)(stream >> 32));
+
+            for (int round = 0; round < ROUNDS; round++)
+            {
+                if (round > 0)
+                {
+                    key.k0 += WEYL_0;
+                    key.k1 += WEYL_1;
+                }
+
+                __m256i high0, low0, high1, low1;
+                multiplyHighLow(m0, c0, high0, low0);
+                multiplyHighLow(m1, c2, high1, low1);
+                c0 = _mm256_xor_si256(_mm256_xor_si256(high1, c1), _mm256_set1_epi32((int)key.k0));
+                c1 = low1;
+                c2 = _mm256_xor_si256(_mm256_xor_si256(high0, c3), _mm256_set1_epi32((int)key.k1));
+                c3 = low0;
+            }
+
+            return Batch{{c0, c1, c2, c3}};
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,557 @@
+#ifndef ARRAY_PROFILER_H
+#define ARRAY_PROFILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/// @brief Hardware performance counters of the calling thread via perf_event_open on Linux, which tell whether a region is stalled on cache misses or limited by its instructions.
+/// @details Each thread opens its counters as one group on its first read, so that all of them count over the same intervals. Only user space is counted, which perf_event_paranoid <= 2 allows without privileges. If the counters cannot be opened, e.g. for missing permissions, on other systems or in virtual machines without a PMU, they read as zero and isAvailable explains why. Counters that the CPU does not support are left out of the group individually.
+/// The counters are disabled by default, since reading them is a system call. Work that a region hands to the thread pool is counted on the worker threads, not on the thread that measures the region.
+namespace HardwareCounters
+{
+    enum Counter : uint8_t
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        LLC_MISSES,
+        L1D_MISSES,
+        BRANCH_MISSES
+    };
+
+    constexpr size_t COUNTER_COUNT = 5;
+
+    inline const char *counterKey(size_t counter)
+    {
+        static const char *keys[] = {"cycles", "instructions", "llcMisses", "l1dMisses", "branchMisses"};
+        return keys[counter];
+    }
+
+    struct Values
+    {
+        uint64_t counts[COUNTER_COUNT] = {};
+
+        uint64_t operator[](Counter counter) const { return counts[counter]; }
+
+        Values &operator+=(const Values &other)
+        {
+            for (size_t i = 0; i < COUNTER_COUNT; i++)
+                counts[i] += other.counts[i];
+            return *this;
+        }
+
+        Values operator-(const Values &other) const
+        {
+            Values result;
+            for (size_t i = 0; i < COUNTER_COUNT; i++)
+                result.counts[i] = counts[i] - other.counts[i];
+            return result;
+        }
+
+        /// @brief Instructions per cycle
+        double ipc() const { return counts[CYCLES] > 0 ? (double)counts[INSTRUCTIONS] / counts[CYCLES] : 0; }
+    };
+
+    /// @brief The counter group of one thread, which is closed when the thread exits
+    class ThreadCounters
+    {
+        int mFds[COUNTER_COUNT];
+        uint64_t mIds[COUNTER_COUNT] = {};
+        std::string mError;
+
+    public:
+        ThreadCounters()
+        {
+            std::fill(mFds, mFds + COUNTER_COUNT, -1);
+#ifdef __linux__
+            const std::pair<uint32_t, uint64_t> events[COUNTER_COUNT] = {
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+                {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}};
+
+            for (size_t i = 0; i < COUNTER_COUNT; i++)
+            {
+                perf_event_attr attributes;
+                std::memset(&attributes, 0, sizeof(attributes));
+                attributes.size = sizeof(attributes);
+                attributes.type = events[i].first;
+                attributes.config = events[i].second;
+                attributes.exclude_kernel = 1;
+                attributes.exclude_hv = 1;
+                attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+                // The cycles lead the group, and the others join it
+                mFds[i] = syscall(SYS_perf_event_open, &attributes, 0, -1, i == CYCLES ? -1 : mFds[CYCLES], 0);
+                if (mFds[i] == -1)
+                {
+                    if (i == CYCLES)
+                    {
+                        mError = std::string("perf_event_open failed: ") + std::strerror(errno) + (errno == EACCES || errno == EPERM ? " (see /proc/sys/kernel/perf_event_paranoid)" : "");
+                        return;
+                    }
+                    continue;
+                }
+                if (ioctl(mFds[i], PERF_EVENT_IOC_ID, &mIds[i]) == -1)
+                {
+                    close(mFds[i]);
+                    mFds[i] = -1;
+                }
+            }
+#else
+            mError = "Hardware counters require perf_event_open, which only Linux has.";
+#endif
+        }
+
+        ThreadCounters(const ThreadCounters &other) = delete;
+
+        ~ThreadCounters()
+        {
+#ifdef __linux__
+            for (int fd : mFds)
+                if (fd != -1)
+                    close(fd);
+#endif
+        }
+
+        bool isOpen() const { return mFds[CYCLES] != -1; }
+
+        bool isSupported(Counter counter) const { return mFds[counter] != -1; }
+
+        /// @brief Why the counters could not be opened, or an empty string if they could
+        const std::string &refError() const { return mError; }
+
+        /// @brief The counts since the group was opened. If the kernel had to multiplex the group with other events, the counts are scaled to the time the group was enabled.
+        Values read() const
+        {
+            Values values;
+#ifdef __linux__
+            if (!isOpen())
+                return values;
+
+            // nr, time enabled, time running, then a value and an id per counter
+            uint64_t buffer[3 + 2 * COUNTER_COUNT];
+            if (::read(mFds[CYCLES], buffer, sizeof(buffer)) <= 0)
+                return values;
+
+            const uint64_t count = std::min<uint64_t>(buffer[0], COUNTER_COUNT);
+            const double scale = buffer[2] > 0 && buffer[2] < buffer[1] ? (double)buffer[1] / buffer[2] : 1;
+            for (uint64_t j = 0; j < count; j++)
+                for (size_t i = 0; i < COUNTER_COUNT; i++)
+                    if (mFds[i] != -1 && mIds[i] == buffer[4 + 2 * j])
+                        values.counts[i] = scale == 1 ? buffer[3 + 2 * j] : (uint64_t)(buffer[3 + 2 * j] * scale);
+#endif
+            return values;
+        }
+    };
+
+    inline ThreadCounters &threadCounters()
+    {
+        thread_local ThreadCounters counters;
+        return counters;
+    }
+
+    inline std::atomic<bool> enabled = false;
+
+    inline bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    /// @brief Enables or disables reading the counters in PerformanceMeasure and the profiler. Enabling has no effect on threads whose counters are not available.
+    inline void setEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+
+    /// @brief Whether the counters of the calling thread could be opened, see refError otherwise
+    inline bool isAvailable() { return threadCounters().isOpen(); }
+
+    inline const std::string &refError() { return threadCounters().refError(); }
+
+    /// @brief Whether the counters are enabled and available on the calling thread
+    inline bool isActive() { return isEnabled() && isAvailable(); }
+
+    /// @brief Accumulates the counts of the calling thread between start and stop, which must be called on the same thread
+    struct Measure
+    {
+        Values accumulated;
+        Values startValues;
+        bool active = false;
+
+        void start()
+        {
+            active = isActive();
+            if (active)
+                startValues = threadCounters().read();
+        }
+
+        void stop()
+        {
+            if (active)
+                accumulated += threadCounters().read() - startValues;
+            active = false;
+        }
+    };
+
+    inline void writeHeader(std::ostream &s)
+    {
+        s << std::left << std::setw(40) << "name" << std::right << std::setw(12) << "us/pass" << std::setw(14) << "cycles/pass" << std::setw(8) << "IPC" << std::setw(14) << "LLC miss/el" << std::setw(14) << "L1D miss/el" << std::setw(14) << "br miss/el" << "\n";
+    }
+
+    /// @brief Writes the counts of a region per pass and per element, e.g. per entry of the result of a unit
+    inline void writeRow(std::ostream &s, const std::string &name, double microseconds, const Values &values, double passes, double elements)
+    {
+        const std::ios_base::fmtflags flags = s.flags();
+        const std::streamsize precision = s.precision();
+        const ThreadCounters &counters = threadCounters();
+        auto perElement = [&](Counter counter)
+        {
+            if (!counters.isSupported(counter))
+                s << std::setw(14) << "-";
+            else
+                s << std::setw(14) << (elements > 0 ? values[counter] / elements : 0);
+        };
+
+        s << std::left << std::setw(40) << (name.size() > 39 ? name.substr(0, 36) + "..." : name) << std::right << std::fixed;
+        s << std::setprecision(1) << std::setw(12) << microseconds / passes << std::setw(14) << values[CYCLES] / passes;
+        s << std::setprecision(2) << std::setw(8) << values.ipc() << std::setprecision(4);
+        perElement(LLC_MISSES);
+        perElement(L1D_MISSES);
+        perElement(BRANCH_MISSES);
+        s << "\n";
+        s.flags(flags);
+        s.precision(precision);
+    }
+}
+
+/// @brief A tracing profiler that records timed events of units, kernels, allocations and the thread pool, and exports them in the Chrome trace format for chrome://tracing or Perfetto.
+/// @details Each thread writes complete events (name, start, duration, shape, bytes, flops and, while they are enabled, the hardware counters) into its own ring buffer, so recording takes no lock. When the buffer is full, the oldest events are overwritten. While the profiler is disabled, which is the default, a Scope costs a single relaxed atomic load.
+/// Export and clear read the buffers of all threads, so they must not run while profiled work is running.
+namespace Profiler
+{
+    enum class Category : uint8_t
+    {
+        FORWARD,
+        BACKWARD,
+        MATMUL,
+        POINTWISE,
+        REDUCE,
+        ALLOCATION,
+        OPTIMIZER,
+        THREAD_POOL,
+        STEP
+    };
+
+    inline const char *categoryName(Category category)
+    {
+        static const char *names[] = {"forward", "backward", "matmul", "pointwise", "reduce", "allocation", "optimizer", "thread pool", "step"};
+        return names[static_cast<size_t>(category)];
+    }
+
+    constexpr long MAX_DIMS = 6;
+    constexpr size_t EVENTS_PER_THREAD = 1 << 15;
+
+    struct Event
+    {
+        /// Must point to a string that outlives the profiler, e.g. a literal or the result of typeid(...).name(), which is demangled on export
+        const char *name = nullptr;
+        Category category = Category::FORWARD;
+        bool instant = false;
+        uint8_t dims = 0;
+        long shape[MAX_DIMS] = {};
+        size_t bytes = 0;
+        uint64_t flops = 0;
+        uint64_t start = 0;
+        uint64_t duration = 0;
+        /// The hardware counters of the thread during the event, if they were active when it started
+        bool counted = false;
+        HardwareCounters::Values counters = {};
+    };
+
+    struct ThreadBuffer
+    {
+        const long threadId;
+        std::vector<Event> events;
+        size_t written = 0;
+
+        ThreadBuffer(long threadId) : threadId(threadId), events(EVENTS_PER_THREAD) {}
+
+        void record(const Event &event)
+        {
+            events[written % events.size()] = event;
+            written++;
+        }
+    };
+
+    /// @brief The number, time and analytical work of the recorded events of one category, summed over all threads
+    struct Totals
+    {
+        std::atomic<uint64_t> events = 0;
+        std::atomic<uint64_t> nanoseconds = 0;
+        std::atomic<uint64_t> bytes = 0;
+        std::atomic<uint64_t> flops = 0;
+
+        void add(const Event &event)
+        {
+            events.fetch_add(1, std::memory_order_relaxed);
+            nanoseconds.fetch_add(event.duration, std::memory_order_relaxed);
+            bytes.fetch_add(event.bytes, std::memory_order_relaxed);
+            flops.fetch_add(event.flops, std::memory_order_relaxed);
+        }
+
+        void clear()
+        {
+            events = 0;
+            nanoseconds = 0;
+            bytes = 0;
+            flops = 0;
+        }
+    };
+
+    constexpr size_t CATEGORY_COUNT = static_cast<size_t>(Category::STEP) + 1;
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        Totals totals[CATEGORY_COUNT];
+        const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+        static Registry &get()
+        {
+            static Registry registry;
+            return registry;
+        }
+    };
+
+    inline std::atomic<bool> enabled = false;
+
+    inline bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    inline void setEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+
+    /// @brief Nanoseconds since the registry was created
+    inline uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Registry::get().epoch).count();
+    }
+
+    /// @brief The buffer of the calling thread, which is created and registered by the first event the thread records. Registered buffers outlive their threads.
+    inline ThreadBuffer &threadBuffer()
+    {
+        thread_local std::shared_ptr<ThreadBuffer> pBuffer = []
+        {
+            Registry &registry = Registry::get();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.buffers.push_back(std::make_shared<ThreadBuffer>(registry.buffers.size()));
+            return registry.buffers.back();
+        }();
+        return *pBuffer;
+    }
+
+    template <typename Shape>
+    void setShape(Event &event, const Shape &shape)
+    {
+        event.dims = static_cast<uint8_t>(std::min((long)shape.size(), MAX_DIMS));
+        for (long i = 0; i < event.dims; i++)
+            event.shape[i] = shape[i];
+    }
+
+    /// @brief Records an event without duration, e.g. an allocation
+    inline void instant(const char *name, Category category, size_t bytes)
+    {
+        if (!isEnabled())
+            return;
+
+        threadBuffer().record(Event{.name = name, .category = category, .instant = true, .bytes = bytes, .start = now()});
+    }
+
+    template <typename Shape>
+    void instant(const char *name, Category category, const Shape &shape, size_t bytes)
+    {
+        if (!isEnabled())
+            return;
+
+        Event event{.name = name, .category = category, .instant = true, .bytes = bytes, .start = now()};
+        setShape(event, shape);
+        threadBuffer().record(event);
+    }
+
+    /// @brief Records the time from its construction to its destruction as one event. Scopes on the same thread nest in the trace by their times.
+    class Scope
+    {
+        bool mActive;
+        Event mEvent;
+
+    public:
+        Scope(const char *name, Category category) : mActive(isEnabled())
+        {
+            if (mActive)
+            {
+                mEvent = Event{.name = name, .category = category};
+                mEvent.counted = HardwareCounters::isActive();
+                if (mEvent.counted)
+                    mEvent.counters = HardwareCounters::threadCounters().read();
+                mEvent.start = now();
+            }
+        }
+
+        template <typename Shape>
+        Scope(const char *name, Category category, const Shape &shape, size_t bytes, uint64_t flops = 0) : Scope(name, category)
+        {
+            describe(shape, bytes, flops);
+        }
+
+        Scope(const Scope &other) = delete;
+
+        /// @brief Sets the shape and the analytical number of bytes moved and floating point operations the event reports, e.g. once the result of a unit is known
+        template <typename Shape>
+        void describe(const Shape &shape, size_t bytes, uint64_t flops = 0)
+        {
+            if (mActive)
+            {
+                setShape(mEvent, shape);
+                mEvent.bytes = bytes;
+                mEvent.flops = flops;
+            }
+        }
+
+        ~Scope()
+        {
+            if (mActive)
+            {
+                mEvent.duration = now() - mEvent.start;
+                if (mEvent.counted)
+                    mEvent.counters = HardwareCounters::threadCounters().read() - mEvent.counters;
+                threadBuffer().record(mEvent);
+                Registry::get().totals[static_cast<size_t>(mEvent.category)].add(mEvent);
+            }
+        }
+    };
+
+    /// @brief The totals of all events of a category recorded since the last clear, including those that were overwritten in the ring buffers
+    inline const Totals &totals(Category category)
+    {
+        return Registry::get().totals[static_cast<size_t>(category)];
+    }
+
+    /// @brief Discards all recorded events and totals
+    inline void clear()
+    {
+        Registry &registry = Registry::get();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (auto &pBuffer : registry.buffers)
+            pBuffer->written = 0;
+        for (auto &categoryTotals : registry.totals)
+            categoryTotals.clear();
+    }
+
+    inline std::string demangle(const char *name)
+    {
+#ifdef __GNUG__
+        int status = 0;
+        char *pDemangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+        if (status == 0 && pDemangled != nullptr)
+        {
+            std::string result(pDemangled);
+            std::free(pDemangled);
+            return result;
+        }
+#endif
+        return name;
+    }
+
+    inline void writeJsonString(std::ostream &s, const std::string &text)
+    {
+        s.put('"');
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                s.put('\\');
+            s.put(c);
+        }
+        s.put('"');
+    }
+
+    /// @brief Writes a time in nanoseconds as microseconds, the unit of the trace format
+    inline void writeMicroseconds(std::ostream &s, uint64_t time)
+    {
+        s << time / 1000 << '.' << std::setw(3) << std::setfill('0') << time % 1000 << std::setfill(' ');
+    }
+
+    /// @brief Writes all recorded events in the Chrome trace event format, with one track per thread. Events of units are named by their demangled types.
+    inline void writeChromeTrace(std::ostream &s)
+    {
+        Registry &registry = Registry::get();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        s << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+        bool first = true;
+        for (auto &pBuffer : registry.buffers)
+        {
+            s << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << pBuffer->threadId << ", \"args\": {\"name\": \"thread " << pBuffer->threadId << "\"}}";
+            first = false;
+
+            const size_t capacity = pBuffer->events.size();
+            const size_t begin = pBuffer->written > capacity ? pBuffer->written - capacity : 0;
+            for (size_t i = begin; i < pBuffer->written; i++)
+            {
+                const Event &event = pBuffer->events[i % capacity];
+                const bool isUnit = event.category == Category::FORWARD || event.category == Category::BACKWARD;
+
+                s << ",\n{\"name\": ";
+                writeJsonString(s, isUnit ? demangle(event.name) : std::string(event.name));
+                s << ", \"cat\": \"" << categoryName(event.category) << "\", \"ph\": \"" << (event.instant ? "i" : "X") << "\", \"pid\": 0, \"tid\": " << pBuffer->threadId;
+                s << ", \"ts\": ";
+                writeMicroseconds(s, event.start);
+                if (event.instant)
+                    s << ", \"s\": \"t\"";
+                else
+                {
+                    s << ", \"dur\": ";
+                    writeMicroseconds(s, event.duration);
+                }
+
+                s << ", \"args\": {\"shape\": \"[";
+                for (long d = 0; d < event.dims; d++)
+                    s << (d > 0 ? ", " : "") << event.shape[d];
+                s << "]\", \"bytes\": " << event.bytes << ", \"flops\": " << event.flops;
+                if (event.counted)
+                {
+                    for (size_t c = 0; c < HardwareCounters::COUNTER_COUNT; c++)
+                        s << ", \"" << HardwareCounters::counterKey(c) << "\": " << event.counters.counts[c];
+                    s << ", \"ipc\": " << event.counters.ipc();
+                }
+                s << "}}";
+            }
+        }
+        s << "\n]}\n";
+    }
+
+    inline void writeChromeTrace(const std::string &path)
+    {
+        std::ofstream file(path);
+        if (!file)
+            throw std::runtime_error("Could not open " + path + " for writing.");
+        writeChromeTrace(file);
+    }
+}
+
+#endif
\ No newline at end of file
@@ -1,23 +1,134 @@
 #ifndef RANDOM_HPP
 #define RANDOM_HPP
 
+#include <numbers>
 #include <random>
 
 #include "array_library.hpp"
+#include "philox.hpp"
+#include "thread_pool.hpp"
 
 namespace ArrayLibrary
 {
+    /// @brief Draws random arrays. Uniform, normal and Bernoulli arrays come from the Philox counter-based generator, see Philox, and all other distributions from std::default_random_engine.
+    /// @details Every Philox array is drawn from a new stream of the generator's key. Its entries only depend on the key, the stream and their flat index, so large arrays are split between the threads of ThreadPool::global and the result is the same for any number of threads.
     class RandomArrayGenerator
     {
         static std::random_device randomDevice;
         std::default_random_engine mRandomEngine;
+        Philox::Key mKey;
+        uint64_t mStream = 0;
+        bool mMultiThread = true;
+
+        /// @brief The number of Philox batches below which an array is generated on the calling thread only
+        static constexpr long MIN_BATCHES_PER_THREAD = 256;
+
+        /// @brief Calls f(k, batch) for the Philox batches k = 0, ..., batches - 1 of the given stream.
+        template <typename F>
+        void forEachBatch(uint64_t stream, long batches, const F &f) const
+        {
+            const Philox::Key key = mKey;
+            auto range = [&](long from, long upto)
+            {
+                for (long k = from; k < upto; k++)
+                    f(k, Philox::batch(k * Philox::BLOCKS_PER_BATCH, stream, key));
+            };
+
+            if (mMultiThread)
+                ThreadPool::global().parallelFor(0, batches, MIN_BATCHES_PER_THREAD, range);
+            else
+                range(0, batches);
+        }
+
+        /// @brief Fills pData[0], ..., pData[length - 1] from a new stream, where batchValues(batch, pOut) turns the k-th Philox batch of the stream into the entries k * VALUES, ..., (k + 1) * VALUES - 1 at pOut.
+        /// @details The last, partial batch is computed into a buffer, so that all entries go through the same code no matter where the batches are split between threads.
+        template <long VALUES, DataType T, typename F>
+        void generate(T *pData, long length, const F &batchValues)
+        {
+            forEachBatch(newStream(), (length + VALUES - 1) / VALUES, [&](long k, const Philox::Batch &batch)
+                         {
+                             if ((k + 1) * VALUES <= length)
+                                 batchValues(batch, pData + k * VALUES);
+                             else
+                             {
+                                 T buffer[VALUES];
+                                 batchValues(batch, buffer);
+                                 std::copy(buffer, buffer + length - k * VALUES, pData + k * VALUES);
+                             } });
+        }
+
+        /// @brief A word is below the threshold with the given probability, up to a resolution of 2^-32.
+        static uint64_t bernoulliThreshold(double probability)
+        {
+            if (probability < 0 || probability > 1)
+                throw std::invalid_argument("The probability must lie between 0 and 1.");
+
+            return (uint64_t)std::llround(probability * 4294967296.0);
+        }
+
+        /// @brief All bits set in the lanes whose words lie below the threshold, see bernoulliThreshold.
+        /// @details AVX2 only compares signed integers, so the sign bits are flipped first. A threshold of 2^32 accepts every word.
+        static inline __m256 belowThreshold(const __m256i &words, uint64_t threshold)
+        {
+            if (threshold > UINT32_MAX)
+                return _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+            const __m256i sign = _mm256_set1_epi32((int)0x80000000);
+            const __m256i biasedThreshold = _mm256_set1_epi32((int)((uint32_t)threshold ^ 0x80000000u));
+            return _mm256_castsi256_ps(_mm256_cmpgt_epi32(biasedThreshold, _mm256_xor_si256(words, sign)));
+        }
+
+        static void storeWords(const Philox::Batch &batch, uint32_t (&words)[4][Philox::BLOCKS_PER_BATCH])
+        {
+            for (long w = 0; w < 4; w++)
+                _mm256_storeu_si256((__m256i *)words[w], batch.words[w]);
+        }
+
+        /// @brief The upper 24 bits of each word as a float in [0, 1)
+        static inline __m256 unitFloats(const __m256i &words)
+        {
+            return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(words, 8)), _mm256_set1_ps(1.0f / (1 << 24)));
+        }
+
+        /// @brief 53 bits of two words as a double in [0, 1)
+        static inline double unitDouble(uint32_t high, uint32_t low)
+        {
+            return ((high >> 5) * 67108864.0 + (low >> 6)) / 9007199254740992.0;
+        }
+
+        /// @brief Computes sin(2 pi u) and cos(2 pi u) for u in [0, 1).
+        /// @details 4u is split into the nearest quadrant q and an angle in [-pi/4, pi/4], for which the polynomial approximations of the Cephes library are accurate to about 1e-7. The quadrant then swaps and negates the results.
+        static inline void sinCosTurn(const __m256 &u, __m256 &sin, __m256 &cos)
+        {
+            const __m256 t = _mm256_mul_ps(u, _mm256_set1_ps(4));
+            const __m256 q = _mm256_round_ps(t, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            const __m256 a = _mm256_mul_ps(_mm256_sub_ps(t, q), _mm256_set1_ps(1.57079632679489662f));
+            const __m256 z = _mm256_mul_ps(a, a);
+
+            const __m256 sinPolynomial = _mm256_fmadd_ps(_mm256_fmadd_ps(_mm256_set1_ps(-1.9515295891E-4f), z, _mm256_set1_ps(8.3321608736E-3f)), z, _mm256_set1_ps(-1.6666654611E-1f));
+            const __m256 s = _mm256_fmadd_ps(_mm256_mul_ps(a, z), sinPolynomial, a);
+            const __m256 cosPolynomial = _mm256_fmadd_ps(_mm256_fmadd_ps(_mm256_set1_ps(2.443315711809948E-5f), z, _mm256_set1_ps(-1.388731625493765E-3f)), z, _mm256_set1_ps(4.166664568298827E-2f));
+            const __m256 c = _mm256_fmadd_ps(_mm256_mul_ps(z, z), cosPolynomial, _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, _mm256_set1_ps(1)));
+
+            const __m256i quadrant = _mm256_cvtps_epi32(q);
+            const __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+            const __m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(2)), 30));
+            const __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+
+            sin = _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sinSign);
+            cos = _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), cosSign);
+        }
 
     public:
-        RandomArrayGenerator() : mRandomEngine(randomDevice()) {}
+        RandomArrayGenerator() : mRandomEngine(randomDevice()), mKey(((uint64_t)randomDevice() << 32) | randomDevice()) {}
 
-        RandomArrayGenerator(long seed) : mRandomEngine(seed) {}
+        RandomArrayGenerator(long seed) : mRandomEngine(seed), mKey(seed) {}
 
-        template <DataType T> requires std::is_floating_point_v<T>
+        /// @brief Whether large Philox arrays are split between threads. The arrays are the same either way.
+        void setMultiThread(bool multiThread) { mMultiThread = multiThread; }
+
+        template <DataType T>
+            requires std::is_floating_point_v<T>
         Array<T> uniform(const Coordinates &shape, T low = 0.0, T high = 1.0)
         {
             if (low >= high)
@@ -26,26 +137,188 @@ namespace ArrayLibrary
                 low = 0.0;
             }
 
-            std::uniform_real_distribution<T> distribution(low, high);
             auto data = Data<T>(Array<T>::calculateFlatLength(shape));
-            for (long i = 0; i < data.size(); i++)
-                data[i] = distribution(mRandomEngine);
+            if (data.size() == 0)
+                return Array<T>(data, shape);
+
+            if constexpr (std::is_same_v<T, float>)
+            {
+                const __m256 offset = _mm256_set1_ps(low), scale = _mm256_set1_ps(high - low);
+                generate<Philox::WORDS_PER_BATCH>(&data[0], data.size(), [&](const Philox::Batch &batch, T *pOut)
+                                                  {
+                                                      for (long w = 0; w < 4; w++)
+                                                          _mm256_storeu_ps(pOut + w * Philox::BLOCKS_PER_BATCH, _mm256_fmadd_ps(unitFloats(batch.words[w]), scale, offset)); });
+            }
+            else
+            {
+                // Two words per entry
+                generate<Philox::WORDS_PER_BATCH / 2>(&data[0], data.size(), [&](const Philox::Batch &batch, T *pOut)
+                                                      {
+                                                          uint32_t words[4][Philox::BLOCKS_PER_BATCH];
+                                                          storeWords(batch, words);
+                                                          for (long j = 0; j < Philox::BLOCKS_PER_BATCH; j++)
+                                                          {
+                                                              pOut[j] = low + (high - low) * unitDouble(words[0][j], words[1][j]);
+                                                              pOut[j + Philox::BLOCKS_PER_BATCH] = low + (high - low) * unitDouble(words[2][j], words[3][j]);
+                                                          } });
+            }
 
             return Array<T>(data, shape);
         }
 
+        /// @brief Draws an array from a normal distribution with the Box-Muller transform, which turns two uniform numbers into two independent normal ones.
         template <DataType T>
             requires std::is_floating_point_v<T>
         Array<T> normal(const Coordinates &shape, T mean = 0.0, T std = 1.0)
         {
-            std::normal_distribution<T> distribution(mean, std);
             auto data = Data<T>(Array<T>::calculateFlatLength(shape));
-            for (long i = 0; i < data.size(); i++)
-                data[i] = distribution(mRandomEngine);
+            if (data.size() == 0)
+                return Array<T>(data, shape);
+
+            if constexpr (std::is_same_v<T, float>)
+            {
+                const __m256 offset = _mm256_set1_ps(mean), scale = _mm256_set1_ps(std);
+                generate<Philox::WORDS_PER_BATCH>(&data[0], data.size(), [&](const Philox::Batch &batch, T *pOut)
+                                                  {
+                                                      for (long w = 0; w < 4; w += 2)
+                                                      {
+                                                          // The first uniform number is taken from (0, 1], so that its logarithm is finite
+                                                          const __m256 u = _mm256_add_ps(unitFloats(batch.words[w]), _mm256_set1_ps(1.0f / (1 << 24)));
+                                                          const __m256 radius = _mm256_sqrt_ps(_mm256_mul_ps(_mm256_set1_ps(-2), Simd::log<float>(u)));
+                                                          __m256 sin, cos;
+                                                          sinCosTurn(unitFloats(batch.words[w + 1]), sin, cos);
+
+                                                          _mm256_storeu_ps(pOut + w * Philox::BLOCKS_PER_BATCH, _mm256_fmadd_ps(_mm256_mul_ps(radius, cos), scale, offset));
+                                                          _mm256_storeu_ps(pOut + (w + 1) * Philox::BLOCKS_PER_BATCH, _mm256_fmadd_ps(_mm256_mul_ps(radius, sin), scale, offset));
+                                                      } });
+            }
+            else
+            {
+                generate<Philox::WORDS_PER_BATCH / 2>(&data[0], data.size(), [&](const Philox::Batch &batch, T *pOut)
+                                                      {
+                                                          uint32_t words[4][Philox::BLOCKS_PER_BATCH];
+                                                          storeWords(batch, words);
+                                                          for (long j = 0; j < Philox::BLOCKS_PER_BATCH; j++)
+                                                          {
+                                                              const T radius = std::sqrt(-2 * std::log(1 - unitDouble(words[0][j], words[1][j])));
+                                                              const T angle = 2 * std::numbers::pi_v<T> * unitDouble(words[2][j], words[3][j]);
+                                                              pOut[j] = mean + std * radius * std::cos(angle);
+                                                              pOut[j + Philox::BLOCKS_PER_BATCH] = mean + std * radius * std::sin(angle);
+                                                          } });
+            }
 
             return Array<T>(data, shape);
         }
 
+        /// @brief Draws an array whose entries are 1 with the given probability and 0 otherwise, e.g. a dropout mask.
+        template <DataType T>
+        Array<T> bernoulli(const Coordinates &shape, double probability)
+        {
+            const uint64_t threshold = bernoulliThreshold(probability);
+            auto data = Data<T>(Array<T>::calculateFlatLength(shape));
+            if (data.size() == 0)
+                return Array<T>(data, shape);
+
+            if constexpr (std::is_same_v<T, float>)
+            {
+                generate<Philox::WORDS_PER_BATCH>(&data[0], data.size(), [&](const Philox::Batch &batch, T *pOut)
+                                                  {
+                                                      for (long w = 0; w < 4; w++)
+                                                          _mm256_storeu_ps(pOut + w * Philox::BLOCKS_PER_BATCH, _mm256_and_ps(belowThreshold(batch.words[w], threshold), _mm256_set1_ps(1))); });
+            }
+            else
+            {
+                generate<Philox::WORDS_PER_BATCH>(&data[0], data.size(), [&](const Philox::Batch &batch, T *pOut)
+                                                  {
+                                                      uint32_t words[4][Philox::BLOCKS_PER_BATCH];
+                                                      storeWords(batch, words);
+                                                      for (long w = 0; w < 4; w++)
+                                                          for (long j = 0; j < Philox::BLOCKS_PER_BATCH; j++)
+                                                              pOut[w * Philox::BLOCKS_PER_BATCH + j] = words[w][j] < threshold ? 1 : 0; });
+            }
+
+            return Array<T>(data, shape);
+        }
+
+        /// @brief Reserves a stream, whose mask can then be applied any number of times with maskedScale.
+        uint64_t newStream() { return mStream++; }
+
+        /// @brief Computes dest = source * mask / probability, or adds it to dest, where mask is the Bernoulli array that bernoulli would draw with the given probability from the given stream.
+        /// @details The mask is regenerated from the counters instead of being stored, and applied together with the scale in a single pass over the data. Applying the same stream to the gradient in the backward pass of a dropout thus reproduces the mask of the forward pass without keeping it in memory.
+        /// @param dest Has to have the shape of source. If accumulate is false, its entries are overwritten and may be uninitialized.
+        template <DataType T>
+        Array<T> &maskedScale(const Array<T> &source, Array<T> &dest, double probability, uint64_t stream, bool accumulate = false) const
+        {
+            if (source.refShape() != dest.refShape())
+                throw std::invalid_argument("The destination must have the shape of the source.");
+            if (probability == 0)
+                throw std::invalid_argument("The probability of a mask to be scaled must not be zero.");
+
+            const uint64_t threshold = bernoulliThreshold(probability);
+            const T scale = static_cast<T>(1 / probability);
+            const long length = source.getFlatLength();
+            if (length == 0)
+                return dest;
+
+            const Array<T> contiguousSource = source.isContiguous() ? source : source.copy();
+            if (!dest.isContiguous())
+            {
+                if (!accumulate)
+                    dest = Array<T>::empty(dest.refShape());
+                else
+                    dest = dest.copy();
+            }
+            dest.ensureUnique();
+            const T *pSource = contiguousSource.readDataPointer();
+            T *pDest = dest.getDataPointer();
+
+            auto batchValues = [&](const Philox::Batch &batch, const T *pIn, T *pOut)
+            {
+                if constexpr (std::is_same_v<T, float>)
+                {
+                    const __m256 simdScale = _mm256_set1_ps(scale);
+                    for (long w = 0; w < 4; w++)
+                    {
+                        const long offset = w * Philox::BLOCKS_PER_BATCH;
+                        __m256 value = _mm256_and_ps(belowThreshold(batch.words[w], threshold), _mm256_mul_ps(_mm256_loadu_ps(pIn + offset), simdScale));
+                        if (accumulate)
+                            value = _mm256_add_ps(value, _mm256_loadu_ps(pOut + offset));
+                        _mm256_storeu_ps(pOut + offset, value);
+                    }
+                }
+                else
+                {
+                    uint32_t words[4][Philox::BLOCKS_PER_BATCH];
+                    storeWords(batch, words);
+                    for (long w = 0; w < 4; w++)
+                        for (long j = 0; j < Philox::BLOCKS_PER_BATCH; j++)
+                        {
+                            const long i = w * Philox::BLOCKS_PER_BATCH + j;
+                            const T value = words[w][j] < threshold ? pIn[i] * scale : 0;
+                            pOut[i] = accumulate ? pOut[i] + value : value;
+                        }
+                }
+            };
+
+            constexpr long VALUES = Philox::WORDS_PER_BATCH;
+            forEachBatch(stream, (length + VALUES - 1) / VALUES, [&](long k, const Philox::Batch &batch)
+                         {
+                             const long from = k * VALUES;
+                             if (from + VALUES <= length)
+                                 batchValues(batch, pSource + from, pDest + from);
+                             else
+                             {
+                                 T in[VALUES] = {}, out[VALUES] = {};
+                                 std::copy(pSource + from, pSource + length, in);
+                                 if (accumulate)
+                                     std::copy(pDest + from, pDest + length, out);
+                                 batchValues(batch, in, out);
+                                 std::copy(out, out + length - from, pDest + from);
+                             } });
+
+            return dest;
+        }
+
         template <DataType T>
         /// @brief Draws an array of random integers from a uniform distribution.
         /// @param shape The shape of the resulting array.
@@ -0,0 +1,176 @@
+#ifndef ARRAY_ROOFLINE_H
+#define ARRAY_ROOFLINE_H
+
+#include <algorithm>
+#include <chrono>
+#include <immintrin.h>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+namespace ArrayLibrary
+{
+    /// @brief Analytical work counts and the peak rates of the machine, from which the roofline model bounds the attainable rate of a kernel by min(peak FLOP/s, arithmetic intensity * peak bandwidth).
+    /// @details The peaks are measured by two microbenchmarks on all threads of the global thread pool: the STREAM triad a = b + s * c for the bandwidth, and independent chains of fused multiply-adds on SIMD registers for the floating point rate. Both are single precision, like the SIMD kernels of the library.
+    namespace Roofline
+    {
+        /// @brief The floating point operations and the bytes moved to and from memory by a computation, counted analytically from the shapes of its operands
+        struct Work
+        {
+            double flops = 0;
+            double bytes = 0;
+
+            Work &operator+=(const Work &other)
+            {
+                flops += other.flops;
+                bytes += other.bytes;
+                return *this;
+            }
+
+            Work operator+(const Work &other) const { return Work(*this) += other; }
+
+            Work operator*(double factor) const { return {flops * factor, bytes * factor}; }
+
+            /// @brief Floating point operations per byte, which is compared with the ridge point of the machine to tell whether the computation is compute- or bandwidth-bound
+            double intensity() const { return bytes > 0 ? flops / bytes : 0; }
+        };
+
+        struct MachinePeak
+        {
+            double flopsPerSecond;
+            double bytesPerSecond;
+
+            /// @brief The arithmetic intensity above which the peak floating point rate, and below which the bandwidth, bounds the attainable rate
+            double ridgePoint() const { return flopsPerSecond / bytesPerSecond; }
+
+            double attainableFlopsPerSecond(double intensity) const { return std::min(flopsPerSecond, intensity * bytesPerSecond); }
+        };
+
+        /// @brief The best time of repetitions runs of f, in seconds
+        template <typename F>
+        double bestTime(int repetitions, const F &f)
+        {
+            double best = 0;
+            for (int r = 0; r < repetitions; r++)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                f();
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                best = r == 0 ? seconds : std::min(best, seconds);
+            }
+            return best;
+        }
+
+        /// @brief Measures the bandwidth of the STREAM triad a = b + s * c in bytes per second, counting three arrays of length floats moved per run
+        /// @param length Should be large enough that the arrays do not fit into the last level cache
+        inline double measureBandwidth(long length = 1 << 23, int repetitions = 5)
+        {
+            std::vector<float> a(length, 0), b(length, 1), c(length, 2);
+            const float s = 3;
+            ThreadPool &pool = ThreadPool::global();
+            auto triad = [&]
+            {
+                pool.parallelFor(0, length, 1 << 14, [&](long from, long upto)
+                                 {
+                                     const __m256 scale = _mm256_set1_ps(s);
+                                     long i = from;
+                                     for (; i + 8 <= upto; i += 8)
+                                         _mm256_storeu_ps(&a[i], _mm256_fmadd_ps(scale, _mm256_loadu_ps(&c[i]), _mm256_loadu_ps(&b[i])));
+                                     for (; i < upto; i++)
+                                         a[i] = b[i] + s * c[i]; });
+            };
+
+            triad();
+            return 3.0 * length * sizeof(float) / bestTime(repetitions, triad);
+        }
+
+        /// @brief Measures the rate of single precision fused multiply-adds on all threads in floating point operations per second, counting a multiply-add as two
+        inline double measureFlops(long iterations = 1 << 22, int repetitions = 3)
+        {
+            // One independent accumulator per SIMD register, so that the latency of the multiply-adds is hidden on all ports
+            constexpr int CHAINS = 16;
+            ThreadPool &pool = ThreadPool::global();
+            const long threads = pool.getThreadCount();
+            std::vector<float> sinks(threads);
+
+            auto run = [&]
+            {
+                pool.parallelFor(0, threads, 1, [&](long from, long upto)
+                                 {
+                                     for (long t = from; t < upto; t++)
+                                     {
+                                         __m256 accumulators[CHAINS];
+                                         for (int j = 0; j < CHAINS; j++)
+                                             accumulators[j] = _mm256_set1_ps(1.0f + j);
+                                         const __m256 factor = _mm256_set1_ps(0.999999f);
+                                         const __m256 addend = _mm256_set1_ps(1e-7f);
+
+                                         for (long i = 0; i < iterations; i++)
+                                             for (int j = 0; j < CHAINS; j++)
+                                                 accumulators[j] = _mm256_fmadd_ps(accumulators[j], factor, addend);
+
+                                         __m256 sum = accumulators[0];
+                                         for (int j = 1; j < CHAINS; j++)
+                                             sum = _mm256_add_ps(sum, accumulators[j]);
+                                         sinks[t] = _mm256_cvtss_f32(sum);
+                                     } });
+            };
+
+            run();
+            const double seconds = bestTime(repetitions, run);
+            // The sinks keep the chains from being optimized away
+            volatile float sink = 0;
+            for (float value : sinks)
+                sink = sink + value;
+            return 2.0 * 8 * CHAINS * iterations * threads / seconds;
+        }
+
+        inline MachinePeak measurePeak()
+        {
+            return {measureFlops(), measureBandwidth()};
+        }
+
+        /// @brief The peak of the machine, which is measured on the first call only
+        inline const MachinePeak &machinePeak()
+        {
+            static const MachinePeak peak = measurePeak();
+            return peak;
+        }
+
+        /// @brief Writes the header of the table written by writeRow
+        inline void writeHeader(std::ostream &s, const MachinePeak &peak)
+        {
+            const std::ios_base::fmtflags flags = s.flags();
+            const std::streamsize precision = s.precision();
+            s << "Peak: " << std::fixed << std::setprecision(1) << peak.flopsPerSecond * 1e-9 << " GFLOP/s, " << peak.bytesPerSecond * 1e-9 << " GB/s, ridge point " << std::setprecision(2) << peak.ridgePoint() << " FLOP/B\n";
+            s << std::left << std::setw(40) << "name" << std::right << std::setw(12) << "ms/step" << std::setw(14) << "MFLOP/step" << std::setw(12) << "MB/step" << std::setw(10) << "GFLOP/s" << std::setw(10) << "GB/s" << std::setw(10) << "FLOP/B" << std::setw(10) << "% peak" << std::setw(10) << "bound" << "\n";
+            s.flags(flags);
+            s.precision(precision);
+        }
+
+        /// @brief Writes one row of the roofline table for work per step that took seconds per step
+        /// @details The percentage is of the rate the roofline allows at the intensity of the work, so 100% means that the computation runs at the bound it is limited by. Since the bandwidth peak is that of main memory, memory-bound work whose operands stay in cache can exceed 100%.
+        inline void writeRow(std::ostream &s, const std::string &name, double seconds, const Work &work, const MachinePeak &peak)
+        {
+            const double flopsPerSecond = seconds > 0 ? work.flops / seconds : 0;
+            const double bytesPerSecond = seconds > 0 ? work.bytes / seconds : 0;
+            const double attainable = peak.attainableFlopsPerSecond(work.intensity());
+            const double percent = work.flops > 0 && attainable > 0 ? 100 * flopsPerSecond / attainable : (work.bytes > 0 ? 100 * bytesPerSecond / peak.bytesPerSecond : 0);
+            const char *bound = work.bytes == 0 && work.flops == 0 ? "-" : (work.intensity() < peak.ridgePoint() ? "memory" : "compute");
+            const std::ios_base::fmtflags flags = s.flags();
+            const std::streamsize precision = s.precision();
+
+            s << std::left << std::setw(40) << (name.size() > 39 ? name.substr(0, 36) + "..." : name) << std::right << std::fixed;
+            s << std::setprecision(3) << std::setw(12) << seconds * 1e3 << std::setw(14) << work.flops * 1e-6 << std::setw(12) << work.bytes * 1e-6;
+            s << std::setprecision(2) << std::setw(10) << flopsPerSecond * 1e-9 << std::setw(10) << bytesPerSecond * 1e-9 << std::setw(10) << work.intensity();
+            s << std::setprecision(1) << std::setw(10) << percent << std::setw(10) << bound << "\n";
+            s.flags(flags);
+            s.precision(precision);
+        }
+    }
+}
+
+#endif
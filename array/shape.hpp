@@ -4,6 +4,7 @@
 #include "stack_buffer.hpp"
 #include "constants.hpp"
 #include <initializer_list>
+#include <array>
 
 #define MAX_DIM 8ul
 
@@ -52,7 +53,7 @@ namespace ArrayLibrary
             if (reduce[i])
             {
                 if (keepDims)
-                    reducedShape[j++] = shape[i];
+                    reducedShape[j++] = 1;
                 keepDimShape[i] = 1;
                 keepDimStrides[i] = 0;
             }
@@ -60,11 +61,16 @@ namespace ArrayLibrary
             {
                 reducedShape[j++] = shape[i];
                 keepDimShape[i] = shape[i];
-                keepDimStrides[i] = flatLength;
-                flatLength *= shape[i];
             }
         }
 
+        // Row-major strides for the kept axes, so that the result is contiguous
+        for (int i = dim - 1; i >= 0; i--)
+        {
+            keepDimStrides[i] = keepDimShape[i] == 1 ? 0 : flatLength;
+            flatLength *= keepDimShape[i];
+        }
+
         return ReduceInformation(std::move(keepDimShape), std::move(keepDimStrides), std::move(reducedShape), flatLength);
     }
 
@@ -186,6 +192,93 @@ namespace ArrayLibrary
         return true;
     }
 
+    /// @brief Determines if the strides describe a dense row-major layout of the shape, i.e. if the entries are consecutive in memory. The strides of axes of length 1 are ignored.
+    bool isContiguousLayout(const Coordinates &shape, const Coordinates &strides)
+    {
+        long expectedStride = 1;
+        for (long i = shape.size() - 1; i >= 0; i--)
+        {
+            if (shape[i] == 1)
+                continue;
+            if (strides[i] != expectedStride)
+                return false;
+            expectedStride *= shape[i];
+        }
+
+        return true;
+    }
+
+    /// @brief The loop shape shared by several operands together with the strides of each operand, as produced by canonicalizeLayout
+    template <size_t N>
+    struct CanonicalLayout
+    {
+        Coordinates shape;
+        std::array<Coordinates, N> strides;
+    };
+
+    /// @brief Rewrites a loop over shape, in which N operands move by the given strides, into an equivalent loop with as few and as cache friendly axes as possible.
+    /// @details Axes of length 1 are dropped, the remaining axes are ordered by decreasing stride so that the smallest stride is innermost, and adjacent axes that are contiguous for every operand are merged. The order of two axes is decided by the first operand that moves along both of them, so the operands should be passed in order of priority; the original order is kept where no operand decides. Broadcast operands must have stride 0 along the axes they are broadcast along. The result has at least one axis.
+    template <size_t N>
+    CanonicalLayout<N> canonicalizeLayout(const Coordinates &shape, const std::array<const Coordinates *, N> &strides)
+    {
+        long order[MAX_DIM];
+        long dim = 0;
+        for (long i = 0; i < shape.size(); i++)
+            if (shape[i] != 1)
+                order[dim++] = i;
+
+        // Whether axis a has to be outside of axis b
+        auto outside = [&](long a, long b)
+        {
+            for (size_t k = 0; k < N; k++)
+            {
+                const long strideA = (*strides[k])[a];
+                const long strideB = (*strides[k])[b];
+                if (strideA != 0 && strideB != 0 && strideA != strideB)
+                    return strideA > strideB;
+            }
+            return false;
+        };
+
+        // Insertion sort is stable and there are at most MAX_DIM axes
+        for (long i = 1; i < dim; i++)
+            for (long j = i; j > 0 && outside(order[j], order[j - 1]); j--)
+                std::swap(order[j], order[j - 1]);
+
+        CanonicalLayout<N> layout{Coordinates(0), {}};
+        for (long i = 0; i < dim; i++)
+        {
+            const long axis = order[i];
+            const long last = layout.shape.size() - 1;
+
+            bool merge = last >= 0;
+            for (size_t k = 0; k < N && merge; k++)
+                merge = layout.strides[k][last] == (*strides[k])[axis] * shape[axis];
+
+            if (merge)
+            {
+                layout.shape[last] *= shape[axis];
+                for (size_t k = 0; k < N; k++)
+                    layout.strides[k][last] = (*strides[k])[axis];
+            }
+            else
+            {
+                layout.shape.pushBack(shape[axis]);
+                for (size_t k = 0; k < N; k++)
+                    layout.strides[k].pushBack((*strides[k])[axis]);
+            }
+        }
+
+        if (layout.shape.size() == 0)
+        {
+            layout.shape.pushBack(1);
+            for (size_t k = 0; k < N; k++)
+                layout.strides[k].pushBack(0);
+        }
+
+        return layout;
+    }
+
     class ShapeIterator
     {
         const Coordinates mShape;
@@ -216,6 +309,67 @@ namespace ArrayLibrary
             return *this;
         }
     };
+
+    /// @brief The highest number of loop axes for which kernels run staticNestedLoop instead of a generic loop with runtime carry logic
+    constexpr long MAX_STATIC_RANK = 4;
+
+    /// @brief A pointer that moves along the axes of a staticNestedLoop
+    template <typename T>
+    struct StridedPointer
+    {
+        T *pData;
+        const Coordinates &strides;
+
+        inline void outerAdvance(long axis) { pData += strides[axis]; }
+    };
+
+    /// @brief Calls body(cursors...) for every position of the first RANK axes of shape, as nested loops that are unrolled at compile time.
+    /// @details Each loop level works on its own copies of the cursors, so moving them with cursor.outerAdvance(axis) never has to be undone. A cursor must therefore advance by 0 along axes where it is broadcast.
+    template <long RANK, long AXIS = 0, typename Body, typename... Cursors>
+        requires(RANK >= 0 && RANK <= MAX_STATIC_RANK)
+    inline void staticNestedLoop(const Coordinates &shape, Body &body, Cursors... cursors)
+    {
+        if constexpr (AXIS == RANK)
+            body(cursors...);
+        else
+        {
+            const long length = shape[AXIS];
+            for (long i = 0; i < length; i++)
+            {
+                staticNestedLoop<RANK, AXIS + 1>(shape, body, cursors...);
+                (cursors.outerAdvance(AXIS), ...);
+            }
+        }
+    }
+
+    /// @brief Calls kernel.template operator()<RANK>() with RANK equal to rank if rank is at most MAX_STATIC_RANK, so that a kernel can be instantiated for each rank.
+    /// @return false if rank is too large, in which case the caller has to fall back to a generic loop
+    template <typename Kernel>
+    inline bool dispatchStaticRank(long rank, Kernel &&kernel)
+    {
+        static_assert(MAX_STATIC_RANK == 4, "dispatchStaticRank has to list every rank up to MAX_STATIC_RANK");
+
+        switch (rank)
+        {
+        case 0:
+            kernel.template operator()<0>();
+            return true;
+        case 1:
+            kernel.template operator()<1>();
+            return true;
+        case 2:
+            kernel.template operator()<2>();
+            return true;
+        case 3:
+            kernel.template operator()<3>();
+            return true;
+        case 4:
+            kernel.template operator()<4>();
+            return true;
+        default:
+            return false;
+        }
+    }
 }
 
 #endif
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define SIMD_OPERATION_H
 
 #include <immintrin.h>
+#include <algorithm>
+#include <limits>
 
 #include "constants.hpp"
 #include "shape.hpp"
@@ -53,9 +55,11 @@ namespace ArrayLibrary
                 requires((... && std::is_same_v<T, Ts>))
             static inline Type setr(Ts... data);
             static inline Type load(const T *pData);
+            static inline Type loadUnaligned(const T *pData);
             static inline Type maskedLoad(const T *pData, const __m256i &mask);
 
             static inline void store(T *pData, const Type &a);
+            static inline void storeUnaligned(T *pData, const Type &a);
             static inline void maskedStore(T *pData, const __m256i &mask, const Type &a);
 
             static inline Type add(const Type &a, const Type &b);
@@ -72,6 +76,8 @@ namespace ArrayLibrary
             static inline Type castFromInt(const __m256i &a);
 
             static inline Type sqrt(const Type &a);
+            static inline Type log(const Type &a);
+            static inline Type exp(const Type &a);
         };
 
         template <DataType T>
@@ -84,6 +90,16 @@ namespace ArrayLibrary
         inline Vector<T> zero() { return Internal<T>::zero(); }
         template <DataType T>
         inline Vector<T> broadcast_set(const T value) { return Internal<T>::broadcast_set(value); }
+
+        /// @brief Like broadcast_set, but can also be called for types without SIMD support, for which it returns an unused placeholder. Use it to initialize the simdParam of operations.
+        template <DataType T>
+        inline Vector<T> broadcastParam(const T value)
+        {
+            if constexpr (supported<T>)
+                return Internal<T>::broadcast_set(value);
+            else
+                return Vector<T>();
+        }
         template <DataType T, DataType... Ts>
             requires((... && std::is_same_v<T, Ts>) && sizeof...(Ts) + 1 <= LENGTH<T>)
         inline Vector<T> set(T first, Ts... remainder)
@@ -100,6 +116,10 @@ namespace ArrayLibrary
         template <DataType T>
         inline Vector<T> load(const T *pData) { return Internal<T>::load(pData); }
 
+        /// @brief Like load, but pData does not have to be aligned to SIMD_BYTES
+        template <DataType T>
+        inline Vector<T> loadUnaligned(const T *pData) { return Internal<T>::loadUnaligned(pData); }
+
         template <DataType T>
         inline Vector<T> maskedLoad(const T *pData, const __m256i &mask)
         {
@@ -107,7 +127,7 @@ namespace ArrayLibrary
         }
 
         template <DataType T>
-        inline void prefixLoad(T *pData, long prefixLength)
+        inline Vector<T> prefixLoad(const T *pData, long prefixLength)
         {
             return maskedLoad<T>(pData, makeTypePrefixMask<T>(prefixLength));
         }
@@ -141,8 +161,45 @@ namespace ArrayLibrary
             }
         }
 
+        /// @brief Like spreadLoad, but only reads the first prefixLength entries at pData, so that it can be used at the end of a buffer. The remaining lanes are zero.
+        template <DataType T, size_t SpreadTypeSize>
+            requires(supported<T> && (SpreadTypeSize % sizeof(T) == 0) && (SpreadTypeSize == 1 || SpreadTypeSize == 2 || SpreadTypeSize == 4 || SpreadTypeSize == 8))
+        inline Vector<T> prefixSpreadLoad(const T *pData, long prefixLength)
+        {
+            if constexpr (SpreadTypeSize == sizeof(T))
+                return prefixLoad<T>(pData, prefixLength);
+            else
+            {
+                alignas(SIMD_BYTES) T buffer[LENGTH<T>] = {};
+                std::copy(pData, pData + std::min(prefixLength, (long)(SIMD_BYTES / SpreadTypeSize)), buffer);
+                return spreadLoad<T, SpreadTypeSize>(buffer);
+            }
+        }
+
+        /// @brief The offsets {0, stride, 2 * stride, ...} of LENGTH<T> entries that are stride apart, for gather and prefixGather. stride * LENGTH<T> has to fit into 32 bits.
+        template <DataType T>
+        inline __m256i strideIndex(long stride) { return Internal<T>::strideIndex(stride); }
+
+        /// @brief Loads LENGTH<T> entries that are stride apart, where index = strideIndex<T>(stride)
+        template <DataType T>
+        inline Vector<T> gather(const T *pData, const __m256i &index) { return Internal<T>::gather(pData, index); }
+
+        /// @brief Like gather, but only loads the first prefixLength entries and sets the others to zero
+        template <DataType T>
+        inline Vector<T> prefixGather(const T *pData, const __m256i &index, long prefixLength)
+        {
+            return Internal<T>::maskedGather(pData, index, makeTypePrefixMask<T>(prefixLength));
+        }
+
+        /// @brief Transposes a block of LENGTH<T> x LENGTH<T> entries in registers. Row i of the block starts at pSource + i * sourceStride, and becomes column i of the block at pDest, whose rows are destStride apart. Neither pointer has to be aligned.
+        template <DataType T>
+        inline void transposeBlock(const T *pSource, const long sourceStride, T *pDest, const long destStride) { Internal<T>::transposeBlock(pSource, sourceStride, pDest, destStride); }
+
         template <DataType T>
         inline void store(T *pData, const Vector<T> &a) { return Internal<T>::store(pData, a); }
+        /// @brief Like store, but pData does not have to be aligned to SIMD_BYTES
+        template <DataType T>
+        inline void storeUnaligned(T *pData, const Vector<T> &a) { Internal<T>::storeUnaligned(pData, a); }
         template <DataType T>
         inline void maskedStore(T *pData, const __m256i &mask, const Vector<T> &a) { Internal<T>::maskedStore(pData, mask, a); }
 
@@ -374,6 +431,22 @@ namespace ArrayLibrary
             return Internal<T>::sqrt(a);
         }
 
+        /// @brief The natural logarithm for positive, normal entries
+        template <DataType T>
+            requires std::is_floating_point_v<T>
+        inline Vector<T> log(const Vector<T> &a)
+        {
+            return Internal<T>::log(a);
+        }
+
+        /// @brief The exponential function, which is 0 or infinity where the exponent is out of the range of normal floats
+        template <DataType T>
+            requires std::is_floating_point_v<T>
+        inline Vector<T> exp(const Vector<T> &a)
+        {
+            return Internal<T>::exp(a);
+        }
+
         template <DataType T>
         struct ClipBounds
         {
@@ -407,8 +480,10 @@ namespace ArrayLibrary
             static constexpr auto set = _mm256_set_ps;
             static constexpr auto setr = _mm256_setr_ps;
             static inline Type load(const T *pData) { return _mm256_load_ps(pData); }
+            static inline Type loadUnaligned(const T *pData) { return _mm256_loadu_ps(pData); }
             static inline Type maskedLoad(const T *pData, const __m256i &mask) { return _mm256_maskload_ps(pData, mask); }
             static inline void store(T *pData, const Type &a) { return _mm256_store_ps(pData, a); }
+            static inline void storeUnaligned(T *pData, const Type &a) { _mm256_storeu_ps(pData, a); }
             static inline void maskedStore(T *pData, const __m256i &mask, const Type &a) { _mm256_maskstore_ps(pData, mask, a); }
 
             static inline Type add(const Type &a, const Type &b)
@@ -459,6 +534,83 @@ namespace ArrayLibrary
             {
                 return _mm256_sqrt_ps(a);
             }
+
+            /// Splits a into 2^e * m with m in [sqrt(0.5), sqrt(2)) and evaluates the polynomial approximation of log(m) from the Cephes library, with a relative error of about 1e-7 for positive, normal a
+            static inline Type log(const Type &a)
+            {
+                const __m256i bits = _mm256_castps_si256(a);
+                __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+                __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F000000)));
+
+                // m is in [0.5, 1) now, move it into [sqrt(0.5), sqrt(2)) - 1
+                const __m256 small = _mm256_cmp_ps(m, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+                e = _mm256_sub_ps(e, _mm256_and_ps(small, _mm256_set1_ps(1)));
+                m = _mm256_sub_ps(_mm256_add_ps(m, _mm256_and_ps(small, m)), _mm256_set1_ps(1));
+
+                const __m256 z = _mm256_mul_ps(m, m);
+                __m256 y = _mm256_set1_ps(7.0376836292E-2f);
+                for (float c : {-1.1514610310E-1f, 1.1676998740E-1f, -1.2420140846E-1f, 1.4249322787E-1f, -1.6668057665E-1f, 2.0000714765E-1f, -2.4999993993E-1f, 3.3333331174E-1f})
+                    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(c));
+                y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+
+                y = _mm256_fmadd_ps(e, _mm256_set1_ps(-2.12194440E-4f), y);
+                y = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, y);
+                return _mm256_fmadd_ps(e, _mm256_set1_ps(0.693359375f), _mm256_add_ps(m, y));
+            }
+
+            /// Splits a into n * log(2) + r with |r| <= log(2) / 2, evaluates the polynomial approximation of exp(r) from the Cephes library and multiplies by 2^n through the exponent bits, with a relative error of about 2e-7. NaN stays NaN.
+            static inline Type exp(const Type &a)
+            {
+                // The operands are ordered so that min and max return a NaN a
+                const __m256 x = _mm256_max_ps(_mm256_set1_ps(-87.3365448f), _mm256_min_ps(_mm256_set1_ps(88.3762626647949f), a));
+                const __m256 n = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(1.44269504088896341f), _mm256_set1_ps(0.5f)));
+                const __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440E-4f), _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x));
+
+                __m256 y = _mm256_set1_ps(1.9875691500E-4f);
+                for (float c : {1.3981999507E-3f, 8.3334519073E-3f, 4.1665795894E-2f, 1.6666665459E-1f, 5.0000001201E-1f})
+                    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(c));
+                y = _mm256_fmadd_ps(y, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1)));
+
+                // Outside of the range of normal floats, the scale would over- or underflow the exponent bits, so the result is set to infinity or flushed to 0
+                const __m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+                const __m256 result = _mm256_mul_ps(y, _mm256_castsi256_ps(exponent));
+                const __m256 flushed = _mm256_andnot_ps(_mm256_cmp_ps(a, _mm256_set1_ps(-87.3365448f), _CMP_LT_OQ), result);
+                return _mm256_blendv_ps(flushed, _mm256_set1_ps(std::numeric_limits<float>::infinity()), _mm256_cmp_ps(a, _mm256_set1_ps(88.7228391f), _CMP_GT_OQ));
+            }
+
+            static inline __m256i strideIndex(long stride)
+            {
+                return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)stride));
+            }
+
+            static inline Type gather(const T *pData, const __m256i &index) { return _mm256_i32gather_ps(pData, index, sizeof(T)); }
+            static inline Type maskedGather(const T *pData, const __m256i &index, const __m256i &mask) { return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), pData, index, _mm256_castsi256_ps(mask), sizeof(T)); }
+
+            static inline void transposeBlock(const T *pSource, const long sourceStride, T *pDest, const long destStride)
+            {
+                Type r[8], t[8];
+                for (long i = 0; i < 8; i++)
+                    r[i] = _mm256_loadu_ps(pSource + i * sourceStride);
+
+                // Interleave pairs of rows, then pairs of pairs, and finally swap the 128 bit halves
+                for (long i = 0; i < 8; i += 2)
+                {
+                    t[i] = _mm256_unpacklo_ps(r[i], r[i + 1]);
+                    t[i + 1] = _mm256_unpackhi_ps(r[i], r[i + 1]);
+                }
+                for (long i = 0; i < 8; i += 4)
+                {
+                    r[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+                    r[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+                    r[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+                    r[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+                }
+                for (long i = 0; i < 4; i++)
+                {
+                    _mm256_storeu_ps(pDest + i * destStride, _mm256_permute2f128_ps(r[i], r[i + 4], 0x20));
+                    _mm256_storeu_ps(pDest + (i + 4) * destStride, _mm256_permute2f128_ps(r[i], r[i + 4], 0x31));
+                }
+            }
         };
 
     }
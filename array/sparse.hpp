@@ -0,0 +1,345 @@
+#ifndef ARRAY_SPARSE_H
+#define ARRAY_SPARSE_H
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "array.hpp"
+#include "thread_pool.hpp"
+
+namespace ArrayLibrary
+{
+    enum class SparseLayout
+    {
+        /// Compressed sparse rows: the entries are sorted by row, and the row indices hold the offset of each row's first entry, followed by the number of entries
+        CSR,
+        /// Coordinate list: the row indices hold the row of each entry, and the entries can be in any order
+        COO
+    };
+
+    /// @brief A matrix of which only the nonzero entries are stored, e.g. a batch of one-hot or bag-of-words vectors.
+    /// @details Entries with the same coordinates are allowed and count as their sum. The products with dense arrays require the CSR layout and convert a COO array first.
+    template <DataType T>
+    class SparseArray
+    {
+        static_assert(std::is_arithmetic_v<T>, "T of SparseArray<T> must be arithmetic type!");
+
+        Coordinates mShape;
+        SparseLayout mLayout;
+        std::vector<long> mRowIndices;
+        std::vector<long> mColumnIndices;
+        std::vector<T> mValues;
+
+        /// @brief The number of scalar multiply-adds below which a product with a dense array runs on the calling thread only
+        static constexpr long CONCURRENCY_THRESHOLD = 0x10000;
+
+        SparseArray(const Coordinates &shape, SparseLayout layout, std::vector<long> &&rowIndices, std::vector<long> &&columnIndices, std::vector<T> &&values) : mShape(shape), mLayout(layout), mRowIndices(std::move(rowIndices)), mColumnIndices(std::move(columnIndices)), mValues(std::move(values))
+        {
+        }
+
+        static void checkShape(const Coordinates &shape)
+        {
+            if (shape.size() != 2)
+                throw std::invalid_argument("Sparse arrays must have exactly two axes.");
+            if (shape[0] < 0 || shape[1] < 0)
+                throw std::invalid_argument("Entries of absolute shape vector cannot be negative.");
+        }
+
+        /// @brief Adds the entries value * right[column, :] for all entries of one CSR row to the row of dest at pDest.
+        /// @details The columns are processed in blocks of UNROLL vectors, which are kept in registers until all entries of the row have been added to them.
+        static void rowProduct(const long *pColumns, const T *pValues, const long count, const T *pRight, const long rightRowStride, const long rightColumnStride, T *pDest, const long destColumnStride, const long length)
+        {
+            if constexpr (Simd::supported<T>)
+            {
+                if (rightColumnStride == 1 && destColumnStride == 1)
+                {
+                    constexpr long LENGTH = Simd::LENGTH<T>;
+                    constexpr long UNROLL = 4;
+
+                    long j = 0;
+                    for (; j + UNROLL * LENGTH <= length; j += UNROLL * LENGTH)
+                    {
+                        Simd::Vector<T> acc[UNROLL];
+                        for (long u = 0; u < UNROLL; u++)
+                            acc[u] = Simd::loadUnaligned<T>(pDest + j + u * LENGTH);
+
+                        for (long e = 0; e < count; e++)
+                        {
+                            const auto a = Simd::broadcast_set<T>(pValues[e]);
+                            const T *pRow = pRight + pColumns[e] * rightRowStride + j;
+                            for (long u = 0; u < UNROLL; u++)
+                                acc[u] = Simd::fusedMultiplyAdd<T>(a, Simd::loadUnaligned<T>(pRow + u * LENGTH), acc[u]);
+                        }
+
+                        for (long u = 0; u < UNROLL; u++)
+                            Simd::storeUnaligned<T>(pDest + j + u * LENGTH, acc[u]);
+                    }
+
+                    for (; j < length; j += LENGTH)
+                    {
+                        const auto mask = Simd::makeTypePrefixMask<T>(std::min(LENGTH, length - j));
+                        auto acc = Simd::maskedLoad<T>(pDest + j, mask);
+                        for (long e = 0; e < count; e++)
+                            acc = Simd::fusedMultiplyAdd<T>(Simd::broadcast_set<T>(pValues[e]), Simd::maskedLoad<T>(pRight + pColumns[e] * rightRowStride + j, mask), acc);
+                        Simd::maskedStore<T>(pDest + j, mask, acc);
+                    }
+
+                    return;
+                }
+            }
+
+            for (long e = 0; e < count; e++)
+            {
+                const T *pRow = pRight + pColumns[e] * rightRowStride;
+                for (long j = 0; j < length; j++)
+                    pDest[j * destColumnStride] += pValues[e] * pRow[j * rightColumnStride];
+            }
+        }
+
+    public:
+        /// @brief Creates a sparse array of the given shape without any nonzero entries
+        explicit SparseArray(const Coordinates &shape, SparseLayout layout = SparseLayout::CSR) : mShape(shape), mLayout(layout)
+        {
+            checkShape(shape);
+            if (layout == SparseLayout::CSR)
+                mRowIndices.assign(shape[0] + 1, 0);
+        }
+
+        /// @brief Creates a sparse array from a list of coordinates in the format returned by Array<T>::findNonZero and the values at these coordinates.
+        /// @param coordinates An array of shape {count, 2} holding the row and column of each entry
+        /// @param values An array of shape {count}
+        static SparseArray<T> fromCoordinates(const Array<long> &coordinates, const Array<T> &values, const Coordinates &shape, SparseLayout layout = SparseLayout::CSR)
+        {
+            checkShape(shape);
+            if (coordinates.getDim() != 2 || coordinates.refShape()[1] != 2)
+                throw std::invalid_argument("The coordinates must be an array of shape {count, 2}.");
+
+            const long count = coordinates.refShape()[0];
+            if (values.refShape() != Coordinates({count}))
+                throw std::invalid_argument("There must be exactly one value for each pair of coordinates.");
+
+            std::vector<long> rows(count), columns(count);
+            std::vector<T> entries(count);
+            for (long k = 0; k < count; k++)
+            {
+                rows[k] = coordinates.get({k, 0});
+                columns[k] = coordinates.get({k, 1});
+                entries[k] = values.get({k});
+
+                if (rows[k] < 0 || rows[k] >= shape[0] || columns[k] < 0 || columns[k] >= shape[1])
+                    throw std::out_of_range("The coordinates of an entry lie outside of the shape.");
+            }
+
+            SparseArray<T> result(shape, SparseLayout::COO, std::move(rows), std::move(columns), std::move(entries));
+            return layout == SparseLayout::CSR ? result.toCSR() : result;
+        }
+
+        /// @brief Stores the nonzero entries of a dense array with two axes
+        static SparseArray<T> fromDense(const Array<T> &dense, SparseLayout layout = SparseLayout::CSR)
+        {
+            checkShape(dense.refShape());
+
+            // findNonZero walks through the data in memory order
+            const Array<T> source = dense.isContiguous() ? dense : dense.copy();
+            const Array<long> coordinates = source.findNonZero();
+            const long count = coordinates.refShape()[0];
+            const long columnCount = dense.refShape()[1];
+            const T *pData = source.readDataPointer();
+
+            std::vector<long> rows(count), columns(count);
+            std::vector<T> entries(count);
+            for (long k = 0; k < count; k++)
+            {
+                rows[k] = coordinates.get({k, 0});
+                columns[k] = coordinates.get({k, 1});
+                entries[k] = pData[rows[k] * columnCount + columns[k]];
+            }
+
+            // The entries are already sorted by row, so that CSR only needs the row offsets
+            SparseArray<T> result(dense.refShape(), SparseLayout::COO, std::move(rows), std::move(columns), std::move(entries));
+            return layout == SparseLayout::CSR ? result.toCSR() : result;
+        }
+
+        /// @brief The sparse counterpart of Array<T>::oneHot: row i has a single entry 1 in column indices[i].
+        /// @param indices The column of the entry of each row. An array with several axes is flattened in row-major order.
+        /// @param depth The number of columns
+        template <DataType U>
+        static SparseArray<T> oneHot(const Array<U> &indices, long depth, SparseLayout layout = SparseLayout::CSR)
+        {
+            const long count = indices.getFlatLength();
+            const Array<U> flat = indices.contiguous().reshape({count});
+
+            std::vector<long> rows(layout == SparseLayout::CSR ? count + 1 : count), columns(count);
+            for (long k = 0; k < count; k++)
+            {
+                columns[k] = (long)flat.get({k});
+                if (columns[k] < 0 || columns[k] >= depth)
+                    throw std::out_of_range("One-hot indices must lie between 0 and depth - 1.");
+            }
+            std::iota(rows.begin(), rows.end(), 0);
+
+            return SparseArray<T>({count, depth}, layout, std::move(rows), std::move(columns), std::vector<T>(count, 1));
+        }
+
+        inline const Coordinates &refShape() const { return mShape; }
+        inline SparseLayout getLayout() const { return mLayout; }
+        inline long getNonZeroCount() const { return mValues.size(); }
+
+        /// @brief The row offsets for CSR or the row of each entry for COO, see SparseLayout
+        inline const std::vector<long> &refRowIndices() const { return mRowIndices; }
+        inline const std::vector<long> &refColumnIndices() const { return mColumnIndices; }
+        inline const std::vector<T> &refValues() const { return mValues; }
+
+        SparseArray<T> toCSR() const
+        {
+            if (mLayout == SparseLayout::CSR)
+                return *this;
+
+            // A counting sort by row, which keeps the order of the entries within a row
+            std::vector<long> offsets(mShape[0] + 1, 0);
+            for (long row : mRowIndices)
+                offsets[row + 1]++;
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+            std::vector<long> next(offsets.begin(), offsets.end() - 1);
+            std::vector<long> columns(mValues.size());
+            std::vector<T> values(mValues.size());
+            for (long k = 0; k < (long)mValues.size(); k++)
+            {
+                const long position = next[mRowIndices[k]]++;
+                columns[position] = mColumnIndices[k];
+                values[position] = mValues[k];
+            }
+
+            return SparseArray<T>(mShape, SparseLayout::CSR, std::move(offsets), std::move(columns), std::move(values));
+        }
+
+        SparseArray<T> toCOO() const
+        {
+            if (mLayout == SparseLayout::COO)
+                return *this;
+
+            std::vector<long> rows(mValues.size());
+            for (long row = 0; row < mShape[0]; row++)
+                std::fill(rows.begin() + mRowIndices[row], rows.begin() + mRowIndices[row + 1], row);
+
+            return SparseArray<T>(mShape, SparseLayout::COO, std::move(rows), std::vector<long>(mColumnIndices), std::vector<T>(mValues));
+        }
+
+        Array<T> toDense() const
+        {
+            Array<T> result = Array<T>::constant(mShape, 0);
+            const SparseArray<T> coo = toCOO();
+            for (long k = 0; k < (long)coo.mValues.size(); k++)
+                result.get({coo.mRowIndices[k], coo.mColumnIndices[k]}) += coo.mValues[k];
+
+            return result;
+        }
+
+        /// @brief The sorted list of columns that hold at least one entry, i.e. the rows of right that contribute to a product with right, and the rows of dest that transposedMatmul writes to.
+        std::vector<long> nonZeroColumns() const
+        {
+            std::vector<char> used(mShape[1], false);
+            for (long column : mColumnIndices)
+                used[column] = true;
+
+            std::vector<long> result;
+            for (long column = 0; column < mShape[1]; column++)
+                if (used[column])
+                    result.push_back(column);
+
+            return result;
+        }
+
+        /// @brief Computes the product of this {m, k} sparse array with a dense {k, n} array into dest of shape {m, n}.
+        /// @details The rows of dest are split between the threads of ThreadPool::global if multiThread is set and the product is large enough. Each row of dest is accumulated in registers over the entries of the sparse row, SIMD across the columns of right.
+        /// @param setzero Whether dest is overwritten. Otherwise the product is added to it.
+        Array<T> &matmul(const Array<T> &right, Array<T> &dest, bool setzero = true, bool multiThread = true) const
+        {
+            if (mLayout != SparseLayout::CSR)
+                return toCSR().matmul(right, dest, setzero, multiThread);
+
+            if (right.getDim() != 2 || right.refShape()[0] != mShape[1])
+                throw std::invalid_argument("The dense array must have two axes, and its first axis must have the length of the second axis of the sparse array.");
+            if (dest.refShape() != Coordinates({mShape[0], right.refShape()[1]}))
+                throw std::invalid_argument("The shape of the destination array does not fit the product shape of left and right.");
+
+            dest.copyOnWrite();
+            if (setzero)
+                dest = 0;
+
+            const long length = right.refShape()[1];
+            const T *pRight = right.readDataPointer();
+            T *pDest = dest.getDataPointer();
+            const long rightRowStride = right.refStrides()[0], rightColumnStride = right.refStrides()[1];
+            const long destRowStride = dest.refStrides()[0], destColumnStride = dest.refStrides()[1];
+
+            auto rows = [&](long from, long upto)
+            {
+                for (long row = from; row < upto; row++)
+                {
+                    const long begin = mRowIndices[row];
+                    rowProduct(mColumnIndices.data() + begin, mValues.data() + begin, mRowIndices[row + 1] - begin, pRight, rightRowStride, rightColumnStride, pDest + row * destRowStride, destColumnStride, length);
+                }
+            };
+
+            const long work = std::max(1l, getNonZeroCount() * length);
+            if (multiThread && work >= CONCURRENCY_THRESHOLD)
+                ThreadPool::global().parallelFor(0, mShape[0], std::max(1l, CONCURRENCY_THRESHOLD * mShape[0] / work), rows);
+            else
+                rows(0, mShape[0]);
+
+            return dest;
+        }
+
+        Array<T> matmul(const Array<T> &right, bool multiThread = true) const
+        {
+            if (right.getDim() != 2)
+                throw std::invalid_argument("The dense array must have two axes.");
+
+            Array<T> result = Array<T>::empty({mShape[0], right.refShape()[1]});
+            return matmul(right, result, true, multiThread);
+        }
+
+        /// @brief Computes the product of the transpose of this {m, k} sparse array with a dense {m, n} array into dest of shape {k, n}, e.g. the gradient of the dense operand of matmul.
+        /// @details Only the rows listed by nonZeroColumns are written to, and the rest of dest is left alone unless setzero is set. The entries are scattered into dest on the calling thread, since several entries can add to the same row.
+        Array<T> &transposedMatmul(const Array<T> &right, Array<T> &dest, bool setzero = true) const
+        {
+            if (right.getDim() != 2 || right.refShape()[0] != mShape[0])
+                throw std::invalid_argument("The dense array must have two axes, and its first axis must have the length of the first axis of the sparse array.");
+            if (dest.refShape() != Coordinates({mShape[1], right.refShape()[1]}))
+                throw std::invalid_argument("The shape of the destination array does not fit the product shape of left and right.");
+
+            dest.copyOnWrite();
+            if (setzero)
+                dest = 0;
+
+            const long length = right.refShape()[1];
+            const T *pRight = right.readDataPointer();
+            T *pDest = dest.getDataPointer();
+            const long rightRowStride = right.refStrides()[0], rightColumnStride = right.refStrides()[1];
+            const long destRowStride = dest.refStrides()[0], destColumnStride = dest.refStrides()[1];
+
+            // An entry (row, column, value) adds value * right[row, :] to dest[column, :], which is rowProduct for a single entry with the roles of row and column swapped
+            auto scatter = [&](long row, long k)
+            {
+                rowProduct(&row, mValues.data() + k, 1, pRight, rightRowStride, rightColumnStride, pDest + mColumnIndices[k] * destRowStride, destColumnStride, length);
+            };
+
+            if (mLayout == SparseLayout::CSR)
+            {
+                for (long row = 0; row < mShape[0]; row++)
+                    for (long k = mRowIndices[row]; k < mRowIndices[row + 1]; k++)
+                        scatter(row, k);
+            }
+            else
+                for (long k = 0; k < getNonZeroCount(); k++)
+                    scatter(mRowIndices[k], k);
+
+            return dest;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef ARRAY_SUMMATION_H
+#define ARRAY_SUMMATION_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "constants.hpp"
+#include "simd.hpp"
+
+namespace ArrayLibrary
+{
+    /// @brief How long sums of floating point entries are accumulated, selected per call, e.g. by Array::reduceSum or MatmulSettings::summation.
+    /// @details NAIVE adds the entries in order, so the bound on the rounding error grows like n * eps with the length n. PAIRWISE sums blocks of CompensatedSum::PAIRWISE_BLOCK entries and adds the block sums along a binary tree, which bounds the error by about (PAIRWISE_BLOCK + log2(n)) * eps at almost no extra cost. KAHAN carries the rounding error of every addition in a compensation term that is added back with the next entry, which bounds the error by a few eps independently of n, for about four operations per entry instead of one.
+    enum class Summation
+    {
+        NAIVE,
+        PAIRWISE,
+        KAHAN
+    };
+
+    /// @brief Kernels for the summation modes of Summation. Contiguous sums of types with SIMD support are vectorized, with one sum or one sum and compensation per lane, and the lanes are combined with compensation at the end.
+    namespace CompensatedSum
+    {
+        /// The length up to which PAIRWISE adds entries in order
+        constexpr long PAIRWISE_BLOCK = 128;
+        /// The number of sums that sumRows interleaves
+        constexpr long ROW_TILE = 8;
+
+        /// @brief Adds x to the compensated sum (sum, compensation), whose value is sum + compensation. The compensation is the rounding error of the last addition and is added back with the next x, so it stays small.
+        template <DataType T>
+        inline void kahanAdd(T &sum, T &compensation, const T x)
+        {
+            const T y = x + compensation;
+            const T t = sum + y;
+            compensation = y - (t - sum);
+            sum = t;
+        }
+
+        /// @brief The sum of the lanes of sums + compensations, added along a binary tree, which adds about log2(LENGTH) * eps to the error of the lanes
+        template <DataType T>
+        inline T horizontalSum(const Simd::Vector<T> &sums, const Simd::Vector<T> &compensations)
+        {
+            constexpr long LENGTH = Simd::LENGTH<T>;
+            T lanes[LENGTH];
+            Simd::storeUnaligned<T>(lanes, sums + compensations);
+            for (long width = LENGTH / 2; width > 0; width /= 2)
+                for (long l = 0; l < width; l++)
+                    lanes[l] += lanes[l + width];
+            return lanes[0];
+        }
+
+        /// @brief Adds length entries that are stride apart in order, with interleaved accumulators
+        template <DataType T>
+        inline T blockSum(const T *pData, const long length, const long stride)
+        {
+            if constexpr (Simd::supported<T>)
+            {
+                if (stride == 1)
+                {
+                    constexpr long LENGTH = Simd::LENGTH<T>;
+                    Simd::Vector<T> a = Simd::zero<T>(), b = Simd::zero<T>();
+                    long i = 0;
+                    for (; i + 2 * LENGTH <= length; i += 2 * LENGTH)
+                    {
+                        a = a + Simd::loadUnaligned<T>(pData + i);
+                        b = b + Simd::loadUnaligned<T>(pData + i + LENGTH);
+                    }
+                    for (; i < length; i += LENGTH)
+                        a = a + Simd::prefixLoad<T>(pData + i, length - i);
+
+                    return horizontalSum<T>(a, b);
+                }
+            }
+
+            T accumulators[ROW_TILE] = {};
+            long i = 0;
+            for (; i + ROW_TILE <= length; i += ROW_TILE)
+#pragma GCC unroll 8
+                for (long t = 0; t < ROW_TILE; t++)
+                    accumulators[t] += pData[(i + t) * stride];
+            for (; i < length; i++)
+                accumulators[0] += pData[i * stride];
+
+            T sum = 0;
+            for (long t = 0; t < ROW_TILE; t++)
+                sum += accumulators[t];
+            return sum;
+        }
+
+        /// @brief The sum of length entries that are stride apart, by recursive halving down to blocks of PAIRWISE_BLOCK entries
+        template <DataType T>
+        T pairwise(const T *pData, const long length, const long stride)
+        {
+            if (length <= PAIRWISE_BLOCK)
+                return blockSum(pData, length, stride);
+
+            // The halves are cut at a multiple of the block length, so that only the last block is partial
+            const long half = (length / PAIRWISE_BLOCK + 1) / 2 * PAIRWISE_BLOCK;
+            return pairwise(pData, half, stride) + pairwise(pData + half * stride, length - half, stride);
+        }
+
+        /// @brief The compensated sum of length entries that are stride apart
+        template <DataType T>
+        T kahan(const T *pData, const long length, const long stride)
+        {
+            if constexpr (Simd::supported<T>)
+            {
+                if (stride == 1)
+                {
+                    constexpr long LENGTH = Simd::LENGTH<T>;
+                    // kahanAdd per lane, with the lanes combined at the end
+                    Simd::Vector<T> sums = Simd::zero<T>(), compensations = Simd::zero<T>();
+                    for (long i = 0; i < length; i += LENGTH)
+                    {
+                        const Simd::Vector<T> y = (i + LENGTH <= length ? Simd::loadUnaligned<T>(pData + i) : Simd::prefixLoad<T>(pData + i, length - i)) + compensations;
+                        const Simd::Vector<T> t = sums + y;
+                        compensations = y - (t - sums);
+                        sums = t;
+                    }
+                    return horizontalSum<T>(sums, compensations);
+                }
+            }
+
+            T sum = 0, compensation = 0;
+            for (long i = 0; i < length; i++)
+                kahanAdd(sum, compensation, pData[i * stride]);
+            return sum + compensation;
+        }
+
+        /// @brief The sum of length entries that are stride apart, accumulated as summation says
+        template <DataType T>
+        T sum(const Summation summation, const T *pData, const long length, const long stride)
+        {
+            switch (summation)
+            {
+            case Summation::PAIRWISE:
+                return pairwise(pData, length, stride);
+            case Summation::KAHAN:
+                return kahan(pData, length, stride);
+            default:
+            {
+                T sum = 0;
+                for (long i = 0; i < length; i++)
+                    sum += pData[i * stride];
+                return sum;
+            }
+            }
+        }
+
+        /// @brief Like pairwise for at most ROW_TILE rows at once, which start rowStride apart and whose entries are stride apart. The sums are written to sums.
+        template <DataType T>
+        void pairwiseRows(const T *pData, const long rows, const long rowStride, const long length, const long stride, T *sums)
+        {
+            if (length <= PAIRWISE_BLOCK)
+            {
+                for (long t = 0; t < rows; t++)
+                    sums[t] = 0;
+                for (long i = 0; i < length; i++)
+                    for (long t = 0; t < rows; t++)
+                        sums[t] += pData[t * rowStride + i * stride];
+                return;
+            }
+
+            const long half = (length / PAIRWISE_BLOCK + 1) / 2 * PAIRWISE_BLOCK;
+            T rightSums[ROW_TILE];
+            pairwiseRows(pData, rows, rowStride, half, stride, sums);
+            pairwiseRows(pData + half * stride, rows, rowStride, length - half, stride, rightSums);
+            for (long t = 0; t < rows; t++)
+                sums[t] += rightSums[t];
+        }
+
+        /// @brief Adds the sums of rows rows, which start rowStride apart and whose length entries are stride apart, to the entries of pDest that are destStride apart. The rows are summed ROW_TILE at a time with interleaved accumulations, like Array::reduceTile.
+        template <DataType T>
+        void sumRows(const Summation summation, const T *pData, T *pDest, const long rows, const long rowStride, const long destStride, const long length, const long stride)
+        {
+            if constexpr (Simd::supported<T>)
+            {
+                // Contiguous rows are summed with one vector of sums and compensations per row, interleaved over ROW_TILE rows like the scalar accumulations below
+                constexpr long LENGTH = Simd::LENGTH<T>;
+                if (summation == Summation::KAHAN && stride == 1 && length >= LENGTH)
+                {
+                    for (long row = 0; row < rows; row += ROW_TILE)
+                    {
+                        const long tile = std::min(ROW_TILE, rows - row);
+                        const T *pTile = pData + row * rowStride;
+                        Simd::Vector<T> sums[ROW_TILE], compensations[ROW_TILE];
+                        for (long t = 0; t < ROW_TILE; t++)
+                            sums[t] = compensations[t] = Simd::zero<T>();
+
+                        for (long i = 0; i < length; i += LENGTH)
+                            for (long t = 0; t < tile; t++)
+                            {
+                                const T *pEntries = pTile + t * rowStride + i;
+                                const Simd::Vector<T> y = (i + LENGTH <= length ? Simd::loadUnaligned<T>(pEntries) : Simd::prefixLoad<T>(pEntries, length - i)) + compensations[t];
+                                const Simd::Vector<T> sum = sums[t] + y;
+                                compensations[t] = y - (sum - sums[t]);
+                                sums[t] = sum;
+                            }
+
+                        for (long t = 0; t < tile; t++)
+                            pDest[(row + t) * destStride] += horizontalSum<T>(sums[t], compensations[t]);
+                    }
+                    return;
+                }
+                if (summation == Summation::PAIRWISE && stride == 1 && length >= 4 * LENGTH)
+                {
+                    for (long row = 0; row < rows; row++)
+                        pDest[row * destStride] += pairwise(pData + row * rowStride, length, stride);
+                    return;
+                }
+            }
+
+            for (long row = 0; row < rows; row += ROW_TILE)
+            {
+                const long tile = std::min(ROW_TILE, rows - row);
+                const T *pTile = pData + row * rowStride;
+                T sums[ROW_TILE] = {}, compensations[ROW_TILE] = {};
+
+                if (summation == Summation::PAIRWISE)
+                    pairwiseRows(pTile, tile, rowStride, length, stride, sums);
+                else if (summation == Summation::KAHAN)
+                {
+                    for (long i = 0; i < length; i++)
+                        for (long t = 0; t < tile; t++)
+                            kahanAdd(sums[t], compensations[t], pTile[t * rowStride + i * stride]);
+                }
+                else
+                {
+                    for (long i = 0; i < length; i++)
+                        for (long t = 0; t < tile; t++)
+                            sums[t] += pTile[t * rowStride + i * stride];
+                }
+
+                for (long t = 0; t < tile; t++)
+                    pDest[(row + t) * destStride] += sums[t] + compensations[t];
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef ARRAY_THREAD_POOL_H
+#define ARRAY_THREAD_POOL_H
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "profiler.hpp"
+
+namespace ArrayLibrary
+{
+    /// @brief A fixed set of worker threads that run the chunks of parallelFor loops, so that multithreaded kernels do not create and join threads on every call.
+    class ThreadPool
+    {
+        std::vector<std::thread> mWorkers;
+        std::deque<std::function<void()>> mTasks;
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        bool mStopping = false;
+
+        /// @brief Tracks the chunks of one parallelFor call that are still running, and the first exception thrown by one of them.
+        struct Completion
+        {
+            std::mutex mutex;
+            std::condition_variable condition;
+            long remaining;
+            std::exception_ptr exception;
+
+            void finish(std::exception_ptr chunkException)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (chunkException && !exception)
+                    exception = chunkException;
+                if (--remaining == 0)
+                    condition.notify_all();
+            }
+        };
+
+        void work()
+        {
+            while (true)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mCondition.wait(lock, [this]
+                                    { return mStopping || !mTasks.empty(); });
+                    if (mTasks.empty())
+                        return;
+                    task = std::move(mTasks.front());
+                    mTasks.pop_front();
+                }
+                task();
+            }
+        }
+
+        bool runPendingTask()
+        {
+            std::function<void()> task;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (mTasks.empty())
+                    return false;
+                task = std::move(mTasks.front());
+                mTasks.pop_front();
+            }
+            task();
+            return true;
+        }
+
+        /// @brief Runs f(from, upto) as one chunk, which the profiler shows on the track of the running thread
+        template <typename F>
+        static void runChunk(const F &f, long from, long upto)
+        {
+            Profiler::Scope scope("parallelFor chunk", Profiler::Category::THREAD_POOL);
+            scope.describe(std::array<long, 1>{upto - from}, 0);
+            f(from, upto);
+        }
+
+    public:
+        /// @param workers The number of threads besides the calling thread, which runs a chunk of every parallelFor itself
+        explicit ThreadPool(long workers)
+        {
+            for (long i = 0; i < workers; i++)
+                mWorkers.emplace_back(&ThreadPool::work, this);
+        }
+
+        ThreadPool(const ThreadPool &other) = delete;
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStopping = true;
+            }
+            mCondition.notify_all();
+            for (auto &worker : mWorkers)
+                worker.join();
+        }
+
+        /// @brief The pool shared by all multithreaded kernels, with one worker less than the hardware has threads
+        static ThreadPool &global()
+        {
+            static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+            return pool;
+        }
+
+        /// @brief The number of threads that run the chunks of a parallelFor, including the calling thread
+        long getThreadCount() const { return mWorkers.size() + 1; }
+
+        /// @brief Calls f(from, upto) on disjoint chunks covering [begin, end), each of which is at least minChunk long, and returns once all chunks are done.
+        /// @details The first chunk runs on the calling thread, which also picks up pending chunks while it waits, so that nested calls from inside a chunk cannot deadlock. If a chunk throws, the first exception is rethrown after all chunks have finished.
+        template <typename F>
+        void parallelFor(long begin, long end, long minChunk, const F &f)
+        {
+            const long length = end - begin;
+            const long chunks = std::min(getThreadCount(), length / std::max(1l, minChunk));
+            if (chunks <= 1)
+            {
+                if (length > 0)
+                    f(begin, end);
+                return;
+            }
+
+            Completion completion;
+            completion.remaining = chunks - 1;
+
+            long from = begin + length / chunks;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                for (long i = 1; i < chunks; i++)
+                {
+                    const long upto = begin + length * (i + 1) / chunks;
+                    mTasks.emplace_back([&f, &completion, from, upto]
+                                        {
+                                            std::exception_ptr exception;
+                                            try
+                                            {
+                                                runChunk(f, from, upto);
+                                            }
+                                            catch (...)
+                                            {
+                                                exception = std::current_exception();
+                                            }
+                                            completion.finish(exception); });
+                    from = upto;
+                }
+            }
+            mCondition.notify_all();
+
+            std::exception_ptr exception;
+            try
+            {
+                runChunk(f, begin, begin + length / chunks);
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+
+            while (runPendingTask())
+                ;
+
+            std::unique_lock<std::mutex> lock(completion.mutex);
+            completion.condition.wait(lock, [&completion]
+                                      { return completion.remaining == 0; });
+
+            if (exception)
+                std::rethrow_exception(exception);
+            if (completion.exception)
+                std::rethrow_exception(completion.exception);
+        }
+    };
+}
+
+#endif
@@ -104,6 +104,10 @@ namespace ArrayLibrary
         static constexpr size_t LARGEST_TYPE_SIZE = std::max({sizeof(ResultType), sizeof(InputTypes)...});
         static constexpr size_t INCREMENT = SIMD_BYTES / LARGEST_TYPE_SIZE;
         static constexpr bool SIMD_SUPPORTED = (... && Simd::supported<InputTypes>) && Simd::supported<ResultType>;
+        /// Gathering needs one 32 bit index per entry of a vector, so all types must have the same size
+        static constexpr bool GATHER_SUPPORTED = SIMD_SUPPORTED && sizeof(ResultType) == 4 && (... && (sizeof(InputTypes) == 4));
+        /// Below this size of the strided sources, half a page, the allocation and the setup of the tiled transpose cost more than contiguous rows save, see chooseStridedStrategy
+        static constexpr long PACK_MIN_BYTES = 2048;
 
         template <DataType T>
         struct SourceInfo
@@ -160,29 +164,123 @@ namespace ArrayLibrary
                 }
             }
 
+            /// @brief Loads the last, incomplete vector of a row without reading past its end
             template <bool Moving>
+            inline void tailAdvance(long remaining)
+            {
+                if constexpr (Moving)
+                {
+                    current = Simd::prefixSpreadLoad<T, LARGEST_TYPE_SIZE>(pData, remaining);
+                    pData += remaining;
+                }
+            }
+
+            /// @brief Prepares the source for a new row. Sources that are not moving keep the same value along the row, which is broadcast once here.
+            template <bool Moving>
+            inline void rowStart()
+            {
+                if constexpr (!Moving)
+                    current = Simd::broadcast_set<T>(*pData);
+            }
+
+            inline void outerAdvance(long i)
+            {
+                pData += strides[i];
+            }
+
+            inline void reset(long i)
+            {
+                pData -= strides[i] * (shape[i] - 1);
+            }
+        };
+
+        /// @brief Like SourceInfo, for rows along the last axis in which the source moves by its stride along that axis rather than by 1
+        template <DataType T>
+        struct StridedSourceInfo
+        {
+            const T *pData;
+            const Coordinates &shape;
+            const Coordinates &strides;
+            const long innerStride;
+
+            StridedSourceInfo(const Array<T> &array) : pData(array.readDataPointer()), shape(array.refShape()), strides(array.refStrides()), innerStride(array.refStrides()[array.getDim() - 1]) {}
+
+            inline const T value() const { return *pData; }
+
+            template <bool Moving>
+            inline void innerAdvance()
+            {
+                if constexpr (Moving)
+                    pData += innerStride;
+            }
+
             inline void outerAdvance(long i)
             {
                 pData += strides[i];
+            }
+
+            inline void reset(long i)
+            {
+                pData -= strides[i] * (shape[i] - 1);
+            }
+        };
+
+        /// @brief Like SimdSourceInfo, for rows along the last axis in which the source moves by its stride along that axis. The entries of each vector are gathered from memory.
+        template <DataType T>
+        struct GatherSourceInfo
+        {
+            const T *pData;
+            Simd::Vector<T> current;
+            const Coordinates &shape;
+            const Coordinates &strides;
+            const long innerStride;
+            const __m256i index;
+
+            GatherSourceInfo(const Array<T> &array) : pData(array.readDataPointer()), current(Simd::broadcast_set<T>(*pData)), shape(array.refShape()), strides(array.refStrides()), innerStride(array.refStrides()[array.getDim() - 1]), index(Simd::strideIndex<T>(innerStride)) {}
+
+            inline const Simd::Vector<T> &value() const { return current; }
+
+            template <bool Moving>
+            inline void innerAdvance()
+            {
                 if constexpr (Moving)
                 {
-                    current = Simd::spreadLoad<T, LARGEST_TYPE_SIZE>(pData);
+                    current = innerStride == 1 ? Simd::spreadLoad<T, sizeof(T)>(pData) : Simd::gather<T>(pData, index);
+                    pData += INCREMENT * innerStride;
                 }
-                else
+            }
+
+            template <bool Moving>
+            inline void tailAdvance(long remaining)
+            {
+                if constexpr (Moving)
                 {
-                    current = Simd::broadcast_set<T>(*pData);
+                    current = Simd::prefixGather<T>(pData, index, remaining);
+                    pData += remaining * innerStride;
                 }
             }
 
+            template <bool Moving>
+            inline void rowStart()
+            {
+                if constexpr (!Moving)
+                    current = Simd::broadcast_set<T>(*pData);
+            }
+
+            inline void outerAdvance(long i)
+            {
+                pData += strides[i];
+            }
+
             inline void reset(long i)
             {
                 pData -= strides[i] * (shape[i] - 1);
             }
         };
 
-        template <typename Operation, bool... Moving>
+        template <typename Operation, bool... Moving, typename... Infos>
             requires(IsOperation<Operation, InputTypes...>)
-        inline static void innerLoop(const Operation &opInfo, long length, ResultType *pDest, SourceInfo<InputTypes>... sourceInfos)
+        inline static void innerLoop(const Operation &opInfo, long length, ResultType *pDest, Infos... sourceInfos)
         {
             for (long j = 0; j < length; j++)
             {
@@ -194,14 +292,23 @@ namespace ArrayLibrary
             }
         }
 
-        template <typename Operation, bool... Moving>
+        template <typename Operation, bool... Moving, typename... Infos>
             requires(sizeof...(Moving) == N && IsOperation<Operation, InputTypes...>)
-        inline static void outerLoop(const Operation &opInfo, const long lastOuterAxis, const long flatBoostAxisLength, Array<ResultType> &dest, SourceInfo<InputTypes> &&...sourceInfos)
+        inline static void outerLoop(const Operation &opInfo, const long lastOuterAxis, const long flatBoostAxisLength, Array<ResultType> &dest, Infos &&...sourceInfos)
         {
             ResultType *pDestData = dest.getDataPointer();
             const Coordinates &destShape = dest.refShape();
             const Coordinates &destStrides = dest.refStrides();
 
+            auto row = [&](StridedPointer<ResultType> destRow, std::remove_reference_t<Infos>... sourceRows)
+            {
+                innerLoop<Operation, Moving...>(opInfo, flatBoostAxisLength, destRow.pData, sourceRows...);
+            };
+
+            if (dispatchStaticRank(lastOuterAxis + 1, [&]<long RANK>()
+                                   { staticNestedLoop<RANK>(destShape, row, StridedPointer<ResultType>{pDestData, destStrides}, sourceInfos...); }))
+                return;
+
             Coordinates c(lastOuterAxis + 1, 0);
             bool end = false;
 
@@ -232,13 +339,15 @@ namespace ArrayLibrary
             }
         }
 
-        template <typename Operation, bool... Moving>
+        template <typename Operation, bool... Moving, typename... Infos>
             requires(IsOperation<Operation, InputTypes...>)
-        inline static void simdInnerLoop(const Operation &opInfo, long length, ResultType *pDest, SimdSourceInfo<InputTypes>... sourceInfos)
+        inline static void simdInnerLoop(const Operation &opInfo, long length, ResultType *pDest, Infos... sourceInfos)
         {
             size_t j = 0;
             Simd::Vector<ResultType> result;
 
+            ((sourceInfos.template rowStart<Moving>()), ...);
+
             for (j = 0; j + INCREMENT <= length; j += INCREMENT)
             {
                 ((sourceInfos.template innerAdvance<Moving>()), ...);
@@ -254,7 +363,7 @@ namespace ArrayLibrary
 
             if (j < length)
             {
-                ((sourceInfos.template innerAdvance<Moving>()), ...);
+                ((sourceInfos.template tailAdvance<Moving>(length - j)), ...);
 
                 if constexpr (IsNonParametrizedOperation<Operation, InputTypes...>)
                     result = Operation::fSimd(sourceInfos.value()...);
@@ -265,14 +374,23 @@ namespace ArrayLibrary
             }
         }
 
-        template <typename Operation, bool... Moving>
+        template <typename Operation, bool... Moving, typename... Infos>
             requires(sizeof...(Moving) == N && IsOperation<Operation, InputTypes...> && HasSimd<Operation>)
-        inline static void simdOuterLoop(const Operation &opInfo, const long lastOuterAxis, const long flatBoostAxisLength, Array<ResultType> &dest, SimdSourceInfo<InputTypes> &&...sourceInfos)
+        inline static void simdOuterLoop(const Operation &opInfo, const long lastOuterAxis, const long flatBoostAxisLength, Array<ResultType> &dest, Infos &&...sourceInfos)
         {
             ResultType *pDestData = dest.getDataPointer();
             const Coordinates &destShape = dest.refShape();
             const Coordinates &destStrides = dest.refStrides();
 
+            auto row = [&](StridedPointer<ResultType> destRow, std::remove_reference_t<Infos>... sourceRows)
+            {
+                simdInnerLoop<Operation, Moving...>(opInfo, flatBoostAxisLength, destRow.pData, sourceRows...);
+            };
+
+            if (dispatchStaticRank(lastOuterAxis + 1, [&]<long RANK>()
+                                   { staticNestedLoop<RANK>(destShape, row, StridedPointer<ResultType>{pDestData, destStrides}, sourceInfos...); }))
+                return;
+
             Coordinates c(destShape.size() - 1, 0);
             bool end = false;
 
@@ -288,7 +406,7 @@ namespace ArrayLibrary
 
                     if (c[i] != destShape[i])
                     {
-                        (sourceInfos.template outerAdvance<Moving>(i), ...);
+                        (sourceInfos.outerAdvance(i), ...);
                         pDestData = destShape[i] == 1 ? pDestData : pDestData + destStrides[i];
                         end = false;
                         break;
@@ -330,21 +448,198 @@ namespace ArrayLibrary
                 execute<Operation, Moving..., false>(opInfo, simd, lastOuterAxis, flatBoostAxisLength, dest, sources...);
         }
 
+        /// @brief How rows are computed in which some sources move with a stride other than 1, see chooseStridedStrategy
+        enum class StridedStrategy
+        {
+            SCALAR,
+            GATHER,
+            PACK
+        };
+
+        /// @brief A simple cost model for rows along the last axis in which some sources move with a stride other than 1.
+        /// @details If every strided source is contiguous along some other axis, Permute::permuteCopy packs it with the tiled transpose at close to the speed of a plain copy, after which the rows are contiguous. This pays off unless the sources are smaller than PACK_MIN_BYTES, where the allocation dominates. Such small sources, and strided sources without a contiguous axis, e.g. a column of a matrix, are gathered if the operation has SIMD support, the rows fill a vector and the strides fit into 32 bit indices. Everything else is computed with scalar strided loads.
+        static StridedStrategy chooseStridedStrategy(bool simd, long rowLength, const Array<InputTypes> &...sources)
+        {
+            long largestStride = 0;
+            long stridedBytes = 0;
+            bool packable = true;
+
+            [[maybe_unused]] auto inspect = [&]<DataType T>(const Array<T> &source)
+            {
+                const Coordinates &strides = source.refStrides();
+                const long stride = std::abs(strides[source.getDim() - 1]);
+                if (stride <= 1)
+                    return;
+
+                largestStride = std::max(largestStride, stride);
+                stridedBytes += source.getFlatLength() * sizeof(T);
+
+                bool contiguousAxis = false;
+                for (long i = 0; i < source.getDim(); i++)
+                    contiguousAxis = contiguousAxis || strides[i] == 1;
+                packable = packable && contiguousAxis;
+            };
+            (inspect(sources), ...);
+
+            if (packable && stridedBytes >= PACK_MIN_BYTES)
+                return StridedStrategy::PACK;
+
+            if (simd && rowLength >= (long)INCREMENT && largestStride * (long)INCREMENT <= std::numeric_limits<int32_t>::max())
+                return StridedStrategy::GATHER;
+
+            return StridedStrategy::SCALAR;
+        }
+
+        /// @brief Returns a contiguous copy of a source that moves along the last axis with a stride other than 1, and the source itself otherwise
+        template <DataType T>
+        static Array<T> packStrided(const Array<T> &source)
+        {
+            const long stride = source.refStrides()[source.getDim() - 1];
+            return stride == 0 || stride == 1 ? source.view() : source.copy();
+        }
+
+        template <typename Operation, bool... Moving>
+            requires(sizeof...(Moving) < N && IsOperation<Operation, InputTypes...>)
+        static void stridedExecute(const Operation &opInfo, bool gather, Array<ResultType> &dest, const Array<InputTypes> &...sources)
+        {
+            auto &source = refPackGet<sizeof...(Moving)>(sources...);
+
+            if (source.refStrides()[source.getDim() - 1] != 0)
+                stridedExecute<Operation, Moving..., true>(opInfo, gather, dest, sources...);
+            else
+                stridedExecute<Operation, Moving..., false>(opInfo, gather, dest, sources...);
+        }
+
+        /// @brief Computes the operation in rows along the last axis, in which dest is contiguous and every source moves by its own stride along that axis
+        template <typename Operation, bool... Moving>
+            requires(sizeof...(Moving) == N && IsOperation<Operation, InputTypes...>)
+        static void stridedExecute(const Operation &opInfo, bool gather, Array<ResultType> &dest, const Array<InputTypes> &...sources)
+        {
+            const long lastOuterAxis = dest.getDim() - 2;
+            const long rowLength = dest.refShape()[dest.getDim() - 1];
+
+            if constexpr (HasSimd<Operation> && GATHER_SUPPORTED)
+            {
+                if (gather)
+                {
+                    simdOuterLoop<Operation, Moving...>(opInfo, lastOuterAxis, rowLength, dest, GatherSourceInfo<InputTypes>(sources)...);
+                    return;
+                }
+            }
+            outerLoop<Operation, Moving...>(opInfo, lastOuterAxis, rowLength, dest, StridedSourceInfo<InputTypes>(sources)...);
+        }
+
+        /// @brief Whether the computation can run as a single loop over the entries of dest: dest is contiguous and every source is either contiguous with the same shape or a single entry that is broadcast.
+        static bool isFlat(const Array<ResultType> &dest, const Array<InputTypes> &...sources)
+        {
+            return dest.isContiguous() && (... && (sources.getFlatLength() == 1 || (sources.isContiguous() && sources.refShape() == dest.refShape())));
+        }
+
+        /// @brief Checks the moving hints for the flat loop, where exactly the sources with more than one entry are moving
+        template <bool... MovingHints, size_t... I>
+        static bool flatMovingHintsMatch(std::index_sequence<I...>, const Array<InputTypes> &...sources)
+        {
+            if constexpr (sizeof...(MovingHints) == 0)
+                return true;
+            else
+            {
+                constexpr std::array<bool, N> hints = {MovingHints...};
+                return (... && (I >= sizeof...(MovingHints) || hints[I] == (refPackGet<I>(sources...).getFlatLength() != 1)));
+            }
+        }
+
+        template <typename Operation, bool... Moving>
+            requires(sizeof...(Moving) < N && IsOperation<Operation, InputTypes...>)
+        static void flatExecute(const Operation &opInfo, bool simd, Array<ResultType> &dest, const Array<InputTypes> &...sources)
+        {
+            if (refPackGet<sizeof...(Moving)>(sources...).getFlatLength() == 1)
+                flatExecute<Operation, Moving..., false>(opInfo, simd, dest, sources...);
+            else
+                flatExecute<Operation, Moving..., true>(opInfo, simd, dest, sources...);
+        }
+
+        /// @brief Computes the operation in a single loop over the entries of dest, see isFlat. Single-entry sources are loaded once and broadcast, in a SIMD register if possible.
+        template <typename Operation, bool... Moving>
+            requires(sizeof...(Moving) == N && IsOperation<Operation, InputTypes...>)
+        static void flatExecute(const Operation &opInfo, bool simd, Array<ResultType> &dest, const Array<InputTypes> &...sources)
+        {
+            if constexpr (HasSimd<Operation>)
+            {
+                if (simd)
+                {
+                    simdInnerLoop<Operation, Moving...>(opInfo, dest.getFlatLength(), dest.getDataPointer(), SimdSourceInfo<InputTypes>(sources)...);
+                    return;
+                }
+            }
+            innerLoop<Operation, Moving...>(opInfo, dest.getFlatLength(), dest.getDataPointer(), SourceInfo<InputTypes>(sources)...);
+        }
+
         template <typename Operation, bool... MovingHints>
             requires(IsOperation<Operation, InputTypes...>)
         static Array<ResultType> &dispatch(const Operation &opInfo, Array<ResultType> &dest, const Array<InputTypes> &...sources)
         {
             assertm((... && isSubshape(sources.refShape(), dest.refShape())), "Not all source arrays have a shape that is a subshape of the shape of the destination array.");
 
-            if (dest.getDim() == 0)
+            const long flatLength = dest.getFlatLength();
+
+            if (flatLength == 0)
+                return dest;
+
+            // Scalars and arrays with a single entry skip the shape analysis entirely
+            if (flatLength == 1)
             {
                 if constexpr (IsNonParametrizedOperation<Operation, InputTypes...>)
-                    dest.mData[dest.mOffset] = Operation::f((sources.eval())...);
+                    *dest.getDataPointer() = Operation::f((*sources.readDataPointer())...);
                 else
-                    dest.mData[dest.mOffset] = Operation::f(opInfo.param, (sources.eval())...);
+                    *dest.getDataPointer() = Operation::f(opInfo.param, (*sources.readDataPointer())...);
+                return dest;
+            }
+
+            // Analytically, an operation reads every source entry once, writes every dest entry once and counts as one floating point operation per entry
+            Profiler::Scope scope("pointwise", Profiler::Category::POINTWISE, dest.refShape(), flatLength * sizeof(ResultType) + (0 + ... + (sources.getFlatLength() * sizeof(InputTypes))), flatLength);
+
+            if (isFlat(dest, sources...))
+            {
+                if (!flatMovingHintsMatch<MovingHints...>(std::make_index_sequence<N>(), sources...))
+                    throw std::invalid_argument("Source arrays do not have correct shape for moving hint.");
+
+                flatExecute<Operation, MovingHints...>(opInfo, HasSimd<Operation> && SIMD_SUPPORTED && flatLength >= (long)INCREMENT, dest, sources...);
                 return dest;
             }
 
+            // Moving hints refer to the last axis as given, so only loops without hints may run over the canonical layout
+            if constexpr (sizeof...(MovingHints) == 0)
+            {
+                const CanonicalLayout<N + 1> layout = canonicalizeLayout<N + 1>(dest.refShape(), {&dest.refStrides(), &sources.refStrides()...});
+                Array<ResultType> canonicalDest(dest.mData.view(), layout.shape, layout.strides[0], dest.mOffset, isContiguousLayout(layout.shape, layout.strides[0]));
+                canonicalDispatch<Operation>(opInfo, std::make_index_sequence<N>(), layout, canonicalDest, sources...);
+            }
+            else
+                stridedDispatch<Operation, MovingHints...>(opInfo, dest, sources...);
+
+            return dest;
+        }
+
+        /// @brief Returns a view of source in the canonical layout of a computation, see canonicalizeLayout. The source has length 1 along the axes where it does not move.
+        template <DataType T>
+        static Array<T> canonicalSource(const Coordinates &shape, const Coordinates &strides, const Array<T> &source)
+        {
+            Coordinates sourceShape(shape);
+            for (long i = 0; i < sourceShape.size(); i++)
+                sourceShape[i] = strides[i] == 0 ? 1 : sourceShape[i];
+
+            return Array<T>(source.mData.view(), sourceShape, strides, source.mOffset, isContiguousLayout(sourceShape, strides));
+        }
+
+        template <typename Operation, size_t... I>
+        static void canonicalDispatch(const Operation &opInfo, std::index_sequence<I...>, const CanonicalLayout<N + 1> &layout, Array<ResultType> &dest, const Array<InputTypes> &...sources)
+        {
+            stridedDispatch<Operation>(opInfo, dest, canonicalSource(layout.shape, layout.strides[I + 1], sources)...);
+        }
+
+        template <typename Operation, bool... MovingHints>
+        static void stridedDispatch(const Operation &opInfo, Array<ResultType> &dest, const Array<InputTypes> &...sources)
+        {
             const Coordinates &destShape = dest.refShape();
             const Coordinates &destStrides = dest.refStrides();
 
@@ -369,6 +664,29 @@ namespace ArrayLibrary
                 lastOuterAxis--;
             }
 
+            // In the canonical layout, nothing is flattened only if a source moves along the last axis with a stride other than 1
+            if constexpr (sizeof...(MovingHints) == 0)
+            {
+                const long lastAxis = dest.getDim() - 1;
+                if (lastOuterAxis == lastAxis && destStrides[lastAxis] == 1 && destShape[lastAxis] > 1)
+                {
+                    const bool simd = HasSimd<Operation> && GATHER_SUPPORTED;
+                    switch (chooseStridedStrategy(simd, destShape[lastAxis], sources...))
+                    {
+                    case StridedStrategy::PACK:
+                        stridedDispatch<Operation>(opInfo, dest, packStrided(sources)...);
+                        break;
+                    case StridedStrategy::GATHER:
+                        stridedExecute<Operation>(opInfo, true, dest, sources...);
+                        break;
+                    case StridedStrategy::SCALAR:
+                        stridedExecute<Operation>(opInfo, false, dest, sources...);
+                        break;
+                    }
+                    return;
+                }
+            }
+
             if (lastOuterAxis < lastNonTrivialAxis)
                 checkMovingHint<MovingHints...>(lastOuterAxis, matchFlatLength, std::pair<const Coordinates &, const Coordinates &>(dest.refShape(), dest.refStrides()), std::pair<const Coordinates &, const Coordinates &>(sources.refShape(), sources.refStrides())...);
 
@@ -376,8 +694,6 @@ namespace ArrayLibrary
                 execute<Operation, MovingHints...>(opInfo, true, lastOuterAxis, matchFlatLength, dest, sources...);
             else
                 execute<Operation, MovingHints...>(opInfo, false, lastOuterAxis, matchFlatLength, dest, sources...);
-
-            return dest;
         }
 
     public:
@@ -385,6 +701,7 @@ namespace ArrayLibrary
             requires(IsNonParametrizedOperation<Operation, InputTypes...> && sizeof...(MovingHints) <= N)
         static Array<ResultType> &computeInPlace(Array<ResultType> &dest, const Array<InputTypes> &...sources)
         {
+            dest.copyOnWrite();
             return dispatch<Operation, MovingHints...>(Operation(), dest, (sources.adjustDimension(dest.getDim()))...);
         }
 
@@ -392,6 +709,7 @@ namespace ArrayLibrary
             requires(IsParametrizedOperation<Operation, InputTypes...> && sizeof...(MovingHints) <= N)
         static Array<ResultType> &computeInPlace(const Operation &operation, Array<ResultType> &dest, const Array<InputTypes> &...sources)
         {
+            dest.copyOnWrite();
             return dispatch<Operation, MovingHints...>(operation, dest, (sources.adjustDimension(dest.getDim()))...);
         }
 
@@ -2,6 +2,7 @@
 #include "diff_unit.hpp"
 #include "diff_basic.hpp"
 #include "diff_matmul.hpp"
+#include "diff_sparse.hpp"
 #include "diff_binary_ptws.hpp"
 #include "diff_reduce.hpp"
 #include "diff_nn.hpp"
@@ -27,7 +27,11 @@ namespace AutoDiff
             if (!this->wildcardMatch(value.refShape()))
                 throw std::invalid_argument("The shape of the value does not match the wildcard shape.");
 
-            this->mArray = value;
+            // A view, e.g. a batch sliced from a data set, is copied into the buffer of the previous value, so that batches of the same length do not allocate and the unit does not keep the data set referenced
+            if (value.isView())
+                computeInPlace<Copy<T>>(this->prepare(this->mArray, value.refShape()), value);
+            else
+                this->mArray = value;
             this->mDiffTape.reset();
         }
 
@@ -64,7 +68,68 @@ namespace AutoDiff
             return this->mArray;
         }
 
+        /// @brief Whether only the rows listed by refGradientRows can have a nonzero gradient, see setRowSparseGradient
+        bool hasRowSparseGradient() const override { return mRowSparseGradient; }
+
+        /// @brief Declares that the gradient is only nonzero in the rows that the units pulling it report via addGradientRows, e.g. for the table of an Embedding.
+        /// @details Then resetGradient only clears those rows, and Adam only updates them. All units that pull gradient into the coefficients have to report their rows, so the tape throws on the next gradient pass if the coefficients are used by any other unit, see Unit<T>::reportsGradientRows.
+        void setRowSparseGradient(bool rowSparse)
+        {
+            if (rowSparse && this->getDim() == 0)
+                throw std::invalid_argument("Only coefficients with at least one axis can have a row-sparse gradient.");
+
+            mRowSparseGradient = rowSparse;
+            clearGradientRows();
+        }
+
+        /// @brief The rows along the first axis that received gradient since the last reset, in the order in which they were reported
+        const std::vector<long> &refGradientRows() const { return mGradientRows; }
+
+        void addGradientRows(const std::vector<long> &rows)
+        {
+            if (!mRowSparseGradient)
+                return;
+
+            if ((long)mHasGradient.size() != this->mArray.refShape()[0])
+                mHasGradient.assign(this->mArray.refShape()[0], false);
+
+            for (long row : rows)
+                if (!mHasGradient[row])
+                {
+                    mHasGradient[row] = true;
+                    mGradientRows.push_back(row);
+                }
+        }
+
+        void resetGradient() override
+        {
+            if (!mRowSparseGradient || this->mArray.refShape() != this->mGradient.refShape())
+            {
+                Unit<T>::resetGradient();
+                clearGradientRows();
+                return;
+            }
+
+            // The gradient may be shared with an array returned by DiffTape::getGradient, which must keep its values
+            this->mGradient.ensureUnique();
+            for (long row : mGradientRows)
+                this->mGradient.sliceAxis(0, row, row + 1) = 0;
+            clearGradientRows();
+        }
+
         void pullGradient() const override {};
+
+    private:
+        bool mRowSparseGradient = false;
+        std::vector<long> mGradientRows;
+        std::vector<char> mHasGradient;
+
+        void clearGradientRows()
+        {
+            for (long row : mGradientRows)
+                mHasGradient[row] = false;
+            mGradientRows.clear();
+        }
     };
 
     template <DataType T>
@@ -76,16 +141,33 @@ namespace AutoDiff
     public:
         Reshape(Unit<T> &source, const Coordinates &shape) : mSource(source), Unit<T>(source.getDiffTape(), shape) {}
 
-        void pullGradient() override
+        std::vector<Unit<T> *> getDependencies() const override
+        {
+            return {&mSource};
+        }
+
+        void pullGradient() const override
         {
-            mSource.mGradient += this->mGradient.copy().reshape(mSource.refWildcardShape());
+            mSource.mGradient += this->mGradient.reshape(mSource.refArrayShape());
         }
 
         void calculate() override
         {
-            this->mArray = mSource.refArray().copy().reshape(this->refWildcardShape());
+            const Array<T> source = mSource.refArray().reshape(this->refWildcardShape());
+            computeInPlace<Copy<T>>(this->prepare(this->mArray, source.refShape()), source);
             Unit<T>::calculate();
         };
+
+        /// A copy moves the entries without operating on them
+        Roofline::Work forwardWork() const override
+        {
+            return this->streamingWork(0);
+        }
+
+        Roofline::Work backwardWork() const override
+        {
+            return this->streamingGradientWork(1);
+        }
     };
 
     template <DataType T>
@@ -117,14 +199,14 @@ namespace AutoDiff
             return {&mSource};
         }
 
-        void pullGradient() override
+        void pullGradient() const override
         {
-            computeInPlace<FusedMultiplyAdd<T>, true, true, true>(mSource.mGradient, this->mGradient, compute<Operation::Differential>(mSource.mArray), mSource.mGradient);
+            mSource.mGradient = lazy(mSource.mGradient) + lazy(this->mGradient) * lazy(mSource.refArray()).apply(typename Operation::Differential());
         }
 
         void calculate() override
         {
-            ArrayLibrary::computeInPlace<Operation::Function>(this->mArray, mSource.mArray);
+            ArrayLibrary::computeInPlace<typename Operation::Function>(this->prepare(this->mArray, mSource.refArrayShape()), mSource.refArray());
             Unit<T>::calculate();
         };
     };
@@ -147,12 +229,14 @@ namespace AutoDiff
 
         void pullGradient() const override
         {
-            computeInPlace<FusedMultiplyAdd<T>, true, true, true>(mSource.mGradient, this->mGradient, compute<typename Operation::Differential>(mOp.param, mSource.refArray()), mSource.mGradient);
+            using Differential = typename Operation::Differential;
+            mSource.mGradient = lazy(mSource.mGradient) + lazy(this->mGradient) * lazy(mSource.refArray()).apply(Differential(mOp.param));
         }
 
         void calculate() override
         {
-            this->mArray = ArrayLibrary::compute<typename Operation::Function>(mOp.param, mSource.refArray());
+            using Function = typename Operation::Function;
+            ArrayLibrary::computeInPlace<Function>(Function(mOp.param), this->prepare(this->mArray, mSource.refArrayShape()), mSource.refArray());
             Unit<T>::calculate();
         };
     };
@@ -13,6 +13,7 @@ namespace AutoDiff
         Unit<T> &mRight;
         Coordinates mReductionAxesLeft;
         Coordinates mReductionAxesRight;
+        mutable Array<T> mBuffer = Array<T>::constant({}, 0);
 
         BinaryPointwiseOperation(Unit<T> &left, Unit<T> &right) : mLeft(left), mRight(right), Unit<T>(left.getDiffTape(), wildcardBroadcastShape(left.refWildcardShape(), right.refWildcardShape()))
         {
@@ -20,6 +21,33 @@ namespace AutoDiff
             mReductionAxesRight = Coordinates::findDifferences(right.refWildcardShape(), this->refWildcardShape());
         }
 
+        Array<T> &prepareResult()
+        {
+            return this->prepare(this->mArray, findOuterShape(mLeft.refArrayShape(), mRight.refArrayShape()));
+        }
+
+        /// @brief Adds (or subtracts) the gradient contribution given by an expression to the gradient of target, summing over the broadcasted axes.
+        template <bool SUBTRACT, typename Node>
+        void pullInto(Unit<T> &target, const Coordinates &reductionAxes, const Node &contribution) const
+        {
+            if (reductionAxes.size() == 0)
+            {
+                if constexpr (SUBTRACT)
+                    target.mGradient = lazy(target.mGradient) - contribution;
+                else
+                    target.mGradient = lazy(target.mGradient) + contribution;
+            }
+            else
+            {
+                contribution.evaluateInto(this->prepare(mBuffer, this->refArrayShape()));
+
+                if constexpr (SUBTRACT)
+                    mBuffer.reduceSubtract(reductionAxes, target.mGradient);
+                else
+                    mBuffer.reduceSum(reductionAxes, target.mGradient, true);
+            }
+        }
+
     public:
         std::vector<Unit<T> *> getDependencies() const override
         {
@@ -36,13 +64,13 @@ namespace AutoDiff
 
         void pullGradient() const override
         {
-            this->mLeft.mGradient += this->mGradient.reduceSum(this->mReductionAxesLeft, true);
-            this->mRight.mGradient += this->mGradient.reduceSum(this->mReductionAxesRight, true);
+            this->mGradient.reduceSum(this->mReductionAxesLeft, this->mLeft.mGradient, true);
+            this->mGradient.reduceSum(this->mReductionAxesRight, this->mRight.mGradient, true);
         }
 
         void calculate() override
         {
-            this->mArray = this->mLeft.refArray() + this->mRight.refArray();
+            computeInPlace<Addition<T>>(this->prepareResult(), this->mLeft.refArray(), this->mRight.refArray());
             Unit<T>::calculate();
         };
     };
@@ -55,13 +83,13 @@ namespace AutoDiff
 
         void pullGradient() const override
         {
-            this->mLeft.mGradient += this->mGradient.reduceSum(this->mReductionAxesLeft, true);
-            this->mRight.mGradient -= this->mGradient.reduceSum(this->mReductionAxesRight, true);
+            this->mGradient.reduceSum(this->mReductionAxesLeft, this->mLeft.mGradient, true);
+            this->mGradient.reduceSubtract(this->mReductionAxesRight, this->mRight.mGradient);
         }
 
         void calculate() override
         {
-            this->mArray = this->mLeft.refArray() - this->mRight.refArray();
+            computeInPlace<Subtraction<T>>(this->prepareResult(), this->mLeft.refArray(), this->mRight.refArray());
             Unit<T>::calculate();
         };
     };
@@ -75,13 +103,13 @@ namespace AutoDiff
 
         void pullGradient() const override
         {
-            this->mLeft.mGradient += (this->mGradient * this->mRight.refArray()).reduceSum(this->mReductionAxesLeft, true);
-            this->mRight.mGradient += (this->mGradient * this->mLeft.refArray()).reduceSum(this->mReductionAxesRight, true);
+            this->template pullInto<false>(this->mLeft, this->mReductionAxesLeft, lazy(this->mGradient) * lazy(this->mRight.refArray()));
+            this->template pullInto<false>(this->mRight, this->mReductionAxesRight, lazy(this->mGradient) * lazy(this->mLeft.refArray()));
         }
 
         void calculate() override
         {
-            this->mArray = this->mLeft.refArray() * this->mRight.refArray();
+            computeInPlace<Multiplication<T>>(this->prepareResult(), this->mLeft.refArray(), this->mRight.refArray());
             Unit<T>::calculate();
         };
     };
@@ -94,14 +122,17 @@ namespace AutoDiff
 
         void pullGradient() const override
         {
-            this->mLeft.mGradient += (this->mGradient / this->mRight.mArray).reduceSum(this->mReductionAxesLeft, true);
+            const auto g = lazy(this->mGradient);
+            const auto left = lazy(this->mLeft.refArray());
+            const auto right = lazy(this->mRight.refArray());
 
-            this->mRight.mGradient -= (this->mGradient * this->mLeft.mArray / this->mRight.mArray.square()).reduceSum(this->mReductionAxesRight, true);
+            this->template pullInto<false>(this->mLeft, this->mReductionAxesLeft, g / right);
+            this->template pullInto<true>(this->mRight, this->mReductionAxesRight, g * left / right.square());
         }
 
         void calculate() override
         {
-            this->mArray = this->mLeft.mArray / this->mRight.mArray;
+            computeInPlace<Division<T>>(this->prepareResult(), this->mLeft.refArray(), this->mRight.refArray());
             Unit<T>::calculate();
         };
     };
@@ -114,20 +145,21 @@ namespace AutoDiff
         const T mScalar;
 
     public:
-        Scale(Unit<T> &source, T scalar) : Unit<T>(source.mDiffTape, source.refShape())
+        Scale(Unit<T> &source, T scalar) : Unit<T>(source.getDiffTape(), source.refWildcardShape()), mSource(source), mScalar(scalar) {}
+
+        std::vector<Unit<T> *> getDependencies() const override
         {
-            mSource = source;
-            mScalar = scalar;
-        };
+            return {&mSource};
+        }
 
         void pullGradient() const override
         {
-            mSource.mGradient += this->mGradient * mScalar;
+            mSource.mGradient = lazy(mSource.mGradient) + lazy(this->mGradient) * mScalar;
         }
 
         void calculate() override
         {
-            this->mArray = mScalar * mSource.mArray;
+            computeInPlace<ScalarMultiplication<T>>(ScalarMultiplication<T>(mScalar), this->prepare(this->mArray, mSource.refArrayShape()), mSource.refArray());
             Unit<T>::calculate();
         };
     };
@@ -140,11 +172,12 @@ namespace AutoDiff
         const T mTranslate;
 
     public:
-        Translate(Unit<T> &source, T translate) : Unit<T>(source.mDiffTape, source.refShape())
+        Translate(Unit<T> &source, T translate) : Unit<T>(source.getDiffTape(), source.refWildcardShape()), mSource(source), mTranslate(translate) {}
+
+        std::vector<Unit<T> *> getDependencies() const override
         {
-            mSource = source;
-            mTranslate = translate;
-        };
+            return {&mSource};
+        }
 
         void pullGradient() const override
         {
@@ -153,7 +186,7 @@ namespace AutoDiff
 
         void calculate() override
         {
-            this->mArray = mSource.mArray + mTranslate;
+            computeInPlace<ScalarAddition<T>>(ScalarAddition<T>(mTranslate), this->prepare(this->mArray, mSource.refArrayShape()), mSource.refArray());
             Unit<T>::calculate();
         };
     };
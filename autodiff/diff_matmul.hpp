@@ -128,12 +128,14 @@ namespace AutoDiff
             mLeftGradientSettings.reduceAxes = mReductionAxesLeft;
             mLeftGradientSettings.keepDims = false;
             mLeftGradientSettings.setzero = false;
+            mLeftGradientSettings.transposeRight = true;
 
             mRightGradientSettings.leftProductAxis = mLeftProductAxis;
             mRightGradientSettings.rightProductAxis = mRightProductAxis;
             mRightGradientSettings.reduceAxes = mReductionAxesRight;
             mRightGradientSettings.keepDims = false;
             mRightGradientSettings.setzero = false;
+            mRightGradientSettings.transposeLeft = true;
         }
 
         std::vector<Unit<T> *> getDependencies() const override
@@ -141,29 +143,57 @@ namespace AutoDiff
             return {&mLeft, &mRight};
         }
 
+        /// The gradient settings transpose the other operand, so that matmul reads it in place or packs it along the axis its kernel needs
         void pullGradient() const override
         {
-            Array<T> leftTranspose = mLeft.refArray().reshape(mLeftBroadcastedShape).transpose(mLeftProductAxis, mRightProductAxis);
-            Array<T> rightTranspose = mRight.refArray().reshape(mRightBroadcastedShape).transpose(mLeftProductAxis, mRightProductAxis);
+            const Array<T> left = mLeft.refArray().reshape(mLeftBroadcastedShape);
+            const Array<T> right = mRight.refArray().reshape(mRightBroadcastedShape);
             Array<T> grad = mVectorRight ? this->mGradient.reshape(this->mWildcardShape + 1) : this->mGradient;
 
-            Matmul::matmul<T>(grad, rightTranspose, &mLeft.mGradient, mLeftGradientSettings);
+            Matmul::matmul<T>(grad, right, &mLeft.mGradient, mLeftGradientSettings);
 
             if (mVectorRight)
             {
                 auto tmp = mRight.mGradient.reshape(mRight.refArrayShape() + 1);
-                Matmul::matmul<T>(leftTranspose, grad, &tmp, mRightGradientSettings);
+                Matmul::matmul<T>(left, grad, &tmp, mRightGradientSettings);
             }
             else
-                Matmul::matmul<T>(leftTranspose, grad, &mRight.mGradient, mRightGradientSettings);
+                Matmul::matmul<T>(left, grad, &mRight.mGradient, mRightGradientSettings);
+        }
+
+        /// @brief The length of the product axis for the current shapes
+        long getProductLength() const
+        {
+            return mLeft.refArrayShape()[mLeftProductAxis - (mLeftBroadcastedShape.size() - mLeft.getDim())];
+        }
+
+        /// Each entry of the result is the sum of getProductLength() multiply-adds, and the operands and the result are moved once
+        Roofline::Work forwardWork() const override
+        {
+            const double entries = this->mArray.getFlatLength();
+            return {2 * entries * getProductLength(), (entries + mLeft.refArray().getFlatLength() + mRight.refArray().getFlatLength()) * sizeof(T)};
+        }
+
+        /// The two gradient products each take as many multiply-adds as the forward product, and update the gradients of the operands
+        Roofline::Work backwardWork() const override
+        {
+            const double entries = this->mArray.getFlatLength();
+            return {4 * entries * getProductLength(), (2 * entries + 3 * mLeft.refArray().getFlatLength() + 3 * mRight.refArray().getFlatLength()) * sizeof(T)};
         }
 
         void calculate() override
         {
+            const Array<T> left = mLeft.refArray().reshape(mLeftBroadcastedShape);
+            const Array<T> right = mRight.refArray().reshape(mRightBroadcastedShape);
+            const Coordinates shape = Matmul::matmulShape(left.refShape(), right.refShape(), mLeftProductAxis, mRightProductAxis);
+
             if (mVectorRight)
-                this->mArray = Matmul::matmul(mLeft.refArray().reshape(mLeftBroadcastedShape), mRight.refArray().reshape(mRightBroadcastedShape), mForwardMatmulSettings).reshape(this->mWildcardShape);
+            {
+                Array<T> dest = this->prepare(this->mArray, shape.interval(0, shape.size() - 1)).reshape(shape);
+                Matmul::matmul<T>(left, right, &dest, mForwardMatmulSettings);
+            }
             else
-                this->mArray = Matmul::matmul(mLeft.refArray().reshape(mLeftBroadcastedShape), mRight.refArray().reshape(mRightBroadcastedShape), mForwardMatmulSettings);
+                Matmul::matmul<T>(left, right, &this->prepare(this->mArray, shape), mForwardMatmulSettings);
             Unit<T>::calculate();
         };
     };
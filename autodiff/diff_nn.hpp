@@ -22,6 +22,7 @@ namespace AutoDiff
         private:
             Unit<T> &mSource;
             const Coordinates mAxes;
+            mutable Array<T> mNorm = Array<T>::constant({}, 0);
 
         public:
             Softmax(Unit<T> &source, const Coordinates &axes) : mSource(source), mAxes(axes), Unit<T>(source.getDiffTape(), source.refWildcardShape()) {}
@@ -33,20 +34,30 @@ namespace AutoDiff
 
             void pullGradient() const override
             {
-                Array<T> centered = mSource.refArray() - mSource.refArray().reduceMax(mAxes, true);
-                Array<T> expd = centered.exp();
-                Array<T> norm = expd.reduceSum(mAxes, true);
-                auto &g = this->mGradient;
-                Array<T> prod = (expd * g);
+                const auto s = lazy(this->mArray);
+                const auto g = lazy(this->mGradient);
+
+                mapReduceInto<Multiplication<T>>(this->prepare(mNorm, reduceShape(this->mArray.refShape(), mAxes, true).keepDimsShape), mAxes, Summation::NAIVE, this->mArray, this->mGradient);
+
+                mSource.mGradient = lazy(mSource.mGradient) + s * (g - lazy(mNorm));
+            }
+
+            /// The maximum and the sum of the exponentials are taken in one read pass, followed by one write pass, see Normalization::softmax
+            Roofline::Work forwardWork() const override
+            {
+                return Roofline::Work{5, 3 * sizeof(T)} * this->mArray.getFlatLength();
+            }
 
-                mSource.mGradient += (prod - expd * prod.reduceSum(mAxes, true) / norm) / norm;
+            /// The products with the gradient are summed in one pass, followed by the update of the source gradient
+            Roofline::Work backwardWork() const override
+            {
+                return Roofline::Work{5, 6 * sizeof(T)} * this->mArray.getFlatLength();
             }
 
             void calculate() override
             {
-                Array<T> centered = mSource.refArray() - mSource.refArray().reduceMax(mAxes, true);
-                Array<T> expd = centered.exp();
-                this->mArray = expd / expd.reduceSum(mAxes, true);
+                const Array<T> &x = mSource.refArray();
+                Normalization<T>::softmax(x, mAxes, this->prepare(this->mArray, x.refShape()));
                 Unit<T>::calculate();
             };
         };
@@ -73,6 +84,9 @@ namespace AutoDiff
         private:
             Unit<T> &mSource;
             const Coordinates mAxes;
+            mutable Array<T> mTmp = Array<T>::constant({}, 0);
+            mutable Array<T> mNorm = Array<T>::constant({}, 0);
+            mutable Array<T> mInnerProduct = Array<T>::constant({}, 0);
 
         public:
             Softermax(Unit<T> &source, const Coordinates &axes) : mSource(source), mAxes(axes), Unit<T>(source.getDiffTape(), source.refWildcardShape())
@@ -109,13 +123,23 @@ namespace AutoDiff
                 }
             };
 
+            /// The function weighted by the gradient, whose sum is the inner product of the backward pass
+            struct WeightedFunction
+            {
+                static inline T f(const T x, const T g)
+                {
+                    return Function::f(x) * g;
+                }
+            };
+
+            /// @details Uses the normalization computed by calculate(), so the source must not have changed since the forward pass.
             void pullGradient() const override
             {
-                Array<T> tmp = compute<Function>(mSource.refArray());
-                Array<T> dTmp = compute<Differential>(mSource.refArray());
-                Array<T> norm = tmp.reduceSum(mAxes, true);
+                const Array<T> &x = mSource.refArray();
                 auto &g = this->mGradient;
-                Array<T> innerProd = (tmp * g).reduceSum(mAxes, true);
+
+                mapReduceInto<WeightedFunction>(this->prepare(mInnerProduct, mNorm.refShape()), mAxes, Summation::NAIVE, x, g);
+                Array<T> &dTmp = computeInPlace<Differential>(this->prepare(mTmp, x.refShape()), x);
 
                 struct LocalComp
                 {
@@ -130,14 +154,35 @@ namespace AutoDiff
                     }
                 };
 
-                computeInPlace<LocalComp>(mSource.mGradient, mSource.mGradient, dTmp, g, innerProd, norm);
+                computeInPlace<LocalComp>(mSource.mGradient, mSource.mGradient, dTmp, g, mInnerProduct, mNorm);
+            }
+
+            /// The function is summed in one pass without being stored, followed by one pass that evaluates it again and divides by the sum
+            Roofline::Work forwardWork() const override
+            {
+                return Roofline::Work{5, 3 * sizeof(T)} * this->mArray.getFlatLength();
+            }
+
+            /// The weighted function is summed in one pass, followed by the differential and the final combination
+            Roofline::Work backwardWork() const override
+            {
+                return Roofline::Work{14, 8 * sizeof(T)} * this->mArray.getFlatLength();
             }
 
             void calculate() override
             {
+                const Array<T> &x = mSource.refArray();
 
-                Array<T> tmp = compute<Function>(mSource.refArray());
-                this->mArray = tmp / tmp.reduceSum(mAxes, true);
+                struct Normalized
+                {
+                    static inline T f(const T x, const T norm)
+                    {
+                        return Function::f(x) / norm;
+                    }
+                };
+
+                mapReduceInto<Function>(this->prepare(mNorm, reduceShape(x.refShape(), mAxes, true).keepDimsShape), mAxes, Summation::NAIVE, x);
+                computeInPlace<Normalized>(this->prepare(this->mArray, x.refShape()), x, mNorm);
                 Unit<T>::calculate();
             }
         };
@@ -193,6 +238,247 @@ namespace AutoDiff
 
         RandomArrayGenerator randomArrayGenerator = RandomArrayGenerator(0);
 
+        /// @brief Sets each entry of the source to zero with the given rate during training and scales the others by 1 / (1 - rate), so that the expected value does not change.
+        /// @details The mask is never stored. Each forward pass reserves a new stream of the generator, and the backward pass regenerates the same mask from it, see RandomArrayGenerator::maskedScale. In inference mode, the unit passes the source and its gradient through without copying the source.
+        template <DataType T>
+        class Dropout : public Unit<T>
+        {
+        private:
+            Unit<T> &mSource;
+            const double mRate;
+            RandomArrayGenerator &mGenerator;
+            uint64_t mStream = 0;
+            bool mTraining = true;
+
+            Dropout(Unit<T> &source, double rate, RandomArrayGenerator &generator) : Unit<T>(source.getDiffTape(), source.refWildcardShape()), mSource(source), mRate(rate), mGenerator(generator)
+            {
+                if (rate < 0 || rate >= 1)
+                    throw std::invalid_argument("The dropout rate must lie in [0, 1).");
+            }
+
+        public:
+            static Dropout<T> &create(Unit<T> &source, double rate, RandomArrayGenerator &generator = randomArrayGenerator)
+            {
+                return *(new Dropout<T>(source, rate, generator));
+            }
+
+            bool isTraining() const { return mTraining; }
+
+            /// @brief Switches between training, where entries are dropped, and inference, where the source is passed through.
+            void setTraining(bool training)
+            {
+                mTraining = training;
+                this->mDiffTape.reset();
+            }
+
+            std::vector<Unit<T> *> getDependencies() const override
+            {
+                return {&mSource};
+            }
+
+            void pullGradient() const override
+            {
+                if (!mTraining || mRate == 0)
+                    mSource.mGradient += this->mGradient;
+                else
+                    mGenerator.maskedScale(this->mGradient, mSource.mGradient, 1 - mRate, mStream, true);
+            }
+
+            void calculate() override
+            {
+                const Array<T> &x = mSource.refArray();
+                if (!mTraining || mRate == 0)
+                    this->mArray = x;
+                else
+                {
+                    mStream = mGenerator.newStream();
+                    mGenerator.maskedScale(x, this->prepare(this->mArray, x.refShape()), 1 - mRate, mStream);
+                }
+                Unit<T>::calculate();
+            };
+        };
+
+        template <DataType T>
+        Dropout<T> &dropout(Unit<T> &unit, double rate)
+        {
+            return Dropout<T>::create(unit, rate);
+        }
+
+        /// @brief Normalizes each sample of the source along its last axis to zero mean and unit variance, then applies a learned scale and shift of the length of that axis.
+        /// @details See Normalization<T>::normalizeRows. The mean and inverse standard deviation of each row are kept for the backward pass.
+        template <DataType T>
+        class LayerNorm : public Unit<T>
+        {
+        private:
+            Unit<T> &mSource;
+            Coefficients<T> &mScale;
+            Coefficients<T> &mShift;
+            const T mEpsilon;
+            Array<T> mMean = Array<T>::constant({}, 0);
+            Array<T> mInverseStd = Array<T>::constant({}, 0);
+
+            LayerNorm(Unit<T> &source, Coefficients<T> &scale, Coefficients<T> &shift, T epsilon) : Unit<T>(source.getDiffTape(), source.refWildcardShape()), mSource(source), mScale(scale), mShift(shift), mEpsilon(epsilon)
+            {
+                if (source.getDim() == 0 || source.refWildcardShape().get(-1) == -1)
+                    throw std::invalid_argument("The last axis of the source must have a fixed length.");
+                if (scale.refWildcardShape() != Coordinates({source.refWildcardShape().get(-1)}) || shift.refWildcardShape() != scale.refWildcardShape())
+                    throw std::invalid_argument("Scale and shift must be vectors of the length of the last axis of the source.");
+            }
+
+        public:
+            static LayerNorm<T> &create(Unit<T> &source, Coefficients<T> &scale, Coefficients<T> &shift, T epsilon = 1e-5)
+            {
+                return *(new LayerNorm<T>(source, scale, shift, epsilon));
+            }
+
+            const Coefficients<T> &refScale() const { return mScale; }
+            const Coefficients<T> &refShift() const { return mShift; }
+
+            std::vector<Unit<T> *> getDependencies() const override
+            {
+                return {&mSource, &mScale, &mShift};
+            }
+
+            void pullGradient() const override
+            {
+                Normalization<T>::normalizeRowsGradient(mSource.refArray(), mScale.refArray(), mMean, mInverseStd, this->mGradient, mSource.mGradient, mScale.mGradient, mShift.mGradient);
+            }
+
+            /// The statistics and the normalization are two passes over the source, and the gradient is two passes over the source and the gradient
+            Roofline::Work forwardWork() const override
+            {
+                return Roofline::Work{8, 3 * sizeof(T)} * this->mArray.getFlatLength();
+            }
+
+            Roofline::Work backwardWork() const override
+            {
+                return Roofline::Work{10, 6 * sizeof(T)} * this->mArray.getFlatLength();
+            }
+
+            void calculate() override
+            {
+                const Array<T> &x = mSource.refArray();
+                const long rows = x.getFlatLength() / x.refShape()[x.getDim() - 1];
+                Normalization<T>::normalizeRows(x, mScale.refArray(), mShift.refArray(), mEpsilon, this->prepare(this->mArray, x.refShape()), this->prepare(mMean, {rows}), this->prepare(mInverseStd, {rows}));
+                Unit<T>::calculate();
+            };
+        };
+
+        /// @brief Creates a layer normalization whose scale starts at one and whose shift starts at zero.
+        template <DataType T>
+        LayerNorm<T> &layerNorm(Unit<T> &source, T epsilon = 1e-5)
+        {
+            const long length = source.refWildcardShape().get(-1);
+            auto &scale = Coefficients<T>::create(source.getDiffTape(), Array<T>::constant({length}, 1));
+            auto &shift = Coefficients<T>::create(source.getDiffTape(), Array<T>::constant({length}, 0));
+            return LayerNorm<T>::create(source, scale, shift, epsilon);
+        }
+
+        /// @brief Normalizes each entry of the last axis of the source over the batch, i.e. over all other axes, then applies a learned scale and shift.
+        /// @details See Normalization<T>::normalizeColumns. During training, the statistics of the batch are used and folded into running statistics, running = (1 - momentum) * running + momentum * batch, with the unbiased variance. In inference mode, the running statistics are used instead and the batch does not change them.
+        template <DataType T>
+        class BatchNorm : public Unit<T>
+        {
+        private:
+            Unit<T> &mSource;
+            Coefficients<T> &mScale;
+            Coefficients<T> &mShift;
+            const T mMomentum;
+            const T mEpsilon;
+            bool mTraining = true;
+            Array<T> mMean = Array<T>::constant({}, 0);
+            Array<T> mInverseStd = Array<T>::constant({}, 0);
+            Array<T> mRunningMean;
+            Array<T> mRunningVariance;
+
+            BatchNorm(Unit<T> &source, Coefficients<T> &scale, Coefficients<T> &shift, T momentum, T epsilon) : Unit<T>(source.getDiffTape(), source.refWildcardShape()), mSource(source), mScale(scale), mShift(shift), mMomentum(momentum), mEpsilon(epsilon),
+                                                                                                                 mRunningMean(Array<T>::constant({source.refWildcardShape().get(-1)}, 0)), mRunningVariance(Array<T>::constant({source.refWildcardShape().get(-1)}, 1))
+            {
+                if (source.getDim() == 0 || source.refWildcardShape().get(-1) == -1)
+                    throw std::invalid_argument("The last axis of the source must have a fixed length.");
+                if (scale.refWildcardShape() != Coordinates({source.refWildcardShape().get(-1)}) || shift.refWildcardShape() != scale.refWildcardShape())
+                    throw std::invalid_argument("Scale and shift must be vectors of the length of the last axis of the source.");
+                if (momentum < 0 || momentum > 1)
+                    throw std::invalid_argument("The momentum must lie between 0 and 1.");
+            }
+
+        public:
+            static BatchNorm<T> &create(Unit<T> &source, Coefficients<T> &scale, Coefficients<T> &shift, T momentum = 0.1, T epsilon = 1e-5)
+            {
+                return *(new BatchNorm<T>(source, scale, shift, momentum, epsilon));
+            }
+
+            const Coefficients<T> &refScale() const { return mScale; }
+            const Coefficients<T> &refShift() const { return mShift; }
+            const Array<T> &refRunningMean() const { return mRunningMean; }
+            const Array<T> &refRunningVariance() const { return mRunningVariance; }
+
+            bool isTraining() const { return mTraining; }
+
+            /// @brief Switches between training, which uses and records the statistics of the batch, and inference, which uses the running statistics.
+            void setTraining(bool training)
+            {
+                mTraining = training;
+                this->mDiffTape.reset();
+            }
+
+            std::vector<Unit<T> *> getDependencies() const override
+            {
+                return {&mSource, &mScale, &mShift};
+            }
+
+            void pullGradient() const override
+            {
+                Normalization<T>::normalizeColumnsGradient(mSource.refArray(), mScale.refArray(), mMean, mInverseStd, this->mGradient, mSource.mGradient, mScale.mGradient, mShift.mGradient, mTraining);
+            }
+
+            /// As for LayerNorm, since the same kernels normalize along the other axis
+            Roofline::Work forwardWork() const override
+            {
+                return Roofline::Work{8, 3 * sizeof(T)} * this->mArray.getFlatLength();
+            }
+
+            Roofline::Work backwardWork() const override
+            {
+                return Roofline::Work{10, 6 * sizeof(T)} * this->mArray.getFlatLength();
+            }
+
+            void calculate() override
+            {
+                const Array<T> &x = mSource.refArray();
+                const long length = x.refShape()[x.getDim() - 1];
+                Array<T> &mean = this->prepare(mMean, {length});
+                Array<T> &inverseStd = this->prepare(mInverseStd, {length});
+
+                if (mTraining)
+                {
+                    Normalization<T>::normalizeColumns(x, mScale.refArray(), mShift.refArray(), mEpsilon, this->prepare(this->mArray, x.refShape()), mean, inverseStd);
+
+                    const long rows = x.getFlatLength() / length;
+                    const T correction = rows > 1 ? static_cast<T>(rows) / (rows - 1) : 1;
+                    mRunningMean = lazy(mRunningMean) * (1 - mMomentum) + lazy(mean) * mMomentum;
+                    mRunningVariance = lazy(mRunningVariance) * (1 - mMomentum) + (T(1) / lazy(inverseStd).square() - mEpsilon) * (mMomentum * correction);
+                }
+                else
+                {
+                    mean = lazy(mRunningMean);
+                    inverseStd = T(1) / (lazy(mRunningVariance) + mEpsilon).sqrt();
+                    Normalization<T>::normalizeColumns(x, mScale.refArray(), mShift.refArray(), mEpsilon, this->prepare(this->mArray, x.refShape()), mean, inverseStd, false);
+                }
+                Unit<T>::calculate();
+            };
+        };
+
+        /// @brief Creates a batch normalization whose scale starts at one and whose shift starts at zero.
+        template <DataType T>
+        BatchNorm<T> &batchNorm(Unit<T> &source, T momentum = 0.1, T epsilon = 1e-5)
+        {
+            const long length = source.refWildcardShape().get(-1);
+            auto &scale = Coefficients<T>::create(source.getDiffTape(), Array<T>::constant({length}, 1));
+            auto &shift = Coefficients<T>::create(source.getDiffTape(), Array<T>::constant({length}, 0));
+            return BatchNorm<T>::create(source, scale, shift, momentum, epsilon);
+        }
+
         template <DataType T>
         class MeanSquaredError : public Unit<T>
         {
@@ -200,8 +486,17 @@ namespace AutoDiff
             Unit<T> &mPrediction;
             Unit<T> &mTarget;
             long mDivisor = 1;
+            Summation mSummation;
+            mutable Array<T> mBuffer = Array<T>::constant({}, 0);
 
-            MeanSquaredError(Unit<T> &prediction, Variables<T> &target) : mPrediction(prediction), mTarget(target), Unit<T>(prediction.getDiffTape(), Coordinates(0))
+            struct SquaredDifference
+            {
+                static inline T f(const T x, const T y) { return (x - y) * (x - y); }
+                static inline Simd::Vector<T> fSimd(const Simd::Vector<T> x, const Simd::Vector<T> y) { return (x - y) * (x - y); }
+                constexpr static bool ignoreSimd = !Simd::supported<T>;
+            };
+
+            MeanSquaredError(Unit<T> &prediction, Variables<T> &target, Summation summation) : Unit<T>(prediction.getDiffTape(), Coordinates(0)), mPrediction(prediction), mTarget(target), mSummation(summation)
             {
                 if (prediction.refWildcardShape() != target.refWildcardShape())
                     throw std::invalid_argument("Prediction must have the same shape as target.");
@@ -215,9 +510,10 @@ namespace AutoDiff
             }
 
         public:
-            static MeanSquaredError<T> &create(Unit<T> &prediction, Variables<T> &target)
+            /// @param summation How the squared differences are summed, see Summation. A large batch of float predictions is summed accurately with PAIRWISE or KAHAN.
+            static MeanSquaredError<T> &create(Unit<T> &prediction, Variables<T> &target, Summation summation = Summation::NAIVE)
             {
-                return *(new MeanSquaredError<T>(prediction, target));
+                return *(new MeanSquaredError<T>(prediction, target, summation));
             }
 
             std::vector<Unit<T> *> getDependencies() const override
@@ -227,14 +523,34 @@ namespace AutoDiff
 
             void pullGradient() const override
             {
-                Array<T> grad = (mPrediction.refArray() - mTarget.refArray()) * ((static_cast<T>(2) / mDivisor) * (this->mGradient));
+                const T factor = (static_cast<T>(2) / mDivisor) * this->mGradient.eval();
+                Array<T> &grad = this->prepare(mBuffer, mPrediction.refArrayShape());
+                grad = (lazy(mPrediction.refArray()) - lazy(mTarget.refArray())) * factor;
                 mPrediction.mGradient += grad;
                 mTarget.mGradient -= grad;
             }
 
+            /// The squared differences are summed in one pass over the prediction and the target
+            Roofline::Work forwardWork() const override
+            {
+                return Roofline::Work{3, 2 * sizeof(T)} * mPrediction.refArray().getFlatLength();
+            }
+
+            /// The scaled differences are written to a buffer and then added to and subtracted from the gradients
+            Roofline::Work backwardWork() const override
+            {
+                return Roofline::Work{4, 9 * sizeof(T)} * mPrediction.refArray().getFlatLength();
+            }
+
             void calculate() override
             {
-                this->mArray = (mPrediction.refArray() - mTarget.refArray()).square().reduceSum() / mDivisor;
+                const Array<T> &prediction = mPrediction.refArray();
+
+                Coordinates axes(prediction.getDim());
+                for (long i = 0; i < axes.size(); i++)
+                    axes[i] = i;
+
+                mapReduceInto<SquaredDifference>(this->prepare(this->mArray, {}), axes, mSummation, prediction, mTarget.refArray()) /= mDivisor;
                 Unit<T>::calculate();
             };
         };
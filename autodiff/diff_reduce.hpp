@@ -16,7 +16,7 @@ namespace AutoDiff
 
     public:
         ReduceSum(Unit<T> &source, const Coordinates &axes, bool keepDims = false) : mSource(source), mAxes(axes), mKeepDims(keepDims), Unit<T>(source.getDiffTape(), reduceShape(source.refWildcardShape(), axes, keepDims).reducedShape),
-                                                                                     mKeepDimsShape(mKeepDims ? Unit<T>::mWildcardShape : reduceShape(source.refWildcardShape(), axes, true).reducedShape) {}
+                                                                                     mKeepDimsShape(keepDims ? Unit<T>::mWildcardShape : reduceShape(source.refWildcardShape(), axes, true).reducedShape) {}
 
         std::vector<Unit<T> *> getDependencies() const override
         {
@@ -30,9 +30,21 @@ namespace AutoDiff
 
         void calculate() override
         {
-            this->mArray = mSource.refArray().reduceSum(mAxes, mKeepDims);
+            const Coordinates shape = reduceShape(mSource.refArrayShape(), mAxes, mKeepDims).reducedShape;
+            mSource.refArray().reduceSum(mAxes, this->prepare(this->mArray, shape));
             Unit<T>::calculate();
         };
+
+        /// One addition per entry of the source
+        Roofline::Work forwardWork() const override
+        {
+            return {(double)mSource.refArray().getFlatLength(), (double)(mSource.refArray().getFlatLength() + this->mArray.getFlatLength()) * sizeof(T)};
+        }
+
+        Roofline::Work backwardWork() const override
+        {
+            return this->streamingGradientWork(1);
+        }
     };
 
     template <DataType T>
@@ -65,13 +77,13 @@ namespace AutoDiff
             return {&mSource};
         }
 
-        void pullGradient() override
+        void pullGradient() const override
         {
             long divisor = mBaseDivisor;
             if (mReducedWildcardDim != -1)
                 divisor *= mSource.refArray().refShape()[mReducedWildcardDim];
 
-            mSource.mGradient += (this->mGradient.reshape(mKeepDimsShape)) / divisor;
+            mSource.mGradient = lazy(mSource.mGradient) + lazy(this->mGradient.reshape(mKeepDimsShape)) / static_cast<T>(divisor);
         }
 
         void calculate() override
@@ -80,9 +92,16 @@ namespace AutoDiff
             if (mReducedWildcardDim != -1)
                 divisor *= mSource.refArray().refShape()[mReducedWildcardDim];
 
-            this->mArray = mSource.refArray().reduceSum(mAxes, mKeepDims) / divisor;
+            const Coordinates shape = reduceShape(mSource.refArrayShape(), mAxes, mKeepDims).reducedShape;
+            mSource.refArray().reduceSum(mAxes, this->prepare(this->mArray, shape)) /= divisor;
             Unit<T>::calculate();
         }
+
+        /// One addition per entry of the source
+        Roofline::Work forwardWork() const override
+        {
+            return {(double)mSource.refArray().getFlatLength(), (double)(mSource.refArray().getFlatLength() + this->mArray.getFlatLength()) * sizeof(T)};
+        }
     };
 
     template <DataType T>
@@ -0,0 +1,173 @@
+#ifndef DIFF_SPARSE_H
+#define DIFF_SPARSE_H
+
+#include "diff_unit.hpp"
+#include "diff_basic.hpp"
+
+namespace AutoDiff
+{
+    /// @brief An input of shape {-1, columns} whose value is a sparse array, e.g. a batch of bag-of-words vectors. It can only be consumed by SparseMatrixProduct.
+    template <DataType T>
+    class SparseVariables : public Unit<T>
+    {
+        SparseArray<T> mSparseArray;
+
+        SparseVariables(DiffTape<T> &diffTape, long columns) : Unit<T>(diffTape, Coordinates({-1, columns})), mSparseArray(Coordinates({0, columns})) {};
+
+    public:
+        static SparseVariables<T> &create(DiffTape<T> &diffTape, long columns)
+        {
+            return *(new SparseVariables<T>(diffTape, columns));
+        }
+
+        std::vector<Unit<T> *> getDependencies() const override
+        {
+            return {};
+        }
+
+        const SparseArray<T> &refSparseArray() const { return mSparseArray; }
+
+        void setValue(const SparseArray<T> &value)
+        {
+            if (!this->wildcardMatch(value.refShape()))
+                throw std::invalid_argument("The shape of the value does not match the wildcard shape.");
+
+            mSparseArray = value.toCSR();
+            this->mDiffTape.reset();
+        }
+
+        /// The gradient of a sparse input is never needed, and the dense placeholder array is not resized to its shape
+        void resetGradient() override {}
+
+        void pullGradient() const override {};
+    };
+
+    /// @brief The product of a sparse {-1, k} input with a dense {k, n} unit, e.g. a linear layer on bag-of-words features.
+    /// @details Only the rows of right whose columns of left hold an entry receive gradient. If right are coefficients, their gradient is made row-sparse, see Coefficients<T>::setRowSparseGradient.
+    template <DataType T>
+    class SparseMatrixProduct : public Unit<T>
+    {
+        SparseVariables<T> &mLeft;
+        Unit<T> &mRight;
+
+    public:
+        SparseMatrixProduct(SparseVariables<T> &left, Unit<T> &right) : Unit<T>(left.getDiffTape(), Coordinates({-1, right.refWildcardShape()[right.getDim() - 1]})), mLeft(left), mRight(right)
+        {
+            if (right.getDim() != 2 || right.refWildcardShape()[0] != left.refWildcardShape()[1])
+                throw std::invalid_argument("The dense operand must have two axes, and its first axis must have the length of the second axis of the sparse operand.");
+
+            if (auto *pCoefficients = dynamic_cast<Coefficients<T> *>(&right))
+                pCoefficients->setRowSparseGradient(true);
+        }
+
+        std::vector<Unit<T> *> getDependencies() const override
+        {
+            return {&mLeft, &mRight};
+        }
+
+        bool reportsGradientRows() const override { return true; }
+
+        void pullGradient() const override
+        {
+            const SparseArray<T> &left = mLeft.refSparseArray();
+            left.transposedMatmul(this->mGradient, mRight.mGradient, false);
+
+            if (auto *pCoefficients = dynamic_cast<Coefficients<T> *>(&mRight))
+                pCoefficients->addGradientRows(left.nonZeroColumns());
+        }
+
+        void calculate() override
+        {
+            const SparseArray<T> &left = mLeft.refSparseArray();
+            const Array<T> &right = mRight.refArray();
+            left.matmul(right, this->prepare(this->mArray, {left.refShape()[0], right.refShape()[1]}));
+            Unit<T>::calculate();
+        };
+
+        /// Each entry of the sparse operand is multiplied with a row of the dense one
+        Roofline::Work forwardWork() const override
+        {
+            const SparseArray<T> &left = mLeft.refSparseArray();
+            const double columns = mRight.refArrayShape()[1];
+            return {2 * left.getNonZeroCount() * columns, (double)(left.getNonZeroCount() * (sizeof(T) + sizeof(long)) + mRight.refArray().getFlatLength() * sizeof(T) + this->mArray.getFlatLength() * sizeof(T))};
+        }
+
+        Roofline::Work backwardWork() const override
+        {
+            const SparseArray<T> &left = mLeft.refSparseArray();
+            const double columns = mRight.refArrayShape()[1];
+            return {2 * left.getNonZeroCount() * columns, (double)(left.getNonZeroCount() * (sizeof(T) + sizeof(long)) + 2 * mRight.refArray().getFlatLength() * sizeof(T) + this->mGradient.getFlatLength() * sizeof(T))};
+        }
+    };
+
+    /// @brief Looks up the rows of a {vocabulary, features} table for integer indices of any shape, so that the result has the shape of the indices followed by features.
+    /// @details The lookup is the product of the one-hot encoding of the indices as a sparse array with the table. The gradient of the table is row-sparse, see Coefficients<T>::setRowSparseGradient, so that Adam only updates the rows that were looked up.
+    template <DataType T>
+    class Embedding : public Unit<T>
+    {
+        Unit<T> &mIndices;
+        Coefficients<T> &mTable;
+        SparseArray<T> mSelection;
+
+    public:
+        Embedding(Unit<T> &indices, Coefficients<T> &table) : Unit<T>(indices.getDiffTape(), indices.refWildcardShape() + table.refWildcardShape()[table.getDim() - 1]), mIndices(indices), mTable(table), mSelection(Coordinates({0, table.refWildcardShape()[0]}))
+        {
+            if (table.getDim() != 2)
+                throw std::invalid_argument("The table of an embedding must have two axes.");
+
+            table.setRowSparseGradient(true);
+        }
+
+        std::vector<Unit<T> *> getDependencies() const override
+        {
+            return {&mIndices, &mTable};
+        }
+
+        bool reportsGradientRows() const override { return true; }
+
+        void pullGradient() const override
+        {
+            const Array<T> grad = this->mGradient.reshape({mSelection.refShape()[0], mTable.refArrayShape()[1]});
+            mSelection.transposedMatmul(grad, mTable.mGradient, false);
+            mTable.addGradientRows(mSelection.nonZeroColumns());
+        }
+
+        void calculate() override
+        {
+            const Array<T> &indices = mIndices.refArray();
+            const Array<T> &table = mTable.refArray();
+            mSelection = SparseArray<T>::oneHot(indices, table.refShape()[0]);
+
+            Array<T> dest = this->prepare(this->mArray, indices.refShape() + table.refShape()[1]).reshape({mSelection.refShape()[0], table.refShape()[1]});
+            mSelection.matmul(table, dest);
+            Unit<T>::calculate();
+        };
+
+        /// The lookup copies one row of the table per index, and the gradient adds one row per index
+        Roofline::Work forwardWork() const override
+        {
+            const double entries = this->mArray.getFlatLength();
+            return {2 * entries, (2 * entries + mIndices.refArray().getFlatLength()) * sizeof(T)};
+        }
+
+        Roofline::Work backwardWork() const override
+        {
+            const double entries = this->mGradient.getFlatLength();
+            return {2 * entries, 3 * entries * sizeof(T)};
+        }
+    };
+
+    template <DataType T>
+    SparseMatrixProduct<T> &matmul(SparseVariables<T> &left, Unit<T> &right)
+    {
+        return *(new SparseMatrixProduct<T>(left, right));
+    }
+
+    template <DataType T>
+    Embedding<T> &embedding(Unit<T> &indices, Coefficients<T> &table)
+    {
+        return *(new Embedding<T>(indices, table));
+    }
+}
+
+#endif
@@ -125,10 +125,43 @@ namespace AutoDiff
             mDiffTape.addVariable(this);
         }
 
+        /// @brief Makes buffer a contiguous array of the given shape whose data is not referenced elsewhere. The memory of buffer is reused if it already has that shape, so that repeated passes with the same batch size do not allocate.
+        /// @details If the data is still referenced elsewhere, e.g. by an array returned from DiffTape::getValue, a new buffer is allocated instead of copying the old entries on write.
+        /// @return A reference to buffer, whose entries are not initialized if it had to be reallocated
+        static Array<T> &prepare(Array<T> &buffer, const Coordinates &shape)
+        {
+            if (buffer.refShape() != shape || !buffer.isContiguous() || buffer.isView() || buffer.useCount() > 1)
+                buffer = Array<T>::empty(shape);
+
+            return buffer;
+        }
+
+        /// @brief The work of a single pass that reads the arrays of all dependencies, writes the result and does flopsPerEntry operations per entry of the result
+        Roofline::Work streamingWork(double flopsPerEntry) const
+        {
+            double bytes = mArray.getFlatLength() * sizeof(T);
+            for (auto dependency : getDependencies())
+                bytes += dependency->refArray().getFlatLength() * sizeof(T);
+            return {flopsPerEntry * mArray.getFlatLength(), bytes};
+        }
+
+        /// @brief The work of a single pass that reads the gradient and the arrays of all dependencies, updates their gradients and does flopsPerEntry operations per entry of each of them
+        Roofline::Work streamingGradientWork(double flopsPerEntry) const
+        {
+            Roofline::Work work{0, (double)mGradient.getFlatLength() * sizeof(T)};
+            for (auto dependency : getDependencies())
+            {
+                const double entries = dependency->refArray().getFlatLength();
+                work += {flopsPerEntry * entries, 3 * entries * sizeof(T)};
+            }
+            return work;
+        }
+
     public:
         Unit() = delete;
         Unit(const Unit<T> &other) = delete;
         Unit(Unit<T> &&other) = delete;
+        virtual ~Unit() = default;
 
         virtual std::vector<Unit<T> *> getDependencies() const = 0;
         virtual void pullGradient() const = 0;
@@ -140,7 +173,7 @@ namespace AutoDiff
             return wildcardRemovalCheck(mWildcardShape, shape);
         }
 
-        void resetGradient()
+        virtual void resetGradient()
         {
             if (mArray.refShape() == mGradient.refShape())
                 mGradient = 0; // Array<T>::constant(mArray.refShape(), 0);
@@ -150,6 +183,25 @@ namespace AutoDiff
 
         virtual void calculate() {}
 
+        /// @brief Whether only the rows listed by refGradientRows can have a nonzero gradient, see Coefficients<T>::setRowSparseGradient
+        virtual bool hasRowSparseGradient() const { return false; }
+
+        /// @brief Whether pullGradient reports the rows it writes to the gradient of a dependency with a row-sparse gradient. The tape refuses any other unit that pulls gradient into such a dependency.
+        virtual bool reportsGradientRows() const { return false; }
+
+        /// @brief The analytical work of calculate for the current shapes of the unit and its dependencies.
+        /// @details By default, a unit with dependencies counts one operation per entry of its result, see streamingWork. Units that do more per entry or that are not a single pass over their operands, e.g. matrix products, override it.
+        virtual Roofline::Work forwardWork() const
+        {
+            return getDependencies().empty() ? Roofline::Work{} : streamingWork(1);
+        }
+
+        /// @brief The analytical work of pullGradient for the current shapes. By default, one multiply-add per entry of each dependency, see streamingGradientWork.
+        virtual Roofline::Work backwardWork() const
+        {
+            return getDependencies().empty() ? Roofline::Work{} : streamingGradientWork(2);
+        }
+
         void initDiff()
         {
             mGradient = 1;
@@ -13,6 +13,7 @@
 #include <unordered_set>
 #include <utility>
 #include <optional>
+#include <typeinfo>
 
 #include "../array/array_library.hpp"
 #include "../performance.hpp"
@@ -38,6 +39,7 @@ namespace AutoDiff
         const bool mEager = false;
         long mCalcProgress = -1;
         Unit<T> *pGradientTarget = nullptr;
+        size_t mCheckedUnitCount = 0;
 
         std::vector<PerformanceMeasure> mCalcPerformanceMeasures;
         std::vector<PerformanceMeasure> mGradientPerformanceMeasures;
@@ -102,6 +104,56 @@ namespace AutoDiff
                 return std::chrono::duration_cast<std::chrono::microseconds>(mGradientPerformanceMeasures[i].accumulated);
         }
 
+    private:
+        /// @brief Calculates the i-th unit, which is timed by its performance measure and recorded by the profiler under the name of its type
+        void calculateUnit(long i)
+        {
+            Profiler::Scope scope(typeid(*mUnits[i]).name(), Profiler::Category::FORWARD);
+            if (mMeasurePerformance)
+            {
+                mCalcPerformanceMeasures[i].start();
+                mUnits[i]->calculate();
+                mCalcPerformanceMeasures[i].stop();
+            }
+            else
+                mUnits[i]->calculate();
+            scope.describe(mUnits[i]->refArrayShape(), mUnits[i]->refArray().getFlatLength() * sizeof(T));
+        }
+
+        /// @brief Checks the units of the tape before a gradient pass, but only again if units were added since the last check
+        void checkRowSparseConsumers()
+        {
+            if (mCheckedUnitCount == mUnits.size())
+                return;
+
+            checkRowSparseConsumers(mUnits);
+            mCheckedUnitCount = mUnits.size();
+        }
+
+        void pullUnitGradient(long i)
+        {
+            Profiler::Scope scope(typeid(*mUnits[i]).name(), Profiler::Category::BACKWARD, mUnits[i]->refArrayShape(), mUnits[i]->refArray().getFlatLength() * sizeof(T));
+            if (mMeasurePerformance)
+            {
+                mGradientPerformanceMeasures[i].start();
+                mUnits[i]->pullGradient();
+                mGradientPerformanceMeasures[i].stop();
+            }
+            else
+                mUnits[i]->pullGradient();
+        }
+
+    public:
+        /// @brief Throws if one of the units pulls gradient into a dependency with a row-sparse gradient without reporting the rows, since resetGradient would never clear them, see Unit<T>::reportsGradientRows
+        static void checkRowSparseConsumers(const std::vector<Unit<T> *> &units)
+        {
+            for (auto *pUnit : units)
+                if (!pUnit->reportsGradientRows())
+                    for (auto *pDependency : pUnit->getDependencies())
+                        if (pDependency->hasRowSparseGradient())
+                            throw std::logic_error("Coefficients with a row-sparse gradient are used by a unit that does not report the rows it pulls gradient into.");
+        }
+
         void addVariable(Unit<T> *px)
         {
             mOrder[px] = mUnits.size();
@@ -115,7 +167,7 @@ namespace AutoDiff
             if (mCalcProgress < position)
             {
                 for (long i = mCalcProgress + 1; i <= position; i++)
-                    mUnits[i]->calculate();
+                    calculateUnit(i);
                 mCalcProgress = position;
             }
 
@@ -131,17 +183,11 @@ namespace AutoDiff
             {
                 // std::cout << "Calculating unit " << typeid(*mUnits[i]).name() << std::endl;
                 // std::cout << mUnits[i]->refWildcardShape() << std::endl;
-                if (mMeasurePerformance)
-                {
-                    mCalcPerformanceMeasures[i].start();
-                    mUnits[i]->calculate();
-                    mCalcPerformanceMeasures[i].stop();
-                }
-                else
-                    mUnits[i]->calculate();
+                calculateUnit(i);
             }
             mCalcProgress = mUnits.size();
 
+            checkRowSparseConsumers();
             pGradientTarget = &target;
             for (long i = mUnits.size() - 1; i >= 0; i--)
                 mUnits[i]->resetGradient();
@@ -150,14 +196,7 @@ namespace AutoDiff
 
             for (long i = mUnits.size() - 1; i >= 0; i--)
             {
-                if (mMeasurePerformance)
-                {
-                    mGradientPerformanceMeasures[i].start();
-                    mUnits[i]->pullGradient();
-                    mGradientPerformanceMeasures[i].stop();
-                }
-                else
-                    mUnits[i]->pullGradient();
+                pullUnitGradient(i);
             }
         }
 
@@ -172,14 +211,7 @@ namespace AutoDiff
                 {
                     // std::cout << "Calculating unit " << typeid(*mUnits[i]).name() << std::endl;
                     // std::cout << mUnits[i]->redWildcardShape() << std::endl;
-                    if (mMeasurePerformance)
-                    {
-                        mCalcPerformanceMeasures[i].start();
-                        mUnits[i]->calculate();
-                        mCalcPerformanceMeasures[i].stop();
-                    }
-                    else
-                        mUnits[i]->calculate();
+                    calculateUnit(i);
                 }
                 mCalcProgress = outputPosition;
             }
@@ -189,6 +221,7 @@ namespace AutoDiff
 
             if (pGradientTarget != &output)
             {
+                checkRowSparseConsumers();
                 pGradientTarget = &output;
                 for (long i = outputPosition; i >= 0; i--)
                     mUnits[i]->resetGradient();
@@ -197,14 +230,7 @@ namespace AutoDiff
 
                 for (long i = outputPosition; i >= 0; i--)
                 {
-                    if (mMeasurePerformance)
-                    {
-                        mGradientPerformanceMeasures[i].start();
-                        mUnits[i]->pullGradient();
-                        mGradientPerformanceMeasures[i].stop();
-                    }
-                    else
-                        mUnits[i]->pullGradient();
+                    pullUnitGradient(i);
                 }
             }
 
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <unordered_set>
+#include <typeinfo>
 
 #include "diff_unit.hpp"
 #include "diff_matmul.hpp"
@@ -28,8 +29,31 @@ namespace AutoDiff
 
             std::vector<PerformanceMeasure> mCalcPerformanceMeasures;
             std::vector<PerformanceMeasure> mGradientPerformanceMeasures;
+            std::vector<Roofline::Work> mCalcWork;
+            std::vector<Roofline::Work> mGradientWork;
+            std::vector<double> mMeasuredEntries;
+            long mMeasuredPasses = 0;
             bool mMeasurePerformance = false;
 
+            /// @brief The demangled type of the unit without the namespaces of the library
+            static std::string shortUnitName(const Unit<T> &unit)
+            {
+                std::string name = Profiler::demangle(typeid(unit).name());
+                for (const std::string prefix : {"AutoDiff::NeuralNetworks::", "AutoDiff::"})
+                    if (name.starts_with(prefix))
+                        name = name.substr(prefix.size());
+                return name;
+            }
+
+            /// @brief The entries of the result or of the largest operand of the unit, whichever has more, which the misses of the unit are reported per
+            static double processedEntries(const Unit<T> &unit)
+            {
+                long entries = unit.refArray().getFlatLength();
+                for (auto dependency : unit.getDependencies())
+                    entries = std::max(entries, dependency->refArray().getFlatLength());
+                return entries;
+            }
+
             static void gatherRecursion(Unit<T> &unit, std::unordered_set<Unit<T> *> &visited, std::vector<Unit<T> *> &units)
             {
                 for (auto dependency : unit.getDependencies())
@@ -84,6 +108,9 @@ namespace AutoDiff
                 {
                     mCalcPerformanceMeasures.resize(mUnits.size(), PerformanceMeasure());
                     mGradientPerformanceMeasures.resize(mUnits.size(), PerformanceMeasure());
+                    mCalcWork.resize(mUnits.size());
+                    mGradientWork.resize(mUnits.size());
+                    mMeasuredEntries.resize(mUnits.size());
                 }
             }
 
@@ -112,6 +139,115 @@ namespace AutoDiff
                     return std::chrono::duration_cast<std::chrono::microseconds>(mGradientPerformanceMeasures[i].accumulated);
             }
 
+            /// @brief The hardware counters of the forward passes of unit i while performance was measured, see HardwareCounters
+            HardwareCounters::Values getCalcCounters(int i) const
+            {
+                if (!mMeasurePerformance)
+                    throw std::logic_error("Performance measurement is not enabled.");
+                else if (i < 0 || i >= mCalcPerformanceMeasures.size())
+                    throw std::out_of_range("Index out of range.");
+                else
+                    return mCalcPerformanceMeasures[i].counters.accumulated;
+            }
+
+            HardwareCounters::Values getGradientCounters(int i) const
+            {
+                if (!mMeasurePerformance)
+                    throw std::logic_error("Performance measurement is not enabled.");
+                else if (i < 0 || i >= mGradientPerformanceMeasures.size())
+                    throw std::out_of_range("Index out of range.");
+                else
+                    return mGradientPerformanceMeasures[i].counters.accumulated;
+            }
+
+            /// @brief The analytical work of the forward passes of unit i while performance was measured, see Unit<T>::forwardWork
+            Roofline::Work getCalcWork(int i) const
+            {
+                if (!mMeasurePerformance)
+                    throw std::logic_error("Performance measurement is not enabled.");
+                else if (i < 0 || i >= (long)mCalcWork.size())
+                    throw std::out_of_range("Index out of range.");
+                else
+                    return mCalcWork[i];
+            }
+
+            /// @brief The analytical work of the backward passes of unit i while performance was measured, see Unit<T>::backwardWork
+            Roofline::Work getGradientWork(int i) const
+            {
+                if (!mMeasurePerformance)
+                    throw std::logic_error("Performance measurement is not enabled.");
+                else if (i < 0 || i >= (long)mGradientWork.size())
+                    throw std::out_of_range("Index out of range.");
+                else
+                    return mGradientWork[i];
+            }
+
+            /// @brief The number of forward passes while performance was measured
+            long getMeasuredPasses() const { return mMeasuredPasses; }
+
+            /// @brief Writes a roofline report with a row for the forward and the backward pass of each unit, with the time and work per pass, the attained GFLOP/s and GB/s, the arithmetic intensity and the percentage of the rate the machine peak allows at that intensity.
+            /// @details If the profiler recorded matmul, pointwise or reduce kernels since it was last cleared, their totals are reported per pass as well, so it should be cleared when measurement starts.
+            void writeRooflineReport(std::ostream &s, const Roofline::MachinePeak &peak = Roofline::machinePeak()) const
+            {
+                if (!mMeasurePerformance)
+                    throw std::logic_error("Performance measurement is not enabled.");
+
+                const double passes = std::max(1l, mMeasuredPasses);
+                Roofline::writeHeader(s, peak);
+
+                double totalSeconds = 0;
+                Roofline::Work totalWork;
+                for (long i = 0; i < (long)mUnits.size(); i++)
+                {
+                    // Inputs and coefficients do no work of their own
+                    if (mCalcWork[i].bytes == 0 && mGradientWork[i].bytes == 0)
+                        continue;
+
+                    const std::string name = shortUnitName(*mUnits[i]);
+                    const double calcSeconds = std::chrono::duration<double>(mCalcPerformanceMeasures[i].accumulated).count() / passes;
+                    const double gradientSeconds = std::chrono::duration<double>(mGradientPerformanceMeasures[i].accumulated).count() / passes;
+                    Roofline::writeRow(s, name + " forward", calcSeconds, mCalcWork[i] * (1 / passes), peak);
+                    Roofline::writeRow(s, name + " backward", gradientSeconds, mGradientWork[i] * (1 / passes), peak);
+                    totalSeconds += calcSeconds + gradientSeconds;
+                    totalWork += (mCalcWork[i] + mGradientWork[i]) * (1 / passes);
+                }
+                Roofline::writeRow(s, "total", totalSeconds, totalWork, peak);
+
+                for (Profiler::Category category : {Profiler::Category::MATMUL, Profiler::Category::POINTWISE, Profiler::Category::REDUCE})
+                {
+                    const Profiler::Totals &totals = Profiler::totals(category);
+                    if (totals.events > 0)
+                        Roofline::writeRow(s, std::string(Profiler::categoryName(category)) + " kernels", totals.nanoseconds * 1e-9 / passes, Roofline::Work{(double)totals.flops, (double)totals.bytes} * (1 / passes), peak);
+                }
+            }
+
+            /// @brief Writes the hardware counters of the forward and the backward pass of each unit next to their times: cycles per pass, instructions per cycle, and LLC, L1D and branch misses per entry, see processedEntries.
+            /// @details The counters have to be enabled while performance is measured, see HardwareCounters::setEnabled. They only count the thread that runs the passes, not the workers of the thread pool. If they are not available, the report says why.
+            void writeCounterReport(std::ostream &s) const
+            {
+                if (!mMeasurePerformance)
+                    throw std::logic_error("Performance measurement is not enabled.");
+
+                if (!HardwareCounters::isAvailable())
+                    s << "Hardware counters are unavailable: " << HardwareCounters::refError() << "\n";
+                else if (!HardwareCounters::isEnabled())
+                    s << "Hardware counters are not enabled.\n";
+
+                const double passes = std::max(1l, mMeasuredPasses);
+                HardwareCounters::writeHeader(s);
+                for (long i = 0; i < (long)mUnits.size(); i++)
+                {
+                    if (mUnits[i]->getDependencies().empty())
+                        continue;
+
+                    const std::string name = shortUnitName(*mUnits[i]);
+                    const double calcMicroseconds = std::chrono::duration<double, std::micro>(mCalcPerformanceMeasures[i].accumulated).count();
+                    const double gradientMicroseconds = std::chrono::duration<double, std::micro>(mGradientPerformanceMeasures[i].accumulated).count();
+                    HardwareCounters::writeRow(s, name + " forward", calcMicroseconds, mCalcPerformanceMeasures[i].counters.accumulated, passes, mMeasuredEntries[i]);
+                    HardwareCounters::writeRow(s, name + " backward", gradientMicroseconds, mGradientPerformanceMeasures[i].counters.accumulated, passes, mMeasuredEntries[i]);
+                }
+            }
+
             Model(const std::vector<Variables<T> *> &variables, Unit<T> &cost, OPT optimizer) : mVariables(variables), mCost(cost), mUnits(std::move(gatherUnits(cost))), mOptimizer(optimizer)
             {
                 if (variables.size() == 0)
@@ -122,6 +258,8 @@ namespace AutoDiff
                         throw std::invalid_argument("Variables must have a wildcard dimension.");
                 }
 
+                DiffTape<T>::checkRowSparseConsumers(mUnits);
+
                 for (auto unit : mUnits)
                 {
                     if (auto *coefficients = dynamic_cast<Coefficients<T> *>(unit))
@@ -137,21 +275,25 @@ namespace AutoDiff
 
             inline Unit<T> &forwardPass()
             {
-                if (mMeasurePerformance)
+                for (long i = 0; i < (long)mUnits.size(); i++)
                 {
-                    for (long i = 0; i < mUnits.size(); i++)
+                    Profiler::Scope scope(typeid(*mUnits[i]).name(), Profiler::Category::FORWARD);
+                    if (mMeasurePerformance)
                     {
                         mCalcPerformanceMeasures[i].start();
                         mUnits[i]->calculate();
                         mCalcPerformanceMeasures[i].stop();
+                        mCalcWork[i] += mUnits[i]->forwardWork();
+                        mMeasuredEntries[i] += processedEntries(*mUnits[i]);
                     }
-                }
-                else
-                {
-                    for (long i = 0; i < mUnits.size(); i++)
+                    else
                         mUnits[i]->calculate();
+                    scope.describe(mUnits[i]->refArrayShape(), mUnits[i]->refArray().getFlatLength() * sizeof(T));
                 }
 
+                if (mMeasurePerformance)
+                    mMeasuredPasses++;
+
                 return mCost;
             }
 
@@ -162,22 +304,37 @@ namespace AutoDiff
 
                 mCost.initDiff();
 
-                if (mMeasurePerformance)
+                for (long i = mUnits.size() - 1; i >= 0; i--)
                 {
-                    for (long i = mUnits.size() - 1; i >= 0; i--)
+                    Profiler::Scope scope(typeid(*mUnits[i]).name(), Profiler::Category::BACKWARD, mUnits[i]->refArrayShape(), mUnits[i]->refArray().getFlatLength() * sizeof(T));
+                    if (mMeasurePerformance)
                     {
                         mGradientPerformanceMeasures[i].start();
                         mUnits[i]->pullGradient();
                         mGradientPerformanceMeasures[i].stop();
+                        mGradientWork[i] += mUnits[i]->backwardWork();
                     }
-                }
-                else
-                {
-                    for (long i = mUnits.size() - 1; i >= 0; i--)
+                    else
                         mUnits[i]->pullGradient();
                 }
             }
 
+            /// @brief Performs one training step on the samples batchStart, ..., batchEnd - 1 of the variable values: a forward and a backward pass followed by an update of the optimizer.
+            /// @return The cost of the batch before the update
+            T trainStep(const std::vector<Array<T>> &variableValues, long batchStart, long batchEnd, T learningRate = 1e-3)
+            {
+                Profiler::Scope stepScope("training step", Profiler::Category::STEP);
+                setVariables(variableValues, batchStart, batchEnd);
+                passMeasure.start();
+                forwardPass();
+                backwardPass();
+                passMeasure.stop();
+                optMeasure.start();
+                mOptimizer.update(learningRate);
+                optMeasure.stop();
+                return mCost.refArray().eval();
+            }
+
             void fit(const std::vector<Array<T>> &variableValues, long epochs, long batchSize, T learningRate = 1e-3, bool verbose = true)
             {
                 if (variableValues.size() != mVariables.size())
@@ -189,6 +346,9 @@ namespace AutoDiff
                         throw std::invalid_argument("The number of samples must be the same for all variable values.");
 
                 T totalCost = 0;
+#ifdef DEBUG_MODE
+                long previousBatchLength = -1;
+#endif
 
                 for (long epoch = 0; epoch < epochs; epoch++)
                 {
@@ -196,15 +356,16 @@ namespace AutoDiff
                     for (long batchStart = 0; batchStart < sampleSize; batchStart += batchSize)
                     {
                         long batchEnd = std::min(batchStart + batchSize, sampleSize);
-                        setVariables(variableValues, batchStart, batchEnd);
-                        passMeasure.start();
-                        forwardPass();
-                        backwardPass();
-                        passMeasure.stop();
-                        optMeasure.start();
-                        mOptimizer.update(learningRate);
-                        optMeasure.stop();
-                        totalCost += mCost.refArray().eval();
+#ifdef DEBUG_MODE
+                        const size_t allocations = allocationCounter;
+#endif
+                        const T cost = trainStep(variableValues, batchStart, batchEnd, learningRate);
+#ifdef DEBUG_MODE
+                        // Once all buffers have been sized for a batch length, further steps with that length must reuse them.
+                        assertm(previousBatchLength != batchEnd - batchStart || allocationCounter == allocations, "A training step with an unchanged batch length should not allocate.");
+                        previousBatchLength = batchEnd - batchStart;
+#endif
+                        totalCost += cost;
 
                         if (verbose && batchStart % 256 < batchSize)
                         {
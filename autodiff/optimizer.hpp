@@ -33,9 +33,12 @@ namespace AutoDiff
 
         void update(T learningRate) override
         {
+            Profiler::Scope scope("SGD::update", Profiler::Category::OPTIMIZER);
+
             for (Coefficients<T> *coefficients : mCoefficientsList)
             {
-                coefficients->refCoefficientArray() -= learningRate * coefficients->refGradient();
+                auto &w = coefficients->refCoefficientArray();
+                w = lazy(w) - learningRate * lazy(coefficients->refGradient());
             }
         }
     };
@@ -138,7 +141,9 @@ namespace AutoDiff
 
         void update(T learningRate) override
         {
-            for (UnitData data : mUnitDataList)
+            Profiler::Scope scope("Adam::update", Profiler::Category::OPTIMIZER);
+
+            for (UnitData &data : mUnitDataList)
             {
                 data.step++;
                 const auto &g = data.coefficients.refGradient();
@@ -148,12 +153,31 @@ namespace AutoDiff
                 T beta2Pow = std::pow(beta2, data.step);
                 T gamma2 = (1 - beta2) / (1 - beta2Pow);
 
-                computeInPlace<FirstMomentCombo, true, true>(FirstMomentCombo(gamma1), data.firstMoment, data.firstMoment, g);
-                computeInPlace<SecondMomentCombo, true, true>(SecondMomentCombo(gamma2), data.secondMoment, data.secondMoment, g);
                 auto &w = data.coefficients.refCoefficientArray();
-                computeInPlace<UpdateWeights, true, true, true>(UpdateWeights(learningRate, epsilon), w, w, data.firstMoment, data.secondMoment);
+                if (data.coefficients.hasRowSparseGradient())
+                {
+                    // Lazy update: the moments and weights of rows without gradient are left as they are, so that the cost only depends on the number of rows that were used
+                    w.ensureUnique();
+                    for (long row : data.coefficients.refGradientRows())
+                    {
+                        Array<T> wRow = w.sliceAxis(0, row, row + 1);
+                        Array<T> firstMomentRow = data.firstMoment.sliceAxis(0, row, row + 1);
+                        Array<T> secondMomentRow = data.secondMoment.sliceAxis(0, row, row + 1);
+                        updateMoments(gamma1, gamma2, learningRate, wRow, firstMomentRow, secondMomentRow, g.sliceAxis(0, row, row + 1));
+                    }
+                }
+                else
+                    updateMoments(gamma1, gamma2, learningRate, w, data.firstMoment, data.secondMoment, g);
             }
         }
+
+    private:
+        void updateMoments(T gamma1, T gamma2, T learningRate, Array<T> &w, Array<T> &firstMoment, Array<T> &secondMoment, const Array<T> &g)
+        {
+            computeInPlace<FirstMomentCombo, true, true>(FirstMomentCombo(gamma1), firstMoment, firstMoment, g);
+            computeInPlace<SecondMomentCombo, true, true>(SecondMomentCombo(gamma2), secondMoment, secondMoment, g);
+            computeInPlace<UpdateWeights, true, true, true>(UpdateWeights(learningRate, epsilon), w, w, firstMoment, secondMoment);
+        }
     };
 
     template <DataType T>
@@ -184,7 +208,9 @@ namespace AutoDiff
 
         void update(T learningRate) override
         {
-            for (UnitData data : mUnitDataList)
+            Profiler::Scope scope("NaiveAdam::update", Profiler::Category::OPTIMIZER);
+
+            for (UnitData &data : mUnitDataList)
             {
                 data.step++;
                 const auto &g = data.coefficients.refGradient();
@@ -194,10 +220,12 @@ namespace AutoDiff
                 T beta2Pow = std::pow(beta2, data.step);
                 T gamma2 = (1 - beta2) / (1 - beta2Pow);
 
-                data.firstMoment = (1 - gamma1) * data.firstMoment + gamma1 * g;
-                data.secondMoment = (1 - gamma2) * data.secondMoment + gamma2 * g.square();
+                // Each line is evaluated lazily as a single fused pass over the arrays.
+                data.firstMoment = (1 - gamma1) * lazy(data.firstMoment) + gamma1 * lazy(g);
+                data.secondMoment = (1 - gamma2) * lazy(data.secondMoment) + gamma2 * lazy(g).square();
 
-                data.coefficients.refCoefficientArray() -= learningRate * data.firstMoment / (data.secondMoment.sqrt() + epsilon);
+                auto &w = data.coefficients.refCoefficientArray();
+                w = lazy(w) - learningRate * lazy(data.firstMoment) / (lazy(data.secondMoment).sqrt() + epsilon);
             }
         }
     };
@@ -0,0 +1,346 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cassert>
+
+#define assertm(exp, msg) assert((void(msg), exp))
+
+#include "array/array_library.hpp"
+#include "autodiff/autodiff.hpp"
+#include "benchmark.hpp"
+
+using namespace ArrayLibrary;
+using namespace AutoDiff;
+using namespace AutoDiff::NeuralNetworks;
+
+/// The floating point operations of a product of operands of the given shapes along their last two axes, counting a multiply-add as two
+double matmulFlops(const Coordinates &leftShape, const Coordinates &rightShape)
+{
+    const long dim = leftShape.size();
+    double flops = 2.0 * leftShape[dim - 2] * leftShape[dim - 1] * rightShape[dim - 1];
+    for (long i = 0; i < dim - 2; i++)
+        flops *= std::max(leftShape[i], rightShape[i]);
+    return flops;
+}
+
+/// Registers a product of operands of the given shapes. If transposeLeft is set, left is created with its last two axes swapped and transposed back, so that the product axis of left is not contiguous. The rate of a Strassen product is that of the conventional product it replaces.
+template <DataType T>
+void addMatmul(Benchmark::Suite &suite, const std::string &name, const Coordinates &leftShape, const Coordinates &rightShape, bool transposeLeft = false, bool multiThread = false, bool strassen = false)
+{
+    suite.add("matmul/" + name, [=]
+              {
+                  RandomArrayGenerator generator(0);
+                  const long dim = leftShape.size();
+                  Coordinates storedShape = leftShape;
+                  if (transposeLeft)
+                      std::swap(storedShape[dim - 2], storedShape[dim - 1]);
+                  Array<T> left = generator.normal<T>(storedShape, 0, 1);
+                  if (transposeLeft)
+                      left = left.transpose(dim - 2, dim - 1);
+                  Array<T> right = generator.normal<T>(rightShape, 0, 1);
+                  Matmul::MatmulSettings settings;
+                  settings.multiThread = multiThread;
+                  settings.strassen = strassen;
+                  Array<T> dest = Matmul::matmul<T>(left, right, settings);
+                  return std::function<void()>([=]() mutable
+                                               { Matmul::matmul<T>(left, right, &dest, settings); }); }, matmulFlops(leftShape, rightShape));
+}
+
+/// Registers the three products of a dense layer with the given numbers of inputs and outputs: the forward product of the input with the weights, and the two products of the backward pass with the transposed weights and the transposed input, which accumulate into the gradients as in MatrixProduct::pullGradient. All three take the same number of operations, so their rates are comparable.
+template <DataType T>
+void addDenseLayer(Benchmark::Suite &suite, long batchSize, long inputs, long outputs)
+{
+    const std::string name = "matmul/dense " + std::to_string(inputs) + "->" + std::to_string(outputs) + " batch " + std::to_string(batchSize);
+    const double flops = 2.0 * batchSize * inputs * outputs;
+
+    auto add = [&](const std::string &product, bool transposeLeft, bool transposeRight)
+    {
+        suite.add(name + " " + product, [=]
+                  {
+                      RandomArrayGenerator generator(0);
+                      Array<T> input = generator.normal<T>({batchSize, inputs}, 0, 1);
+                      Array<T> weights = generator.normal<T>({inputs, outputs}, 0, 1);
+                      Array<T> gradient = generator.normal<T>({batchSize, outputs}, 0, 1);
+                      Matmul::MatmulSettings settings;
+                      settings.transposeLeft = transposeLeft;
+                      settings.transposeRight = transposeRight;
+                      settings.setzero = !transposeLeft && !transposeRight;
+                      const Array<T> left = transposeRight ? gradient : input;
+                      const Array<T> right = transposeLeft ? gradient : weights;
+                      Array<T> dest = Matmul::matmul<T>(left, right, settings);
+                      return std::function<void()>([=]() mutable
+                                                   { Matmul::matmul<T>(left, right, &dest, settings); }); }, flops);
+    };
+    add("forward", false, false);
+    add("backward input", false, true);
+    add("backward weights", true, false);
+}
+
+template <DataType T>
+void addPointwise(Benchmark::Suite &suite, const std::string &name, const Coordinates &leftShape, const Coordinates &rightShape)
+{
+    suite.add("pointwise/" + name, [=]
+              {
+                  RandomArrayGenerator generator(0);
+                  Array<T> left = generator.normal<T>(leftShape, 0, 1);
+                  Array<T> right = generator.normal<T>(rightShape, 0, 1);
+                  Array<T> dest = left + right;
+                  return std::function<void()>([=]() mutable
+                                               { computeInPlace<Addition<T>>(dest, left, right); }); });
+}
+
+template <DataType T>
+void addReduce(Benchmark::Suite &suite, const std::string &name, const Coordinates &shape, const Coordinates &axes, Summation summation = Summation::NAIVE)
+{
+    suite.add("reduce/" + name, [=]
+              {
+                  RandomArrayGenerator generator(0);
+                  Array<T> source = generator.normal<T>(shape, 0, 1);
+                  Array<T> dest = source.reduceSum(axes);
+                  return std::function<void()>([=]() mutable
+                                               { source.reduceSum(axes, dest, false, summation); }); });
+}
+
+/// The sum of the products of two arrays, once with mapReduce and once with the products written to a buffer first
+template <DataType T>
+void addMapReduce(Benchmark::Suite &suite, const std::string &name, const Coordinates &shape, const Coordinates &axes)
+{
+    suite.add("reduce/fused product " + name, [=]
+              {
+                  RandomArrayGenerator generator(0);
+                  Array<T> left = generator.normal<T>(shape, 0, 1);
+                  Array<T> right = generator.normal<T>(shape, 0, 1);
+                  Array<T> dest = left.reduceSum(axes);
+                  return std::function<void()>([=]() mutable
+                                               { mapReduceInto<Multiplication<T>>(dest, axes, Summation::NAIVE, left, right); }); });
+    suite.add("reduce/materialized product " + name, [=]
+              {
+                  RandomArrayGenerator generator(0);
+                  Array<T> left = generator.normal<T>(shape, 0, 1);
+                  Array<T> right = generator.normal<T>(shape, 0, 1);
+                  Array<T> products = left * right;
+                  Array<T> dest = left.reduceSum(axes);
+                  return std::function<void()>([=]() mutable
+                                               {
+                                                   computeInPlace<Multiplication<T>>(products, left, right);
+                                                   products.reduceSum(axes, dest); }); });
+}
+
+template <DataType T>
+void addSearches(Benchmark::Suite &suite)
+{
+    auto logits = []
+    { return RandomArrayGenerator(0).normal<T>({4096, 1000}, 0, 1); };
+    suite.add("search/argMax along rows of {4096, 1000}", [=]
+              {
+                  Array<T> source = logits();
+                  return std::function<void()>([=]()
+                                               { source.argMax(1); }); });
+    suite.add("search/argMax along columns of {4096, 1000}", [=]
+              {
+                  Array<T> source = logits();
+                  return std::function<void()>([=]()
+                                               { source.argMax(0); }); });
+    suite.add("search/top 5 along rows of {4096, 1000}", [=]
+              {
+                  Array<T> source = logits();
+                  return std::function<void()>([=]()
+                                               { source.topK(5, 1); }); });
+    suite.add("search/findNonZero of {4096, 1000} at 10%", [=]
+              {
+                  Array<T> source = RandomArrayGenerator(0).bernoulli<T>({4096, 1000}, 0.1);
+                  return std::function<void()>([=]()
+                                               { source.findNonZero(); }); });
+}
+
+/// The units of the suite live on tapes that are kept alive by the timed functions
+template <DataType T>
+void addUnits(Benchmark::Suite &suite)
+{
+    suite.add("unit/softmax forward {256, 1000}", []
+              {
+                  auto pTape = std::make_shared<DiffTape<T>>();
+                  auto &input = Variables<T>::create(*pTape, {-1, 1000});
+                  auto &unit = softmax(input, {1});
+                  input.setValue(RandomArrayGenerator(0).normal<T>({256, 1000}, 0, 1));
+                  return std::function<void()>([pTape, &unit]
+                                               { unit.calculate(); }); });
+
+    suite.add("unit/softmax backward {256, 1000}", []
+              {
+                  auto pTape = std::make_shared<DiffTape<T>>();
+                  auto &input = Variables<T>::create(*pTape, {-1, 1000});
+                  auto &unit = softmax(input, {1});
+                  input.setValue(RandomArrayGenerator(0).normal<T>({256, 1000}, 0, 1));
+                  unit.calculate();
+                  input.resetGradient();
+                  unit.mGradient = RandomArrayGenerator(1).normal<T>({256, 1000}, 0, 1);
+                  return std::function<void()>([pTape, &unit]
+                                               { unit.pullGradient(); }); });
+
+    suite.add("unit/adam update 1M coefficients", []
+              {
+                  auto pTape = std::make_shared<DiffTape<T>>();
+                  auto &coefficients = Coefficients<T>::create(*pTape, RandomArrayGenerator(0).normal<T>({1000, 1000}, 0, 1));
+                  coefficients.mGradient = RandomArrayGenerator(1).normal<T>({1000, 1000}, 0, 1);
+                  auto pAdam = std::make_shared<Adam<T>>();
+                  pAdam->addUnit(coefficients);
+                  return std::function<void()>([pTape, pAdam]
+                                               { pAdam->update(T(1e-3)); }); });
+}
+
+/// A training step of the model of Test::mnistModel on a batch of synthetic data of the shape of MNIST, so that the benchmark does not depend on the data set being present
+template <DataType T>
+void addTrainingStep(Benchmark::Suite &suite, long batchSize)
+{
+    suite.add("model/mnist training step batch " + std::to_string(batchSize), [batchSize]
+              {
+                  using LayerSettings = LinearLayer<T>::template Settings<T>;
+                  using Activation = LinearLayer<T>::Activation;
+
+                  auto pTape = std::make_shared<DiffTape<T>>();
+                  auto &input = Variables<T>::create(*pTape, {-1, 784});
+                  auto &labels = Variables<T>::create(*pTape, {-1, 10});
+                  auto layer1 = LinearLayer<T>::create(input, LayerSettings(200, Activation::LEAKYRELU, T(0.01)));
+                  auto layer2 = LinearLayer<T>::create(layer1, LayerSettings(10, Activation::NONE, T(0.01)));
+                  auto &sftm = Softermax<T>::create(layer2, {-1});
+                  auto &cost = MeanSquaredError<T>::create(sftm, labels);
+
+                  RandomArrayGenerator generator(0);
+                  std::vector<Array<T>> values = {generator.uniform<T>({batchSize, 784}, 0, 1), generator.uniform<T>({batchSize, 10}, 0, 1)};
+                  auto pModel = std::make_shared<Model<T, Adam<T>>>(std::vector<Variables<T> *>{&input, &labels}, cost, Adam<T>());
+                  return std::function<void()>([pTape, pModel, values, batchSize]
+                                               { pModel->trainStep(values, 0, batchSize); }); });
+}
+
+template <DataType T>
+Benchmark::Suite createSuite()
+{
+    Benchmark::Suite suite;
+
+    addMatmul<T>(suite, "square 256", {256, 256}, {256, 256});
+    addMatmul<T>(suite, "square 512 multithreaded", {512, 512}, {512, 512}, false, true);
+    addMatmul<T>(suite, "skinny {4096, 64} x {64, 64}", {4096, 64}, {64, 64});
+    addMatmul<T>(suite, "matrix-vector {1, 1024} x {1024, 1024}", {1, 1024}, {1024, 1024});
+    addMatmul<T>(suite, "batched {32, 64, 64} x {32, 64, 64}", {32, 64, 64}, {32, 64, 64});
+    addMatmul<T>(suite, "batched small {4096, 16, 16} x {4096, 16, 16}", {4096, 16, 16}, {4096, 16, 16});
+    addMatmul<T>(suite, "batched small {4096, 8, 16} x {4096, 16, 8} multithreaded", {4096, 8, 16}, {4096, 16, 8}, false, true);
+    addMatmul<T>(suite, "transposed left 256", {256, 256}, {256, 256}, true);
+    addMatmul<T>(suite, "square 2048", {2048, 2048}, {2048, 2048});
+    addMatmul<T>(suite, "square 2048 strassen", {2048, 2048}, {2048, 2048}, false, false, true);
+    addDenseLayer<T>(suite, 128, 784, 200);
+    addDenseLayer<T>(suite, 128, 200, 10);
+
+    addPointwise<T>(suite, "same shape {1024, 1024}", {1024, 1024}, {1024, 1024});
+    addPointwise<T>(suite, "row broadcast {1024, 1024} + {1024}", {1024, 1024}, {1024});
+    addPointwise<T>(suite, "column broadcast {1024, 1024} + {1024, 1}", {1024, 1024}, {1024, 1});
+    addPointwise<T>(suite, "outer {1024, 1} + {1, 1024}", {1024, 1}, {1, 1024});
+
+    addReduce<T>(suite, "axis 0 of {256, 256, 64}", {256, 256, 64}, {0});
+    addReduce<T>(suite, "axis 1 of {256, 256, 64}", {256, 256, 64}, {1});
+    addReduce<T>(suite, "axis 2 of {256, 256, 64}", {256, 256, 64}, {2});
+    addReduce<T>(suite, "all axes of {256, 256, 64}", {256, 256, 64}, {0, 1, 2});
+    addReduce<T>(suite, "all axes of {256, 256, 64} pairwise", {256, 256, 64}, {0, 1, 2}, Summation::PAIRWISE);
+    addReduce<T>(suite, "all axes of {256, 256, 64} kahan", {256, 256, 64}, {0, 1, 2}, Summation::KAHAN);
+    addReduce<T>(suite, "axis 2 of {256, 256, 64} pairwise", {256, 256, 64}, {2}, Summation::PAIRWISE);
+    addReduce<T>(suite, "axis 2 of {256, 256, 64} kahan", {256, 256, 64}, {2}, Summation::KAHAN);
+
+    addMapReduce<T>(suite, "axis 0 of {256, 256, 64}", {256, 256, 64}, {0});
+    addMapReduce<T>(suite, "axis 2 of {256, 256, 64}", {256, 256, 64}, {2});
+    addMapReduce<T>(suite, "all axes of {256, 256, 64}", {256, 256, 64}, {0, 1, 2});
+
+    addSearches<T>(suite);
+
+    addUnits<T>(suite);
+    addTrainingStep<T>(suite, 16);
+    addTrainingStep<T>(suite, 128);
+
+    return suite;
+}
+
+/// Usage: benchmark [--filter=text] [--samples=n] [--warmup=n] [--min-sample-ms=n] [--cpus=0-3] [--json=path] [--baseline=path] [--threshold=0.1] [--autotune[=path]]
+/// Exits with status 1 if a benchmark regressed against the baseline.
+/// With --autotune, matrix products are autotuned while the benchmarks calibrate, see Matmul::Autotuner. If a path is given, the table is loaded from it if it exists and saved to it afterwards.
+/// Called by main in benchmark_main.cpp.
+int runBenchmarks(int argc, char **argv)
+{
+    Benchmark::Settings settings;
+    std::string cpus, jsonPath, baselinePath, autotunePath;
+    double threshold = 0.1;
+    bool autotune = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        const size_t equals = argument.find('=');
+        const std::string key = argument.substr(0, equals);
+        const std::string value = equals == std::string::npos ? "" : argument.substr(equals + 1);
+
+        if (key == "--filter")
+            settings.filter = value;
+        else if (key == "--samples")
+            settings.samples = std::stol(value);
+        else if (key == "--warmup")
+            settings.warmupSamples = std::stol(value);
+        else if (key == "--min-sample-ms")
+            settings.minSampleTime = std::chrono::milliseconds(std::stol(value));
+        else if (key == "--cpus")
+            cpus = value;
+        else if (key == "--json")
+            jsonPath = value;
+        else if (key == "--baseline")
+            baselinePath = value;
+        else if (key == "--threshold")
+            threshold = std::stod(value);
+        else if (key == "--autotune")
+        {
+            autotune = true;
+            autotunePath = value;
+        }
+        else
+        {
+            std::cerr << "Unknown argument " << argument << std::endl;
+            return 2;
+        }
+    }
+
+    // Before anything uses the thread pool, so that its workers inherit the affinity
+    if (!cpus.empty() && !Benchmark::pinToCpus(cpus))
+        std::cerr << "Could not pin to CPUs " << cpus << ", running unpinned." << std::endl;
+
+    Matmul::Autotuner &tuner = Matmul::Autotuner::global();
+    tuner.setEnabled(autotune);
+    if (!autotunePath.empty() && std::ifstream(autotunePath))
+        tuner.load(autotunePath);
+
+    const std::vector<Benchmark::Result> results = createSuite<float>().run(settings, std::cerr);
+    Benchmark::writeTable(std::cout, results);
+
+    if (!autotunePath.empty())
+        tuner.save(autotunePath);
+
+    if (!jsonPath.empty())
+    {
+        std::ofstream file(jsonPath);
+        if (!file)
+        {
+            std::cerr << "Could not open " << jsonPath << " for writing." << std::endl;
+            return 2;
+        }
+        Benchmark::writeJson(file, results, cpus);
+    }
+
+    if (!baselinePath.empty())
+    {
+        std::cout << std::endl;
+        const long regressions = Benchmark::compareWithBaseline(std::cout, results, Benchmark::readBaseline(baselinePath), threshold);
+        if (regressions > 0)
+        {
+            std::cout << regressions << " benchmark(s) regressed by more than " << threshold * 100 << "%." << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,255 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/// @brief A small harness for reproducible benchmarks: each benchmark is calibrated to a minimum sample time, warmed up, sampled repeatedly and summarized by its median and 95th percentile, which are robust to the outliers of a shared machine.
+/// @details Results are written as JSON, one benchmark per line, and can be compared with such a file from an earlier run to flag regressions of the median beyond a threshold.
+namespace Benchmark
+{
+    struct Settings
+    {
+        long warmupSamples = 3;
+        long samples = 20;
+        /// Each sample repeats the benchmark until it takes at least this long, so that the resolution of the clock does not matter
+        std::chrono::nanoseconds minSampleTime = std::chrono::milliseconds(5);
+        /// Only benchmarks whose names contain the filter are run
+        std::string filter;
+    };
+
+    /// @brief The times of one benchmark, in nanoseconds per call
+    struct Result
+    {
+        std::string name;
+        /// The floating point operations per call, or 0 if they are not counted
+        double flops;
+        long iterations;
+        std::vector<double> samples;
+        double median;
+        double p95;
+        double min;
+        double mean;
+    };
+
+    /// @brief The nearest-rank percentile of sorted values
+    inline double percentile(const std::vector<double> &sorted, double q)
+    {
+        if (sorted.empty())
+            return 0;
+        const long rank = (long)std::ceil(q * sorted.size());
+        return sorted[std::clamp(rank - 1, 0l, (long)sorted.size() - 1)];
+    }
+
+    /// @brief The time of iterations calls of f in nanoseconds
+    template <typename F>
+    double time(const F &f, long iterations)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < iterations; i++)
+            f();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    inline Result measure(const std::string &name, double flops, const std::function<void()> &f, const Settings &settings)
+    {
+        // Doubles the iterations per sample until a sample is long enough, which also warms up caches and buffers
+        long iterations = 1;
+        while (time(f, iterations) < settings.minSampleTime.count() && iterations < (1l << 24))
+            iterations *= 2;
+
+        for (long i = 0; i < settings.warmupSamples; i++)
+            time(f, iterations);
+
+        Result result{name, flops, iterations};
+        for (long i = 0; i < settings.samples; i++)
+            result.samples.push_back(time(f, iterations) / iterations);
+
+        std::vector<double> sorted = result.samples;
+        std::sort(sorted.begin(), sorted.end());
+        result.median = percentile(sorted, 0.5);
+        result.p95 = percentile(sorted, 0.95);
+        result.min = sorted.front();
+        result.mean = 0;
+        for (double sample : sorted)
+            result.mean += sample / sorted.size();
+        return result;
+    }
+
+    /// @brief A list of named benchmarks. Each is registered with a setup function that prepares its data and returns the function to be timed, so that the setup is neither timed nor run for benchmarks that are filtered out.
+    class Suite
+    {
+        struct Entry
+        {
+            std::string name;
+            double flops;
+            std::function<std::function<void()>()> setup;
+        };
+        std::vector<Entry> mBenchmarks;
+
+    public:
+        /// @param flops The floating point operations of one call of the timed function, from which the rate is reported, or 0
+        void add(const std::string &name, const std::function<std::function<void()>()> &setup, double flops = 0)
+        {
+            mBenchmarks.push_back({name, flops, setup});
+        }
+
+        std::vector<Result> run(const Settings &settings, std::ostream &log) const
+        {
+            std::vector<Result> results;
+            for (const auto &[name, flops, setup] : mBenchmarks)
+            {
+                if (name.find(settings.filter) == std::string::npos)
+                    continue;
+
+                log << "Running " << name << "..." << std::flush;
+                results.push_back(measure(name, flops, setup(), settings));
+                log << "\r\t\r";
+            }
+            return results;
+        }
+    };
+
+    /// @brief Formats a time in nanoseconds with a unit that keeps it readable
+    inline std::string formatTime(double nanoseconds)
+    {
+        std::stringstream s;
+        s << std::fixed << std::setprecision(2);
+        if (nanoseconds < 1e3)
+            s << nanoseconds << " ns";
+        else if (nanoseconds < 1e6)
+            s << nanoseconds * 1e-3 << " us";
+        else
+            s << nanoseconds * 1e-6 << " ms";
+        return s.str();
+    }
+
+    /// @brief The rate of the median in GFLOP/s, or "-" if the operations are not counted
+    inline std::string formatRate(const Result &result)
+    {
+        if (result.flops <= 0 || result.median <= 0)
+            return "-";
+        std::stringstream s;
+        s << std::fixed << std::setprecision(2) << result.flops / result.median;
+        return s.str();
+    }
+
+    inline void writeTable(std::ostream &s, const std::vector<Result> &results)
+    {
+        s << std::left << std::setw(52) << "benchmark" << std::right << std::setw(14) << "median" << std::setw(14) << "p95" << std::setw(14) << "min" << std::setw(10) << "GFLOP/s" << std::setw(12) << "iterations" << "\n";
+        for (const Result &result : results)
+            s << std::left << std::setw(52) << result.name << std::right << std::setw(14) << formatTime(result.median) << std::setw(14) << formatTime(result.p95) << std::setw(14) << formatTime(result.min) << std::setw(10) << formatRate(result) << std::setw(12) << result.iterations << "\n";
+    }
+
+    inline void writeJson(std::ostream &s, const std::vector<Result> &results, const std::string &pinnedCpus)
+    {
+        const std::ios_base::fmtflags flags = s.flags();
+        const std::streamsize precision = s.precision();
+        s << std::fixed << std::setprecision(1);
+        s << "{\"threads\": " << std::thread::hardware_concurrency() << ", \"cpus\": \"" << pinnedCpus << "\", \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result &result = results[i];
+            s << (i > 0 ? ",\n" : "\n") << "{\"name\": \"" << result.name << "\", \"median_ns\": " << result.median << ", \"p95_ns\": " << result.p95 << ", \"min_ns\": " << result.min << ", \"mean_ns\": " << result.mean << ", \"flops\": " << result.flops << ", \"iterations\": " << result.iterations << ", \"samples\": " << result.samples.size() << "}";
+        }
+        s << "\n]}\n";
+        s.flags(flags);
+        s.precision(precision);
+    }
+
+    /// @brief Reads the medians of a file written by writeJson, by name
+    /// @details This is not a general JSON parser: it relies on each benchmark being on a line of its own, as writeJson writes them.
+    inline std::unordered_map<std::string, double> readBaseline(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file)
+            throw std::runtime_error("Could not open " + path + " for reading.");
+
+        std::unordered_map<std::string, double> medians;
+        const std::string nameKey = "{\"name\": \"";
+        const std::string medianKey = "\"median_ns\": ";
+        std::string line;
+        while (std::getline(file, line))
+        {
+            const size_t nameStart = line.find(nameKey);
+            const size_t medianStart = line.find(medianKey);
+            if (nameStart == std::string::npos || medianStart == std::string::npos)
+                continue;
+
+            const size_t nameEnd = line.find('"', nameStart + nameKey.size());
+            medians[line.substr(nameStart + nameKey.size(), nameEnd - nameStart - nameKey.size())] = std::stod(line.substr(medianStart + medianKey.size()));
+        }
+        return medians;
+    }
+
+    /// @brief Compares the medians with those of a baseline and writes the ratios
+    /// @param threshold The relative slowdown of the median above which a benchmark counts as a regression, e.g. 0.1 for 10%
+    /// @return The number of regressions
+    inline long compareWithBaseline(std::ostream &s, const std::vector<Result> &results, const std::unordered_map<std::string, double> &baseline, double threshold)
+    {
+        const std::ios_base::fmtflags flags = s.flags();
+        const std::streamsize precision = s.precision();
+        long regressions = 0;
+        s << std::left << std::setw(52) << "benchmark" << std::right << std::setw(14) << "baseline" << std::setw(14) << "median" << std::setw(10) << "ratio" << "  status\n";
+        for (const Result &result : results)
+        {
+            const auto it = baseline.find(result.name);
+            s << std::left << std::setw(52) << result.name << std::right;
+            if (it == baseline.end())
+            {
+                s << std::setw(14) << "-" << std::setw(14) << formatTime(result.median) << std::setw(10) << "-" << "  new\n";
+                continue;
+            }
+
+            const double ratio = result.median / it->second;
+            const bool regression = ratio > 1 + threshold;
+            regressions += regression;
+            s << std::setw(14) << formatTime(it->second) << std::setw(14) << formatTime(result.median) << std::setw(10) << std::fixed << std::setprecision(3) << ratio;
+            s << (regression ? "  REGRESSION\n" : (ratio < 1 - threshold ? "  improved\n" : "  ok\n"));
+        }
+        s.flags(flags);
+        s.precision(precision);
+        return regressions;
+    }
+
+    /// @brief Restricts the calling thread, and the threads it creates afterwards, to a list of CPUs such as "0-3,6", so that repeated runs are scheduled alike
+    /// @details The workers of the global thread pool inherit the restriction if it is set before the pool is first used.
+    /// @return Whether the affinity could be set, which is only supported on Linux
+    inline bool pinToCpus(const std::string &cpus)
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        std::stringstream list(cpus);
+        std::string range;
+        while (std::getline(list, range, ','))
+        {
+            const size_t dash = range.find('-');
+            const long first = std::stol(range.substr(0, dash));
+            const long last = dash == std::string::npos ? first : std::stol(range.substr(dash + 1));
+            for (long cpu = first; cpu <= last; cpu++)
+                CPU_SET(cpu, &set);
+        }
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        return false;
+#endif
+    }
+}
+
+#endif
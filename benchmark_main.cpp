@@ -0,0 +1,9 @@
+// The library declares int main() as a friend of Array<T>, so the entry point that takes command line arguments is kept in a translation unit that does not include it.
+// Build it together with benchmark.cpp, e.g. g++ -std=c++23 -O2 -mavx2 -mfma benchmark.cpp benchmark_main.cpp -o benchmark
+
+int runBenchmarks(int argc, char **argv);
+
+int main(int argc, char **argv)
+{
+    return runBenchmarks(argc, argv);
+}
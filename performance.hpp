@@ -2,23 +2,28 @@
 #define PERFORMANCE_H
 
 #include <chrono>
-#include <vector>
+#include <stdexcept>
+
+#include "array/profiler.hpp"
 
 using std::chrono::high_resolution_clock;
 using std::chrono::nanoseconds;
 using std::chrono::time_point;
 
+/// @brief Accumulates the wall-clock time between calls of start and stop, and the hardware counters of the calling thread if they are enabled, see HardwareCounters
 struct PerformanceMeasure
 {
     nanoseconds accumulated = nanoseconds::zero();
     time_point<high_resolution_clock> startTime;
     bool running = false;
+    HardwareCounters::Measure counters;
 
     void start()
     {
         if (running)
             throw std::logic_error("Clock is already running.");
         running = true;
+        counters.start();
         startTime = std::chrono::high_resolution_clock::now();
     }
 
@@ -29,6 +34,7 @@ struct PerformanceMeasure
             throw std::logic_error("Clock is not running");
         running = false;
         accumulated += std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime);
+        counters.stop();
     }
 };
 
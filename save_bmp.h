@@ -3,7 +3,10 @@
 #ifndef SAVE_BMP_H
 #define SAVE_BMP_H
 
+#include <errno.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
 namespace bitmap
 {
@@ -32,10 +35,6 @@ namespace bitmap
     } // extern "C"
 #endif // __cplusplus
 
-#include <errno.h>
-#include <stdio.h>
-#include <string.h>
-
     enum save_bmp_result save_bmp(const char *filename,
                                   uint32_t width, uint32_t height,
                                   const uint8_t *image)
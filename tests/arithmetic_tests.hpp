@@ -56,6 +56,579 @@ namespace Test::Arithmetic
         std::cout << "Broadcast test passed.\n";
     }
 
+    void lazyExpression()
+    {
+        int k = 37;
+        Array<float> m = Array<float>::range(k * k).reshape(k, k) / 100.0f;
+        Array<float> g = Array<float>::range(k).reshape(1, k).cos();
+        float gamma = 0.1f;
+
+        Array<float> eager = (1 - gamma) * m + gamma * g.square();
+        Array<float> fused = (1 - gamma) * lazy(m) + gamma * lazy(g).square();
+
+        TEST_LOG((fused.refShape() == eager.refShape()), "Lazy expression has the wrong shape");
+        for (ShapeIterator it(eager.refShape()); !it.isFinished(); ++it)
+            TEST_LOG(approxEqual(fused[it.refPosition()], eager[it.refPosition()]), "Lazy expression does not match eager computation");
+
+        // Assigning to an array of matching shape writes into the existing data.
+        const float *pData = m.readDataPointer();
+        m = lazy(m) - 2.0f * lazy(g);
+        TEST_LOG((pData == m.readDataPointer()), "Lazy assignment did not evaluate in place");
+        for (ShapeIterator it(eager.refShape()); !it.isFinished(); ++it)
+        {
+            float expected = (it.refPosition()[0] * k + it.refPosition()[1]) / 100.0f - 2.0f * std::cos((float)it.refPosition()[1]);
+            TEST_LOG(approxEqual(m[it.refPosition()], expected), "In-place lazy assignment is wrong");
+        }
+
+        // The transposed view overlaps with the destination, so the expression has to go through a temporary.
+        Array<float> square = Array<float>::range(k * k).reshape(k, k);
+        square = lazy(square.transpose(0, 1)) + 0.0f;
+        for (ShapeIterator it(square.refShape()); !it.isFinished(); ++it)
+            TEST_LOG((square[it.refPosition()] == it.refPosition()[1] * k + it.refPosition()[0]), "Aliased lazy assignment is wrong");
+
+        std::cout << "Lazy expression test passed.\n";
+    }
+
+    void destinationVariants()
+    {
+        int k = 12;
+        Array<float> a = Array<float>::range(3 * k).reshape(3, k) / 10.0f;
+
+        // Results written into existing arrays must match the allocating versions and keep the destination's data.
+        Array<float> dest = Array<float>::empty({3, k});
+        const float *pDestData = dest.readDataPointer();
+        a.exp(dest);
+        TEST_LOG((dest.readDataPointer() == pDestData), "Destination variant reallocated");
+        Array<float> expected = a.exp();
+        for (ShapeIterator it(dest.refShape()); !it.isFinished(); ++it)
+            TEST_LOG(approxEqual(dest[it.refPosition()], expected[it.refPosition()]), "exp with destination is wrong");
+
+        dest.clipInPlace(1.5f, 2.5f);
+        expected = expected.clip(1.5f, 2.5f);
+        for (ShapeIterator it(dest.refShape()); !it.isFinished(); ++it)
+            TEST_LOG((dest[it.refPosition()] == expected[it.refPosition()]), "clipInPlace is wrong");
+
+        Array<bool> mask = Array<bool>::empty({3, k});
+        a.greater(Array<float>(1.0f), mask);
+        for (ShapeIterator it(a.refShape()); !it.isFinished(); ++it)
+            TEST_LOG((mask[it.refPosition()] == (a[it.refPosition()] > 1.0f)), "greater with destination is wrong");
+
+        // The zeroth power is a constant, but its destination is still checked against the source.
+        Array<float> ones = Array<float>::empty({3, k});
+        a.intPow(0, ones);
+        TEST_LOG((ones.reduceSum().eval() == 3 * k), "intPow(0) with destination is wrong");
+        bool rejected = false;
+        try
+        {
+            Array<float> column = Array<float>::empty({3, 1});
+            a.intPow(0, column);
+        }
+        catch (const std::invalid_argument &)
+        {
+            rejected = true;
+        }
+        TEST_LOG(rejected, "intPow(0) accepted a destination of the wrong shape");
+
+        // Reductions accept the shape with or without the reduced axes, and can accumulate into the destination.
+        Array<float> rowSums = Array<float>::empty({3});
+        a.reduceSum({1}, rowSums);
+        Array<float> columnSums = Array<float>::constant({1, k}, 1.0f);
+        a.reduceSum({0}, columnSums, true);
+        Array<float> reference = a.reduceSum({1});
+        TEST_LOG((reference.refShape() == Coordinates({3})), "reduceSum without keepDims has the wrong shape");
+        for (long i = 0; i < 3; i++)
+            TEST_LOG(approxEqual(rowSums[{i}], reference[{i}]), "reduceSum with destination is wrong");
+        for (long j = 0; j < k; j++)
+            TEST_LOG(approxEqual(columnSums[{0, j}], 1.0f + (j + (j + k) + (j + 2 * k)) / 10.0f), "Accumulating reduceSum is wrong");
+
+        std::cout << "Destination variants test passed.\n";
+    }
+
+    void copyOnWrite()
+    {
+        Array<float> a = Array<float>::range(12) / 2.0f;
+        const float *pData = a.readDataPointer();
+
+        // Copies share the data until one of them is written to.
+        Array<float> b = a;
+        TEST_LOG((b.readDataPointer() == pData), "Copy did not share the data");
+        b += 1.0f;
+        TEST_LOG((b.readDataPointer() != pData && a.readDataPointer() == pData), "Write to a shared copy did not clone the data");
+        for (long i = 0; i < 12; i++)
+            TEST_LOG((a[{i}] == i / 2.0f && b[{i}] == i / 2.0f + 1.0f), "Copy-on-write changed the wrong array");
+
+        // Once the data is no longer shared, writes do not copy.
+        b *= 2.0f;
+        TEST_LOG((b.readDataPointer() != pData && a.readDataPointer() == pData), "Write to unshared data was not in place");
+
+        // Views write through to the data they were created from.
+        Array<float> rows = a.reshape(3, 4);
+        rows.sliceAxis(1, 0, 1) = 0.0f;
+        TEST_LOG((a.readDataPointer() == pData && a[{0}] == 0.0f && a[{4}] == 0.0f && a[{1}] == 0.5f), "Write to a view did not go through");
+
+        // ensureUnique detaches a view, so that it can be mutated without affecting the original data.
+        Array<float> detached = a.reshape(3, 4);
+        detached.ensureUnique() = -1.0f;
+        TEST_LOG((!detached.isView() && a[{1}] == 0.5f && detached[{1, 1}] == -1.0f), "ensureUnique did not detach the view");
+        const float *pUnshared = b.readDataPointer();
+        TEST_LOG((b.ensureUnique().readDataPointer() == pUnshared), "ensureUnique copied unshared data");
+
+        // Views and entries of a shared array count as writes to it, so they never reach the data of the other owners.
+        Array<float> c = a;
+        a.sliceAxis(0, 0, 1) = 7.0f;
+        TEST_LOG((c[{0}] == 0.0f && a[{0}] == 7.0f), "Write through a slice of a shared array changed its copy");
+        Array<float> d = a;
+        a.reshape(3, 4).transpose(0, 1) = 3.0f;
+        a[{1}] = 2.0f;
+        TEST_LOG((d[{0}] == 7.0f && d[{1}] == 0.5f && a[{0}] == 3.0f && a[{1}] == 2.0f), "Write through a view or entry of a shared array changed its copy");
+
+        // A copy taken while a view is alive does not see later writes through the view.
+        Array<float> alive = a.reshape(3, 4);
+        Array<float> e = a;
+        alive = 5.0f;
+        TEST_LOG((e[{0}] == 3.0f && a[{0}] == 5.0f), "Write through an older view changed a later copy");
+
+        // Reshaped and reduced temporaries own their data, so copies of them are copied on write like any other array.
+        Array<float> x = Array<float>::range(6).reshape({2, 3});
+        Array<float> y = x;
+        y *= 0.0f;
+        TEST_LOG((!x.isView() && x[{1, 2}] == 5.0f && y[{1, 2}] == 0.0f), "Write to a copy of a reshaped array changed the original");
+        Array<float> s = x.reduceSum({1});
+        Array<float> t = s;
+        t += 100.0f;
+        TEST_LOG((!s.isView() && s[{0}] == 3.0f && s[{1}] == 12.0f && t[{1}] == 112.0f), "Write to a copy of a reduce result changed the original");
+
+        // A copy of a view is independent of the data the view writes through to.
+        Array<float> v = x.reshape(3, 2);
+        Array<float> w = v;
+        w *= 0.0f;
+        TEST_LOG((v.isView() && !w.isView() && x[{1, 2}] == 5.0f && w[{2, 1}] == 0.0f), "Write to a copy of a view changed the original");
+
+        std::cout << "Copy-on-write test passed.\n";
+    }
+
+    void smallArrays()
+    {
+        // Lengths around the SIMD width exercise the vector loop, the partial tail and the scalar loop
+        for (long n : {1L, 3L, 8L, 13L, 40L})
+        {
+            Array<float> x = Array<float>::range(n) + 1.0f;
+            Array<float> reverse = 2.0f - x;
+            Array<float> quotient = 1.0f / x;
+            Array<float> scaled = x * Array<float>(3.0f);
+            for (long i = 0; i < n; i++)
+            {
+                TEST_LOG((reverse[{i}] == 1.0f - i), "Scalar minus array is wrong");
+                TEST_LOG(approxEqual(quotient[{i}], 1.0f / (i + 1)), "Scalar divided by array is wrong");
+                TEST_LOG((scaled[{i}] == 3.0f * (i + 1)), "Broadcast of a single entry is wrong");
+            }
+        }
+
+        // A single column is not contiguous and must not take the flat path
+        Array<float> grid = Array<float>::range(12).reshape(3, 4);
+        Array<float> column = grid.sliceAxis(1, 2, 3);
+        TEST_LOG((!column.isContiguous()), "A single column of a matrix is marked as contiguous");
+        column += 100.0f;
+        for (long i = 0; i < 3; i++)
+            for (long j = 0; j < 4; j++)
+                TEST_LOG((grid[{i, j}] == i * 4 + j + (j == 2 ? 100.0f : 0.0f)), "Write to a column is wrong");
+
+        Array<float> total = grid.reduceSum({0, 1});
+        total *= 0.5f;
+        TEST_LOG((total.eval() == (66.0f + 300.0f) / 2), "Scalar array arithmetic is wrong");
+
+        std::cout << "Small arrays test passed.\n";
+    }
+
+    void permutedLayouts()
+    {
+        // A transposed source makes the loops run over the canonical layout, in which the axes are reordered by stride
+        Array<float> cube = Array<float>::range(120).reshape(4, 5, 6);
+        Array<float> permuted = cube.transpose(0, 2);
+        Array<float> bias = Array<float>::range(5).reshape(1, 5, 1);
+
+        Array<float> copied = permuted.copy();
+        Array<float> shifted = permuted + bias;
+        TEST_LOG((copied.isContiguous()), "Copy of a transposed array is not contiguous");
+        for (long i = 0; i < 6; i++)
+            for (long j = 0; j < 5; j++)
+                for (long k = 0; k < 4; k++)
+                {
+                    const float value = k * 30 + j * 6 + i;
+                    TEST_LOG((copied[{i, j, k}] == value), "Copy of a transposed array is wrong");
+                    TEST_LOG((shifted[{i, j, k}] == value + j), "Broadcast with a transposed array is wrong");
+                }
+
+        Array<float> sum0 = permuted.reduceSum({0});
+        Array<float> sum2 = permuted.reduceSum({2});
+        Array<float> sum01 = permuted.reduceSum({0, 1});
+        for (long j = 0; j < 5; j++)
+            for (long k = 0; k < 4; k++)
+            {
+                float expected = 0;
+                for (long i = 0; i < 6; i++)
+                    expected += k * 30 + j * 6 + i;
+                TEST_LOG((sum0[{j, k}] == expected), "Reduction along the outer axis of a transposed array is wrong");
+            }
+        for (long i = 0; i < 6; i++)
+            for (long j = 0; j < 5; j++)
+            {
+                float expected = 0;
+                for (long k = 0; k < 4; k++)
+                    expected += k * 30 + j * 6 + i;
+                TEST_LOG((sum2[{i, j}] == expected), "Reduction along the inner axis of a transposed array is wrong");
+            }
+        for (long k = 0; k < 4; k++)
+        {
+            float expected = 0;
+            for (long i = 0; i < 6; i++)
+                for (long j = 0; j < 5; j++)
+                    expected += k * 30 + j * 6 + i;
+            TEST_LOG((sum01[{k}] == expected), "Reduction along two axes of a transposed array is wrong");
+        }
+
+        // Rows that are reduced along the contiguous axis are accumulated in tiles, including a partial tile
+        Array<float> rows = Array<float>::range(13 * 7).reshape(13, 7);
+        Array<float> rowSums = rows.reduceSum({1});
+        for (long i = 0; i < 13; i++)
+            TEST_LOG((rowSums[{i}] == 49 * i + 21), "Tiled row reduction is wrong");
+
+        std::cout << "Permuted layouts test passed.\n";
+    }
+
+    void transposeCopy()
+    {
+        // Sizes around the tile and block sizes exercise the in-register blocks and the scalar edges
+        for (long rows : {1L, 8L, 13L, 40L})
+            for (long cols : {3L, 8L, 37L})
+            {
+                Array<float> matrix = Array<float>::range(rows * cols).reshape(rows, cols);
+                Array<float> transposed = matrix.transpose(0, 1).copy();
+                TEST_LOG((transposed.isContiguous()), "Copy of a transposed matrix is not contiguous");
+                for (long i = 0; i < cols; i++)
+                    for (long j = 0; j < rows; j++)
+                        TEST_LOG((transposed[{i, j}] == j * cols + i), "Copy of a transposed matrix is wrong");
+            }
+
+        // A batch of matrices, a general permutation of axes and a reshape of a transposed view
+        Array<float> batch = Array<float>::range(3 * 20 * 12).reshape(3, 20, 12);
+        Array<float> batchTransposed = batch.transpose(1, 2).copy();
+        Array<float> rotated = batch.transpose(0, 2).transpose(1, 2).copy();
+        Array<float> flat = batch.transpose(0, 1).contiguous().reshape(-1);
+        for (long b = 0; b < 3; b++)
+            for (long i = 0; i < 20; i++)
+                for (long j = 0; j < 12; j++)
+                {
+                    const float value = b * 240 + i * 12 + j;
+                    TEST_LOG((batchTransposed[{b, j, i}] == value), "Copy of a batch of transposed matrices is wrong");
+                    TEST_LOG((rotated[{j, b, i}] == value), "Copy of a permuted array is wrong");
+                    TEST_LOG((flat[{i * 36 + b * 12 + j}] == value), "Reshape of a transposed array is wrong");
+                }
+
+        // reshape only returns views, so a transposed view has to be made contiguous explicitly
+        bool rejected = false;
+        try
+        {
+            batch.transpose(0, 1).reshape(-1);
+        }
+        catch (const std::logic_error &)
+        {
+            rejected = true;
+        }
+        TEST_LOG(rejected, "Reshape of a transposed view did not throw");
+
+        std::cout << "Transpose copy test passed.\n";
+    }
+
+    void stridedSources()
+    {
+        // Small transposed sources use scalar strided loads, larger ones are packed first, and columns are gathered
+        for (long n : {5L, 20L, 600L})
+        {
+            Array<float> matrix = Array<float>::range(n * 40).reshape(40, n);
+            Array<float> other = Array<float>::range(n * 40).reshape(n, 40) * 0.5f;
+            Array<float> sum = matrix.transpose(0, 1) + other;
+            Array<bool> less = matrix.transpose(0, 1) < other;
+            Array<float> column = matrix.sliceAxis(1, 2, 3) * 2.0f;
+            for (long i = 0; i < n; i++)
+                for (long j = 0; j < 40; j++)
+                {
+                    const float expected = j * n + i;
+                    TEST_LOG((sum[{i, j}] == expected + (i * 40 + j) * 0.5f), "Sum with a strided source is wrong");
+                    TEST_LOG((less[{i, j}] == (expected < (i * 40 + j) * 0.5f)), "Comparison with a strided source is wrong");
+                }
+            for (long j = 0; j < 40; j++)
+                TEST_LOG((column[{j, 0}] == 2.0f * (j * n + 2)), "Product with a column is wrong");
+        }
+
+        Array<float> large = Array<float>::range(600 * 600).reshape(600, 600);
+        Array<float> symmetric = large + large.transpose(0, 1);
+        for (long i = 0; i < 600; i += 7)
+            for (long j = 0; j < 600; j += 13)
+                TEST_LOG((symmetric[{i, j}] == 601.0f * (i + j)), "Sum of a large array and its transpose is wrong");
+
+        std::cout << "Strided sources test passed.\n";
+    }
+
+    void philoxRandom()
+    {
+        // Known answers of Philox4x32-10 from the Random123 library
+        auto zero = Philox::block(0u, 0u, 0u, 0u, Philox::Key());
+        TEST_LOG((zero == Philox::Block{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}), "Philox block of zeros is wrong");
+        Philox::Key piKey;
+        piKey.k0 = 0xa4093822;
+        piKey.k1 = 0x299f31d0;
+        auto pi = Philox::block(0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u, piKey);
+        TEST_LOG((pi == Philox::Block{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}), "Philox block of pi digits is wrong");
+
+        Philox::Batch batch = Philox::batch(64, 77, Philox::Key(12345));
+        uint32_t words[4][Philox::BLOCKS_PER_BATCH];
+        for (long w = 0; w < 4; w++)
+            _mm256_storeu_si256((__m256i *)words[w], batch.words[w]);
+        for (long j = 0; j < Philox::BLOCKS_PER_BATCH; j++)
+        {
+            auto block = Philox::block(64 + j, 77, Philox::Key(12345));
+            for (long w = 0; w < 4; w++)
+                TEST_LOG((block[w] == words[w][j]), "Philox batch does not match the single blocks");
+        }
+
+        // The arrays do not depend on the number of threads, and a partial last batch continues the same sequence
+        const long n = 1000003;
+        RandomArrayGenerator serial(7), parallel(7), small(7);
+        serial.setMultiThread(false);
+        Array<float> uniform = serial.uniform<float>({n});
+        Array<float> normal = serial.normal<float>({n}, 1.0f, 2.0f);
+        Array<float> bernoulli = serial.bernoulli<float>({n}, 0.3);
+        Array<float> parallelUniform = parallel.uniform<float>({n});
+        Array<float> parallelNormal = parallel.normal<float>({n}, 1.0f, 2.0f);
+        Array<float> parallelBernoulli = parallel.bernoulli<float>({n}, 0.3);
+        for (long i = 0; i < n; i++)
+        {
+            TEST_LOG((parallelUniform[{i}] == uniform[{i}]), "Multithreaded uniform array differs from the serial one");
+            TEST_LOG((parallelNormal[{i}] == normal[{i}]), "Multithreaded normal array differs from the serial one");
+            TEST_LOG((parallelBernoulli[{i}] == bernoulli[{i}]), "Multithreaded Bernoulli array differs from the serial one");
+        }
+        Array<float> prefix = small.uniform<float>({37});
+        for (long i = 0; i < 37; i++)
+            TEST_LOG((prefix[{i}] == uniform[{i}]), "Short uniform array is not a prefix of the long one");
+
+        TEST_LOG((uniform.reduceMin().eval() >= 0.0f && uniform.reduceMax().eval() < 1.0f), "Uniform array is out of range");
+        TEST_LOG(approxEqual(uniform.reduceSum().eval() / n, 0.5f, 1e-2f), "Uniform array has the wrong mean");
+        TEST_LOG(approxEqual(normal.reduceSum().eval() / n, 1.0f, 1e-2f), "Normal array has the wrong mean");
+        TEST_LOG(approxEqual(((normal - 1.0f) * (normal - 1.0f)).reduceSum().eval() / n, 4.0f, 1e-2f), "Normal array has the wrong variance");
+        TEST_LOG(approxEqual(bernoulli.reduceSum().eval() / n, 0.3f, 1e-2f), "Bernoulli array has the wrong mean");
+
+        Array<double> normalDouble = serial.normal<double>({n});
+        TEST_LOG(approxEqual((normalDouble * normalDouble).reduceSum().eval() / n, 1.0, 1e-2), "Normal double array has the wrong variance");
+
+        std::cout << "Philox random test passed.\n";
+    }
+
+    void compensatedSummation()
+    {
+        // 0.1f is not representable, and the naive sum of 2^22 copies loses most of its digits once the sum is large
+        const long n = 1 << 22;
+        const double expected = n * (double)0.1f;
+        Array<float> tenths = Array<float>::constant({n}, 0.1f);
+        auto error = [&](const Array<float> &sum, double reference)
+        { return std::abs(sum.eval() - reference) / reference; };
+
+        const double naive = error(tenths.reduceSum(), expected);
+        for (Summation summation : {Summation::PAIRWISE, Summation::KAHAN})
+        {
+            TEST_LOG((error(tenths.reduceSum(summation), expected) < 1e-6 && error(tenths.reduceSum(summation), expected) < naive), "Compensated sum of a long array is inaccurate");
+            TEST_LOG((error(tenths.reduceMean(summation), 0.1f) < 1e-6), "Compensated mean of a long array is inaccurate");
+
+            // A strided sum, and a sum of a transposed array, which is copied first, that ends with a partial block
+            TEST_LOG((error(tenths.reshape(-1, 2).sliceAxis(1, 0, 1).reduceSum(summation), expected / 2) < 1e-6), "Compensated sum of a strided array is inaccurate");
+            TEST_LOG((error(tenths.sliceAxis(0, 0, n - 2).reshape(-1, 7).transpose(0, 1).reduceSum(summation), expected - 2 * (double)0.1f) < 1e-6), "Compensated sum of a transposed array is inaccurate");
+
+            // Rows reduced along the contiguous axis are summed in tiles, including a partial tile, and columns are moved innermost by a copy
+            const long rows = 11, columns = n / 16;
+            Array<float> matrix = tenths.sliceAxis(0, 0, rows * columns).reshape(rows, columns);
+            Array<float> rowSums = matrix.reduceSum({1}, false, summation);
+            Array<float> columnSums = Array<float>::constant({columns}, 1.0f);
+            matrix.reduceSum({0}, columnSums, true, summation);
+            for (long i = 0; i < rows; i++)
+                TEST_LOG((std::abs(rowSums[{i}] - columns * (double)0.1f) / (columns * 0.1) < 1e-6), "Compensated row sums are inaccurate");
+            TEST_LOG((approxEqual(columnSums[{0}], 1.0f + rows * 0.1f) && approxEqual(columnSums[{columns - 1}], 1.0f + rows * 0.1f)), "Accumulating compensated sums are wrong");
+            Array<float> cube = tenths.reshape(64, 256, 256);
+            Array<float> outerSums = cube.reduceSum({0, 2}, false, summation);
+            TEST_LOG((std::abs(outerSums[{17}] - 64 * 256 * (double)0.1f) / (64 * 256 * 0.1) < 1e-6), "Compensated sum along an outer axis is inaccurate");
+        }
+
+        std::cout << "Compensated summation test passed.\n";
+    }
+
+    void argReductions()
+    {
+        RandomArrayGenerator rng(0);
+        // Rows along the contiguous axis, with a partial vector, and columns, which are compared 8 at a time, including a partial block
+        Array<float> scores = rng.normal<float>({37, 21});
+        scores[{5, 20}] = 100.0f;
+        scores[{5, 3}] = 100.0f;
+        Array<long> rowMax = scores.argMax(1), rowMin = scores.argMin(-1, true), columnMax = scores.argMax(0);
+        TEST_LOG((rowMax.refShape() == Coordinates({37}) && rowMin.refShape() == Coordinates({37, 1}) && columnMax.refShape() == Coordinates({21})), "Arg reductions have the wrong shape");
+        for (long i = 0; i < 37; i++)
+            for (long j = 0; j < 21; j++)
+            {
+                TEST_LOG((scores[{i, j}] <= scores[{i, rowMax[{i}]}] && scores[{i, j}] >= scores[{i, rowMin[{i, 0}]}]), "argMax or argMin along rows is wrong");
+                TEST_LOG((scores[{i, j}] <= scores[{columnMax[{j}], j}]), "argMax along columns is wrong");
+            }
+        TEST_LOG((rowMax[{5}] == 3), "argMax does not take the first of equal maxima");
+        TEST_LOG((scores.argMax().eval() == 5 * 21 + 3 && scores.transpose(0, 1).argMax().eval() == 3 * 37 + 5), "argMax of the whole array is wrong");
+
+        // The same along the middle axis of a transposed array, and of integers, which take the scalar kernels
+        Array<float> cube = rng.normal<float>({4, 9, 6}).transpose(0, 2);
+        Array<long> middle = cube.argMin(1);
+        Array<int> integers = Array<int>::range(24).reshape(2, 12);
+        for (long j = 0; j < 12; j++)
+            for (long i = 0; i < 2; i++)
+                integers[{i, j}] %= 5;
+        TEST_LOG((integers.argMax(1)[{0}] == 4 && integers.argMin(1)[{1}] == 3), "Arg reductions of integers are wrong");
+        for (long i = 0; i < 6; i++)
+            for (long k = 0; k < 4; k++)
+                for (long j = 0; j < 9; j++)
+                    TEST_LOG((cube[{i, j, k}] >= cube[{i, middle[{i, k}], k}]), "argMin along a strided axis is wrong");
+
+        // NaN entries are skipped, and NaN values come last in topK
+        Array<float> withNaN = Array<float>::range(20.0f);
+        withNaN[{13}] = std::numeric_limits<float>::quiet_NaN();
+        withNaN[{2}] = 19.0f;
+        TEST_LOG((withNaN.argMax().eval() == 2 && withNaN.argMin().eval() == 0), "Arg reductions do not skip NaN entries");
+        auto [largest, largestIndices] = withNaN.topK(3);
+        TEST_LOG((largest[{0}] == 19.0f && largestIndices[{0}] == 2 && largestIndices[{1}] == 19 && largest[{2}] == 18.0f), "topK is wrong");
+        auto [all, allIndices] = withNaN.topK(20, 0, false);
+        TEST_LOG((all[{0}] == 0.0f && allIndices[{1}] == 1 && std::isnan(all[{19}]) && allIndices[{19}] == 13), "topK of all entries does not sort them");
+
+        // Along columns and against a sort of each line
+        Array<float> logits = rng.normal<float>({300, 5});
+        auto [top, topIndices] = logits.topK(4, 0);
+        TEST_LOG((top.refShape() == Coordinates({4, 5})), "topK has the wrong shape");
+        for (long j = 0; j < 5; j++)
+        {
+            std::vector<float> column;
+            for (long i = 0; i < 300; i++)
+                column.push_back(logits[{i, j}]);
+            std::sort(column.begin(), column.end(), std::greater<float>());
+            for (long r = 0; r < 4; r++)
+                TEST_LOG((top[{r, j}] == column[r] && logits[{topIndices[{r, j}], j}] == column[r]), "topK along columns is wrong");
+        }
+
+        // findWhere packs the indices of matches, with full, partial and empty vectors
+        Array<float> sparse = Array<float>::constant({3, 29}, 0.0f);
+        for (long j : {0, 7, 8, 9, 10, 11, 12, 13, 14, 15, 28})
+            sparse[{1, j}] = 1.0f;
+        sparse[{2, 3}] = -2.0f;
+        Array<long> nonZero = sparse.findNonZero(), zero = sparse.findZero();
+        TEST_LOG((nonZero.refShape() == Coordinates({12, 2}) && zero.refShape() == Coordinates({3 * 29 - 12, 2})), "findWhere finds the wrong number of entries");
+        TEST_LOG((nonZero[{0, 0}] == 1 && nonZero[{0, 1}] == 0 && nonZero[{9, 1}] == 15 && nonZero[{10, 1}] == 28 && nonZero[{11, 0}] == 2 && nonZero[{11, 1}] == 3), "findNonZero has the wrong coordinates");
+        TEST_LOG((zero[{29, 0}] == 1 && zero[{29, 1}] == 1), "findZero has the wrong coordinates");
+        Array<long> transposedNonZero = sparse.transpose(0, 1).findNonZero();
+        TEST_LOG((transposedNonZero[{0, 0}] == 0 && transposedNonZero[{0, 1}] == 1 && transposedNonZero[{1, 0}] == 3 && transposedNonZero[{1, 1}] == 2), "findNonZero of a transposed array is not in the order of its entries");
+
+        std::cout << "Arg reductions test passed.\n";
+    }
+
+
+    struct SquaredDifference
+    {
+        static inline float f(const float x, const float y) { return (x - y) * (x - y); }
+        static inline Simd::Vector<float> fSimd(const Simd::Vector<float> x, const Simd::Vector<float> y) { return (x - y) * (x - y); }
+    };
+
+    void mapReduction()
+    {
+        RandomArrayGenerator rng(11);
+        auto matches = [](const Array<float> &fused, const Array<float> &expected)
+        {
+            if (fused.refShape() != expected.refShape())
+                return false;
+            const Array<float> x = fused.copy(), y = expected.copy();
+            for (long i = 0; i < x.getFlatLength(); i++)
+                if (!approxEqual(x.getFlat(i), y.getFlat(i), 1e-4f))
+                    return false;
+            return true;
+        };
+
+        // Along every kind of axis, for small arrays on one thread and for large ones split into pieces or blocks
+        for (auto [rows, columns] : {std::pair(37l, 300l), std::pair(600l, 300l), std::pair(2000l, 100l)})
+        {
+            Array<float> a = rng.normal<float>({rows, columns}), b = rng.normal<float>({rows, columns});
+            Array<float> squares = (a - b) * (a - b);
+            TEST_LOG((matches(mapReduce<SquaredDifference>({0, 1}, a, b), squares.reduceSum({0, 1}))), "Fused sum over all axes is wrong");
+            TEST_LOG((matches(mapReduce<SquaredDifference>({1}, a, b), squares.reduceSum({1}))), "Fused sum along rows is wrong");
+            TEST_LOG((matches(mapReduce<SquaredDifference>({0}, a, b), squares.reduceSum({0}))), "Fused sum along columns is wrong");
+            TEST_LOG((matches(mapReduce<SquaredDifference>({0}, a.transpose(0, 1), b.transpose(0, 1)), squares.reduceSum({1}))), "Fused sum of transposed arrays is wrong");
+            TEST_LOG((matches(mapReduce<Multiplication<float>, Maximum<float>>({1}, a, b), (a * b).reduceMax({1}))), "Fused maximum is wrong");
+        }
+
+        // Broadcast sources, a parametrized operation and a scalar operation
+        Array<float> c = rng.normal<float>({8, 1, 30}), d = rng.normal<float>({20, 1});
+        TEST_LOG((matches(mapReduce<SquaredDifference>({0, 2}, c, d), ((c - d) * (c - d)).reduceSum({0, 2}))), "Fused sum of broadcast arrays is wrong");
+        TEST_LOG((matches(mapReduce(ScalarMultiplication<float>(2.0f), {-1}, c), (c * 2.0f).reduceSum({2}))), "Fused sum of a parametrized operation is wrong");
+        Array<int> integers = Array<int>::range(12).reshape(3, 4);
+        Array<int> integerSums = mapReduce<Multiplication<int>>({1}, integers, integers);
+        TEST_LOG((integerSums[{0}] == 14 && integerSums[{2}] == 8 * 8 + 9 * 9 + 10 * 10 + 11 * 11), "Fused sum of integers is wrong");
+
+        // Into an existing array, with compensated sums along a long line and along an outer axis
+        const long n = 1 << 20;
+        Array<float> tenths = Array<float>::constant({n}, 0.1f), ones = Array<float>::constant({n}, 1.0f);
+        Array<float> total = Array<float>::constant({}, 0.0f);
+        for (Summation summation : {Summation::PAIRWISE, Summation::KAHAN})
+        {
+            mapReduceInto<Multiplication<float>>(total, {0}, summation, tenths, ones);
+            TEST_LOG((std::abs(total.eval() - n * (double)0.1f) / (n * 0.1) < 1e-6), "Compensated fused sum is inaccurate");
+
+            Array<float> columns = Array<float>::constant({1, 256}, 5.0f);
+            mapReduceInto<Multiplication<float>>(columns, {0}, summation, tenths.reshape(4096, 256), ones.reshape(4096, 256));
+            TEST_LOG((std::abs(columns[{0, 17}] - 4096 * (double)0.1f) / (4096 * 0.1) < 1e-6), "Compensated fused sum along an outer axis is inaccurate");
+        }
+
+        std::cout << "Map reduction test passed.\n";
+    }
+
+    void softmaxKernel()
+    {
+        RandomArrayGenerator rng(13);
+        auto matches = [](const Array<float> &result, const Array<float> &expected, float eps)
+        {
+            if (result.refShape() != expected.refShape())
+                return false;
+            const Array<float> x = result.copy(), y = expected.copy();
+            for (long i = 0; i < x.getFlatLength(); i++)
+                if (!approxEqual(x.getFlat(i), y.getFlat(i), eps))
+                    return false;
+            return true;
+        };
+        auto reference = [](const Array<float> &x, const Coordinates &axes)
+        {
+            const Array<float> exponentials = (x - x.reduceMax(axes, true)).exp();
+            return exponentials / exponentials.reduceSum(axes, true);
+        };
+
+        // Rows shorter than a vector, rows with a tail, rows split into many blocks, and enough rows for the thread pool
+        for (auto [rows, columns] : {std::pair(5l, 3l), std::pair(37l, 300l), std::pair(600l, 1000l)})
+        {
+            Array<float> a = rng.normal<float>({rows, columns}) * 10.0f;
+            TEST_LOG((matches(a.softmax({1}), reference(a, {1}), 1e-5f)), "Softmax along rows is wrong");
+            TEST_LOG((matches(a.softmax({-1}).reduceSum({1}), Array<float>::constant({rows}, 1.0f), 1e-5f)), "Softmax rows do not sum to one");
+            TEST_LOG((matches(a.softmax({0}), reference(a, {0}), 1e-5f)), "Softmax along columns is wrong");
+            TEST_LOG((matches(a.transpose(0, 1).softmax({1}), reference(a, {0}).transpose(0, 1), 1e-5f)), "Softmax of a transposed array is wrong");
+            TEST_LOG((matches(a.logSoftmax({1}).exp(), reference(a, {1}), 1e-5f)), "Log softmax is wrong");
+        }
+
+        // Several axes, and a row of large entries whose exponentials overflow without the shift by the maximum
+        Array<float> b = rng.normal<float>({6, 7, 40});
+        TEST_LOG((matches(b.softmax({0, 2}), reference(b, {0, 2}), 1e-5f)), "Softmax over outer and inner axes is wrong");
+        TEST_LOG((matches(b.softmax({0, 1, 2}), reference(b, {0, 1, 2}), 1e-5f)), "Softmax over all axes is wrong");
+        Array<float> large = Array<float>::range(100).reshape(4, 25) * 20.0f;
+        TEST_LOG((matches(large.softmax({1}), reference(large, {1}), 1e-5f)), "Softmax of large entries is wrong");
+        TEST_LOG((large.logSoftmax({1})[{0, 0}] == -480.0f), "Log softmax of large entries is wrong");
+
+        std::cout << "Softmax kernel test passed.\n";
+    }
+
 }
 
 #endif
\ No newline at end of file
@@ -243,11 +243,376 @@ namespace Test::Gradient
         std::cout << "MNIST gradient test 2 successful." << std::endl;
     }
 
+    /// @brief Checks that training steps with an unchanged batch length reuse all buffers. Only meaningful if the library is compiled with DEBUG_MODE.
+    template <DataType T>
+    void allocationTest()
+    {
+        using LayerSettings = LinearLayer<T>::template Settings<T>;
+        using Activation = LinearLayer<T>::Activation;
+
+        DiffTape<T> diffTape = DiffTape<T>();
+        auto &input = Variables<T>::create(diffTape, {-1, 20});
+        auto &labels = Variables<T>::create(diffTape, {-1, 5});
+
+        auto &layer1Weights = Coefficients<T>::create(diffTape, generatePseudorandom<T, [](T x)
+                                                                                     { return x; }>({12, 20}));
+        auto &layer1Bias = Coefficients<T>::create(diffTape, Array<T>::constant({12}, 0));
+        auto layer1 = LinearLayer<T>::create(input, LayerSettings(layer1Weights, layer1Bias, Activation::LEAKYRELU, T(0.01)));
+
+        auto &layer2Weights = Coefficients<T>::create(diffTape, generatePseudorandom<T, [](T x)
+                                                                                     { return 5 * x; }>({5, 12}));
+        auto &layer2Bias = Coefficients<T>::create(diffTape, Array<T>::constant({5}, 0));
+        auto layer2 = LinearLayer<T>::create(layer1, LayerSettings(layer2Weights, layer2Bias, Activation::NONE, T(0.01)));
+
+        auto &sftm = Softermax<T>::create(layer2, {-1});
+        auto &cost = MeanSquaredError<T>::create(sftm, labels);
+
+        auto x = generatePseudorandom<T, [](T x)
+                                      { return 7 * x; }>({64, 20});
+        auto y = generatePseudorandom<T, [](T x)
+                                      { return 3 * x; }>({64, 5});
+
+        Model model({&input, &labels}, cost, Adam<T>());
+        model.fit({x, y}, 1, 16, 1e-3, false);
+
+        const size_t allocations = allocationCounter;
+        model.fit({x, y}, 2, 16, 1e-3, false);
+        TEST_LOG((allocationCounter == allocations), "Training steps with an unchanged batch length should not allocate.");
+
+        std::cout << "Allocation test successful." << std::endl;
+    }
+
+    /// @brief Checks the row-sparse gradients of Embedding and SparseMatrixProduct against the dense products, and that Adam only updates the rows that received gradient.
+    template <DataType T>
+    void sparseGradientTest()
+    {
+        const long vocabulary = 50;
+        auto tableBare = generatePseudorandom<T, [](T x)
+                                              { return x; }>({vocabulary, 6});
+
+        DiffTape<T> diffTape = DiffTape<T>();
+        auto &indices = Variables<T>::create(diffTape, {-1, 3});
+        auto &table = Coefficients<T>::create(diffTape, tableBare);
+        auto &embedded = embedding(indices, table);
+        auto &cost = reduceSum(embedded * embedded);
+
+        auto &bagOfWords = SparseVariables<T>::create(diffTape, vocabulary);
+        auto &weights = Coefficients<T>::create(diffTape, tableBare);
+        auto &product = matmul(bagOfWords, weights);
+        auto &productCost = reduceSum(product * product);
+
+        const Array<T> ids = Array<T>({4, 17, 4, 9, 17, 31}).reshape({2, 3});
+        indices.setValue(ids);
+        const Array<T> idsDense = ids.reshape({6}).template oneHot<T>(T(0), T(vocabulary));
+        bagOfWords.setValue(SparseArray<T>::fromDense(idsDense));
+
+        const Array<T> gradient = diffTape.getGradient(table, cost);
+        const Array<T> rows = embedded.refArray().reshape({6, 6});
+        const Array<T> expectedGradient = ArrayLibrary::Matmul::matmul<T>(idsDense.transpose(0, 1).copy(), T(2) * rows);
+        TEST_LOG(approxEqual(checksum(gradient), checksum(expectedGradient)), "The gradient of the embedding table should match the dense product.");
+        TEST_LOG((table.refGradientRows().size() == 4), "Exactly the rows that were looked up should have received gradient.");
+
+        const Array<T> productGradient = diffTape.getGradient(weights, productCost);
+        TEST_LOG(approxEqual(checksum(product.refArray()), checksum(rows)), "The sparse product should match the embedding.");
+        TEST_LOG(approxEqual(checksum(productGradient), checksum(expectedGradient)), "The gradient of the sparse product should match the dense product.");
+
+        diffTape.getGradient(table, cost);
+        Adam<T> adam;
+        adam.addUnit(table);
+        adam.update(1e-2);
+
+        const Array<T> &updated = table.refCoefficientArray();
+        for (long row = 0; row < vocabulary; row++)
+        {
+            const bool used = row == 4 || row == 9 || row == 17 || row == 31;
+            const bool unchanged = (updated.sliceAxis(0, row, row + 1) == tableBare.sliceAxis(0, row, row + 1)).reduceAll().eval();
+            TEST_LOG((used != unchanged), std::format("Adam should update exactly the rows that were looked up, row {}", row));
+        }
+
+        // A dense unit on tied weights would leave rows of the gradient that resetGradient never clears
+        DiffTape<T> tiedTape = DiffTape<T>();
+        auto &tiedIndices = Variables<T>::create(tiedTape, {-1, 3});
+        auto &tiedTable = Coefficients<T>::create(tiedTape, tableBare);
+        auto &tiedCost = reduceSum(embedding(tiedIndices, tiedTable));
+        reduceSum(tiedTable);
+        tiedIndices.setValue(ids);
+        bool rejected = false;
+        try
+        {
+            tiedTape.getGradient(tiedTable, tiedCost);
+        }
+        catch (const std::logic_error &)
+        {
+            rejected = true;
+        }
+        TEST_LOG(rejected, "A dense unit pulling gradient into row-sparse coefficients should be rejected.");
+
+        std::cout << "Sparse gradient test successful." << std::endl;
+    }
+
+    template <DataType T>
+    void dropoutTest()
+    {
+        // 37 columns, so that the last Philox batch is only partially used
+        const Array<T> xBare = Array<T>::range(64 * 37).reshape({64, 37}) + T(1);
+        const T keep = 0.75;
+
+        DiffTape<T> diffTape = DiffTape<T>();
+        auto &x = Coefficients<T>::create(diffTape, xBare);
+        auto &dropped = dropout(x, 1 - keep);
+        auto &cost = reduceSum(dropped);
+
+        const Array<T> gradient = diffTape.getGradient(x, cost);
+        const Array<T> &output = dropped.refArray();
+        long kept = 0;
+        for (long i = 0; i < 64; i++)
+            for (long j = 0; j < 37; j++)
+            {
+                const bool isKept = output[{i, j}] != 0;
+                kept += isKept;
+                TEST_LOG((!isKept || approxEqual(output[{i, j}], xBare[{i, j}] / keep)), "Dropout should scale the kept entries.");
+                TEST_LOG(approxEqual(gradient[{i, j}], isKept ? 1 / keep : T(0)), "The gradient of dropout should use the mask of the forward pass.");
+            }
+        TEST_LOG((std::abs(kept / (64.0 * 37) - keep) < 0.05), "Dropout should keep the expected fraction of entries.");
+
+        dropped.setTraining(false);
+        const Array<T> inferenceGradient = diffTape.getGradient(x, cost);
+        TEST_LOG((dropped.refArray().readDataPointer() == x.refArray().readDataPointer()), "Dropout in inference mode should pass the source through without copying.");
+        TEST_LOG((inferenceGradient == T(1)).reduceAll().eval(), "The gradient of dropout in inference mode should be passed through.");
+
+        std::cout << "Dropout test successful." << std::endl;
+    }
+
+    /// @brief Checks the output and the gradients of LayerNorm and BatchNorm against a direct computation of the normalization and central differences of it.
+    template <DataType T>
+    void normalizationTest()
+    {
+        // 21 columns, so that the kernels run through their SIMD loops and scalar tails
+        const long rows = 6, columns = 21;
+        const Array<T> xBare = (Array<T>::range(rows * columns).reshape({rows, columns}).square().sin() * T(3)) + T(1);
+        const Array<T> weights = Array<T>::range(rows * columns).reshape({rows, columns}).cos();
+        const Array<T> scaleBare = Array<T>::range(columns) * T(0.1) + T(1);
+        const Array<T> shiftBare = Array<T>::range(columns) * T(-0.05);
+
+        // The normalization of x along rows (layer) or columns (batch), weighted with weights and summed up
+        auto reference = [&](const Array<T> &x, bool layer, Array<double> &output)
+        {
+            output = Array<double>::constant({rows, columns}, 0);
+            const long groups = layer ? rows : columns, length = layer ? columns : rows;
+            double cost = 0;
+            for (long g = 0; g < groups; g++)
+            {
+                double mean = 0, variance = 0;
+                for (long k = 0; k < length; k++)
+                    mean += layer ? x[{g, k}] : x[{k, g}];
+                mean /= length;
+                for (long k = 0; k < length; k++)
+                {
+                    const double d = (layer ? x[{g, k}] : x[{k, g}]) - mean;
+                    variance += d * d;
+                }
+                variance /= length;
+                for (long k = 0; k < length; k++)
+                {
+                    const long i = layer ? g : k, j = layer ? k : g;
+                    output[{i, j}] = (x[{i, j}] - mean) / std::sqrt(variance + 1e-5) * scaleBare[{j}] + shiftBare[{j}];
+                    cost += output[{i, j}] * weights[{i, j}];
+                }
+            }
+            return cost;
+        };
+
+        for (bool layer : {true, false})
+        {
+            DiffTape<T> diffTape = DiffTape<T>();
+            auto &x = Coefficients<T>::create(diffTape, xBare);
+            auto &scale = Coefficients<T>::create(diffTape, scaleBare);
+            auto &shift = Coefficients<T>::create(diffTape, shiftBare);
+            auto &w = Coefficients<T>::create(diffTape, weights);
+            Unit<T> &normalized = layer ? static_cast<Unit<T> &>(LayerNorm<T>::create(x, scale, shift)) : static_cast<Unit<T> &>(BatchNorm<T>::create(x, scale, shift));
+            auto &cost = reduceSum(normalized * w);
+
+            const Array<T> gradient = diffTape.getGradient(x, cost);
+            Array<double> expected(0);
+            reference(xBare, layer, expected);
+            for (long i = 0; i < rows; i++)
+                for (long j = 0; j < columns; j++)
+                {
+                    TEST_LOG(approxEqual<double>(normalized.refArray()[{i, j}], expected[{i, j}]), "The normalized array is wrong.");
+
+                    Array<T> shifted = xBare.copy();
+                    const T h = 1e-2;
+                    shifted[{i, j}] = xBare[{i, j}] + h;
+                    Array<double> unused(0);
+                    const double up = reference(shifted, layer, unused);
+                    shifted[{i, j}] = xBare[{i, j}] - h;
+                    const double down = reference(shifted, layer, unused);
+                    TEST_LOG(approxEqual<double>(gradient[{i, j}], (up - down) / (2 * h), 1e-2), "The gradient of the normalized array is wrong.");
+                }
+
+            for (long j = 0; j < columns; j++)
+            {
+                double scaleGradient = 0, shiftGradient = 0;
+                for (long i = 0; i < rows; i++)
+                {
+                    scaleGradient += weights[{i, j}] * (expected[{i, j}] - shiftBare[{j}]) / scaleBare[{j}];
+                    shiftGradient += weights[{i, j}];
+                }
+                TEST_LOG(approxEqual<double>(scale.refGradient()[{j}], scaleGradient), "The gradient of the scale is wrong.");
+                TEST_LOG(approxEqual<double>(shift.refGradient()[{j}], shiftGradient), "The gradient of the shift is wrong.");
+            }
+
+            if (!layer)
+            {
+                auto &batchNorm = static_cast<BatchNorm<T> &>(normalized);
+                const Array<T> batchMean = xBare.reduceSum({0}) / T(rows);
+                for (long j = 0; j < columns; j++)
+                    TEST_LOG(approxEqual<T>(batchNorm.refRunningMean()[{j}], T(0.1) * batchMean[{j}]), "The running mean is wrong.");
+
+                batchNorm.setTraining(false);
+                diffTape.getGradient(x, cost);
+                for (long i = 0; i < rows; i++)
+                    for (long j = 0; j < columns; j++)
+                    {
+                        const T inference = (xBare[{i, j}] - batchNorm.refRunningMean()[{j}]) / std::sqrt(batchNorm.refRunningVariance()[{j}] + T(1e-5)) * scaleBare[{j}] + shiftBare[{j}];
+                        TEST_LOG(approxEqual<T>(normalized.refArray()[{i, j}], inference), "Batch normalization in inference mode should use the running statistics.");
+                    }
+            }
+        }
+
+        std::cout << "Normalization test successful." << std::endl;
+    }
+
+    template <DataType T>
+    void profilerTest()
+    {
+        DiffTape<T> diffTape = DiffTape<T>();
+        auto &input = Variables<T>::create(diffTape, {-1, 64});
+        auto &weights = Coefficients<T>::create(diffTape, Array<T>::range(32 * 64).reshape({32, 64}).sin());
+        auto &product = matvecmul(weights, input);
+        auto &cost = reduceSum(product * product);
+        input.setValue(Array<T>::range(8 * 64).reshape({8, 64}).cos());
+
+        Profiler::clear();
+        Profiler::setEnabled(true);
+        diffTape.getGradient(weights, cost);
+        Profiler::setEnabled(false);
+
+        std::stringstream trace;
+        Profiler::writeChromeTrace(trace);
+        const std::string json = trace.str();
+        TEST_LOG((json.starts_with("{\"displayTimeUnit\"") && json.ends_with("]}\n")), "The trace is not a JSON object with a list of events.");
+        for (const char *expected : {"\"cat\": \"forward\"", "\"cat\": \"backward\"", "\"name\": \"matmul\"", "\"name\": \"pointwise\"", "\"name\": \"reduce\"", "\"name\": \"allocate\"", "AutoDiff::MatrixProduct<", "\"shape\": \"[8, 32]\""})
+            TEST_LOG((json.find(expected) != std::string::npos), std::format("The trace is missing {}.", expected));
+
+        // Nothing is recorded while the profiler is disabled
+        Profiler::clear();
+        diffTape.reset();
+        diffTape.getGradient(weights, cost);
+        std::stringstream emptyTrace;
+        Profiler::writeChromeTrace(emptyTrace);
+        TEST_LOG((emptyTrace.str().find("\"ph\": \"X\"") == std::string::npos), "The disabled profiler recorded events.");
+
+        std::cout << "Profiler test successful." << std::endl;
+    }
+
+    /// @brief Checks the analytical work the model accumulates per unit against hand counts, and that the roofline report lists the units and the kernels recorded by the profiler.
+    template <DataType T>
+    void rooflineTest()
+    {
+        DiffTape<T> diffTape = DiffTape<T>();
+        auto &input = Variables<T>::create(diffTape, {-1, 20});
+        auto &labels = Variables<T>::create(diffTape, {-1, 5});
+        auto &weights = Coefficients<T>::create(diffTape, Array<T>::range(5 * 20).reshape({5, 20}).sin());
+        auto &product = matvecmul(weights, input);
+        auto &cost = MeanSquaredError<T>::create(product, labels);
+
+        auto x = Array<T>::range(64 * 20).reshape({64, 20}).cos();
+        auto y = Array<T>::range(64 * 5).reshape({64, 5}).sin();
+
+        Model model({&input, &labels}, cost, SGD<T>());
+        model.setMeasurePerformance(true);
+        Profiler::clear();
+        Profiler::setEnabled(true);
+        model.fit({x, y}, 1, 16, 1e-3, false);
+        Profiler::setEnabled(false);
+
+        TEST_LOG((model.getMeasuredPasses() == 4), "The model did not count its measured passes.");
+        const auto &units = model.refUnits();
+        const long productIndex = std::find(units.begin(), units.end(), &product) - units.begin();
+        // Four batches of 16 samples, each with 16 * 5 dot products of length 20
+        const Roofline::Work productWork = model.getCalcWork(productIndex);
+        TEST_LOG((productWork.flops == 4 * 2 * 16 * 5 * 20), "The forward work of the matrix product is wrong.");
+        TEST_LOG((productWork.bytes == 4 * (16 * 5 + 5 * 20 + 16 * 20) * sizeof(T)), "The bytes moved by the matrix product are wrong.");
+        TEST_LOG((model.getGradientWork(productIndex).flops == 2 * productWork.flops), "The backward work of the matrix product is wrong.");
+        TEST_LOG((Profiler::totals(Profiler::Category::MATMUL).flops >= productWork.flops), "The matmul kernels reported less work than the unit.");
+
+        std::stringstream report;
+        model.writeRooflineReport(report, Roofline::MachinePeak{1e11, 1e10});
+        for (const char *expected : {"ridge point 10.00", "MatrixProduct<float> forward", "MeanSquaredError<float> backward", "total", "matmul kernels", "pointwise kernels", "reduce kernels"})
+            TEST_LOG((report.str().find(expected) != std::string::npos), std::format("The roofline report is missing {}.", expected));
+
+        std::cout << "Roofline test successful." << std::endl;
+    }
+
+    /// @brief Checks that the hardware counters count the passes of a model and the profiled regions if the system allows it, and that the report explains why not otherwise.
+    template <DataType T>
+    void hardwareCounterTest()
+    {
+        DiffTape<T> diffTape = DiffTape<T>();
+        auto &input = Variables<T>::create(diffTape, {-1, 20});
+        auto &labels = Variables<T>::create(diffTape, {-1, 5});
+        auto &weights = Coefficients<T>::create(diffTape, Array<T>::range(5 * 20).reshape({5, 20}).sin());
+        auto &product = matvecmul(weights, input);
+        auto &cost = MeanSquaredError<T>::create(product, labels);
+
+        auto x = Array<T>::range(64 * 20).reshape({64, 20}).cos();
+        auto y = Array<T>::range(64 * 5).reshape({64, 5}).sin();
+
+        Model model({&input, &labels}, cost, SGD<T>());
+        model.setMeasurePerformance(true);
+        Profiler::clear();
+        Profiler::setEnabled(true);
+        HardwareCounters::setEnabled(true);
+        model.fit({x, y}, 1, 16, 1e-3, false);
+        HardwareCounters::setEnabled(false);
+        Profiler::setEnabled(false);
+
+        const auto &units = model.refUnits();
+        const long productIndex = std::find(units.begin(), units.end(), &product) - units.begin();
+        const HardwareCounters::Values counters = model.getCalcCounters(productIndex);
+        std::stringstream report;
+        model.writeCounterReport(report);
+        std::stringstream trace;
+        Profiler::writeChromeTrace(trace);
+
+        if (HardwareCounters::isAvailable())
+        {
+            TEST_LOG((counters[HardwareCounters::CYCLES] > 0 && counters[HardwareCounters::INSTRUCTIONS] > 0), "The counters did not count the forward passes of the matrix product.");
+            TEST_LOG((report.str().find("MatrixProduct<float> forward") != std::string::npos), "The counter report is missing the matrix product.");
+            TEST_LOG((trace.str().find("\"ipc\": ") != std::string::npos), "The profiled regions do not carry counters.");
+        }
+        else
+        {
+            TEST_LOG((counters[HardwareCounters::CYCLES] == 0), "Unavailable counters must read as zero.");
+            TEST_LOG((report.str().find("unavailable") != std::string::npos), "The counter report does not explain why the counters are unavailable.");
+        }
+
+        std::cout << "Hardware counter test successful." << std::endl;
+    }
+
     /// WARNING: The generated pseudorandom numbers may differ if compiler optimizations are applied, which may lead to false positive test failures
     void all()
     {
         gradientTest<float>();
         gradientTest2<float>();
+        allocationTest<float>();
+        sparseGradientTest<float>();
+        dropoutTest<float>();
+        normalizationTest<float>();
+        profilerTest<float>();
+        rooflineTest<float>();
+        hardwareCounterTest<float>();
         gradientTestMnist<float>();
         gradientTestMnist2<float>();
     }
@@ -131,6 +131,328 @@ namespace Test::Matmul
         std::cout << "Small matvecmul test passed.\n";
     }
 
+    void matmulTransposed()
+    {
+        const long m = 67;
+        const long p = 41;
+        const long n = 100;
+        RandomArrayGenerator rng;
+        // Neither operand is contiguous along the product axis, so they are packed before the product
+        auto A = rng.normal<float>({p, m}).transpose(0, 1);
+        auto B = rng.normal<float>({n, p}).transpose(0, 1);
+        auto C = ArrayLibrary::Matmul::matmul<float>(A, B);
+
+        for (int i = 0; i < m; i++)
+        {
+            for (int k = 0; k < n; k++)
+            {
+                float sum = 0;
+                for (int j = 0; j < p; j++)
+                {
+                    sum += A.get({i, j}) * B.get({j, k});
+                }
+                TEST_LOG(approxEqual(C.get({i, k}), sum), std::format("Unexpected result for indices ({},{})", i, k));
+            }
+        }
+
+        std::cout << "Transposed matmul test passed.\n";
+    }
+
+    void matmulGathered()
+    {
+        const long m = 67;
+        const long p = 5;
+        const long n = 100;
+        RandomArrayGenerator rng;
+        // The product axis is too short to pack, so the entries of the transposed operand are gathered
+        auto A = rng.normal<float>({p, m}).transpose(0, 1);
+        auto B = rng.normal<float>({n, p}).transpose(0, 1);
+        auto C = ArrayLibrary::Matmul::matmul<float>(A, B);
+
+        for (int i = 0; i < m; i++)
+        {
+            for (int k = 0; k < n; k++)
+            {
+                float sum = 0;
+                for (int j = 0; j < p; j++)
+                {
+                    sum += A.get({i, j}) * B.get({j, k});
+                }
+                TEST_LOG(approxEqual(C.get({i, k}), sum), std::format("Unexpected result for indices ({},{})", i, k));
+            }
+        }
+
+        std::cout << "Gathered matmul test passed.\n";
+    }
+
+    void sparseMatmul()
+    {
+        const long m = 600;
+        const long k = 300;
+        const long n = 70;
+        RandomArrayGenerator rng;
+        // About 13% of the entries are nonzero, and the product is large enough to be split between threads
+        auto A = rng.normal<float>({m, k});
+        A = A * Array<float>(A.abs() > 1.5f);
+        auto B = rng.normal<float>({k, n});
+        auto G = rng.normal<float>({m, n});
+
+        auto denseProduct = ArrayLibrary::Matmul::matmul<float>(A, B);
+        auto denseTransposedProduct = ArrayLibrary::Matmul::matmul<float>(A.transpose(0, 1).copy(), G);
+
+        for (SparseLayout layout : {SparseLayout::CSR, SparseLayout::COO})
+        {
+            auto S = SparseArray<float>::fromDense(A, layout);
+            TEST_LOG((S.toDense() == A).reduceAll().eval(), "Converting to a sparse array and back should give the original array");
+
+            auto C = S.matmul(B);
+            auto D = Array<float>::constant({k, n}, 0);
+            S.transposedMatmul(G, D);
+
+            for (long i = 0; i < m; i++)
+                for (long j = 0; j < n; j++)
+                    TEST_LOG(approxEqual(C.get({i, j}), denseProduct.get({i, j})), std::format("Unexpected result for indices ({},{})", i, j));
+
+            for (long i = 0; i < k; i++)
+                for (long j = 0; j < n; j++)
+                    TEST_LOG(approxEqual(D.get({i, j}), denseTransposedProduct.get({i, j})), std::format("Unexpected transposed result for indices ({},{})", i, j));
+        }
+
+        // A transposed dense operand does not have unit stride along its columns
+        auto Bt = rng.normal<float>({n, k}).transpose(0, 1);
+        auto C = SparseArray<float>::fromDense(A).matmul(Bt, false);
+        auto expected = ArrayLibrary::Matmul::matmul<float>(A, Bt.copy());
+        TEST_LOG(approxEqual(checksum(C), checksum(expected)), "Unexpected result for a transposed dense operand");
+
+        auto indices = Array<long>({3, 0, 3, 7});
+        TEST_LOG((SparseArray<float>::oneHot(indices, 8).toDense() == indices.oneHot<float>(0l, 8l)).reduceAll().eval(), "The sparse one-hot encoding should match the dense one");
+
+        std::cout << "Sparse matmul test passed.\n";
+    }
+
+    void matmulBatched()
+    {
+        using namespace ArrayLibrary::Matmul;
+        RandomArrayGenerator rng(0);
+        MatmulSettings scalar;
+        scalar.useSimd = false;
+        MatmulSettings multiThread;
+        multiThread.multiThread = true;
+
+        // Batches of small products, with a broadcast operand and a transposed one, which the small matrix kernel packs
+        const std::vector<std::pair<Array<float>, Array<float>>> operands = {
+            {rng.normal<float>({64, 12, 16}), rng.normal<float>({64, 16, 10})},
+            {rng.normal<float>({8, 8, 5, 3}), rng.normal<float>({1, 8, 3, 16})},
+            {rng.normal<float>({64, 12, 16}), rng.normal<float>({64, 10, 16}).transpose(1, 2)}};
+
+        std::vector<Array<float>> expected;
+        for (const auto &[A, B] : operands)
+        {
+            expected.push_back(matmul<float>(A, B, scalar));
+            TEST_LOG(((matmul<float>(A, B, multiThread) - expected.back()).abs().reduceMax().eval() < 1e-4f), "The batched small matrix product does not match the scalar one");
+        }
+
+        // A result that is contiguous along the rows of left is computed as the transposed product
+        auto D = Array<float>::constant({64, 10, 12}, 0).transpose(1, 2);
+        MatmulSettings keepDims;
+        keepDims.keepDims = true;
+        matmul<float>(operands[0].first, operands[0].second, &D, keepDims);
+        TEST_LOG(((D - expected[0]).abs().reduceMax().eval() < 1e-4f), "The small matrix product into a transposed destination is wrong");
+
+        // Four threads are forced through the tuning table, so that the batch is split into groups of products even on a machine with fewer cores
+        Autotuner &tuner = Autotuner::global();
+        tuner.clear();
+        tuner.setEnabled(true);
+        const MatmulConfig fourThreads{MatmulPacking::NONE, MatmulKernel::SMALL, 0, 0, 4};
+        tuner.store(Autotuner::signature<float>({64, 12, 16}, {192, 16, 1}, {64, 16, 10}, {160, 10, 1}, {64, 12, 10}, {120, 10, 1}, 2, 1, multiThread), fourThreads);
+        auto C = matmul<float>(operands[0].first, operands[0].second, multiThread);
+        TEST_LOG(((C - expected[0]).abs().reduceMax().eval() < 1e-4f), "The product split between threads does not match the scalar one");
+
+        // The products along a reduced batch axis accumulate into the same entries, so they must not be split between threads
+        MatmulSettings reduced = multiThread;
+        reduced.reduceAxes = Coordinates({0});
+        tuner.store(Autotuner::signature<float>({64, 12, 16}, {192, 16, 1}, {64, 16, 10}, {160, 10, 1}, {1, 12, 10}, {0, 10, 1}, 2, 1, reduced), fourThreads);
+        auto R = matmul<float>(operands[0].first, operands[0].second, reduced);
+        TEST_LOG(((R - expected[0].reduceSum({0})).abs().reduceMax().eval() < 1e-3f), "The product reduced over the batch does not match the scalar one");
+        TEST_LOG((tuner.size() == 2), "The stored configurations should have been used instead of tuning");
+
+        tuner.setEnabled(false);
+        tuner.clear();
+        std::cout << "Batched matmul test passed.\n";
+    }
+
+    void matmulTransposeSettings()
+    {
+        using namespace ArrayLibrary::Matmul;
+        RandomArrayGenerator rng(0);
+        MatmulSettings scalar;
+        scalar.useSimd = false;
+
+        // The shapes of the backward pass of a dense layer: the gradient with respect to the input is the product with the transposed weights, which is packed along its free axis
+        auto X = rng.normal<float>({128, 300});
+        auto W = rng.normal<float>({300, 40});
+        auto G = rng.normal<float>({128, 40});
+        MatmulSettings transposeRight;
+        transposeRight.transposeRight = true;
+        auto dX = matmul<float>(G, W, transposeRight);
+        TEST_LOG(((dX - matmul<float>(G, W.transpose(0, 1).copy(), scalar)).abs().reduceMax().eval() < 1e-3f), "The product with the transposed right operand is wrong");
+
+        MatmulSettings transposeLeft;
+        transposeLeft.transposeLeft = true;
+        auto dW = matmul<float>(X, G, transposeLeft);
+        TEST_LOG(((dW - matmul<float>(X.transpose(0, 1).copy(), G, scalar)).abs().reduceMax().eval() < 1e-3f), "The product with the transposed left operand is wrong");
+
+        // Transposing both operands of a batched product, with the left operand padded to the dimension of the right one
+        auto A = rng.normal<float>({24, 33});
+        auto B = rng.normal<float>({5, 17, 24});
+        MatmulSettings transposeBoth;
+        transposeBoth.transposeLeft = true;
+        transposeBoth.transposeRight = true;
+        auto C = matmul<float>(A, B, transposeBoth);
+        TEST_LOG(((C - matmul<float>(A.transpose(0, 1).copy(), B.transpose(1, 2).copy(), scalar)).abs().reduceMax().eval() < 1e-3f), "The product with both operands transposed is wrong");
+
+        // Every candidate of the tuner, including packing either operand along its free axis, gives the same product
+        Autotuner &tuner = Autotuner::global();
+        tuner.clear();
+        tuner.setEnabled(true);
+        auto tuned = matmul<float>(G, W, transposeRight);
+        TEST_LOG(((tuned - dX).abs().reduceMax().eval() < 1e-3f), "The tuned product with the transposed right operand is wrong");
+        tuner.setEnabled(false);
+        tuner.clear();
+
+        std::cout << "Matmul transpose settings test passed.\n";
+    }
+
+    void matmulStrassen()
+    {
+        using namespace ArrayLibrary::Matmul;
+        RandomArrayGenerator rng(0);
+        MatmulSettings strassen;
+        strassen.strassen = true;
+        // Three levels of recursion with odd axes on the lower levels, which are peeled
+        strassen.strassenCutoff = 64;
+
+        auto A = rng.normal<float>({300, 260});
+        auto B = rng.normal<float>({260, 270});
+        auto expected = ArrayLibrary::Matmul::matmul<float>(A, B);
+        auto C = ArrayLibrary::Matmul::matmul<float>(A, B, strassen);
+        TEST_LOG(((C - expected).abs().reduceMax().eval() < 1e-3f), "The Strassen product does not match the conventional one");
+
+        // Transposed operands and a transposed destination are copied to the workspace, and the product is added to the destination
+        MatmulSettings accumulate = strassen;
+        accumulate.setzero = false;
+        accumulate.keepDims = true;
+        accumulate.transposeLeft = true;
+        auto D = Array<float>::constant({270, 300}, 1).transpose(0, 1);
+        ArrayLibrary::Matmul::matmul<float>(A.transpose(0, 1).copy(), B.transpose(0, 1).copy().transpose(0, 1), &D, accumulate);
+        TEST_LOG(((D - expected - 1.0f).abs().reduceMax().eval() < 1e-3f), "The Strassen product of transposed operands is wrong");
+
+        // The parallel first level, called directly so that it runs on machines with a single core as well
+        const long n = 150;
+        auto E = rng.normal<float>({n, n});
+        auto F = rng.normal<float>({n, n});
+        auto P = ArrayLibrary::Matmul::matmul<float>(E, F);
+        std::vector<float> e(n * n), f(n * n), p(n * n, 0);
+        for (long i = 0; i < n; i++)
+            for (long j = 0; j < n; j++)
+            {
+                e[i * n + j] = E.get({i, j});
+                f[i * n + j] = F.get({i, j});
+            }
+        strassenParallel<float>(e.data(), n, f.data(), n, p.data(), n, n, n, n, 64, MatmulKernel::RIGHT_FREE_AXIS, StrassenWorkspace<float>::local());
+        float difference = 0;
+        for (long i = 0; i < n; i++)
+            for (long j = 0; j < n; j++)
+                difference = std::max(difference, std::abs(p[i * n + j] - P.get({i, j})));
+        TEST_LOG((difference < 1e-3f), "The parallel Strassen product does not match the conventional one");
+
+        std::cout << "Strassen matmul test passed.\n";
+    }
+
+    void matmulSummation()
+    {
+        using namespace ArrayLibrary::Matmul;
+        // Long product axes of 0.1f, whose naive sums lose digits, with a partial last block and a transposed operand
+        const long k = 100003;
+        auto A = Array<float>::constant({3, k}, 0.1f);
+        auto B = Array<float>::constant({5, k}, 1.0f).transpose(0, 1);
+        const double expected = k * (double)0.1f;
+        auto error = [&](const Array<float> &C)
+        { return (C - (float)expected).abs().reduceMax().eval() / expected; };
+
+        const double naive = error(ArrayLibrary::Matmul::matmul<float>(A, B));
+        for (Summation summation : {Summation::PAIRWISE, Summation::KAHAN})
+        {
+            MatmulSettings settings;
+            settings.summation = summation;
+            auto C = ArrayLibrary::Matmul::matmul<float>(A, B, settings);
+            TEST_LOG((C.refShape() == Coordinates({3, 5})), "The summed product has the wrong shape");
+            TEST_LOG((error(C) < 1e-6 && error(C) <= naive), "The summed product is inaccurate");
+
+            // The blocks accumulate into the destination
+            settings.setzero = false;
+            auto D = Array<float>::constant({3, 5}, 1.0f);
+            ArrayLibrary::Matmul::matmul<float>(A, B, &D, settings);
+            TEST_LOG((((D - 1.0f) - C).abs().reduceMax().eval() < 1e-2f), "The summed product does not accumulate into the destination");
+        }
+
+        std::cout << "Summed matmul test passed.\n";
+    }
+
+    void matmulAutotune()
+    {
+        using ArrayLibrary::Matmul::Autotuner;
+        using ArrayLibrary::Matmul::MatmulSettings;
+        Autotuner &tuner = Autotuner::global();
+        tuner.clear();
+
+        RandomArrayGenerator rng(0);
+        const std::vector<std::pair<Array<float>, Array<float>>> operands = {
+            {rng.normal<float>({67, 41}), rng.normal<float>({41, 100})},
+            {rng.normal<float>({41, 67}).transpose(0, 1), rng.normal<float>({100, 41}).transpose(0, 1)},
+            {rng.normal<float>({5, 67}).transpose(0, 1), rng.normal<float>({100, 5}).transpose(0, 1)},
+            {rng.normal<float>({1, 300}), rng.normal<float>({300, 200})}};
+        MatmulSettings multiThread;
+        multiThread.multiThread = true;
+
+        std::vector<Array<float>> expected;
+        for (const auto &[A, B] : operands)
+            expected.push_back(ArrayLibrary::Matmul::matmul<float>(A, B));
+
+        tuner.setEnabled(true);
+        for (long pass = 0; pass < 2; pass++)
+            for (long i = 0; i < (long)operands.size(); i++)
+                for (const MatmulSettings &settings : {MatmulSettings(), multiThread})
+                {
+                    auto C = ArrayLibrary::Matmul::matmul<float>(operands[i].first, operands[i].second, settings);
+                    TEST_LOG(((C - expected[i]).abs().reduceMax().eval() < 1e-3f), std::format("The tuned product {} does not match the default one", i));
+                }
+        // Every signature is tuned once, and the second pass finds all of them in the table
+        TEST_LOG((tuner.size() == 2 * operands.size()), std::format("Expected {} tuned signatures, found {}", 2 * operands.size(), tuner.size()));
+
+        // The timed candidates must not leave their sums in a destination that is accumulated into
+        MatmulSettings accumulate;
+        accumulate.setzero = false;
+        auto D = Array<float>::constant({67, 100}, 1);
+        ArrayLibrary::Matmul::matmul<float>(operands[0].first, operands[0].second, &D, accumulate);
+        TEST_LOG(((D - expected[0] - 1.0f).abs().reduceMax().eval() < 1e-3f), "Tuning a product that accumulates into its destination changed the result");
+
+        const std::string path = (std::filesystem::temp_directory_path() / "matmul_autotune_test.txt").string();
+        const auto signature = Autotuner::signature<float>({67, 41}, {41, 1}, {41, 100}, {100, 1}, {67, 100}, {100, 1}, 1, 0, MatmulSettings());
+        const auto config = tuner.find(signature);
+        TEST_LOG((config.has_value()), "The product of contiguous operands should have been tuned");
+        tuner.save(path);
+        const size_t size = tuner.size();
+        tuner.clear();
+        tuner.load(path);
+        std::filesystem::remove(path);
+        TEST_LOG((tuner.size() == size && tuner.find(signature) == config), "Loading the saved table should restore the tuned configurations");
+
+        tuner.setEnabled(false);
+        tuner.clear();
+        std::cout << "Matmul autotune test passed.\n";
+    }
+
     void all()
     {
         matmulSmall();
@@ -138,6 +460,14 @@ namespace Test::Matmul
         matmulOuter();
         matvecmulSmall();
         matvecmul();
+        matmulTransposed();
+        matmulGathered();
+        sparseMatmul();
+        matmulBatched();
+        matmulTransposeSettings();
+        matmulStrassen();
+        matmulSummation();
+        matmulAutotune();
     }
 }
 
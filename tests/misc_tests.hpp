@@ -98,6 +98,240 @@ namespace Test
         LOG_TIME(reduceMeasure.accumulated);
     }
 
+    template <DataType T>
+    void broadcastAddPerf()
+    {
+        RandomArrayGenerator randomArrayGenerator(0);
+        auto A = randomArrayGenerator.normal<T>({512, 384}, 0, 1);
+        auto b = randomArrayGenerator.normal<T>({1, 384}, 0, 1);
+        auto result = Array<T>::empty({512, 384});
+
+        PerformanceMeasure addMeasure;
+
+        for (int i = 0; i < 100; i++)
+        {
+            addMeasure.start();
+            computeInPlace<Addition<T>>(result, A, b);
+            addMeasure.stop();
+        }
+
+        LOG(result.reduceSum().eval());
+        LOG_TIME(addMeasure.accumulated);
+    }
+
+    template <DataType T>
+    void batchedReducePerf()
+    {
+        RandomArrayGenerator randomArrayGenerator(0);
+        auto A = randomArrayGenerator.normal<T>({64, 128, 96}, 0, 1);
+        auto rowSums = Array<T>::empty({64, 128});
+        auto columnSums = Array<T>::empty({64, 96});
+
+        PerformanceMeasure rowMeasure;
+        PerformanceMeasure columnMeasure;
+
+        for (int i = 0; i < 100; i++)
+        {
+            rowMeasure.start();
+            A.reduceSum({2}, rowSums);
+            rowMeasure.stop();
+
+            columnMeasure.start();
+            A.reduceSum({1}, columnSums);
+            columnMeasure.stop();
+        }
+
+        LOG(rowSums.reduceSum().eval());
+        LOG(columnSums.reduceSum().eval());
+        LOG_TIME(rowMeasure.accumulated);
+        LOG_TIME(columnMeasure.accumulated);
+    }
+
+    template <DataType T>
+    void transposeCopyPerf()
+    {
+        RandomArrayGenerator randomArrayGenerator(0);
+        auto A = randomArrayGenerator.normal<T>({16, 256, 384}, 0, 1);
+        auto transposed = A.transpose(1, 2);
+
+        PerformanceMeasure tiledMeasure;
+        PerformanceMeasure pointwiseMeasure;
+
+        for (int i = 0; i < 20; i++)
+        {
+            tiledMeasure.start();
+            Array<T> tiled = transposed.copy();
+            tiledMeasure.stop();
+
+            pointwiseMeasure.start();
+            Array<T> pointwise = compute<Copy<T>>(transposed);
+            pointwiseMeasure.stop();
+        }
+
+        LOG(transposed.copy().reduceSum().eval());
+        LOG_TIME(tiledMeasure.accumulated);
+        LOG_TIME(pointwiseMeasure.accumulated);
+    }
+
+    template <DataType T>
+    void stridedPointwisePerf()
+    {
+        RandomArrayGenerator randomArrayGenerator(0);
+        auto largeA = randomArrayGenerator.normal<T>({1024, 1024}, 0, 1);
+        auto largeB = randomArrayGenerator.normal<T>({1024, 1024}, 0, 1);
+        auto smallA = randomArrayGenerator.normal<T>({96, 96}, 0, 1);
+        auto smallB = randomArrayGenerator.normal<T>({96, 96}, 0, 1);
+        auto largeResult = Array<T>::empty({1024, 1024});
+        auto smallResult = Array<T>::empty({96, 96});
+
+        PerformanceMeasure largeMeasure;
+        PerformanceMeasure smallMeasure;
+
+        for (int i = 0; i < 20; i++)
+        {
+            largeMeasure.start();
+            computeInPlace<Addition<T>>(largeResult, largeA.transpose(0, 1), largeB);
+            largeMeasure.stop();
+
+            smallMeasure.start();
+            for (int j = 0; j < 100; j++)
+                computeInPlace<Addition<T>>(smallResult, smallA.transpose(0, 1), smallB);
+            smallMeasure.stop();
+        }
+
+        LOG(largeResult.reduceSum().eval());
+        LOG(smallResult.reduceSum().eval());
+        LOG_TIME(largeMeasure.accumulated);
+        LOG_TIME(smallMeasure.accumulated);
+    }
+
+    template <DataType T>
+    void sparseMatmulPerf()
+    {
+        RandomArrayGenerator randomArrayGenerator(0);
+        std::vector<long> ids(256);
+        for (long i = 0; i < 256; i++)
+            ids[i] = i * 7919 % 20000;
+        auto indices = Array<long>(Data<long>(ids));
+        auto table = randomArrayGenerator.normal<T>({20000, 64}, 0, 1);
+        auto dense = indices.template oneHot<T>(0l, 20000l);
+        auto sparse = SparseArray<T>::oneHot(indices, 20000);
+        auto denseResult = Array<T>::empty({256, 64});
+        auto sparseResult = Array<T>::empty({256, 64});
+
+        PerformanceMeasure denseMeasure;
+        PerformanceMeasure sparseMeasure;
+
+        for (int i = 0; i < 20; i++)
+        {
+            denseMeasure.start();
+            Matmul::matmul<T>(dense, table, &denseResult, Matmul::MatmulSettings());
+            denseMeasure.stop();
+
+            sparseMeasure.start();
+            sparse.matmul(table, sparseResult);
+            sparseMeasure.stop();
+        }
+
+        LOG(denseResult.reduceSum().eval());
+        LOG(sparseResult.reduceSum().eval());
+        LOG_TIME(denseMeasure.accumulated);
+        LOG_TIME(sparseMeasure.accumulated);
+    }
+
+    template <DataType T>
+    void randomPerf()
+    {
+        RandomArrayGenerator serial(0), parallel(0);
+        serial.setMultiThread(false);
+        PerformanceMeasure serialMeasure;
+        PerformanceMeasure parallelMeasure;
+
+        T serialSum = 0;
+        T parallelSum = 0;
+        for (int i = 0; i < 10; i++)
+        {
+            serialMeasure.start();
+            auto serialArray = serial.normal<T>({0x400000});
+            serialMeasure.stop();
+
+            parallelMeasure.start();
+            auto parallelArray = parallel.normal<T>({0x400000});
+            parallelMeasure.stop();
+
+            serialSum += serialArray.reduceSum().eval();
+            parallelSum += parallelArray.reduceSum().eval();
+        }
+
+        LOG(serialSum);
+        LOG(parallelSum);
+        LOG_TIME(serialMeasure.accumulated);
+        LOG_TIME(parallelMeasure.accumulated);
+    }
+
+    template <DataType T>
+    void normalizationPerf()
+    {
+        RandomArrayGenerator randomArrayGenerator(0);
+        const long rows = 4096, columns = 512;
+        auto x = randomArrayGenerator.normal<T>({rows, columns}, 1, 2);
+        auto scale = Array<T>::constant({columns}, 1);
+        auto shift = Array<T>::constant({columns}, 0);
+        Array<T> composed(0);
+        Array<T> fused = Array<T>::empty({rows, columns});
+        Array<T> mean = Array<T>::empty({rows});
+        Array<T> inverseStd = Array<T>::empty({rows});
+
+        PerformanceMeasure composedMeasure;
+        PerformanceMeasure fusedMeasure;
+        for (int i = 0; i < 10; i++)
+        {
+            composedMeasure.start();
+            auto centered = x - x.reduceSum({1}, true) / T(columns);
+            auto variance = (centered * centered).reduceSum({1}, true) / T(columns);
+            composed = centered / (variance + T(1e-5)).sqrt() * scale + shift;
+            composedMeasure.stop();
+
+            fusedMeasure.start();
+            Normalization<T>::normalizeRows(x, scale, shift, T(1e-5), fused, mean, inverseStd);
+            fusedMeasure.stop();
+        }
+
+        LOG(checksum(composed));
+        LOG(checksum(fused));
+        LOG_TIME(composedMeasure.accumulated);
+        LOG_TIME(fusedMeasure.accumulated);
+    }
+
+    template <DataType T>
+    void rooflinePerf()
+    {
+        using LayerSettings = LinearLayer<T>::template Settings<T>;
+        using Activation = LinearLayer<T>::Activation;
+
+        RandomArrayGenerator randomArrayGenerator(0);
+        DiffTape<T> diffTape = DiffTape<T>();
+        auto &input = Variables<T>::create(diffTape, {-1, 784});
+        auto &labels = Variables<T>::create(diffTape, {-1, 10});
+        auto layer1 = LinearLayer<T>::create(input, LayerSettings(512, Activation::LEAKYRELU, T(0.01)));
+        auto layer2 = LinearLayer<T>::create(layer1, LayerSettings(10, Activation::NONE, T(0.01)));
+        auto &sftm = Softermax<T>::create(layer2, {-1});
+        auto &cost = MeanSquaredError<T>::create(sftm, labels);
+
+        auto x = randomArrayGenerator.uniform<T>({4096, 784}, 0, 1);
+        auto y = randomArrayGenerator.uniform<T>({4096, 10}, 0, 1);
+
+        Model model({&input, &labels}, cost, Adam<T>());
+        model.fit({x, y}, 1, 256, 1e-3, false);
+        model.setMeasurePerformance(true);
+        Profiler::clear();
+        Profiler::setEnabled(true);
+        model.fit({x, y}, 2, 256, 1e-3, false);
+        Profiler::setEnabled(false);
+
+        model.writeRooflineReport(std::cout);
+    }
+
     template <DataType T>
     void concurrencyTest()
     {
@@ -123,6 +357,30 @@ namespace Test
         std::cout << singleMeasure.accumulated << std::endl;
     }
 
+    void sharedDataTest()
+    {
+        const long threadCount = 8;
+        const long copiesPerThread = 100000;
+
+        Array<float> a = Array<float>::range(16);
+
+        std::vector<std::thread> threads;
+        for (long t = 0; t < threadCount; t++)
+            threads.emplace_back([&a, copiesPerThread]()
+                                 {
+                                     for (long i = 0; i < copiesPerThread; i++)
+                                     {
+                                         Array<float> copy = a;
+                                         Array<float> view = copy.reshape({4, 4});
+                                     } });
+
+        for (auto &thread : threads)
+            thread.join();
+
+        TEST_LOG((a.useCount() == 1), "Reference count of shared data is wrong after concurrent copies");
+        std::cout << "Shared data test passed." << std::endl;
+    }
+
     void printingTest()
     {
         auto A = Array<int>::range(18).reshape({3, 2, 3});
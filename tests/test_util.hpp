@@ -5,6 +5,7 @@
 #include <cmath>
 #include <vector>
 #include <string>
+#include <sstream>
 #include <initializer_list>
 #include <stdexcept>
 #include <cstdarg>
@@ -18,6 +19,7 @@
 #include <utility>
 #include <memory>
 #include <bitset>
+#include <filesystem>
 
 #include "../array/array_library.hpp"
 #include "../autodiff/autodiff.hpp"